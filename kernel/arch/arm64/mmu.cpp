@@ -505,6 +505,57 @@ void ArmArchVmAspace::FlushTLBEntry(vaddr_t vaddr, bool terminal) {
     }
 }
 
+// Replace the block descriptor at |pte|, which maps the block containing
+// |vaddr|, with a table of next level descriptors covering the same physical
+// range with the same attributes. Used when only part of a block is being
+// unmapped or reprotected.
+zx_status_t ArmArchVmAspace::SplitBlock(vaddr_t vaddr, uint index_shift, uint page_size_shift,
+                                        volatile pte_t* pte) {
+    const pte_t block = *pte;
+
+    DEBUG_ASSERT(index_shift > page_size_shift);
+    DEBUG_ASSERT((block & MMU_PTE_DESCRIPTOR_MASK) == MMU_PTE_L012_DESCRIPTOR_BLOCK);
+
+    paddr_t table_paddr;
+    zx_status_t status = AllocPageTable(&table_paddr, page_size_shift);
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    const uint next_index_shift = index_shift - (page_size_shift - 3);
+    const size_t next_block_size = 1UL << next_index_shift;
+    const size_t count = 1UL << (page_size_shift - 3);
+    const paddr_t paddr = block & MMU_PTE_OUTPUT_ADDR_MASK;
+    pte_t attrs = block & ~(MMU_PTE_OUTPUT_ADDR_MASK | MMU_PTE_DESCRIPTOR_MASK);
+    if (next_index_shift > page_size_shift)
+        attrs |= MMU_PTE_L012_DESCRIPTOR_BLOCK;
+    else
+        attrs |= MMU_PTE_L3_DESCRIPTOR_PAGE;
+
+    volatile pte_t* table = static_cast<volatile pte_t*>(paddr_to_physmap(table_paddr));
+    for (size_t i = 0; i < count; i++) {
+        table[i] = (paddr + i * next_block_size) | attrs;
+    }
+
+    LTRACEF("split block %#" PRIx64 " at vaddr %#" PRIxPTR " into table %#" PRIxPTR "\n",
+            block, vaddr, table_paddr);
+
+    // The architecture requires break-before-make when changing the size of a
+    // translation, so invalidate the block and flush it before installing the
+    // table. Accesses in the window fault and are retried by the caller's fault path.
+    *pte = MMU_PTE_DESCRIPTOR_INVALID;
+    __dmb(ARM_MB_ISHST);
+    FlushTLBEntry(vaddr, true);
+    __dsb(ARM_MB_SY);
+
+    *pte = table_paddr | MMU_PTE_L012_DESCRIPTOR_TABLE;
+
+    // ensure that the update is observable from hardware page table walkers
+    __dmb(ARM_MB_ISHST);
+
+    return ZX_OK;
+}
+
 // NOTE: caller must DSB afterwards to ensure TLB entries are flushed
 ssize_t ArmArchVmAspace::UnmapPageTable(vaddr_t vaddr, vaddr_t vaddr_rel,
                                         size_t size, uint index_shift,
@@ -533,6 +584,20 @@ ssize_t ArmArchVmAspace::UnmapPageTable(vaddr_t vaddr, vaddr_t vaddr_rel,
 
         pte = page_table[index];
 
+        if (index_shift > page_size_shift && chunk_size != block_size &&
+            (pte & MMU_PTE_DESCRIPTOR_MASK) == MMU_PTE_L012_DESCRIPTOR_BLOCK) {
+            // Only part of this block is being unmapped; split it so the rest
+            // stays mapped. If that fails the whole block is dropped, which is
+            // safe since the pages can be faulted back in.
+            if (SplitBlock(vaddr - vaddr_rem, index_shift, page_size_shift,
+                           &page_table[index]) == ZX_OK) {
+                pte = page_table[index];
+            } else {
+                TRACEF("failed to split block at vaddr %#" PRIxPTR ", unmapping it\n",
+                       vaddr - vaddr_rem);
+            }
+        }
+
         if (index_shift > page_size_shift &&
             (pte & MMU_PTE_DESCRIPTOR_MASK) == MMU_PTE_L012_DESCRIPTOR_TABLE) {
             page_table_paddr = pte & MMU_PTE_OUTPUT_ADDR_MASK;
@@ -697,6 +762,15 @@ int ArmArchVmAspace::ProtectPageTable(vaddr_t vaddr_in, vaddr_t vaddr_rel_in,
         index = vaddr_rel >> index_shift;
         pte = page_table[index];
 
+        if (index_shift > page_size_shift && chunk_size != block_size &&
+            (pte & MMU_PTE_DESCRIPTOR_MASK) == MMU_PTE_L012_DESCRIPTOR_BLOCK) {
+            if (SplitBlock(vaddr - vaddr_rem, index_shift, page_size_shift,
+                           &page_table[index]) != ZX_OK) {
+                goto err;
+            }
+            pte = page_table[index];
+        }
+
         if (index_shift > page_size_shift &&
             (pte & MMU_PTE_DESCRIPTOR_MASK) == MMU_PTE_L012_DESCRIPTOR_TABLE) {
             page_table_paddr = pte & MMU_PTE_OUTPUT_ADDR_MASK;
@@ -934,18 +1008,26 @@ zx_status_t ArmArchVmAspace::Map(vaddr_t vaddr, paddr_t* phys, size_t count, uin
         });
 
         vaddr_t v = vaddr;
-        for (; idx < count; ++idx) {
+        while (idx < count) {
+            // Map physically contiguous runs in one call so that aligned runs
+            // are installed as block descriptors.
+            size_t run = 1;
+            while (idx + run < count && phys[idx + run] == phys[idx] + run * PAGE_SIZE) {
+                ++run;
+            }
+
             paddr_t paddr = phys[idx];
             DEBUG_ASSERT(IS_PAGE_ALIGNED(paddr));
             // TODO: optimize by not DSBing inside each of these calls
-            ret = MapPages(v, paddr, PAGE_SIZE,
+            ret = MapPages(v, paddr, run * PAGE_SIZE,
                            attrs, vaddr_base, top_size_shift,
                            top_index_shift, page_size_shift);
             if (ret < 0) {
                 return static_cast<zx_status_t>(ret);
             }
 
-            v += PAGE_SIZE;
+            idx += run;
+            v += run * PAGE_SIZE;
             total_mapped += ret / PAGE_SIZE;
         }
         undo.cancel();
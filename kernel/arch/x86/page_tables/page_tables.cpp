@@ -853,8 +853,9 @@ zx_status_t X86PageTableBase::MapPages(vaddr_t vaddr, paddr_t* phys, size_t coun
         fbl::AutoLock a(&lock_);
         DEBUG_ASSERT(virt_);
 
-        // TODO(teisenbe): Improve performance of this function by integrating deeper into
-        // the algorithm (e.g. make the cursors aware of the page array).
+        // Physically contiguous runs in |phys| are handed to AddMapping as a
+        // single cursor so that suitably aligned runs are mapped with large
+        // pages rather than one 4k entry at a time.
         size_t idx = 0;
         auto undo = fbl::MakeAutoCall([&]() TA_NO_THREAD_SAFETY_ANALYSIS {
             if (idx > 0) {
@@ -870,9 +871,14 @@ zx_status_t X86PageTableBase::MapPages(vaddr_t vaddr, paddr_t* phys, size_t coun
         });
 
         vaddr_t v = vaddr;
-        for (; idx < count; ++idx) {
+        while (idx < count) {
+            size_t run = 1;
+            while (idx + run < count && phys[idx + run] == phys[idx] + run * PAGE_SIZE) {
+                ++run;
+            }
+
             MappingCursor start = {
-                .paddr = phys[idx], .vaddr = v, .size = PAGE_SIZE,
+                .paddr = phys[idx], .vaddr = v, .size = run * PAGE_SIZE,
             };
             MappingCursor result;
             zx_status_t status = AddMapping(virt_, mmu_flags, top, start, &result, &cm);
@@ -882,7 +888,8 @@ zx_status_t X86PageTableBase::MapPages(vaddr_t vaddr, paddr_t* phys, size_t coun
             }
             DEBUG_ASSERT(result.size == 0);
 
-            v += PAGE_SIZE;
+            idx += run;
+            v += run * PAGE_SIZE;
         }
 
         undo.cancel();
@@ -27,6 +27,10 @@ struct percpu {
     struct list_node run_queue[NUM_PRIORITIES];
     uint32_t run_queue_bitmap;
 
+    // the thread currently running on this cpu, published for code outside the thread lock
+    // that only compares it (see mutex_spin). Never dereference it without the thread lock.
+    uintptr_t running_thread;
+
 #if WITH_LOCK_DEP
     // state for runtime lock validation when in irq context
     lockdep_state_t lock_state;
@@ -9,19 +9,107 @@
 
 #include <kernel/mutex.h>
 
+#include <arch/ops.h>
 #include <assert.h>
 #include <debug.h>
 #include <err.h>
 #include <inttypes.h>
+#include <kernel/atomic.h>
+#include <kernel/cmdline.h>
+#include <kernel/mp.h>
+#include <kernel/percpu.h>
 #include <kernel/sched.h>
 #include <kernel/thread.h>
 #include <kernel/thread_lock.h>
+#include <lib/counters.h>
 #include <lib/ktrace.h>
+#include <lk/init.h>
+#include <platform.h>
 #include <trace.h>
+#include <zircon/time.h>
 #include <zircon/types.h>
 
 #define LOCAL_TRACE 0
 
+KCOUNTER(mutex_spin_success, "kernel.mutex.spin.success");
+KCOUNTER(mutex_spin_failure, "kernel.mutex.spin.failure");
+
+// The longest a thread will spin on a contended mutex before blocking, set by
+// kernel.mutex-spin-max-ns.  Zero disables spinning.
+static zx_duration_t mutex_spin_max_duration = ZX_USEC(10);
+
+static void mutex_init_spin(uint level) {
+    mutex_spin_max_duration = cmdline_get_uint64("kernel.mutex-spin-max-ns",
+                                                 mutex_spin_max_duration);
+}
+
+LK_INIT_HOOK(mutex_spin, mutex_init_spin, LK_INIT_LEVEL_THREADING);
+
+// Returns the cpu other than the current one whose published running thread is
+// |holder|, or INVALID_CPU.  The holder value is only ever compared against the
+// per-cpu slots, never dereferenced: without the thread lock it may already
+// have exited and been freed.
+static cpu_num_t mutex_holder_cpu(uintptr_t holder) {
+    const cpu_num_t curr_cpu = arch_curr_cpu_num();
+    for (cpu_num_t i = 0; i < arch_max_num_cpus(); i++) {
+        if (i != curr_cpu && atomic_load_u64_relaxed(&percpu[i].running_thread) == holder) {
+            return i;
+        }
+    }
+    return INVALID_CPU;
+}
+
+// Spins on a contended mutex for as long as its holder is running on another
+// cpu, up to mutex_spin_max_duration, on the theory that the holder will
+// release it sooner than it would take us to block and be woken.  Returns
+// true if the mutex was acquired.
+static bool mutex_spin(mutex_t* m, thread_t* ct) {
+    if (mutex_spin_max_duration == 0) {
+        return false;
+    }
+
+    const zx_time_t deadline = zx_time_add_duration(current_time(), mutex_spin_max_duration);
+    uintptr_t holder = 0;
+    cpu_num_t holder_cpu = INVALID_CPU;
+    for (;;) {
+        uintptr_t oldval = mutex_val(m);
+        if (oldval == 0) {
+            if (atomic_cmpxchg_u64(&m->val, &oldval, (uintptr_t)ct)) {
+                kcounter_add(mutex_spin_success, 1);
+                return true;
+            }
+            continue;
+        }
+
+        // Once a thread has queued, the holder hands the mutex directly to
+        // it on release, so there is nothing to gain by spinning.
+        if (oldval & MUTEX_FLAG_QUEUED) {
+            break;
+        }
+
+        // Look the holder up in the per-cpu running thread slots when it
+        // changes, and after that only recheck the slot it was found in.
+        // The answer may be stale, which only affects how long we spin; the
+        // mutex itself is only ever claimed by the cmpxchg.
+        if (oldval != holder) {
+            holder = oldval;
+            holder_cpu = mutex_holder_cpu(holder);
+        } else if (atomic_load_u64_relaxed(&percpu[holder_cpu].running_thread) != holder) {
+            holder_cpu = INVALID_CPU;
+        }
+        if (holder_cpu == INVALID_CPU) {
+            break;
+        }
+        if (current_time() >= deadline) {
+            break;
+        }
+        arch_spinloop_pause();
+    }
+
+    kcounter_add(mutex_spin_failure, 1);
+    return false;
+}
+
 /**
  * @brief  mutex_t destructor
  *
@@ -72,6 +160,11 @@ retry:
               ct, ct->name, m);
 #endif
 
+    if (mutex_spin(m, ct)) {
+        ct->mutexes_held++;
+        return;
+    }
+
     {
         // we contended with someone else, will probably need to block
         Guard<spin_lock_t, IrqSave> guard{ThreadLock::Get()};
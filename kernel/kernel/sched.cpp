@@ -5,6 +5,7 @@
 #include <debug.h>
 #include <err.h>
 #include <inttypes.h>
+#include <kernel/atomic.h>
 #include <kernel/mp.h>
 #include <kernel/percpu.h>
 #include <kernel/thread.h>
@@ -890,6 +891,8 @@ void sched_resched_internal() {
         vmm_context_switch(oldthread->aspace, newthread->aspace);
     }
 
+    atomic_store_u64_relaxed(&percpu[cpu].running_thread, (uintptr_t)newthread);
+
     // do the low level context switch
     final_context_switch(oldthread, newthread);
 }
@@ -978,6 +978,7 @@ void thread_construct_first(thread_t* t, const char* name) {
 
     arch_thread_construct_first(t);
     set_current_thread(t);
+    atomic_store_u64_relaxed(&percpu[cpu].running_thread, (uintptr_t)t);
 
     Guard<spin_lock_t, IrqSave> guard{ThreadLock::Get()};
     list_add_head(&thread_list, &t->thread_list_node);
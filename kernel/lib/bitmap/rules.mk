@@ -11,5 +11,6 @@ MODULE_DEPS := kernel/lib/fbl
 MODULE_SRCS := \
     $(SRC_DIR)/raw-bitmap.cpp \
     $(SRC_DIR)/rle-bitmap.cpp \
+    $(SRC_DIR)/summary.cpp \
 
 include make/module.mk
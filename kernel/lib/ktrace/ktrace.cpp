@@ -2,12 +2,20 @@
 #include <debug.h>
 #include <err.h>
 #include <platform.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <arch/ops.h>
 #include <arch/user_copy.h>
+#include <fbl/algorithm.h>
+#include <fbl/atomic.h>
+#include <fbl/auto_lock.h>
+#include <fbl/mutex.h>
 #include <hypervisor/ktrace.h>
+#include <kernel/align.h>
+#include <kernel/atomic.h>
 #include <kernel/cmdline.h>
+#include <kernel/thread.h>
 #include <lib/ktrace.h>
 #include <lk/init.h>
 #include <object/thread_dispatcher.h>
@@ -70,41 +78,254 @@ static void ktrace_report_probes(void) {
     }
 }
 
-typedef struct ktrace_state {
-    // where the next record will be written
-    int offset;
+// Records are written to per-cpu rings, so that writers on different cpus never contend
+// for a cache line. Each ring is divided into blocks, and records never straddle a block
+// boundary, so the first record of any block can be found even after the ring has wrapped.
+//
+// Name records carry no timestamp, and are needed to interpret everything else in the
+// trace, so they are kept in a separate metadata buffer which is never overwritten.
+//
+// In circular ("flight recorder") mode, each ring overwrites its oldest blocks once it is
+// full; otherwise tracing stops as soon as any ring fills. The trace is read from a
+// snapshot, which merges the metadata and the rings, in timestamp order, into a single
+// buffer. KTRACE_ACTION_STOP and KTRACE_ACTION_SNAPSHOT take a snapshot.
+//
+// A snapshot must not copy records which are still being written. Writers count themselves
+// in a per-cpu count of writers in flight for as long as they touch the buffers, and the
+// snapshot waits for those counts to drain after pausing tracing.
+
+static constexpr uint64_t kBlockSize = PAGE_SIZE;
+
+// Tag of a record which pads out unused space in a ring. Group 0 is never enabled, so
+// padding is never mistaken for an event.
+#define KTRACE_TAG_PAD(siz) KTRACE_TAG(0, 0, siz)
+
+typedef struct __CPU_ALIGN ktrace_cpu_state {
+    // total bytes ever reserved in this ring; the next record is written at
+    // head % ring_size
+    fbl::atomic<uint64_t> head;
+
+    // number of writers which started on this cpu and have not finished
+    fbl::atomic<uint32_t> writers;
+
+    // raw ring buffer
+    uint8_t* buffer;
+} ktrace_cpu_state_t;
 
+typedef struct ktrace_state {
     // mask of groups we allow, 0 == tracing disabled
     int grpmask;
 
-    // total size of the trace buffer
-    uint32_t bufsize;
+    // nonzero if full rings overwrite their oldest records
+    int circular;
 
-    // offset where tracing was stopped, 0 if tracing active
-    uint32_t marker;
+    // where the next name record will be written in the metadata buffer
+    int meta_offset;
 
-    // raw trace buffer
-    uint8_t* buffer;
+    // total size of the metadata buffer
+    uint32_t meta_size;
+
+    // version, ticks-per-ms and name records
+    uint8_t* meta;
+
+    // number of rings, and size of each (a multiple of kBlockSize)
+    uint32_t cpu_count;
+    uint64_t ring_size;
+
+    // size of the metadata buffer and all rings together
+    size_t bufsize;
+
+    ktrace_cpu_state_t cpu[SMP_MAX_CPUS];
 } ktrace_state_t;
 
 static ktrace_state_t KTRACE_STATE;
 
-ssize_t ktrace_read_user(void* ptr, uint32_t off, size_t len) {
-    ktrace_state_t* ks = &KTRACE_STATE;
+// Serializes control actions and reads, and guards the snapshot.
+static fbl::Mutex ktrace_lock;
+
+// The trace as of the last snapshot.
+static uint8_t* snapshot_buffer TA_GUARDED(ktrace_lock);
+static size_t snapshot_len TA_GUARDED(ktrace_lock);
+
+// Marks |len| bytes of |cs|'s ring, starting at |off|, as padding.
+static void ktrace_pad(ktrace_state_t* ks, ktrace_cpu_state_t* cs, uint64_t off, uint64_t len) {
+    DEBUG_ASSERT(len > 0 && len <= KTRACE_LEN(0xF));
+    *reinterpret_cast<uint32_t*>(cs->buffer + off % ks->ring_size) =
+        KTRACE_TAG_PAD(static_cast<uint32_t>(len));
+}
+
+// Counts a writer in flight on the current cpu until the matching ktrace_end_write, and
+// returns that cpu's state. The writer may migrate in between, so it must keep using the
+// returned state rather than the state of whichever cpu it ends up on.
+static ktrace_cpu_state_t* ktrace_begin_write(ktrace_state_t* ks) {
+    ktrace_cpu_state_t* cs = &ks->cpu[arch_curr_cpu_num()];
+    cs->writers.fetch_add(1);
+    return cs;
+}
+
+static void ktrace_end_write(ktrace_cpu_state_t* cs) {
+    cs->writers.fetch_sub(1, fbl::memory_order_release);
+}
+
+// Waits for every writer in flight to finish. Writers which start later must find tracing
+// paused, or only write records which the caller will not read.
+static void ktrace_drain_writers(ktrace_state_t* ks) {
+    for (uint32_t i = 0; i < ks->cpu_count; i++) {
+        while (ks->cpu[i].writers.load(fbl::memory_order_acquire) != 0) {
+            // The writer may be a preempted thread, so give it a chance to run.
+            thread_sleep_relative(ZX_USEC(10));
+        }
+    }
+}
 
-    // Buffer size is limited by the marker if set,
-    // otherwise limited by offset (last written point).
-    // Offset can end up pointing past the end, so clip
-    // it to the actual buffer size to be safe.
-    uint32_t max;
-    if (ks->marker) {
-        max = ks->marker;
-    } else {
-        max = ks->offset;
-        if (max > ks->bufsize) {
-            max = ks->bufsize;
+// Reserves |len| bytes in |cs|'s ring. Returns nullptr, and disables tracing, if the ring
+// is full and tracing is not circular.
+static void* ktrace_reserve(ktrace_state_t* ks, ktrace_cpu_state_t* cs, uint32_t len) {
+    const bool circular = atomic_load(&ks->circular);
+    for (;;) {
+        const uint64_t off = cs->head.fetch_add(len, fbl::memory_order_relaxed);
+        if (!circular && off + len > ks->ring_size) {
+            // if we arrive at the end, stop
+            if (off < ks->ring_size) {
+                ktrace_pad(ks, cs, off, ks->ring_size - off);
+            }
+            atomic_store(&ks->grpmask, 0);
+            return nullptr;
+        }
+        const uint64_t block_end = ROUNDUP(off + 1, kBlockSize);
+        if (off + len <= block_end) {
+            return cs->buffer + off % ks->ring_size;
         }
+        // The record would straddle a block boundary. Pad out both parts of the
+        // reservation and try again at the new head.
+        ktrace_pad(ks, cs, off, block_end - off);
+        ktrace_pad(ks, cs, block_end, off + len - block_end);
     }
+}
+
+// A reader's position in a ring.
+typedef struct ktrace_ring_cursor {
+    uint64_t pos;
+    uint64_t end;
+} ktrace_ring_cursor_t;
+
+// Returns the first event record at or after |c->pos| in |cs|'s ring, advancing |c->pos|
+// to it, or nullptr if there is none.
+static const ktrace_header_t* ktrace_ring_peek(const ktrace_state_t* ks,
+                                               const ktrace_cpu_state_t* cs,
+                                               ktrace_ring_cursor_t* c) {
+    while (c->pos < c->end) {
+        const uint8_t* rec = cs->buffer + c->pos % ks->ring_size;
+        const uint32_t len = KTRACE_LEN(*reinterpret_cast<const uint32_t*>(rec));
+        const uint64_t block_end = ROUNDUP(c->pos + 1, kBlockSize);
+        if (len == 0 || c->pos + len > block_end || c->pos + len > c->end) {
+            // The rest of this block was never (completely) written.
+            c->pos = block_end;
+            continue;
+        }
+        const ktrace_header_t* hdr = reinterpret_cast<const ktrace_header_t*>(rec);
+        if (KTRACE_GROUP(hdr->tag) == 0 || len < KTRACE_HDRSIZE) {
+            c->pos += len;
+            continue;
+        }
+        return hdr;
+    }
+    return nullptr;
+}
+
+// Copies the first |meta_len| bytes of metadata, followed by the records of every ring in
+// timestamp order, to |out|, which must hold at least |ks->bufsize| bytes. Returns the
+// number of bytes copied.
+static size_t ktrace_merge(ktrace_state_t* ks, size_t meta_len, uint8_t* out) {
+    size_t len = fbl::min(meta_len, static_cast<size_t>(ks->meta_size));
+    memcpy(out, ks->meta, len);
+
+    // Only the blocks which have not been (even partially) overwritten are read.
+    ktrace_ring_cursor_t cursor[SMP_MAX_CPUS];
+    for (uint32_t i = 0; i < ks->cpu_count; i++) {
+        uint64_t end = ks->cpu[i].head.load(fbl::memory_order_relaxed);
+        if (!ks->circular) {
+            end = fbl::min(end, ks->ring_size);
+        }
+        const uint64_t block_end = ROUNDUP(end, kBlockSize);
+        cursor[i].pos = block_end > ks->ring_size ? block_end - ks->ring_size : 0;
+        cursor[i].end = end;
+    }
+
+    for (;;) {
+        const ktrace_header_t* next = nullptr;
+        uint32_t next_cpu = 0;
+        for (uint32_t i = 0; i < ks->cpu_count; i++) {
+            const ktrace_header_t* hdr = ktrace_ring_peek(ks, &ks->cpu[i], &cursor[i]);
+            if (hdr != nullptr && (next == nullptr || hdr->ts < next->ts)) {
+                next = hdr;
+                next_cpu = i;
+            }
+        }
+        if (next == nullptr) {
+            return len;
+        }
+        const uint32_t rec_len = KTRACE_LEN(next->tag);
+        memcpy(out + len, next, rec_len);
+        len += rec_len;
+        cursor[next_cpu].pos += rec_len;
+    }
+}
+
+// Replaces the snapshot with the current contents of the trace buffers.
+static zx_status_t ktrace_snapshot(ktrace_state_t* ks) TA_REQ(ktrace_lock) {
+    if (ks->bufsize == 0) {
+        return ZX_ERR_BAD_STATE;
+    }
+    if (snapshot_buffer == nullptr) {
+        zx_status_t status = VmAspace::kernel_aspace()->Alloc(
+            "ktrace-snapshot", ks->bufsize, (void**)&snapshot_buffer, 0,
+            VmAspace::VMM_FLAG_COMMIT, ARCH_MMU_FLAG_PERM_READ | ARCH_MMU_FLAG_PERM_WRITE);
+        if (status != ZX_OK) {
+            snapshot_buffer = nullptr;
+            return status;
+        }
+    }
+
+    // Pause tracing so that the rings do not change while they are merged, and wait for
+    // the records already reserved to be written. Names may still be added to the
+    // metadata, so only those reserved before the wait are copied.
+    int grpmask = atomic_swap(&ks->grpmask, 0);
+    size_t meta_len = atomic_load(&ks->meta_offset);
+    ktrace_drain_writers(ks);
+    snapshot_len = ktrace_merge(ks, meta_len, snapshot_buffer);
+    atomic_store(&ks->grpmask, grpmask);
+    return ZX_OK;
+}
+
+// Empties the rings and the metadata buffer, and rewrites the metadata.
+static void ktrace_rewind(ktrace_state_t* ks) {
+    for (uint32_t i = 0; i < ks->cpu_count; i++) {
+        ks->cpu[i].head.store(0);
+    }
+    // roll back to just after the version and ticks-per-ms records
+    atomic_store(&ks->meta_offset, KTRACE_RECSIZE * 2);
+    ktrace_report_syscalls(kt_syscall_info);
+    ktrace_report_probes();
+    ktrace_report_vcpu_meta();
+}
+
+static void ktrace_start(ktrace_state_t* ks, uint32_t options, bool circular) {
+    // Records written in one mode cannot be read back in the other.
+    if (atomic_swap(&ks->circular, circular) != circular) {
+        ktrace_rewind(ks);
+    }
+    options = KTRACE_GRP_TO_MASK(options);
+    atomic_store(&ks->grpmask, options ? options : KTRACE_GRP_TO_MASK(KTRACE_GRP_ALL));
+    ktrace_report_live_processes();
+    ktrace_report_live_threads();
+}
+
+ssize_t ktrace_read_user(void* ptr, uint32_t off, size_t len) {
+    fbl::AutoLock lock(&ktrace_lock);
+
+    // Reads are served from the last snapshot.
+    size_t max = snapshot_len;
 
     // null read is a query for trace buffer size
     if (ptr == nullptr) {
@@ -119,7 +340,7 @@ ssize_t ktrace_read_user(void* ptr, uint32_t off, size_t len) {
         len = max - off;
     }
 
-    if (arch_copy_to_user(ptr, ks->buffer + off, len) != ZX_OK) {
+    if (arch_copy_to_user(ptr, snapshot_buffer + off, len) != ZX_OK) {
         return ZX_ERR_INVALID_ARGS;
     }
     return len;
@@ -128,30 +349,34 @@ ssize_t ktrace_read_user(void* ptr, uint32_t off, size_t len) {
 zx_status_t ktrace_control(uint32_t action, uint32_t options, void* ptr) {
     ktrace_state_t* ks = &KTRACE_STATE;
     switch (action) {
-    case KTRACE_ACTION_START:
-        options = KTRACE_GRP_TO_MASK(options);
-        ks->marker = 0;
-        atomic_store(&ks->grpmask, options ? options : KTRACE_GRP_TO_MASK(KTRACE_GRP_ALL));
-        ktrace_report_live_processes();
-        ktrace_report_live_threads();
+    case KTRACE_ACTION_START: {
+        fbl::AutoLock lock(&ktrace_lock);
+        ktrace_start(ks, options, false);
+        break;
+    }
+    case KTRACE_ACTION_START_CIRCULAR: {
+        fbl::AutoLock lock(&ktrace_lock);
+        ktrace_start(ks, options, true);
         break;
+    }
     case KTRACE_ACTION_STOP: {
+        fbl::AutoLock lock(&ktrace_lock);
         atomic_store(&ks->grpmask, 0);
-        uint32_t n = ks->offset;
-        if (n > ks->bufsize) {
-            ks->marker = ks->bufsize;
-        } else {
-            ks->marker = n;
+        // Stopping is harmless even if there is no buffer to read.
+        if (ks->bufsize == 0) {
+            break;
         }
-        break;
+        return ktrace_snapshot(ks);
     }
-    case KTRACE_ACTION_REWIND:
-        // roll back to just after the metadata
-        atomic_store(&ks->offset, KTRACE_RECSIZE * 2);
-        ktrace_report_syscalls(kt_syscall_info);
-        ktrace_report_probes();
-        ktrace_report_vcpu_meta();
+    case KTRACE_ACTION_SNAPSHOT: {
+        fbl::AutoLock lock(&ktrace_lock);
+        return ktrace_snapshot(ks);
+    }
+    case KTRACE_ACTION_REWIND: {
+        fbl::AutoLock lock(&ktrace_lock);
+        ktrace_rewind(ks);
         break;
+    }
     case KTRACE_ACTION_NEW_PROBE: {
         fbl::AutoLock lock(&probe_list_lock);
         ktrace_probe_info_t* probe;
@@ -188,19 +413,36 @@ void ktrace_init(unsigned level) {
 
     mb *= (1024*1024);
 
+    // The metadata buffer gets a sixteenth of the space, and the rings share the rest.
+    uint32_t cpu_count = arch_max_num_cpus();
+    uint32_t meta_size = ROUNDDOWN(mb / 16, kBlockSize);
+    uint64_t ring_size = ROUNDDOWN((mb - meta_size) / cpu_count, kBlockSize);
+    if (meta_size == 0 || ring_size == 0) {
+        dprintf(INFO, "ktrace: buffer too small for %u cpus\n", cpu_count);
+        return;
+    }
+
+    uint8_t* buffer;
     zx_status_t status;
     VmAspace* aspace = VmAspace::kernel_aspace();
-    if ((status = aspace->Alloc("ktrace", mb, (void**)&ks->buffer, 0, VmAspace::VMM_FLAG_COMMIT,
+    if ((status = aspace->Alloc("ktrace", mb, (void**)&buffer, 0, VmAspace::VMM_FLAG_COMMIT,
                                 ARCH_MMU_FLAG_PERM_READ | ARCH_MMU_FLAG_PERM_WRITE)) < 0) {
         dprintf(INFO, "ktrace: cannot alloc buffer %d\n", status);
         return;
     }
 
-    // The last packet written can overhang the end of the buffer,
-    // so we reduce the reported size by the max size of a record
-    ks->bufsize = mb - 256;
+    ks->meta = buffer;
+    ks->meta_size = meta_size;
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        ks->cpu[i].buffer = buffer + meta_size + i * ring_size;
+    }
+    ks->cpu_count = cpu_count;
+    ks->ring_size = ring_size;
+    ks->bufsize = meta_size + cpu_count * ring_size;
+    ks->circular = cmdline_get_bool("ktrace.circular", false);
 
-    dprintf(INFO, "ktrace: buffer at %p (%u bytes)\n", ks->buffer, mb);
+    dprintf(INFO, "ktrace: buffer at %p (%u bytes, %u cpus%s)\n", buffer, mb, cpu_count,
+            ks->circular ? ", circular" : "");
 
     // register all static probes
     {
@@ -214,7 +456,7 @@ void ktrace_init(unsigned level) {
 
     // write metadata to the first two event slots
     uint64_t n = ktrace_ticks_per_ms();
-    ktrace_rec_32b_t* rec = (ktrace_rec_32b_t*) ks->buffer;
+    ktrace_rec_32b_t* rec = (ktrace_rec_32b_t*) ks->meta;
     rec[0].tag = TAG_VERSION;
     rec[0].a = KTRACE_VERSION;
     rec[1].tag = TAG_TICKS_PER_MS;
@@ -222,7 +464,7 @@ void ktrace_init(unsigned level) {
     rec[1].b = (uint32_t)(n >> 32);
 
     // enable tracing
-    atomic_store(&ks->offset, KTRACE_RECSIZE * 2);
+    atomic_store(&ks->meta_offset, KTRACE_RECSIZE * 2);
     ktrace_report_syscalls(kt_syscall_info);
     ktrace_report_probes();
     atomic_store(&ks->grpmask, KTRACE_GRP_TO_MASK(grpmask));
@@ -242,61 +484,70 @@ void ktrace_init(unsigned level) {
 
 void ktrace_tiny(uint32_t tag, uint32_t arg) {
     ktrace_state_t* ks = &KTRACE_STATE;
+    if (!(tag & atomic_load(&ks->grpmask))) {
+        return;
+    }
+
+    // Check again once counted in flight, in case a snapshot paused tracing in between.
+    ktrace_cpu_state_t* cs = ktrace_begin_write(ks);
     if (tag & atomic_load(&ks->grpmask)) {
         tag = (tag & 0xFFFFFFF0) | 2;
-        int off;
-        if ((off = atomic_add(&ks->offset, KTRACE_HDRSIZE)) >= (int)ks->bufsize) {
-            // if we arrive at the end, stop
-            atomic_store(&ks->grpmask, 0);
-        } else {
-            ktrace_header_t* hdr = (ktrace_header_t*) (ks->buffer + off);
+        ktrace_header_t* hdr = (ktrace_header_t*) ktrace_reserve(ks, cs, KTRACE_HDRSIZE);
+        if (hdr != nullptr) {
             hdr->ts = ktrace_timestamp();
             hdr->tag = tag;
             hdr->tid = arg;
         }
     }
+    ktrace_end_write(cs);
 }
 
-void* ktrace_open(uint32_t tag) {
+bool ktrace_write(uint32_t tag, const void* payload, size_t len) {
     ktrace_state_t* ks = &KTRACE_STATE;
     if (!(tag & atomic_load(&ks->grpmask))) {
-        return nullptr;
+        return false;
     }
+    DEBUG_ASSERT(len <= KTRACE_LEN(tag) - KTRACE_HDRSIZE);
 
-    int off;
-    if ((off = atomic_add(&ks->offset, KTRACE_LEN(tag))) >= (int)ks->bufsize) {
-        // if we arrive at the end, stop
-        atomic_store(&ks->grpmask, 0);
-        return nullptr;
+    // Check again once counted in flight, in case a snapshot paused tracing in between.
+    ktrace_cpu_state_t* cs = ktrace_begin_write(ks);
+    ktrace_header_t* hdr = nullptr;
+    if (tag & atomic_load(&ks->grpmask)) {
+        hdr = (ktrace_header_t*) ktrace_reserve(ks, cs, KTRACE_LEN(tag));
     }
-
-    ktrace_header_t* hdr = (ktrace_header_t*) (ks->buffer + off);
-    hdr->ts = ktrace_timestamp();
-    hdr->tag = tag;
-    hdr->tid = (uint32_t)get_current_thread()->user_tid;
-    return hdr + 1;
+    if (hdr != nullptr) {
+        hdr->ts = ktrace_timestamp();
+        hdr->tag = tag;
+        hdr->tid = (uint32_t)get_current_thread()->user_tid;
+        if (len > 0) {
+            memcpy(hdr + 1, payload, len);
+        }
+    }
+    ktrace_end_write(cs);
+    return hdr != nullptr;
 }
 
 void ktrace_name_etc(uint32_t tag, uint32_t id, uint32_t arg, const char* name, bool always) {
     ktrace_state_t* ks = &KTRACE_STATE;
     if ((tag & atomic_load(&ks->grpmask)) || always) {
+        ktrace_cpu_state_t* cs = ktrace_begin_write(ks);
         uint32_t len = static_cast<uint32_t>(strnlen(name, ZX_MAX_NAME_LEN - 1));
 
         // set size to: sizeof(hdr) + len + 1, round up to multiple of 8
         tag = (tag & 0xFFFFFFF0) | ((KTRACE_NAMESIZE + len + 1 + 7) >> 3);
 
-        int off;
-        if ((off = atomic_add(&ks->offset, KTRACE_LEN(tag))) >= (int)ks->bufsize) {
-            // if we arrive at the end, stop
-            atomic_store(&ks->grpmask, 0);
-        } else {
-            ktrace_rec_name_t* rec = (ktrace_rec_name_t*) (ks->buffer + off);
+        // Names go to the metadata buffer, so that they are never overwritten by
+        // events. If it is full, the name is dropped but tracing continues.
+        int off = atomic_add(&ks->meta_offset, KTRACE_LEN(tag));
+        if (off + KTRACE_LEN(tag) <= ks->meta_size) {
+            ktrace_rec_name_t* rec = (ktrace_rec_name_t*) (ks->meta + off);
             rec->tag = tag;
             rec->id = id;
             rec->arg = arg;
             memcpy(rec->name, name, len);
             rec->name[len] = 0;
         }
+        ktrace_end_write(cs);
     }
 }
 
@@ -0,0 +1,38 @@
+
+#pragma once
+
+#include <stddef.h>
+
+#include <fbl/alloc_checker.h>
+
+// The slab allocator serves small, fixed-size kernel objects from per-cpu caches, so that
+// allocating and freeing hot objects does not take the heap lock.
+//
+// Objects are grouped into power-of-two size classes. Each class carves whole pages into
+// objects. Each cpu keeps a small magazine of free objects of each class, and the
+// magazines trade objects with a shared depot in batches. The depot tracks its free objects
+// by page, and returns a page to the PMM once all of its objects are back in the depot,
+// keeping one such page per class. The `kmem` console command shows each class's occupancy.
+
+// Allocates |size| bytes from the slab cache for |size|'s size class, or from the heap if
+// |size| is larger than every class. Returns nullptr on failure.
+void* slab_alloc(size_t size);
+
+// Frees |ptr|, which must have been returned by slab_alloc(|size|).
+void slab_free(void* ptr, size_t size);
+
+// Classes deriving from SlabAllocated are allocated with slab_alloc. The size passed to
+// operator delete is the size of the most derived class, so classes with virtual
+// destructors may derive from it too.
+class SlabAllocated {
+public:
+    static void* operator new(size_t size, fbl::AllocChecker* ac) noexcept {
+        void* ptr = slab_alloc(size);
+        ac->arm(size, ptr != nullptr);
+        return ptr;
+    }
+
+    static void operator delete(void* ptr, size_t size) {
+        slab_free(ptr, size);
+    }
+};
@@ -0,0 +1,13 @@
+
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+MODULE := $(LOCAL_DIR)
+
+MODULE_SRCS += \
+	$(LOCAL_DIR)/slab.cpp
+
+MODULE_DEPS += \
+	kernel/lib/counters \
+	kernel/lib/heap
+
+include make/module.mk
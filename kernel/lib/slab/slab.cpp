@@ -0,0 +1,354 @@
+
+#include <lib/slab.h>
+
+#include <arch/ops.h>
+#include <debug.h>
+#include <err.h>
+#include <fbl/algorithm.h>
+#include <fbl/alloc_checker.h>
+#include <fbl/intrusive_double_list.h>
+#include <fbl/intrusive_wavl_tree.h>
+#include <fbl/mutex.h>
+#include <kernel/align.h>
+#include <kernel/lockdep.h>
+#include <kernel/spinlock.h>
+#include <ktl/move.h>
+#include <ktl/unique_ptr.h>
+#include <lib/counters.h>
+#include <lib/heap.h>
+#include <stdio.h>
+#include <string.h>
+#include <zircon/types.h>
+
+namespace {
+
+// Objects move between a cpu's magazine and the depot in batches of this many.
+constexpr size_t kBatchSize = 16;
+
+// A magazine holds up to two batches, so that a cpu alternating between allocating and
+// freeing does not trade with the depot every time.
+constexpr size_t kMagazineSize = 2 * kBatchSize;
+
+// Each cache keeps up to this many pages with no objects in use, so that a workload
+// allocating and freeing around a page boundary does not return and refetch a page every
+// time. Further pages are returned to the PMM as soon as their last object is freed.
+constexpr size_t kMaxEmptyPages = 1;
+
+// A cache of free objects of a single size.
+class ObjectCache {
+public:
+    ObjectCache(size_t object_size, const Counter& allocs, const Counter& frees,
+                const Counter& refills, const Counter& pages, const Counter& pages_freed)
+        : object_size_(object_size), objects_per_page_(PAGE_SIZE / object_size),
+          allocs_(allocs), frees_(frees), refills_(refills), pages_(pages),
+          pages_freed_(pages_freed) {}
+
+    size_t object_size() const { return object_size_; }
+
+    void* Alloc();
+    void Free(void* ptr);
+
+    void Dump(bool panic_time);
+
+private:
+    ObjectCache(const ObjectCache&) = delete;
+    ObjectCache& operator=(const ObjectCache&) = delete;
+
+    // Free objects in the depot are linked through their first word.
+    struct FreeObject {
+        FreeObject* next;
+    };
+
+    // The depot tracks its free objects by the page they were carved from, so that it can
+    // tell when every object of a page is free.
+    struct SlabPage : public fbl::WAVLTreeContainable<ktl::unique_ptr<SlabPage>>,
+                      public fbl::DoublyLinkedListable<SlabPage*> {
+        explicit SlabPage(char* base) : base(base) {}
+        uintptr_t GetKey() const { return reinterpret_cast<uintptr_t>(base); }
+
+        char* const base;
+        FreeObject* free = nullptr;
+        size_t free_count = 0;
+    };
+
+    struct __CPU_ALIGN Magazine {
+        DECLARE_SPINLOCK(Magazine) lock;
+        size_t count = 0;
+        void* objects[kMagazineSize] = {};
+    };
+
+    Magazine& CurrentMagazine() { return magazines_[arch_curr_cpu_num()]; }
+
+    // Moves up to kBatchSize objects from the depot to |batch|, carving up a new page if
+    // the depot is empty. Returns the number of objects moved.
+    size_t DepotAlloc(void** batch);
+
+    // Moves |count| objects from |batch| to the depot.
+    void DepotFree(void* const* batch, size_t count);
+
+    // Carves a new page into objects and adds them to the depot.
+    bool GrowLocked() TA_REQ(depot_lock_);
+
+    // Returns |page|, none of whose objects are in use, to the PMM.
+    void ShrinkLocked(SlabPage* page) TA_REQ(depot_lock_);
+
+    const size_t object_size_;
+    const size_t objects_per_page_;
+    const Counter& allocs_;
+    const Counter& frees_;
+    const Counter& refills_;
+    const Counter& pages_;
+    const Counter& pages_freed_;
+
+    Magazine magazines_[SMP_MAX_CPUS];
+
+    DECLARE_MUTEX(ObjectCache) depot_lock_;
+    // Every page of the cache, by address.
+    fbl::WAVLTree<uintptr_t, ktl::unique_ptr<SlabPage>> pages_by_addr_ TA_GUARDED(depot_lock_);
+    // The pages with free objects in the depot. Objects are allocated from the front, where
+    // pages which were full are added, so that the pages at the back have a chance to empty.
+    fbl::DoublyLinkedList<SlabPage*> partial_ TA_GUARDED(depot_lock_);
+    size_t depot_count_ TA_GUARDED(depot_lock_) = 0;
+    size_t page_count_ TA_GUARDED(depot_lock_) = 0;
+    size_t empty_page_count_ TA_GUARDED(depot_lock_) = 0;
+};
+
+void* ObjectCache::Alloc() {
+    {
+        Magazine& mag = CurrentMagazine();
+        Guard<SpinLock, IrqSave> guard{&mag.lock};
+        if (mag.count > 0) {
+            kcounter_add(allocs_, 1);
+            return mag.objects[--mag.count];
+        }
+    }
+
+    // The magazine is empty. Refill it from the depot, keeping one object for the caller.
+    void* batch[kBatchSize];
+    size_t count = DepotAlloc(batch);
+    if (count == 0) {
+        return nullptr;
+    }
+    void* ptr = batch[--count];
+    {
+        // We may have moved to another cpu, or the magazine may have been refilled, since
+        // it was found to be empty.
+        Magazine& mag = CurrentMagazine();
+        Guard<SpinLock, IrqSave> guard{&mag.lock};
+        while (count > 0 && mag.count < kMagazineSize) {
+            mag.objects[mag.count++] = batch[--count];
+        }
+    }
+    if (count > 0) {
+        DepotFree(batch, count);
+    }
+    kcounter_add(refills_, 1);
+    kcounter_add(allocs_, 1);
+    return ptr;
+}
+
+void ObjectCache::Free(void* ptr) {
+    kcounter_add(frees_, 1);
+
+    void* batch[kBatchSize];
+    {
+        Magazine& mag = CurrentMagazine();
+        Guard<SpinLock, IrqSave> guard{&mag.lock};
+        if (mag.count < kMagazineSize) {
+            mag.objects[mag.count++] = ptr;
+            return;
+        }
+        // The magazine is full. Return a batch to the depot to make room.
+        mag.count -= kBatchSize;
+        memcpy(batch, &mag.objects[mag.count], sizeof(batch));
+        mag.objects[mag.count++] = ptr;
+    }
+    DepotFree(batch, kBatchSize);
+}
+
+size_t ObjectCache::DepotAlloc(void** batch) {
+    Guard<fbl::Mutex> guard{&depot_lock_};
+    if (partial_.is_empty() && !GrowLocked()) {
+        return 0;
+    }
+    size_t count = 0;
+    while (count < kBatchSize && !partial_.is_empty()) {
+        SlabPage& page = partial_.front();
+        if (page.free_count == objects_per_page_) {
+            empty_page_count_--;
+        }
+        while (count < kBatchSize && page.free != nullptr) {
+            batch[count++] = page.free;
+            page.free = page.free->next;
+            page.free_count--;
+        }
+        if (page.free == nullptr) {
+            partial_.pop_front();
+        }
+    }
+    depot_count_ -= count;
+    return count;
+}
+
+void ObjectCache::DepotFree(void* const* batch, size_t count) {
+    Guard<fbl::Mutex> guard{&depot_lock_};
+    for (size_t i = 0; i < count; i++) {
+        auto iter = pages_by_addr_.find(ROUNDDOWN(reinterpret_cast<uintptr_t>(batch[i]),
+                                                  PAGE_SIZE));
+        DEBUG_ASSERT_MSG(iter.IsValid(), "%p is not a slab object\n", batch[i]);
+        SlabPage* page = &*iter;
+
+        FreeObject* obj = static_cast<FreeObject*>(batch[i]);
+        obj->next = page->free;
+        page->free = obj;
+        depot_count_++;
+        if (page->free_count++ == 0) {
+            partial_.push_front(page);
+        }
+        if (page->free_count == objects_per_page_) {
+            if (empty_page_count_ < kMaxEmptyPages) {
+                // Keep the page, but allocate from it only once the others are full.
+                empty_page_count_++;
+                partial_.erase(*page);
+                partial_.push_back(page);
+            } else {
+                ShrinkLocked(page);
+            }
+        }
+    }
+}
+
+bool ObjectCache::GrowLocked() {
+    char* base = static_cast<char*>(heap_page_alloc(1));
+    if (base == nullptr) {
+        return false;
+    }
+    fbl::AllocChecker ac;
+    ktl::unique_ptr<SlabPage> page(new (&ac) SlabPage(base));
+    if (!ac.check()) {
+        heap_page_free(base, 1);
+        return false;
+    }
+    for (size_t i = 0; i < objects_per_page_; i++) {
+        FreeObject* obj = reinterpret_cast<FreeObject*>(base + i * object_size_);
+        obj->next = page->free;
+        page->free = obj;
+    }
+    page->free_count = objects_per_page_;
+    depot_count_ += objects_per_page_;
+    empty_page_count_++;
+    partial_.push_back(page.get());
+    pages_by_addr_.insert(ktl::move(page));
+    page_count_++;
+    kcounter_add(pages_, 1);
+    return true;
+}
+
+void ObjectCache::ShrinkLocked(SlabPage* page) {
+    DEBUG_ASSERT(page->free_count == objects_per_page_);
+    partial_.erase(*page);
+    ktl::unique_ptr<SlabPage> owned = pages_by_addr_.erase(*page);
+    heap_page_free(owned->base, 1);
+    depot_count_ -= objects_per_page_;
+    page_count_--;
+    kcounter_add(pages_freed_, 1);
+}
+
+void ObjectCache::Dump(bool panic_time) TA_NO_THREAD_SAFETY_ANALYSIS {
+    // The magazines are read without their locks, so the counts are approximate.
+    size_t cached = 0;
+    for (const Magazine& mag : magazines_) {
+        cached += mag.count;
+    }
+
+    size_t pages, depot;
+    if (panic_time) {
+        // Avoid taking locks at panic time.
+        pages = page_count_;
+        depot = depot_count_;
+    } else {
+        Guard<fbl::Mutex> guard{&depot_lock_};
+        pages = page_count_;
+        depot = depot_count_;
+    }
+    const size_t total = pages * objects_per_page_;
+    printf("%8zu %8zu %10zu %10zu %10zu\n", object_size_, pages,
+           total - fbl::min(total, cached + depot), cached, depot);
+}
+
+#define SLAB_COUNTERS(size)                                                  \
+    KCOUNTER(slab_##size##_allocs, "kernel.slab." #size ".allocs");          \
+    KCOUNTER(slab_##size##_frees, "kernel.slab." #size ".frees");            \
+    KCOUNTER(slab_##size##_refills, "kernel.slab." #size ".depot_refills");  \
+    KCOUNTER(slab_##size##_pages, "kernel.slab." #size ".pages");            \
+    KCOUNTER(slab_##size##_pages_freed, "kernel.slab." #size ".pages_freed")
+
+#define SLAB_CACHE(size) \
+    ObjectCache(size, slab_##size##_allocs, slab_##size##_frees, slab_##size##_refills, \
+                slab_##size##_pages, slab_##size##_pages_freed)
+
+SLAB_COUNTERS(32);
+SLAB_COUNTERS(64);
+SLAB_COUNTERS(128);
+SLAB_COUNTERS(256);
+SLAB_COUNTERS(512);
+SLAB_COUNTERS(1024);
+SLAB_COUNTERS(2048);
+
+// Size classes, in increasing order of size.
+ObjectCache caches[] = {
+    SLAB_CACHE(32),
+    SLAB_CACHE(64),
+    SLAB_CACHE(128),
+    SLAB_CACHE(256),
+    SLAB_CACHE(512),
+    SLAB_CACHE(1024),
+    SLAB_CACHE(2048),
+};
+
+// Returns the cache for objects of |size| bytes, or nullptr if they are too large.
+ObjectCache* CacheFor(size_t size) {
+    for (ObjectCache& cache : caches) {
+        if (size <= cache.object_size()) {
+            return &cache;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+void* slab_alloc(size_t size) {
+    ObjectCache* cache = CacheFor(size);
+    return cache ? cache->Alloc() : malloc(size);
+}
+
+void slab_free(void* ptr, size_t size) {
+    if (ptr == nullptr) {
+        return;
+    }
+    ObjectCache* cache = CacheFor(size);
+    if (cache) {
+        cache->Free(ptr);
+    } else {
+        free(ptr);
+    }
+}
+
+#if LK_DEBUGLEVEL > 1
+
+#include <lib/console.h>
+
+static int cmd_kmem(int argc, const cmd_args* argv, uint32_t flags) {
+    printf("%8s %8s %10s %10s %10s\n", "size", "pages", "in use", "cached", "depot");
+    for (ObjectCache& cache : caches) {
+        cache.Dump(flags & CMD_FLAG_PANIC);
+    }
+    return 0;
+}
+
+STATIC_COMMAND_START
+STATIC_COMMAND_MASKED("kmem", "dump slab cache occupancy", &cmd_kmem, CMD_AVAIL_ALWAYS)
+STATIC_COMMAND_END(kmem);
+
+#endif
@@ -18,7 +18,17 @@ FutexContext::~FutexContext() {
 
     // All of the threads should have removed themselves from wait queues
     // by the time the process has exited.
-    DEBUG_ASSERT(futex_table_.is_empty());
+    for (Bucket& bucket : buckets_) {
+        DEBUG_ASSERT(bucket.waiters.load() == 0);
+        DEBUG_ASSERT(bucket.heads.is_empty());
+    }
+}
+
+FutexContext::Bucket& FutexContext::BucketFor(uintptr_t futex_key) {
+    // Futexes are often laid out at a regular stride (for instance, one per
+    // cache line), so the address is mixed before its top bits are taken.
+    const uint64_t hash = (futex_key / sizeof(int)) * 0x9e3779b97f4a7c15ull;
+    return buckets_[hash >> (64 - kBucketShift)];
 }
 
 zx_status_t FutexContext::FutexWait(user_in_ptr<const zx_futex_t> value_ptr,
@@ -42,24 +52,33 @@ zx_status_t FutexContext::FutexWait(user_in_ptr<const zx_futex_t> value_ptr,
     // If a FutexWake() operation could occur between them, a userland mutex
     // operation built on top of futexes would have a race condition that
     // could miss wakeups.
-    Guard<fbl::Mutex> guard{&lock_};
+    Bucket& bucket = BucketFor(futex_key);
+    Guard<fbl::Mutex> guard{&bucket.lock};
+
+    // Count ourselves as a waiter before reading the futex value.  FutexWake()
+    // reads the count without the lock after userspace has changed the value,
+    // so either it sees this thread counted, or this thread sees the new value.
+    // The fences order the count and the value on both sides.
+    bucket.waiters.fetch_add(1, fbl::memory_order_relaxed);
+    fbl::atomic_thread_fence(fbl::memory_order_seq_cst);
 
     int value;
     zx_status_t result = value_ptr.copy_from_user(&value);
+    if (result == ZX_OK && value != current_value) {
+        result = ZX_ERR_BAD_STATE;
+    }
     if (result != ZX_OK) {
+        bucket.waiters.fetch_sub(1, fbl::memory_order_relaxed);
         return result;
     }
-    if (value != current_value) {
-        return ZX_ERR_BAD_STATE;
-    }
 
     FutexNode node;
     node.set_hash_key(futex_key);
     node.SetAsSingletonList();
 
-    QueueNodesLocked(&node);
+    QueueNodesLocked(&bucket, &node);
 
-    // Block current thread.  This releases lock_ and does not reacquire it.
+    // Block current thread.  This releases the bucket lock and does not reacquire it.
     result = node.BlockThread(guard.take(), deadline);
     if (result == ZX_OK) {
         DEBUG_ASSERT(!node.IsInQueue());
@@ -73,8 +92,7 @@ zx_status_t FutexContext::FutexWait(user_in_ptr<const zx_futex_t> value_ptr,
     //
     // We need to ensure that the thread's node is removed from the wait
     // queue, because FutexWake() probably didn't do that.
-    Guard<fbl::Mutex> guard2{&lock_};
-    if (UnqueueNodeLocked(&node)) {
+    if (UnqueueNode(&node)) {
         return result;
     }
     // The current thread was not found on the wait queue.  This means
@@ -112,23 +130,35 @@ zx_status_t FutexContext::FutexWake(user_in_ptr<const zx_futex_t> value_ptr,
     if (futex_key % sizeof(int))
         return ZX_ERR_INVALID_ARGS;
 
+    // If no thread is blocked in this bucket, there is nothing to wake.  This
+    // pairs with the fence in FutexWait(): the caller changed the futex value
+    // before calling us, so a waiter which we do not see counted here will see
+    // the new value and not block.
+    Bucket& bucket = BucketFor(futex_key);
+    fbl::atomic_thread_fence(fbl::memory_order_seq_cst);
+    if (bucket.waiters.load(fbl::memory_order_relaxed) == 0) {
+        return ZX_OK;
+    }
+
     AutoReschedDisable resched_disable; // Must come before the Guard.
     resched_disable.Disable();
-    Guard<fbl::Mutex> guard{&lock_};
+    Guard<fbl::Mutex> guard{&bucket.lock};
 
-    FutexNode* node = futex_table_.erase(futex_key);
+    FutexNode* node = EraseHeadLocked(&bucket, futex_key);
     if (!node) {
         // nothing blocked on this futex if we can't find it
         return ZX_OK;
     }
     DEBUG_ASSERT(node->GetKey() == futex_key);
 
+    uint32_t woken = 0;
     FutexNode* remaining_waiters =
-        FutexNode::WakeThreads(node, wake_count, futex_key);
+        FutexNode::WakeThreads(node, wake_count, futex_key, &woken);
+    bucket.waiters.fetch_sub(woken, fbl::memory_order_relaxed);
 
     if (remaining_waiters) {
         DEBUG_ASSERT(remaining_waiters->GetKey() == futex_key);
-        futex_table_.insert(remaining_waiters);
+        bucket.heads.push_front(remaining_waiters);
     }
 
     return ZX_OK;
@@ -154,24 +184,46 @@ zx_status_t FutexContext::FutexRequeue(user_in_ptr<const zx_futex_t> wake_ptr,
         return ZX_ERR_INVALID_ARGS;
     }
 
+    uintptr_t wake_key = reinterpret_cast<uintptr_t>(wake_ptr.get());
+    uintptr_t requeue_key = reinterpret_cast<uintptr_t>(requeue_ptr.get());
+    if (wake_key == requeue_key) return ZX_ERR_INVALID_ARGS;
+    if (wake_key % sizeof(int) || requeue_key % sizeof(int))
+        return ZX_ERR_INVALID_ARGS;
+
+    Bucket* wake_bucket = &BucketFor(wake_key);
+    Bucket* requeue_bucket = &BucketFor(requeue_key);
+
     AutoReschedDisable resched_disable; // Must come before the Guard.
-    Guard<fbl::Mutex> guard{&lock_};
+    if (wake_bucket == requeue_bucket) {
+        Guard<fbl::Mutex> guard{&wake_bucket->lock};
+        return RequeueLocked(wake_bucket, wake_key, wake_count, current_value, wake_ptr,
+                             requeue_bucket, requeue_key, requeue_count, &resched_disable);
+    }
+    // Both buckets are locked in address order, so two requeues between the
+    // same pair of buckets cannot deadlock.
+    GuardMultiple<2, fbl::Mutex> guard{&wake_bucket->lock, &requeue_bucket->lock};
+    return RequeueLocked(wake_bucket, wake_key, wake_count, current_value, wake_ptr,
+                         requeue_bucket, requeue_key, requeue_count, &resched_disable);
+}
+
+zx_status_t FutexContext::RequeueLocked(Bucket* wake_bucket, uintptr_t wake_key,
+                                        uint32_t wake_count, zx_futex_t current_value,
+                                        user_in_ptr<const zx_futex_t> wake_ptr,
+                                        Bucket* requeue_bucket, uintptr_t requeue_key,
+                                        uint32_t requeue_count,
+                                        AutoReschedDisable* resched_disable) {
+    DEBUG_ASSERT(wake_bucket->lock.lock().IsHeld());
+    DEBUG_ASSERT(requeue_bucket->lock.lock().IsHeld());
 
     int value;
     zx_status_t result = wake_ptr.copy_from_user(&value);
     if (result != ZX_OK) return result;
     if (value != current_value) return ZX_ERR_BAD_STATE;
 
-    uintptr_t wake_key = reinterpret_cast<uintptr_t>(wake_ptr.get());
-    uintptr_t requeue_key = reinterpret_cast<uintptr_t>(requeue_ptr.get());
-    if (wake_key == requeue_key) return ZX_ERR_INVALID_ARGS;
-    if (wake_key % sizeof(int) || requeue_key % sizeof(int))
-        return ZX_ERR_INVALID_ARGS;
-
     // This must happen before RemoveFromHead() calls set_hash_key() on
-    // nodes below, because operations on futex_table_ look at the GetKey
-    // field of the list head nodes for wake_key and requeue_key.
-    FutexNode* node = futex_table_.erase(wake_key);
+    // nodes below, because the bucket lookups look at the GetKey field of
+    // the list head nodes for wake_key and requeue_key.
+    FutexNode* node = EraseHeadLocked(wake_bucket, wake_key);
     if (!node) {
         // nothing blocked on this futex if we can't find it
         return ZX_OK;
@@ -179,10 +231,12 @@ zx_status_t FutexContext::FutexRequeue(user_in_ptr<const zx_futex_t> wake_ptr,
 
     // This must come before WakeThreads() to be useful, but we want to
     // avoid doing it before copy_from_user() in case that faults.
-    resched_disable.Disable();
+    resched_disable->Disable();
 
     if (wake_count > 0) {
-        node = FutexNode::WakeThreads(node, wake_count, wake_key);
+        uint32_t woken = 0;
+        node = FutexNode::WakeThreads(node, wake_count, wake_key, &woken);
+        wake_bucket->waiters.fetch_sub(woken, fbl::memory_order_relaxed);
     }
 
     // node is now the head of wake_ptr futex after possibly removing some threads to wake
@@ -190,19 +244,22 @@ zx_status_t FutexContext::FutexRequeue(user_in_ptr<const zx_futex_t> wake_ptr,
         if (requeue_count > 0) {
             // head and tail of list of nodes to requeue
             FutexNode* requeue_head = node;
+            uint32_t requeued = 0;
             node = FutexNode::RemoveFromHead(node, requeue_count,
-                                             wake_key, requeue_key);
+                                             wake_key, requeue_key, &requeued);
 
             // now requeue our nodes to requeue_ptr mutex
             DEBUG_ASSERT(requeue_head->GetKey() == requeue_key);
-            QueueNodesLocked(requeue_head);
+            wake_bucket->waiters.fetch_sub(requeued, fbl::memory_order_relaxed);
+            requeue_bucket->waiters.fetch_add(requeued, fbl::memory_order_relaxed);
+            QueueNodesLocked(requeue_bucket, requeue_head);
         }
     }
 
     // add any remaining nodes back to wake_key futex
     if (node != nullptr) {
         DEBUG_ASSERT(node->GetKey() == wake_key);
-        futex_table_.insert(node);
+        wake_bucket->heads.push_front(node);
     }
 
     return ZX_OK;
@@ -213,38 +270,59 @@ zx_status_t FutexContext::FutexGetOwner(user_in_ptr<const zx_futex_t> wake_ptr,
     return koid.copy_to_user(ZX_KOID_INVALID);
 }
 
-void FutexContext::QueueNodesLocked(FutexNode* head) {
-    DEBUG_ASSERT(lock_.lock().IsHeld());
+FutexNode* FutexContext::EraseHeadLocked(Bucket* bucket, uintptr_t futex_key) {
+    DEBUG_ASSERT(bucket->lock.lock().IsHeld());
 
-    FutexNode::HashTable::iterator iter;
+    return bucket->heads.erase_if([futex_key](const FutexNode& head) {
+        return head.GetKey() == futex_key;
+    });
+}
 
-    // Attempt to insert this FutexNode into the hash table.  If the insert
-    // succeeds, then the current thread is first to block on this futex and we
-    // are finished.  If the insert fails, then there is already a thread
-    // waiting on this futex.  Add ourselves to that thread's list.
-    if (!futex_table_.insert_or_find(head, &iter))
+void FutexContext::QueueNodesLocked(Bucket* bucket, FutexNode* head) {
+    DEBUG_ASSERT(bucket->lock.lock().IsHeld());
+
+    // Look for a thread already waiting on this futex.  If there is none, then
+    // the current thread is first to block on this futex and becomes the head
+    // of its list.  Otherwise, add ourselves to that thread's list.
+    uintptr_t futex_key = head->GetKey();
+    auto iter = bucket->heads.find_if([futex_key](const FutexNode& node) {
+        return node.GetKey() == futex_key;
+    });
+    if (iter.IsValid()) {
         iter->AppendList(head);
+    } else {
+        bucket->heads.push_front(head);
+    }
 }
 
 // This attempts to unqueue a thread (which may or may not be waiting on a
 // futex), given its FutexNode.  This returns whether the FutexNode was
 // found and removed from a futex wait queue.
-bool FutexContext::UnqueueNodeLocked(FutexNode* node) {
-    DEBUG_ASSERT(lock_.lock().IsHeld());
-
-    if (!node->IsInQueue())
-        return false;
-
+bool FutexContext::UnqueueNode(FutexNode* node) {
     // Note: When UnqueueNode() is called from FutexWait(), it might be
     // tempting to reuse the futex key that was passed to FutexWait().
     // However, that could be out of date if the thread was requeued by
-    // FutexRequeue(), so we need to re-get the hash table key here.
-    uintptr_t futex_key = node->GetKey();
-
-    FutexNode* old_head = futex_table_.erase(futex_key);
-    DEBUG_ASSERT(old_head);
-    FutexNode* new_head = FutexNode::RemoveNodeFromList(old_head, node);
-    if (new_head)
-        futex_table_.insert(new_head);
-    return true;
+    // FutexRequeue(), so we need to re-get the key here.  FutexRequeue()
+    // changes the key with the locks of both the old and the new bucket
+    // held, so the key is stable once it is seen again with the lock of its
+    // bucket held.
+    while (true) {
+        uintptr_t futex_key = node->GetKey();
+        Bucket& bucket = BucketFor(futex_key);
+        Guard<fbl::Mutex> guard{&bucket.lock};
+        if (node->GetKey() != futex_key) {
+            continue;
+        }
+
+        if (!node->IsInQueue())
+            return false;
+
+        FutexNode* old_head = EraseHeadLocked(&bucket, futex_key);
+        DEBUG_ASSERT(old_head);
+        FutexNode* new_head = FutexNode::RemoveNodeFromList(old_head, node);
+        if (new_head)
+            bucket.heads.push_front(new_head);
+        bucket.waiters.fetch_sub(1, fbl::memory_order_relaxed);
+        return true;
+    }
 }
@@ -63,7 +63,8 @@ FutexNode* FutexNode::RemoveNodeFromList(FutexNode* list_head,
 
 // This removes up to |count| threads from the list specified by |node|,
 // and it wakes those threads.  It returns the new list head (i.e. the list
-// of remaining nodes), which may be null (empty).
+// of remaining nodes), which may be null (empty), and sets |woken_count| to
+// the number of threads woken.
 //
 // This will always remove at least one node, because it requires that
 // |count| is non-zero and |list_head| is a non-empty list.
@@ -71,15 +72,17 @@ FutexNode* FutexNode::RemoveNodeFromList(FutexNode* list_head,
 // RemoveFromHead() is similar, except that it produces a list of removed
 // threads without waking them.
 FutexNode* FutexNode::WakeThreads(FutexNode* node, uint32_t count,
-                                  uintptr_t old_hash_key) {
+                                  uintptr_t old_hash_key, uint32_t* woken_count) {
     ASSERT(node);
     ASSERT(count != 0);
 
     FutexNode* const list_end = node->queue_prev_;
     for (uint32_t i = 0; i < count; i++) {
+        *woken_count = i + 1;
         DEBUG_ASSERT(node->GetKey() == old_hash_key);
-        // Clear this field to avoid any possible confusion.
-        node->set_hash_key(0);
+        // The key is left in place, so that a FutexWait() which times out
+        // while we are waking it locks the same FutexContext bucket as we
+        // hold, and does not return until we are done with |node|.
 
         const bool is_last_node = (node == list_end);
         FutexNode* next = node->queue_next_;
@@ -102,7 +105,8 @@ FutexNode* FutexNode::WakeThreads(FutexNode* node, uint32_t count,
 }
 
 // This removes up to |count| nodes from |list_head|.  It returns the new
-// list head (i.e. the list of remaining nodes), which may be null (empty).
+// list head (i.e. the list of remaining nodes), which may be null (empty),
+// and sets |removed_count| to the number of nodes removed.
 // On return, |list_head| is the list of nodes that were removed --
 // |list_head| remains a valid list.
 //
@@ -113,12 +117,14 @@ FutexNode* FutexNode::WakeThreads(FutexNode* node, uint32_t count,
 // removes from the list.
 FutexNode* FutexNode::RemoveFromHead(FutexNode* list_head, uint32_t count,
                                      uintptr_t old_hash_key,
-                                     uintptr_t new_hash_key) {
+                                     uintptr_t new_hash_key,
+                                     uint32_t* removed_count) {
     ASSERT(list_head);
     ASSERT(count != 0);
 
     FutexNode* node = list_head;
     for (uint32_t i = 0; i < count; i++) {
+        *removed_count = i + 1;
         DEBUG_ASSERT(node->GetKey() == old_hash_key);
         // For requeuing, update the key so that FutexWait() can remove the
         // thread from its current queue if the wait operation times out.
@@ -170,12 +176,12 @@ void FutexNode::WakeThread() {
     // cases to consider:
     //  1) The thread's wait times out, or the thread is killed or
     //     suspended.  In those cases, FutexWait() will reacquire the
-    //     FutexContext lock.  We are currently holding that lock, so
-    //     FutexWait() will not race with us.
+    //     lock of the node's FutexContext bucket.  We are currently
+    //     holding that lock, so FutexWait() will not race with us.
     //  2) The thread is woken by our wait_queue_wake_one() call.  In
-    //     this case, FutexWait() will *not* reacquire the FutexContext
-    //     lock.  To handle this correctly, we must not access |this|
-    //     after wait_queue_wake_one().
+    //     this case, FutexWait() will *not* reacquire the bucket lock.
+    //     To handle this correctly, we must not access |this| after
+    //     wait_queue_wake_one().
 
     // We must do this before we wake the thread, to handle case 2.
     MarkAsNotInQueue();
@@ -19,6 +19,7 @@
 
 #include <kernel/lockdep.h>
 #include <kernel/spinlock.h>
+#include <lib/slab.h>
 #include <object/handle.h>
 #include <object/state_observer.h>
 
@@ -80,7 +81,8 @@ DECLARE_DISPTAG(PagerDispatcher, ZX_OBJ_TYPE_PAGER)
 // You don't derive directly from this class; instead derive
 // from SoloDispatcher or PeeredDispatcher.
 class Dispatcher : private fbl::RefCountedUpgradeable<Dispatcher>,
-                   private fbl::Recyclable<Dispatcher> {
+                   private fbl::Recyclable<Dispatcher>,
+                   public SlabAllocated {
 public:
     using fbl::RefCountedUpgradeable<Dispatcher>::AddRef;
     using fbl::RefCountedUpgradeable<Dispatcher>::Release;
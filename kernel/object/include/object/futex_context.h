@@ -3,6 +3,7 @@
 
 #include <lib/user_copy/user_ptr.h>
 #include <zircon/types.h>
+#include <fbl/atomic.h>
 #include <fbl/mutex.h>
 #include <kernel/lockdep.h>
 #include <object/futex_node.h>
@@ -14,6 +15,9 @@
 // After no threads are left blocked on a futex it is removed from the hash table.
 // The value in the futex hash table is the FutexNode object associated with the head
 // of the list of threads blocked on the futex.
+// The hash table is split into buckets, each with its own lock, so that operations on
+// unrelated futexes do not contend with each other. Each bucket also counts its blocked
+// threads, so that waking a futex which nobody is waiting on takes no lock at all.
 // To avoid memory allocation at futex operation time, a FutexNode is embedded in each
 // ThreadDispatcher object.
 // When the thread at the head of the futex's blocked thread list is resumed,
@@ -73,14 +77,40 @@ private:
     FutexContext(const FutexContext&) = delete;
     FutexContext& operator=(const FutexContext&) = delete;
 
-    void QueueNodesLocked(FutexNode* head) TA_REQ(lock_);
+    // The number of buckets in the hash table. Must be a power of two.
+    static constexpr uint32_t kBucketShift = 5;
+    static constexpr size_t kBucketCount = 1u << kBucketShift;
 
-    bool UnqueueNodeLocked(FutexNode* node) TA_REQ(lock_);
+    struct Bucket {
+        DECLARE_MUTEX(Bucket) lock;
 
-    // protects futex_table_
-    DECLARE_MUTEX(FutexContext) lock_;
+        // The number of threads blocked on futexes in this bucket. This is
+        // written with |lock| held, but FutexWake reads it without the lock.
+        fbl::atomic<uint32_t> waiters{0};
 
-    // Hash table for futexes in this context.
-    // Key is futex address, value is the FutexNode for the head of futex's blocked thread list.
-    FutexNode::HashTable futex_table_ TA_GUARDED(lock_);
+        // The FutexNode for the head of each active futex's blocked thread list.
+        FutexNode::List heads TA_GUARDED(lock);
+    };
+
+    Bucket& BucketFor(uintptr_t futex_key);
+
+    // Removes the list of blocked threads for |futex_key| from |bucket|, and
+    // returns its head, or nullptr if no thread is blocked on the futex.
+    static FutexNode* EraseHeadLocked(Bucket* bucket, uintptr_t futex_key) TA_REQ(bucket->lock);
+
+    static void QueueNodesLocked(Bucket* bucket, FutexNode* head) TA_REQ(bucket->lock);
+
+    // Does the work of FutexRequeue once the locks of both buckets are held.
+    // |wake_bucket| and |requeue_bucket| may be the same bucket.
+    static zx_status_t RequeueLocked(Bucket* wake_bucket, uintptr_t wake_key,
+                                     uint32_t wake_count, zx_futex_t current_value,
+                                     user_in_ptr<const zx_futex_t> wake_ptr,
+                                     Bucket* requeue_bucket, uintptr_t requeue_key,
+                                     uint32_t requeue_count,
+                                     AutoReschedDisable* resched_disable)
+        TA_NO_THREAD_SAFETY_ANALYSIS;
+
+    bool UnqueueNode(FutexNode* node);
+
+    Bucket buckets_[kBucketCount];
 };
@@ -6,14 +6,14 @@
 #include <kernel/wait.h>
 #include <list.h>
 #include <zircon/types.h>
-#include <fbl/intrusive_hash_table.h>
+#include <fbl/intrusive_single_list.h>
 #include <fbl/mutex.h>
 
 // Node for linked list of threads blocked on a futex
 // Intended to be embedded within a ThreadDispatcher Instance
 class FutexNode : public fbl::SinglyLinkedListable<FutexNode*> {
 public:
-    using HashTable = fbl::HashTable<uintptr_t, FutexNode*>;
+    using List = fbl::SinglyLinkedList<FutexNode*>;
 
     FutexNode();
     ~FutexNode();
@@ -30,12 +30,13 @@ public:
     static FutexNode* RemoveNodeFromList(FutexNode* list_head, FutexNode* node);
 
     static FutexNode* WakeThreads(FutexNode* node, uint32_t count,
-                                  uintptr_t old_hash_key);
+                                  uintptr_t old_hash_key, uint32_t* woken_count);
 
     static FutexNode* RemoveFromHead(FutexNode* list_head,
                                      uint32_t count,
                                      uintptr_t old_hash_key,
-                                     uintptr_t new_hash_key);
+                                     uintptr_t new_hash_key,
+                                     uint32_t* removed_count);
 
     // This must be called with a guard held in the calling scope. Releases the
     // guard and does not reacquire it.
@@ -45,9 +46,7 @@ public:
         hash_key_ = key;
     }
 
-    // Trait implementation for fbl::HashTable
     uintptr_t GetKey() const { return hash_key_; }
-    static size_t GetHash(uintptr_t key) { return (key >> 3); }
 
 private:
     static void RelinkAsAdjacent(FutexNode* node1, FutexNode* node2);
@@ -61,8 +60,8 @@ private:
     //  * It is used by FutexWait() to determine which queue to remove the
     //    thread from when a wait operation times out.
     //  * Additionally, when this FutexNode is the head of a futex wait
-    //    queue, this field is used by the HashTable (because it uses
-    //    intrusive SinglyLinkedLists).
+    //    queue, this field identifies the queue within its FutexContext
+    //    bucket.
     uintptr_t hash_key_;
 
     // Used for waking the thread corresponding to the FutexNode.
@@ -3,7 +3,9 @@
 
 #include <stdint.h>
 
+#include <lib/slab.h>
 #include <lib/user_copy/user_ptr.h>
+#include <zircon/time.h>
 #include <zircon/types.h>
 #include <fbl/intrusive_single_list.h>
 
@@ -11,6 +13,9 @@
 //
 // It's designed to back sockets and channels.  Don't simultaneously store stream data and datagrams
 // in a single instance.
+//
+// The chain's capacity starts at kSizeDefault and grows, up to limit(), while its reader keeps up
+// with its writer: see MaybeGrow().
 class MBufChain {
 public:
     MBufChain() = default;
@@ -26,7 +31,7 @@ public:
     // This operation is atomic in that either the entire datagram is written successfully or the
     // chain is unmodified.
     //
-    // Writing a zero-length datagram is an error.
+    // Writing a zero-length datagram, or one larger than kSizeDefault, is an error.
     //
     // Returns an error on failure.
     zx_status_t WriteDatagram(user_in_ptr<const void> src, size_t len, size_t* written);
@@ -58,15 +63,32 @@ public:
         return size_;
     }
 
-    // Returns the maximum number of bytes that can be stored in the chain.
-    size_t max_size() const { return kSizeMax; }
+    // Returns the maximum number of bytes that can currently be stored in the chain.
+    size_t max_size() const { return capacity_; }
+
+    // Returns the largest capacity the chain may grow to.
+    size_t limit() const { return limit_; }
+
+    // Sets the largest capacity the chain may grow to, which must be at least kSizeDefault and
+    // no more than the kernel.socket.rx-buf-limit-max boot option allows. Lowering the limit
+    // below the current capacity lowers the capacity too.
+    zx_status_t set_limit(size_t limit);
+
+    // Called when a write finds no room in the chain. Doubles the capacity, up to limit(), if
+    // the reader has consumed at least a full buffer since the first write which found the
+    // chain full, no more than kGrowWindow ago. Returns true if the capacity grew.
+    bool MaybeGrow();
+
+    // Reads the boot options which bound set_limit().
+    static void InitLimits();
 
 private:
     // An MBuf is a small fixed-size chainable memory buffer.
-    struct MBuf : public fbl::SinglyLinkedListable<MBuf*> {
+    struct MBuf : public fbl::SinglyLinkedListable<MBuf*>, public SlabAllocated {
         // 8 for the linked list and 4 for the explicit uint32_t fields.
         static constexpr size_t kHeaderSize = 8 + (4 * 4);
-        // 16 is for the malloc header.
+        // MBufs come from the 2048 byte slab size class. The 16 bytes once reserved for
+        // the malloc header are kept so that the chain's capacity is unchanged.
         static constexpr size_t kMallocSize = 2048 - 16;
         static constexpr size_t kPayloadSize = kMallocSize - kHeaderSize;
 
@@ -87,7 +109,19 @@ private:
     };
     static_assert(sizeof(MBuf) == MBuf::kMallocSize, "");
 
-    static constexpr size_t kSizeMax = 128 * MBuf::kPayloadSize;
+    // Socket buffers are not charged to any job, so by default a chain may only grow a little
+    // beyond the old fixed capacity. Larger limits must be allowed at boot.
+    static constexpr size_t kSizeDefault = 128 * MBuf::kPayloadSize;
+    static constexpr size_t kSizeLimitDefault = 2 * kSizeDefault;
+    static constexpr size_t kSizeLimitMax = 64 * kSizeDefault;
+    static constexpr zx_duration_t kGrowWindow = ZX_MSEC(10);
+
+    // The largest limit which set_limit() accepts.
+    static size_t limit_max_;
+
+    // The number of free MBufs a chain keeps for reuse. Any more are returned to the slab
+    // allocator, so that a chain which has grown does not hold on to its peak footprint.
+    static constexpr size_t kFreelistMax = 16;
 
     MBuf* AllocMBuf();
     void FreeMBuf(MBuf* buf);
@@ -101,7 +135,16 @@ private:
     static size_t ReadHelper(T* chain, user_out_ptr<void> dst, size_t len, bool datagram);
 
     fbl::SinglyLinkedList<MBuf*> freelist_;
+    size_t freelist_count_ = 0u;
     fbl::SinglyLinkedList<MBuf*> tail_;
     MBuf* head_ = nullptr;
     size_t size_ = 0u;
+
+    size_t capacity_ = kSizeDefault;
+    size_t limit_ = kSizeLimitDefault;
+
+    // The number of bytes consumed since |window_start_|, when a write found the chain full
+    // after the previous window had expired or the chain had grown.
+    size_t drained_ = 0u;
+    zx_time_t window_start_ = 0;
 };
@@ -44,9 +44,12 @@ public:
 
     // Copies the packet's |data_size()| bytes to |buf|.
     // Returns an error if |buf| points to a bad user address.
-    zx_status_t CopyDataTo(user_out_ptr<void> buf) const {
-        return buffer_chain_->CopyOut(buf, payload_offset_, data_size_);
-    }
+    zx_status_t CopyDataTo(user_out_ptr<void> buf) const;
+
+    // Like CopyDataTo, but when the payload is held in whole pages and |buf| is a
+    // page-aligned, writable range of a single VMO mapping, moves the pages into the
+    // VMO rather than copying them. The payload cannot be read again afterwards.
+    zx_status_t TransferDataTo(user_out_ptr<void> buf);
 
     uint32_t num_handles() const { return num_handles_; }
     Handle* const* handles() const { return handles_; }
@@ -61,14 +64,12 @@ public:
             return 0;
         }
         // The first few bytes of the payload are a zx_txid_t.
-        void* payload_start = buffer_chain_->buffers()->front().data() + payload_offset_;
-        return *reinterpret_cast<zx_txid_t*>(payload_start);
+        return *reinterpret_cast<zx_txid_t*>(PayloadStart());
     }
 
     void set_txid(zx_txid_t txid) {
         if (data_size_ >= sizeof(zx_txid_t)) {
-            void* payload_start = buffer_chain_->buffers()->front().data() + payload_offset_;
-            *(reinterpret_cast<zx_txid_t*>(payload_start)) = txid;
+            *(reinterpret_cast<zx_txid_t*>(PayloadStart())) = txid;
         }
     }
 
@@ -78,9 +79,10 @@ private:
     // when a user creates a MessagePacket, they end up with the proper
     // MessagePacket::UPtr type for managing the message packet's life cycle.
     MessagePacket(BufferChain* chain, uint32_t data_size, uint32_t payload_offset,
-                  uint16_t num_handles, Handle** handles)
+                  uint16_t num_handles, Handle** handles, bool page_payload)
         : buffer_chain_(chain), handles_(handles), data_size_(data_size),
-          payload_offset_(payload_offset), num_handles_(num_handles), owns_handles_(false) {}
+          payload_offset_(payload_offset), num_handles_(num_handles), owns_handles_(false),
+          page_payload_(page_payload) {}
 
     // A private destructor helps to make sure that only our custom deleter is
     // ever used to destroy this object which, in turn, makes it very difficult
@@ -101,12 +103,23 @@ private:
     static zx_status_t CreateCommon(uint32_t data_size, uint32_t num_handles,
                                     MessagePacketPtr* msg);
 
+    // Copy |data_size_| bytes from |src| into |payload_pages_|.
+    zx_status_t CopyPagesIn(user_in_ptr<const void> src);
+    void CopyPagesInKernel(const void* src);
+
+    // Returns the first byte of the payload.
+    char* PayloadStart() const;
+
     BufferChain* buffer_chain_;
     Handle** const handles_;
     const uint32_t data_size_;
     const uint32_t payload_offset_;
     const uint16_t num_handles_;
     bool owns_handles_;
+    // If true, the payload is held in |payload_pages_| rather than following the
+    // handles in |buffer_chain_|.
+    const bool page_payload_;
+    list_node payload_pages_ = LIST_INITIAL_VALUE(payload_pages_);
 };
 
 namespace internal {
@@ -15,6 +15,7 @@
 #include <fbl/mutex.h>
 #include <ktl/unique_ptr.h>
 #include <kernel/spinlock.h>
+#include <lib/slab.h>
 
 #include <sys/types.h>
 
@@ -107,7 +108,7 @@ struct PortInterruptPacket final : public fbl::DoublyLinkedListable<PortInterrup
 // Observers are weakly contained in state trackers until |remove_| member
 // is false at the end of one of OnInitialize(), OnStateChange() or OnCancel()
 // callbacks.
-class PortObserver final : public StateObserver {
+class PortObserver final : public StateObserver, public SlabAllocated {
 public:
     PortObserver(uint32_t type, const Handle* handle, fbl::RefPtr<PortDispatcher> port,
                  uint64_t key, zx_signals_t signals);
@@ -149,8 +150,9 @@ private:
 // |packets_| linked list and case 4 uses |interrupt_packets_| linked list.
 //
 // The threads that wish to receive notifications block on Dequeue() (which
-// maps to zx_port_wait()) and will receive packets from any of the four sources
-// depending on what kind of object the port has been 'bound' to.
+// maps to zx_port_wait()) or DequeueMany() (which maps to zx_port_wait_many())
+// and will receive packets from any of the four sources depending on what kind
+// of object the port has been 'bound' to.
 //
 // When a packet from any of the sources arrives to the port, one waiting
 // thread unblocks and gets the packet. In all cases |sema_| is used to signal
@@ -173,6 +175,10 @@ public:
     zx_status_t QueueUser(const zx_port_packet_t& packet);
     bool QueueInterruptPacket(PortInterruptPacket* port_packet, zx_time_t timestamp);
     zx_status_t Dequeue(const Deadline& deadline, zx_port_packet_t* packet);
+    // Like Dequeue(), but removes up to |count| packets which are ready at once,
+    // and sets |actual| to the number removed. Blocks only if none are ready.
+    zx_status_t DequeueMany(const Deadline& deadline, zx_port_packet_t* packets, size_t count,
+                            size_t* actual);
     bool RemoveInterruptPacket(PortInterruptPacket* port_packet);
 
     // Decides who is going to destroy the observer. If it returns the
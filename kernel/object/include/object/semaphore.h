@@ -18,6 +18,10 @@ public:
 
     zx_status_t Wait(const Deadline& deadline);
 
+    // Takes up to |count| posts which are available without blocking, and
+    // returns the number taken. Never takes a post which a waiter needs.
+    int64_t TryWait(int64_t count);
+
 private:
     int64_t count_;
     WaitQueue waitq_;
@@ -59,6 +59,8 @@ public:
     zx_status_t SetReadThreshold(size_t value);
     size_t GetWriteThreshold() const;
     zx_status_t SetWriteThreshold(size_t value);
+    size_t GetReadBufferLimit() const;
+    zx_status_t SetReadBufferLimit(size_t value);
 
     void GetInfo(zx_info_socket_t* info) const;
 
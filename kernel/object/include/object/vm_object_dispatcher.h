@@ -51,6 +51,9 @@ public:
 
     zx_status_t SetMappingCachePolicy(uint32_t cache_policy);
 
+    uint64_t GetReadaheadMax();
+    zx_status_t SetReadaheadMax(uint64_t bytes);
+
     zx_info_vmo_t GetVmoInfo();
 
     const fbl::RefPtr<VmObject>& vmo() const { return vmo_; }
@@ -5,14 +5,34 @@
 
 #include <fbl/algorithm.h>
 #include <fbl/alloc_checker.h>
+#include <kernel/cmdline.h>
 #include <lib/user_copy/user_ptr.h>
+#include <lk/init.h>
+#include <platform.h>
 
 #define LOCAL_TRACE 0
 
 constexpr size_t MBufChain::MBuf::kHeaderSize;
 constexpr size_t MBufChain::MBuf::kMallocSize;
 constexpr size_t MBufChain::MBuf::kPayloadSize;
-constexpr size_t MBufChain::kSizeMax;
+constexpr size_t MBufChain::kSizeDefault;
+constexpr size_t MBufChain::kSizeLimitDefault;
+constexpr size_t MBufChain::kSizeLimitMax;
+constexpr zx_duration_t MBufChain::kGrowWindow;
+constexpr size_t MBufChain::kFreelistMax;
+
+size_t MBufChain::limit_max_ = MBufChain::kSizeLimitDefault;
+
+void MBufChain::InitLimits() {
+    uint64_t max = cmdline_get_uint64("kernel.socket.rx-buf-limit-max", kSizeLimitDefault);
+    limit_max_ = fbl::clamp<size_t>(max, kSizeLimitDefault, kSizeLimitMax);
+}
+
+static void mbuf_init(uint level) {
+    MBufChain::InitLimits();
+}
+
+LK_INIT_HOOK(mbuf, mbuf_init, LK_INIT_LEVEL_KERNEL);
 
 size_t MBufChain::MBuf::rem() const {
     return kPayloadSize - (off_ + len_);
@@ -26,15 +46,44 @@ MBufChain::~MBufChain() {
 }
 
 bool MBufChain::is_full() const {
-    return size_ >= kSizeMax;
+    return size_ >= capacity_;
 }
 
 bool MBufChain::is_empty() const {
     return size_ == 0;
 }
 
+zx_status_t MBufChain::set_limit(size_t limit) {
+    if (limit < kSizeDefault || limit > limit_max_)
+        return ZX_ERR_INVALID_ARGS;
+    limit_ = limit;
+    capacity_ = fbl::min(capacity_, limit_);
+    return ZX_OK;
+}
+
+bool MBufChain::MaybeGrow() {
+    const zx_time_t now = current_time();
+    if (zx_time_sub_time(now, window_start_) > kGrowWindow) {
+        // The reader did not consume a full buffer in time. Measure it again from now, but
+        // not again on each retry of a blocked writer, which would never let it catch up.
+        drained_ = 0u;
+        window_start_ = now;
+        return false;
+    }
+    if (capacity_ >= limit_ || drained_ < capacity_)
+        return false;
+    capacity_ = fbl::min(capacity_ * 2, limit_);
+    drained_ = 0u;
+    window_start_ = now;
+    return true;
+}
+
 size_t MBufChain::Read(user_out_ptr<void> dst, size_t len, bool datagram) {
-    return ReadHelper(this, dst, len, datagram);
+    size_t size_before = size_;
+    size_t st = ReadHelper(this, dst, len, datagram);
+    // Count the bytes which left the chain, including the discarded remainder of a datagram.
+    drained_ += size_before - size_;
+    return st;
 }
 
 size_t MBufChain::Peek(user_out_ptr<void> dst, size_t len, bool datagram) const {
@@ -97,9 +146,11 @@ zx_status_t MBufChain::WriteDatagram(user_in_ptr<const void> src, size_t len,
     if (len == 0) {
         return ZX_ERR_INVALID_ARGS;
     }
-    if (len > kSizeMax)
+    // The capacity never drops below kSizeDefault, so a datagram of that size always fits
+    // eventually, however much the chain has grown.
+    if (len > kSizeDefault)
         return ZX_ERR_OUT_OF_RANGE;
-    if (len + size_ > kSizeMax)
+    if (len + size_ > capacity_)
         return ZX_ERR_SHOULD_WAIT;
 
     fbl::SinglyLinkedList<MBuf*> bufs;
@@ -162,8 +213,8 @@ zx_status_t MBufChain::WriteStream(user_in_ptr<const void> src, size_t len, size
         }
         void* dst = head_->data_ + head_->off_ + head_->len_;
         size_t copy_len = fbl::min(head_->rem(), len - pos);
-        if (size_ + copy_len > kSizeMax) {
-            copy_len = kSizeMax - size_;
+        if (size_ + copy_len > capacity_) {
+            copy_len = capacity_ - size_;
             if (copy_len == 0)
                 break;
         }
@@ -187,11 +238,18 @@ MBufChain::MBuf* MBufChain::AllocMBuf() {
         MBuf* buf = new (&ac) MBuf();
         return (!ac.check()) ? nullptr : buf;
     }
+    freelist_count_--;
     return freelist_.pop_front();
 }
 
 void MBufChain::FreeMBuf(MBuf* buf) {
+    if (freelist_count_ == kFreelistMax) {
+        delete buf;
+        return;
+    }
     buf->off_ = 0u;
     buf->len_ = 0u;
+    buf->pkt_len_ = 0u;
     freelist_.push_front(buf);
+    freelist_count_++;
 }
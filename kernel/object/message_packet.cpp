@@ -3,9 +3,15 @@
 
 #include <err.h>
 #include <fbl/algorithm.h>
+#include <lib/counters.h>
 #include <new>
 #include <stdint.h>
 #include <string.h>
+#include <vm/physmap.h>
+#include <vm/pmm.h>
+#include <vm/vm.h>
+#include <vm/vm_address_region.h>
+#include <vm/vm_aspace.h>
 
 // MessagePackets have special allocation requirements because they can contain a variable number of
 // handles and a variable size payload.
@@ -16,6 +22,20 @@
 //
 // The first buffer in a MessagePacket's BufferChain contains the MessagePacket object, followed by
 // its handles (if any), and finally its payload data (if any).
+//
+// Large payloads which are a whole number of pages are instead stored in whole pages of their own,
+// outside the BufferChain. When such a message is read into a page-aligned buffer of a suitable
+// VMO, the pages are moved into the VMO rather than copied a second time.
+
+KCOUNTER(channel_pages_moved, "kernel.channel.pages_moved");
+
+// The smallest payload which is stored in whole pages. Below this, the cost of remapping the
+// receiver's buffer outweighs the cost of a copy.
+static constexpr uint32_t kPagePayloadThreshold = 4 * PAGE_SIZE;
+
+static inline bool UsePagePayload(uint32_t data_size) {
+    return data_size >= kPagePayloadThreshold && IS_PAGE_ALIGNED(data_size);
+}
 
 // The MessagePacket object, its handles and zx_txid_t must all fit in the first buffer.
 static constexpr size_t kContiguousBytes =
@@ -45,13 +65,28 @@ inline zx_status_t MessagePacket::CreateCommon(uint32_t data_size, uint32_t num_
     }
 
     const uint32_t payload_offset = PayloadOffset(num_handles);
+    const bool page_payload = UsePagePayload(data_size);
 
     // MessagePackets lives *inside* a list of buffers.  The first buffer holds the MessagePacket
     // object, followed by its handles (if any), and finally the payload data.
-    BufferChain* chain = BufferChain::Alloc(payload_offset + data_size);
+    BufferChain* chain = BufferChain::Alloc(payload_offset + (page_payload ? 0 : data_size));
     if (unlikely(!chain)) {
         return ZX_ERR_NO_MEMORY;
     }
+
+    list_node pages = LIST_INITIAL_VALUE(pages);
+    if (page_payload) {
+        zx_status_t status = pmm_alloc_pages(data_size / PAGE_SIZE, 0, &pages);
+        if (unlikely(status != ZX_OK)) {
+            BufferChain::Free(chain);
+            return ZX_ERR_NO_MEMORY;
+        }
+        vm_page_t* page;
+        list_for_every_entry (&pages, page, vm_page_t, queue_node) {
+            DEBUG_ASSERT(page->state == VM_PAGE_STATE_ALLOC);
+            page->state = VM_PAGE_STATE_IPC;
+        }
+    }
     DEBUG_ASSERT(!chain->buffers()->is_empty());
 
     char* const data = chain->buffers()->front().data();
@@ -61,8 +96,10 @@ inline zx_status_t MessagePacket::CreateCommon(uint32_t data_size, uint32_t num_
     MessagePacket* const packet = reinterpret_cast<MessagePacket*>(data);
     static_assert(kMaxMessageHandles <= UINT16_MAX, "");
     msg->reset(new (packet) MessagePacket(chain, data_size, payload_offset,
-                                          static_cast<uint16_t>(num_handles), handles));
-    // The MessagePacket now owns the BufferChain and msg owns the MessagePacket.
+                                          static_cast<uint16_t>(num_handles), handles,
+                                          page_payload));
+    list_move(&pages, &(*msg)->payload_pages_);
+    // The MessagePacket now owns the BufferChain and its pages, and msg owns the MessagePacket.
 
     return ZX_OK;
 }
@@ -75,7 +112,11 @@ zx_status_t MessagePacket::Create(user_in_ptr<const void> data, uint32_t data_si
     if (unlikely(status != ZX_OK)) {
         return status;
     }
-    status = new_msg->buffer_chain_->CopyIn(data, PayloadOffset(num_handles), data_size);
+    if (new_msg->page_payload_) {
+        status = new_msg->CopyPagesIn(data);
+    } else {
+        status = new_msg->buffer_chain_->CopyIn(data, PayloadOffset(num_handles), data_size);
+    }
     if (unlikely(status != ZX_OK)) {
         return status;
     }
@@ -91,18 +132,89 @@ zx_status_t MessagePacket::Create(const void* data, uint32_t data_size, uint32_t
     if (unlikely(status != ZX_OK)) {
         return status;
     }
-    status = new_msg->buffer_chain_->CopyInKernel(data, PayloadOffset(num_handles), data_size);
-    if (unlikely(status != ZX_OK)) {
-        return status;
+    if (new_msg->page_payload_) {
+        new_msg->CopyPagesInKernel(data);
+    } else {
+        status = new_msg->buffer_chain_->CopyInKernel(data, PayloadOffset(num_handles), data_size);
+        if (unlikely(status != ZX_OK)) {
+            return status;
+        }
     }
     *msg = ktl::move(new_msg);
     return ZX_OK;
 }
 
+zx_status_t MessagePacket::CopyPagesIn(user_in_ptr<const void> src) {
+    vm_page_t* page;
+    list_for_every_entry (&payload_pages_, page, vm_page_t, queue_node) {
+        zx_status_t status = src.copy_array_from_user(paddr_to_physmap(page->paddr()), PAGE_SIZE);
+        if (unlikely(status != ZX_OK)) {
+            return status;
+        }
+        src = src.byte_offset(PAGE_SIZE);
+    }
+    return ZX_OK;
+}
+
+void MessagePacket::CopyPagesInKernel(const void* src) {
+    const char* p = static_cast<const char*>(src);
+    vm_page_t* page;
+    list_for_every_entry (&payload_pages_, page, vm_page_t, queue_node) {
+        memcpy(paddr_to_physmap(page->paddr()), p, PAGE_SIZE);
+        p += PAGE_SIZE;
+    }
+}
+
+zx_status_t MessagePacket::CopyDataTo(user_out_ptr<void> buf) const {
+    if (!page_payload_) {
+        return buffer_chain_->CopyOut(buf, payload_offset_, data_size_);
+    }
+    DEBUG_ASSERT(!list_is_empty(&payload_pages_));
+    const vm_page_t* page;
+    list_for_every_entry (&payload_pages_, page, vm_page_t, queue_node) {
+        zx_status_t status = buf.copy_array_to_user(paddr_to_physmap(page->paddr()), PAGE_SIZE);
+        if (unlikely(status != ZX_OK)) {
+            return status;
+        }
+        buf = buf.byte_offset(PAGE_SIZE);
+    }
+    return ZX_OK;
+}
+
+zx_status_t MessagePacket::TransferDataTo(user_out_ptr<void> buf) {
+    if (page_payload_) {
+        const vaddr_t va = reinterpret_cast<vaddr_t>(buf.get());
+        if (IS_PAGE_ALIGNED(va) && is_user_address_range(va, data_size_)) {
+            VmAspace* aspace = VmAspace::vaddr_to_aspace(va);
+            fbl::RefPtr<VmAddressRegionOrMapping> region =
+                aspace ? aspace->FindRegion(va) : nullptr;
+            fbl::RefPtr<VmMapping> mapping = region ? region->as_vm_mapping() : nullptr;
+            // On failure the pages are left in |payload_pages_| and the payload is copied below.
+            if (mapping && mapping->ReplacePages(va, data_size_, &payload_pages_) == ZX_OK) {
+                kcounter_add(channel_pages_moved, data_size_ / PAGE_SIZE);
+                return ZX_OK;
+            }
+        }
+    }
+    return CopyDataTo(buf);
+}
+
+char* MessagePacket::PayloadStart() const {
+    if (page_payload_) {
+        DEBUG_ASSERT(!list_is_empty(&payload_pages_));
+        const vm_page_t* page = containerof(payload_pages_.next, vm_page_t, queue_node);
+        return static_cast<char*>(paddr_to_physmap(page->paddr()));
+    }
+    return buffer_chain_->buffers()->front().data() + payload_offset_;
+}
+
 void MessagePacket::recycle(MessagePacket* packet) {
     // Grab the buffer chain for this packet
     BufferChain* chain = packet->buffer_chain_;
 
+    // Free any payload pages which were not moved into a receiver's VMO.
+    pmm_free(&packet->payload_pages_);
+
     // Manually destruct the packet.  Do not delete it; its memory did not come
     // from new, it is contained as part of the buffer chain.
     packet->~MessagePacket();
@@ -78,7 +78,7 @@ PortPacket::PortPacket(const void* handle, PortAllocator* allocator)
     // Note that packet is initialized to zeros.
     if (handle) {
         // Currently |handle| is only valid if the packets are not ephemeral
-        // which means that PortObserver always uses the kernel heap.
+        // which means that the packet is owned by a PortObserver.
         DEBUG_ASSERT(allocator == nullptr);
     }
 }
@@ -295,50 +295,79 @@ zx_status_t PortDispatcher::Queue(PortPacket* port_packet, zx_signals_t observed
 
 zx_status_t PortDispatcher::Dequeue(const Deadline& deadline,
                                     zx_port_packet_t* out_packet) {
+    size_t actual;
+    return DequeueMany(deadline, out_packet, 1, &actual);
+}
+
+zx_status_t PortDispatcher::DequeueMany(const Deadline& deadline, zx_port_packet_t* out_packets,
+                                        size_t count, size_t* actual) {
     canary_.Assert();
+    DEBUG_ASSERT(count > 0);
 
     while (true) {
+        // Every queued packet posts |sema_| once, so a successful wait means a packet was queued.
+        // It may already have been removed by another waiter's batch or by CancelQueued(), in
+        // which case the queues are empty and the loop waits again.
+        {
+            ThreadDispatcher::AutoBlocked by(ThreadDispatcher::Blocked::PORT);
+            zx_status_t st = sema_.Wait(deadline);
+            if (st != ZX_OK)
+                return st;
+        }
+
+        size_t n = 0;
         if (options_ == ZX_PORT_BIND_TO_INTERRUPT) {
             Guard<SpinLock, IrqSave> guard{&spinlock_};
-            PortInterruptPacket* port_interrupt_packet = interrupt_packets_.pop_front();
-            if (port_interrupt_packet != nullptr) {
+            while (n < count) {
+                PortInterruptPacket* port_interrupt_packet = interrupt_packets_.pop_front();
+                if (port_interrupt_packet == nullptr) {
+                    break;
+                }
+                zx_port_packet_t* out_packet = &out_packets[n++];
                 *out_packet = {};
                 out_packet->key = port_interrupt_packet->key;
                 out_packet->type = ZX_PKT_TYPE_INTERRUPT;
                 out_packet->status = ZX_OK;
                 out_packet->interrupt.timestamp = port_interrupt_packet->timestamp;
-                return ZX_OK;
             }
         }
-        {
-            Guard<fbl::Mutex> guard{get_lock()};
-            PortPacket* port_packet = packets_.pop_front();
-            if (port_packet != nullptr) {
-                --num_packets_;
-                *out_packet = port_packet->packet;
-
-                bool is_ephemeral = port_packet->is_ephemeral();
-                // The reference to the port that the observer holds cannot be the last one
-                // because another reference was used to call Dequeue, so we don't need to
-                // worry about destroying ourselves.
-                port_packet->observer.reset();
-                guard.Release();
-
-                // If the packet is ephemeral, free it outside of the lock. We need to read
-                // is_ephemeral inside the lock because it's possible for a non-ephemeral packet
-                // to get deleted after a call to |MaybeReap| as soon as we release the lock.
-                if (is_ephemeral) {
-                    port_packet->Free();
+        if (n < count) {
+            fbl::DoublyLinkedList<PortPacket*> ephemeral;
+            {
+                Guard<fbl::Mutex> guard{get_lock()};
+                while (n < count) {
+                    PortPacket* port_packet = packets_.pop_front();
+                    if (port_packet == nullptr) {
+                        break;
+                    }
+                    --num_packets_;
+                    out_packets[n++] = port_packet->packet;
+
+                    // The reference to the port that the observer holds cannot be the last one
+                    // because another reference was used to call Dequeue, so we don't need to
+                    // worry about destroying ourselves.
+                    port_packet->observer.reset();
+
+                    // If the packet is ephemeral, free it outside of the lock. We need to read
+                    // is_ephemeral inside the lock because it's possible for a non-ephemeral
+                    // packet to get deleted after a call to |MaybeReap| as soon as we release
+                    // the lock.
+                    if (port_packet->is_ephemeral()) {
+                        ephemeral.push_back(port_packet);
+                    }
                 }
-                return ZX_OK;
+            }
+            while (!ephemeral.is_empty()) {
+                ephemeral.pop_front()->Free();
             }
         }
-
-        {
-            ThreadDispatcher::AutoBlocked by(ThreadDispatcher::Blocked::PORT);
-            zx_status_t st = sema_.Wait(deadline);
-            if (st != ZX_OK)
-                return st;
+        if (n > 0) {
+            // The wait above took one post; take the ones made by the rest of the batch too, so
+            // that the next wait blocks until another packet is queued. Posts which another
+            // waiter already took are left to it.
+            sema_.TryWait(static_cast<int64_t>(n - 1));
+            *actual = n;
+            return ZX_OK;
         }
     }
 }
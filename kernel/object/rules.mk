@@ -63,5 +63,6 @@ MODULE_DEPS := \
     kernel/lib/oom \
     kernel/lib/pretty \
     kernel/lib/region-alloc \
+    kernel/lib/slab \
 
 include make/module.mk
@@ -45,3 +45,12 @@ zx_status_t Semaphore::Wait(const Deadline& deadline) {
 
     return ret;
 }
+
+int64_t Semaphore::TryWait(int64_t count) {
+    Guard<spin_lock_t, IrqSave> guard{ThreadLock::Get()};
+    int64_t taken = count_ < count ? count_ : count;
+    if (taken <= 0)
+        return 0;
+    count_ -= taken;
+    return taken;
+}
@@ -262,6 +262,12 @@ zx_status_t SocketDispatcher::WriteSelfLocked(user_in_ptr<const void> src, size_
                                               size_t* written) TA_NO_THREAD_SAFETY_ANALYSIS {
     canary_.Assert();
 
+    // If there is no room for this write, see whether the reader has been keeping up well
+    // enough to earn a larger buffer.
+    const bool no_room = (flags_ & ZX_SOCKET_DATAGRAM) ? data_.size() + len > data_.max_size()
+                                                       : is_full();
+    const bool grew = no_room && data_.MaybeGrow();
+
     if (is_full())
         return ZX_ERR_SHOULD_WAIT;
 
@@ -301,8 +307,14 @@ zx_status_t SocketDispatcher::WriteSelfLocked(user_in_ptr<const void> src, size_
     if (peer_ && is_full())
         clear |= ZX_SOCKET_WRITABLE;
 
-    if (clear)
-        peer_->UpdateStateLocked(clear, 0u);
+    // A write which found the buffer full cleared the writer's signal; if the buffer has
+    // since grown, there is room again.
+    set = 0u;
+    if (peer_ && grew && !is_full())
+        set |= ZX_SOCKET_WRITABLE;
+
+    if (clear || set)
+        peer_->UpdateStateLocked(clear, set);
 
     *written = st;
     return status;
@@ -520,6 +532,18 @@ zx_status_t SocketDispatcher::SetReadThreshold(size_t value) TA_NO_THREAD_SAFETY
     return ZX_OK;
 }
 
+size_t SocketDispatcher::GetReadBufferLimit() const TA_NO_THREAD_SAFETY_ANALYSIS {
+    canary_.Assert();
+    Guard<fbl::Mutex> guard{get_lock()};
+    return data_.limit();
+}
+
+zx_status_t SocketDispatcher::SetReadBufferLimit(size_t value) TA_NO_THREAD_SAFETY_ANALYSIS {
+    canary_.Assert();
+    Guard<fbl::Mutex> guard{get_lock()};
+    return data_.set_limit(value);
+}
+
 zx_status_t SocketDispatcher::SetWriteThreshold(size_t value) TA_NO_THREAD_SAFETY_ANALYSIS {
     canary_.Assert();
     Guard<fbl::Mutex> guard{get_lock()};
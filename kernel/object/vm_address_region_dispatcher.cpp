@@ -74,6 +74,10 @@ zx_status_t split_syscall_flags(uint32_t flags, uint32_t* vmar_flags, uint* arch
         vmar |= VMAR_FLAG_REQUIRE_NON_RESIZABLE;
         flags &= ~ZX_VM_REQUIRE_NON_RESIZABLE;
     }
+    if (flags & ZX_VM_HINT_LARGE_PAGES) {
+        vmar |= VMAR_FLAG_LARGE_PAGES;
+        flags &= ~ZX_VM_HINT_LARGE_PAGES;
+    }
 
     if (flags != 0)
         return ZX_ERR_INVALID_ARGS;
@@ -183,11 +187,31 @@ zx_status_t VmAddressRegionDispatcher::Map(size_t vmar_offset, fbl::RefPtr<VmObj
             return ZX_ERR_NOT_SUPPORTED;
     }
 
+    // Large pages can only be used where the mapping and the vmo agree on
+    // alignment, so when the kernel is picking the address align the base
+    // to match the vmo offset. The hint is dropped where it cannot help.
+    uint8_t align_pow2 = 0;
+    if (vmar_flags & VMAR_FLAG_LARGE_PAGES) {
+        if (!vmo->is_paged() || len < kLargePageSize) {
+            vmar_flags &= ~VMAR_FLAG_LARGE_PAGES;
+        } else if (!(vmar_flags & VMAR_FLAG_SPECIFIC) &&
+                   IS_ALIGNED(vmo_offset, kLargePageSize)) {
+            align_pow2 = kLargePageSizeShift;
+        }
+    }
+
     fbl::RefPtr<VmMapping> result(nullptr);
-    status = vmar_->CreateVmMapping(vmar_offset, len, /* align_pow2 */ 0,
-                                    vmar_flags, ktl::move(vmo), vmo_offset,
+    status = vmar_->CreateVmMapping(vmar_offset, len, align_pow2,
+                                    vmar_flags, vmo, vmo_offset,
                                     arch_mmu_flags, "useralloc",
                                     &result);
+    if (status == ZX_ERR_NO_MEMORY && align_pow2 != 0) {
+        // no aligned gap left; the mapping still works, just without large pages
+        status = vmar_->CreateVmMapping(vmar_offset, len, /* align_pow2 */ 0,
+                                        vmar_flags, ktl::move(vmo), vmo_offset,
+                                        arch_mmu_flags, "useralloc",
+                                        &result);
+    }
     if (status != ZX_OK) {
         return status;
     }
@@ -184,6 +184,14 @@ zx_status_t VmObjectDispatcher::SetMappingCachePolicy(uint32_t cache_policy) {
     return vmo_->SetMappingCachePolicy(cache_policy);
 }
 
+uint64_t VmObjectDispatcher::GetReadaheadMax() {
+    return vmo_->GetReadaheadMax();
+}
+
+zx_status_t VmObjectDispatcher::SetReadaheadMax(uint64_t bytes) {
+    return vmo_->SetReadaheadMax(bytes);
+}
+
 zx_status_t VmObjectDispatcher::Clone(uint32_t options, uint64_t offset, uint64_t size,
         bool copy_name, fbl::RefPtr<VmObject>* clone_vmo) {
     canary_.Assert();
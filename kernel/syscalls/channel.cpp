@@ -150,7 +150,7 @@ static zx_status_t channel_read(zx_handle_t handle_value, uint32_t options,
         return result;
 
     if (num_bytes > 0u) {
-        if (msg->CopyDataTo(bytes) != ZX_OK)
+        if (msg->TransferDataTo(bytes) != ZX_OK)
             return ZX_ERR_INVALID_ARGS;
     }
 
@@ -207,7 +207,7 @@ static zx_status_t channel_read_out(ProcessDispatcher* up,
         return status;
 
     if (num_bytes > 0u) {
-        if (reply->CopyDataTo(make_user_out_ptr(args->rd_bytes)) != ZX_OK) {
+        if (reply->TransferDataTo(make_user_out_ptr(args->rd_bytes)) != ZX_OK) {
             return ZX_ERR_INVALID_ARGS;
         }
     }
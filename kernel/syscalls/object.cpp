@@ -688,6 +688,24 @@ zx_status_t sys_object_get_property(zx_handle_t handle_value, uint32_t property,
         size_t value = socket->GetWriteThreshold();
         return _value.reinterpret<size_t>().copy_to_user(value);
     }
+    case ZX_PROP_SOCKET_RX_BUF_LIMIT: {
+        if (size < sizeof(size_t))
+            return ZX_ERR_BUFFER_TOO_SMALL;
+        auto socket = DownCastDispatcher<SocketDispatcher>(&dispatcher);
+        if (!socket)
+            return ZX_ERR_WRONG_TYPE;
+        size_t value = socket->GetReadBufferLimit();
+        return _value.reinterpret<size_t>().copy_to_user(value);
+    }
+    case ZX_PROP_VMO_READAHEAD_MAX: {
+        if (size < sizeof(size_t))
+            return ZX_ERR_BUFFER_TOO_SMALL;
+        auto vmo = DownCastDispatcher<VmObjectDispatcher>(&dispatcher);
+        if (!vmo)
+            return ZX_ERR_WRONG_TYPE;
+        size_t value = vmo->GetReadaheadMax();
+        return _value.reinterpret<size_t>().copy_to_user(value);
+    }
     default:
         return ZX_ERR_INVALID_ARGS;
     }
@@ -798,6 +816,30 @@ zx_status_t sys_object_set_property(zx_handle_t handle_value, uint32_t property,
             return status;
         return socket->SetWriteThreshold(value);
     }
+    case ZX_PROP_SOCKET_RX_BUF_LIMIT: {
+        if (size < sizeof(size_t))
+            return ZX_ERR_BUFFER_TOO_SMALL;
+        auto socket = DownCastDispatcher<SocketDispatcher>(&dispatcher);
+        if (!socket)
+            return ZX_ERR_WRONG_TYPE;
+        size_t value = 0;
+        zx_status_t status = _value.reinterpret<const size_t>().copy_from_user(&value);
+        if (status != ZX_OK)
+            return status;
+        return socket->SetReadBufferLimit(value);
+    }
+    case ZX_PROP_VMO_READAHEAD_MAX: {
+        if (size < sizeof(size_t))
+            return ZX_ERR_BUFFER_TOO_SMALL;
+        auto vmo = DownCastDispatcher<VmObjectDispatcher>(&dispatcher);
+        if (!vmo)
+            return ZX_ERR_WRONG_TYPE;
+        size_t value = 0;
+        zx_status_t status = _value.reinterpret<const size_t>().copy_from_user(&value);
+        if (status != ZX_OK)
+            return status;
+        return vmo->SetReadaheadMax(value);
+    }
     case ZX_PROP_JOB_KILL_ON_OOM: {
         auto job = DownCastDispatcher<JobDispatcher>(&dispatcher);
         if (!job)
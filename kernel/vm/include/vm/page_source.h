@@ -56,8 +56,13 @@ public:
     // Returns ZX_ERR_NEXT if the PageRequest is in batch mode and the caller
     // can continue to add more pages to the request.
     // Returns ZX_ERR_NOT_FOUND if the request cannot be fulfilled.
+    //
+    // |readahead_limit| is the number of bytes starting at |offset| which the vm object
+    // is missing and which may be requested along with the page if the faults look
+    // sequential. Zero disables readahead. Batched requests never read ahead.
     zx_status_t GetPage(uint64_t offset, PageRequest* req,
-                        vm_page_t** const page_out, paddr_t* const pa_out);
+                        vm_page_t** const page_out, paddr_t* const pa_out,
+                        uint64_t readahead_limit = 0);
 
     // Called to complete a batched PageRequest if the last call to GetPage
     // returned ZX_ERR_NEXT.
@@ -113,11 +118,20 @@ private:
     // is keyed by the end offset of the requests (not the start offsets).
     fbl::WAVLTree<uint64_t, PageRequest*> outstanding_requests_ TA_GUARDED(page_source_mtx_);
 
+    // Readahead state. Faults at |ra_next_offset_| continue a sequential stream and grow the
+    // window, anything else resets it.
+    uint64_t ra_next_offset_ TA_GUARDED(page_source_mtx_) = 0;
+    uint64_t ra_window_ TA_GUARDED(page_source_mtx_) = 0;
+
 #ifdef DEBUG_ASSERT_IMPLEMENTED
     // Tracks the request currently being processed (only used for verifying batching assertions).
     PageRequest* current_request_ TA_GUARDED(page_source_mtx_) = nullptr;
 #endif // DEBUG_ASSERT_IMPLEMENTED
 
+    // Returns the length of the read request to send for a fault at |offset|, updating the
+    // readahead state.
+    uint64_t ReadaheadLocked(uint64_t offset, uint64_t limit) TA_REQ(page_source_mtx_);
+
     // Sends a read request to the backing source, or queues the request if the needed
     // region has already been requested from the source.
     void RaiseReadRequestLocked(PageRequest* request) TA_REQ(page_source_mtx_);
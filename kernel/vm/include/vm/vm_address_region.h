@@ -39,6 +39,13 @@
 #define VMAR_FLAG_CAN_MAP_EXECUTE (1 << 6)
 // Require that VMO backing the mapping is non-resizable.
 #define VMAR_FLAG_REQUIRE_NON_RESIZABLE (1 << 7)
+// When on a VmMapping, back aligned portions of the mapping with large pages
+// where possible. Only a hint; the mapping falls back to base pages.
+#define VMAR_FLAG_LARGE_PAGES (1 << 8)
+
+// Size of the runs committed and mapped as a unit for VMAR_FLAG_LARGE_PAGES.
+static constexpr uint8_t kLargePageSizeShift = 21;
+static constexpr size_t kLargePageSize = 1UL << kLargePageSizeShift;
 
 #define VMAR_CAN_RWX_FLAGS (VMAR_FLAG_CAN_MAP_READ |  \
                             VMAR_FLAG_CAN_MAP_WRITE | \
@@ -429,6 +436,11 @@ public:
     // offset modification and locking.
     zx_status_t DecommitRange(size_t offset, size_t len);
 
+    // Convenience wrapper for vmo()->ReplacePages() for the range [base, base + len)
+    // of this mapping, which must be writable, with the necessary offset
+    // modification and locking.
+    zx_status_t ReplacePages(vaddr_t base, size_t len, list_node* pages);
+
     // Map in pages from the underlying vm object, optionally committing pages as it goes
     zx_status_t MapRange(size_t offset, size_t len, bool commit);
 
@@ -485,6 +497,14 @@ private:
     // Version of AllocatedPages() that does not acquire the aspace lock
     size_t AllocatedPagesLocked() const override;
 
+    // Map, read-only, the pages surrounding the just faulted |va| that the vm object already
+    // has resident and that are not yet mapped. Best effort; failures are ignored.
+    void FaultAroundLocked(vaddr_t va, uint mmu_flags);
+
+    // For VMAR_FLAG_LARGE_PAGES mappings, map the whole large page around |va| with a single
+    // translation. Returns an error if that isn't possible and base pages should be used.
+    zx_status_t LargePageFaultLocked(vaddr_t va, uint pf_flags);
+
     void Activate() override;
 
     // Version of Activate that does not take the object_ lock.
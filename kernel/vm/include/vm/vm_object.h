@@ -123,6 +123,14 @@ public:
         return ZX_ERR_NOT_SUPPORTED;
     }
 
+    // Replaces the pages of this vmo in the range [offset, offset + len) with |pages|, in
+    // order, and frees the pages which were replaced. This is equivalent to writing the
+    // contents of |pages| to the range, so it is only supported where no other object
+    // shares the pages of the range. On failure, |pages| is unchanged.
+    virtual zx_status_t ReplacePages(uint64_t offset, uint64_t len, list_node* pages) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
     // The associated VmObjectDispatcher will set an observer to notify user mode.
     void SetChildObserver(VmObjectChildObserver* child_observer);
 
@@ -166,6 +174,13 @@ public:
         return ZX_ERR_NOT_SUPPORTED;
     }
 
+    // Maximum number of bytes that may be requested from the page source ahead of
+    // sequential faults. Zero disables readahead.
+    virtual uint64_t GetReadaheadMax() { return 0; }
+    virtual zx_status_t SetReadaheadMax(uint64_t bytes) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
     // create a copy-on-write clone vmo at the page-aligned offset and length
     // note: it's okay to start or extend past the size of the parent
     virtual zx_status_t CloneCOW(bool resizable,
@@ -208,6 +223,16 @@ public:
         return ZX_ERR_NOT_SUPPORTED;
     }
 
+    // Looks up an aligned, physically contiguous run of kLargePageSize bytes
+    // backing |offset|, returning its base in |pa|. If |commit| is set and none
+    // of the run is committed yet, a new run is allocated. Objects that cannot
+    // provide such a run return ZX_ERR_NOT_SUPPORTED and the caller falls back
+    // to base pages.
+    virtual zx_status_t GetLargePageLocked(uint64_t offset, bool commit,
+                                           paddr_t* pa) TA_REQ(lock_) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
     Lock<fbl::Mutex>* lock() TA_RET_CAP(lock_) { return &lock_; }
     Lock<fbl::Mutex>& lock_ref() TA_RET_CAP(lock_) { return lock_; }
 
@@ -86,6 +86,7 @@ public:
 
     zx_status_t TakePages(uint64_t offset, uint64_t len, VmPageSpliceList* pages) override;
     zx_status_t SupplyPages(uint64_t offset, uint64_t len, VmPageSpliceList* pages) override;
+    zx_status_t ReplacePages(uint64_t offset, uint64_t len, list_node* pages) override;
 
     void Dump(uint depth, bool verbose) override;
 
@@ -99,6 +100,9 @@ public:
         // Calls a Locked method of the parent, which confuses analysis.
         TA_NO_THREAD_SAFETY_ANALYSIS;
 
+    zx_status_t GetLargePageLocked(uint64_t offset, bool commit, paddr_t* pa) override
+        TA_REQ(lock_);
+
     zx_status_t CloneCOW(bool resizable, uint64_t offset, uint64_t size, bool copy_name,
                          fbl::RefPtr<VmObject>* clone_vmo) override
         // Calls a Locked method of the child, which confuses analysis.
@@ -111,11 +115,17 @@ public:
     uint32_t GetMappingCachePolicy() const override;
     zx_status_t SetMappingCachePolicy(const uint32_t cache_policy) override;
 
+    uint64_t GetReadaheadMax() override;
+    zx_status_t SetReadaheadMax(uint64_t bytes) override;
+
     void DetachSource() override {
         DEBUG_ASSERT(page_source_);
         page_source_->Detach();
     }
 
+    // Upper bound for SetReadaheadMax().
+    static constexpr uint64_t kMaxReadahead = 2 * 1024 * 1024;
+
     // The size is clamped to allow VmPageList to use a one-past-the-end for
     // VmPageListNode offsets.
     static const uint64_t MAX_SIZE = ROUNDDOWN(UINT64_MAX, VmPageListNode::kPageFanOut * PAGE_SIZE);
@@ -154,6 +164,9 @@ private:
         // Walks the clone chain to get the root page source, which confuses analysis.
         TA_NO_THREAD_SAFETY_ANALYSIS;
 
+    // length of the run of absent pages at |offset|, bounded by readahead_max_
+    uint64_t ReadaheadLimitLocked(uint64_t offset) TA_REQ(lock_);
+
     // internal check if any pages in a range are pinned
     bool AnyPagesPinnedLocked(uint64_t offset, size_t len) TA_REQ(lock_);
 
@@ -173,6 +186,7 @@ private:
     uint64_t parent_offset_ TA_GUARDED(lock_) = 0;
     uint32_t pmm_alloc_flags_ TA_GUARDED(lock_) = PMM_ALLOC_FLAG_ANY;
     uint32_t cache_policy_ TA_GUARDED(lock_) = ARCH_MMU_FLAG_CACHED;
+    uint64_t readahead_max_ TA_GUARDED(lock_) = 0;
 
     // The page source, if any.
     const fbl::RefPtr<PageSource> page_source_;
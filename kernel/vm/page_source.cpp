@@ -1,12 +1,22 @@
 
+#include <fbl/algorithm.h>
 #include <fbl/auto_lock.h>
 #include <kernel/lockdep.h>
 #include <ktl/move.h>
+#include <lib/counters.h>
 #include <trace.h>
 #include <vm/page_source.h>
 
 #define LOCAL_TRACE 0
 
+KCOUNTER(pager_readahead_hit, "kernel.pager.readahead.hit");
+KCOUNTER(pager_readahead_miss, "kernel.pager.readahead.miss");
+KCOUNTER(pager_readahead_pages, "kernel.pager.readahead.pages");
+
+// Size of the readahead window once a fault stream is first seen to be sequential. The window
+// doubles on every further sequential fault, up to the limit given by the vm object.
+static constexpr uint64_t kInitialReadaheadWindow = 4 * PAGE_SIZE;
+
 PageSource::PageSource() {
     LTRACEF("%p\n", this);
 }
@@ -116,7 +126,8 @@ void PageSource::OnPagesSupplied(uint64_t offset, uint64_t len) {
 }
 
 zx_status_t PageSource::GetPage(uint64_t offset, PageRequest* request,
-                                vm_page_t** const page_out, paddr_t* const pa_out) {
+                                vm_page_t** const page_out, paddr_t* const pa_out,
+                                uint64_t readahead_limit) {
     canary_.Assert();
     ASSERT(request);
 
@@ -180,7 +191,7 @@ zx_status_t PageSource::GetPage(uint64_t offset, PageRequest* request,
             res = ZX_ERR_SHOULD_WAIT;
         }
     } else {
-        request->len_ = PAGE_SIZE;
+        request->len_ = ReadaheadLocked(offset, readahead_limit);
         send_request = true;
         res = ZX_ERR_SHOULD_WAIT;
     }
@@ -192,6 +203,46 @@ zx_status_t PageSource::GetPage(uint64_t offset, PageRequest* request,
     return res;
 }
 
+uint64_t PageSource::ReadaheadLocked(uint64_t offset, uint64_t limit) {
+    if (limit == 0) {
+        return PAGE_SIZE;
+    }
+    DEBUG_ASSERT(IS_PAGE_ALIGNED(limit));
+
+    // If the page is already part of an outstanding request, this one will just wait
+    // on it and says nothing about the access pattern.
+    auto next = outstanding_requests_.upper_bound(offset);
+    if (next.IsValid() && next->offset_ <= offset) {
+        return PAGE_SIZE;
+    }
+
+    if (offset == ra_next_offset_) {
+        if (ra_window_ == 0) {
+            ra_window_ = kInitialReadaheadWindow;
+        } else if (ra_window_ < limit) {
+            ra_window_ *= 2;
+        }
+        kcounter_add(pager_readahead_hit, 1);
+    } else {
+        ra_window_ = 0;
+        kcounter_add(pager_readahead_miss, 1);
+    }
+
+    uint64_t len = fbl::max(fbl::min(ra_window_, limit), static_cast<uint64_t>(PAGE_SIZE));
+
+    // Don't run into a request that's already outstanding; RaiseReadRequestLocked relies on
+    // new requests either starting inside an outstanding one or not overlapping any.
+    if (next.IsValid()) {
+        len = fbl::min(len, next->offset_ - offset);
+    }
+
+    LTRACEF("%p offset %lx window %lx len %lx\n", this, offset, ra_window_, len);
+
+    ra_next_offset_ = offset + len;
+    kcounter_add(pager_readahead_pages, (len / PAGE_SIZE) - 1);
+    return len;
+}
+
 zx_status_t PageSource::FinalizeRequest(PageRequest* request) {
     LTRACEF("%p\n", this);
     DEBUG_ASSERT(request->offset_ != UINT64_MAX);
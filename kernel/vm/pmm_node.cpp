@@ -3,6 +3,7 @@
 
 #include <inttypes.h>
 #include <kernel/mp.h>
+#include <lib/counters.h>
 #include <new>
 #include <trace.h>
 #include <vm/bootalloc.h>
@@ -12,6 +13,12 @@
 
 #define LOCAL_TRACE MAX(VM_GLOBAL_TRACE, 0)
 
+KCOUNTER(pmm_cache_alloc_hit, "kernel.pmm.cache.alloc_hit");
+KCOUNTER(pmm_cache_alloc_miss, "kernel.pmm.cache.alloc_miss");
+KCOUNTER(pmm_cache_refill, "kernel.pmm.cache.refill");
+KCOUNTER(pmm_cache_spill, "kernel.pmm.cache.spill");
+KCOUNTER(pmm_cache_drain, "kernel.pmm.cache.drain_all");
+
 namespace {
 
 void set_state_alloc(vm_page* page) {
@@ -87,16 +94,127 @@ void PmmNode::AddFreePages(list_node* list) TA_NO_THREAD_SAFETY_ANALYSIS {
     LTRACEF("free count now %" PRIu64 "\n", free_count_);
 }
 
-zx_status_t PmmNode::AllocPage(uint alloc_flags, vm_page_t** page_out, paddr_t* pa_out) {
+vm_page* PmmNode::AllocPageFromCache() {
+    PageCache& cache = LocalPageCache();
+
+    Guard<SpinLock, IrqSave> guard{&cache.lock};
+    vm_page* page = list_remove_head_type(&cache.free_list, vm_page, queue_node);
+    if (page) {
+        DEBUG_ASSERT(cache.count > 0);
+        cache.count--;
+    }
+    return page;
+}
+
+void PmmNode::RefillPageCache() {
+    list_node batch = LIST_INITIAL_VALUE(batch);
+    size_t count = 0;
+    {
+        Guard<fbl::Mutex> guard{&lock_};
+        while (count < kPageCacheBatch) {
+            vm_page* page = list_remove_head_type(&free_list_, vm_page, queue_node);
+            if (!page) {
+                break;
+            }
+            DEBUG_ASSERT(free_count_ > 0);
+            free_count_--;
+            list_add_tail(&batch, &page->queue_node);
+            count++;
+        }
+    }
+
+    if (count == 0) {
+        return;
+    }
+
+    kcounter_add(pmm_cache_refill, 1);
+
+    // we may have migrated while holding lock_, in which case the batch simply lands in the
+    // cache of the cpu we are on now
+    PageCache& cache = LocalPageCache();
+    Guard<SpinLock, IrqSave> guard{&cache.lock};
+    list_splice_after(&batch, &cache.free_list);
+    cache.count += count;
+}
+
+void PmmNode::FreePageToCache(vm_page* page) {
+    list_node spill = LIST_INITIAL_VALUE(spill);
+    size_t spill_count = 0;
+    {
+        PageCache& cache = LocalPageCache();
+        Guard<SpinLock, IrqSave> guard{&cache.lock};
+        list_add_head(&cache.free_list, &page->queue_node);
+        cache.count++;
+
+        // once the cache is full hand the coldest batch back to the shared free list
+        if (cache.count > kPageCacheMax) {
+            while (spill_count < kPageCacheBatch) {
+                vm_page* p = list_remove_tail_type(&cache.free_list, vm_page, queue_node);
+                list_add_head(&spill, &p->queue_node);
+                spill_count++;
+            }
+            cache.count -= spill_count;
+        }
+    }
+
+    if (spill_count == 0) {
+        return;
+    }
+
+    kcounter_add(pmm_cache_spill, 1);
+
     Guard<fbl::Mutex> guard{&lock_};
+    list_splice_after(&spill, &free_list_);
+    free_count_ += spill_count;
+}
 
-    vm_page* page = list_remove_head_type(&free_list_, vm_page, queue_node);
-    if (!page) {
-        return ZX_ERR_NO_MEMORY;
+void PmmNode::DrainPageCachesLocked() {
+    kcounter_add(pmm_cache_drain, 1);
+
+    for (auto& cache : page_cache_) {
+        Guard<SpinLock, IrqSave> guard{&cache.lock};
+        if (cache.count == 0) {
+            continue;
+        }
+        list_splice_after(&cache.free_list, &free_list_);
+        free_count_ += cache.count;
+        cache.count = 0;
+    }
+}
+
+// okay if accessed outside of a lock
+uint64_t PmmNode::CountCachedPages() const TA_NO_THREAD_SAFETY_ANALYSIS {
+    uint64_t count = 0;
+    for (const auto& cache : page_cache_) {
+        count += cache.count;
+    }
+    return count;
+}
+
+zx_status_t PmmNode::AllocPage(uint alloc_flags, vm_page_t** page_out, paddr_t* pa_out) {
+    vm_page* page = AllocPageFromCache();
+    if (page) {
+        kcounter_add(pmm_cache_alloc_hit, 1);
+    } else {
+        kcounter_add(pmm_cache_alloc_miss, 1);
+
+        RefillPageCache();
+        page = AllocPageFromCache();
     }
 
-    DEBUG_ASSERT(free_count_ > 0);
-    free_count_--;
+    if (!page) {
+        // the shared free list is empty, but other cpus may still be holding on to free pages
+        Guard<fbl::Mutex> guard{&lock_};
+        DrainPageCachesLocked();
+
+        page = list_remove_head_type(&free_list_, vm_page, queue_node);
+        if (!page) {
+            return ZX_ERR_NO_MEMORY;
+        }
+
+        DEBUG_ASSERT(free_count_ > 0);
+        free_count_--;
+    }
 
     DEBUG_ASSERT(page->is_free());
 
@@ -131,6 +249,11 @@ zx_status_t PmmNode::AllocPages(size_t count, uint alloc_flags, list_node* list)
 
     Guard<fbl::Mutex> guard{&lock_};
 
+    if (free_count_ < count) {
+        // pull back whatever the per-cpu caches are holding before giving up
+        DrainPageCachesLocked();
+    }
+
     while (count > 0) {
         vm_page* page = list_remove_head_type(&free_list_, vm_page, queue_node);
         if (unlikely(!page)) {
@@ -174,6 +297,10 @@ zx_status_t PmmNode::AllocRange(paddr_t address, size_t count, list_node* list)
 
     Guard<fbl::Mutex> guard{&lock_};
 
+    // a free page may be sitting in a per-cpu cache rather than on free_list_, put them all
+    // back so the pages below can be pulled off the free list directly
+    DrainPageCachesLocked();
+
     // walk through the arenas, looking to see if the physical page belongs to it
     for (auto& a : arena_list_) {
         while (allocated < count && a.address_in_arena(address)) {
@@ -228,6 +355,10 @@ zx_status_t PmmNode::AllocContiguous(const size_t count, uint alloc_flags, uint8
 
     Guard<fbl::Mutex> guard{&lock_};
 
+    // the arenas only know that a page is free, not whether it is on free_list_ or in a per-cpu
+    // cache, so return the cached pages before searching for a run
+    DrainPageCachesLocked();
+
     for (auto& a : arena_list_) {
         vm_page_t* p = a.FindFreeContiguous(count, alignment_log2);
         if (!p) {
@@ -262,7 +393,7 @@ zx_status_t PmmNode::AllocContiguous(const size_t count, uint alloc_flags, uint8
     return ZX_ERR_NOT_FOUND;
 }
 
-void PmmNode::FreePageLocked(vm_page* page) {
+void PmmNode::PrepareFreePage(vm_page* page) {
     LTRACEF("page %p state %u paddr %#" PRIxPTR "\n", page, page->state, page->paddr());
 
     DEBUG_ASSERT(page->state != VM_PAGE_STATE_OBJECT || page->object.pin_count == 0);
@@ -279,6 +410,10 @@ void PmmNode::FreePageLocked(vm_page* page) {
 
     // mark it free
     page->state = VM_PAGE_STATE_FREE;
+}
+
+void PmmNode::FreePageLocked(vm_page* page) {
+    PrepareFreePage(page);
 
     // add it to the free queue
     list_add_head(&free_list_, &page->queue_node);
@@ -287,9 +422,8 @@ void PmmNode::FreePageLocked(vm_page* page) {
 }
 
 void PmmNode::FreePage(vm_page* page) {
-    Guard<fbl::Mutex> guard{&lock_};
-
-    FreePageLocked(page);
+    PrepareFreePage(page);
+    FreePageToCache(page);
 }
 
 void PmmNode::FreeListLocked(list_node* list) {
@@ -310,7 +444,7 @@ void PmmNode::FreeList(list_node* list) {
 
 // okay if accessed outside of a lock
 uint64_t PmmNode::CountFreePages() const TA_NO_THREAD_SAFETY_ANALYSIS {
-    return free_count_;
+    return free_count_ + CountCachedPages();
 }
 
 uint64_t PmmNode::CountTotalBytes() const TA_NO_THREAD_SAFETY_ANALYSIS {
@@ -334,8 +468,10 @@ void PmmNode::DumpFree() const TA_NO_THREAD_SAFETY_ANALYSIS {
 void PmmNode::Dump(bool is_panic) const {
     // No lock analysis here, as we want to just go for it in the panic case without the lock.
     auto dump = [this]() TA_NO_THREAD_SAFETY_ANALYSIS {
-        printf("pmm node %p: free_count %zu (%zu bytes), total size %zu\n",
-               this, free_count_, free_count_ * PAGE_SIZE, arena_cumulative_size_);
+        const uint64_t cached_count = CountCachedPages();
+        printf("pmm node %p: free_count %zu (%zu bytes), cpu cached %zu, total size %zu\n",
+               this, free_count_ + cached_count, (free_count_ + cached_count) * PAGE_SIZE,
+               cached_count, arena_cumulative_size_);
         for (auto& a : arena_list_) {
             a.Dump(false, false);
         }
@@ -353,6 +489,8 @@ void PmmNode::Dump(bool is_panic) const {
 void PmmNode::EnforceFill() {
     DEBUG_ASSERT(!enforce_fill_);
 
+    DrainPageCachesLocked();
+
     vm_page* page;
     list_for_every_entry (&free_list_, page, vm_page, queue_node) {
         FreeFill(page);
@@ -5,7 +5,9 @@
 #include <fbl/intrusive_double_list.h>
 #include <fbl/mutex.h>
 
+#include <kernel/align.h>
 #include <kernel/lockdep.h>
+#include <kernel/spinlock.h>
 #include <vm/pmm.h>
 
 #include "pmm_arena.h"
@@ -51,7 +53,35 @@ public:
     // add new pages to the free queue. used when boostrapping a PmmArena
     void AddFreePages(list_node* list);
 
+    // number of pages moved between a cpu's page cache and the shared free list at a time,
+    // and the most pages a single cpu's cache may hold
+    static constexpr size_t kPageCacheBatch = 32;
+    static constexpr size_t kPageCacheMax = kPageCacheBatch * 2;
+
 private:
+    // Each cpu keeps a small stack of free pages in front of free_list_ so the common single
+    // page alloc and free paths do not need to take lock_. Pages in a cache stay in
+    // VM_PAGE_STATE_FREE and are accounted in the cache's count rather than in free_count_.
+    struct PageCache {
+        DECLARE_SPINLOCK(PageCache) lock;
+        list_node free_list TA_GUARDED(lock) = LIST_INITIAL_VALUE(free_list);
+        size_t count TA_GUARDED(lock) = 0;
+    } __CPU_ALIGN;
+
+    PageCache& LocalPageCache() { return page_cache_[arch_curr_cpu_num()]; }
+
+    // pop a page off the local cpu's cache, returning nullptr if it is empty
+    vm_page* AllocPageFromCache();
+    // move a batch of pages from the free list into the local cpu's cache
+    void RefillPageCache() TA_EXCL(lock_);
+    // push a page onto the local cpu's cache, spilling a batch to the free list if it is full
+    void FreePageToCache(vm_page* page) TA_EXCL(lock_);
+    // return every cached page on every cpu to the free list
+    void DrainPageCachesLocked() TA_REQ(lock_);
+    uint64_t CountCachedPages() const;
+
+    // take a page out of whatever queue it is in and mark it free, but do not put it anywhere
+    void PrepareFreePage(vm_page* page);
     void FreePageLocked(vm_page* page) TA_REQ(lock_);
     void FreeListLocked(list_node* list) TA_REQ(lock_);
 
@@ -71,6 +101,8 @@ private:
     list_node modified_list_ TA_GUARDED(lock_) = LIST_INITIAL_VALUE(modified_list_);
     list_node wired_list_ TA_GUARDED(lock_) = LIST_INITIAL_VALUE(wired_list_);
 
+    PageCache page_cache_[SMP_MAX_CPUS];
+
 #if PMM_ENABLE_FREE_FILL
     void FreeFill(vm_page_t* page);
     void CheckFreeFill(vm_page_t* page);
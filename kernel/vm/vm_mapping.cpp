@@ -8,8 +8,12 @@
 #include <fbl/auto_call.h>
 #include <ktl/move.h>
 #include <inttypes.h>
+#include <kernel/cmdline.h>
+#include <lib/counters.h>
+#include <lk/init.h>
 #include <trace.h>
 #include <vm/fault.h>
+#include <vm/physmap.h>
 #include <vm/vm.h>
 #include <vm/vm_aspace.h>
 #include <vm/vm_object.h>
@@ -17,6 +21,37 @@
 
 #define LOCAL_TRACE MAX(VM_GLOBAL_TRACE, 0)
 
+KCOUNTER(vm_fault_demand_mapped, "kernel.vm.fault.demand_mapped");
+KCOUNTER(vm_fault_around_mapped, "kernel.vm.fault_around.mapped");
+KCOUNTER(vm_large_page_mapped, "kernel.vm.large_page.mapped");
+
+namespace {
+
+// upper bound for kernel.vm.fault-around-pages
+constexpr uint32_t kMaxFaultAroundPages = 64;
+
+// Size in pages of the aligned window around a read fault that PageFault() will try to fill in
+// with pages the vm object already has resident. Always a power of two; 1 disables fault-around.
+uint32_t fault_around_pages = 16;
+
+void vm_fault_around_init(uint level) {
+    uint32_t pages = cmdline_get_uint32("kernel.vm.fault-around-pages", fault_around_pages);
+    if (pages > kMaxFaultAroundPages) {
+        pages = kMaxFaultAroundPages;
+    }
+    if (pages <= 1) {
+        pages = 1;
+    } else {
+        // round down to a power of two so the window stays naturally aligned
+        pages = 1u << (31 - __builtin_clz(pages));
+    }
+    fault_around_pages = pages;
+}
+
+} // namespace
+
+LK_INIT_HOOK(vm_fault_around, vm_fault_around_init, LK_INIT_LEVEL_VM);
+
 VmMapping::VmMapping(VmAddressRegion& parent, vaddr_t base, size_t size, uint32_t vmar_flags,
                      fbl::RefPtr<VmObject> vmo, uint64_t vmo_offset, uint arch_mmu_flags)
     : VmAddressRegionOrMapping(base, size, vmar_flags,
@@ -387,7 +422,7 @@ namespace {
 
 class VmMappingCoalescer {
 public:
-    VmMappingCoalescer(VmMapping* mapping, vaddr_t base);
+    VmMappingCoalescer(VmMapping* mapping, vaddr_t base, uint mmu_flags);
     ~VmMappingCoalescer();
 
     // Add a page to the mapping run.  If this fails, the VmMappingCoalescer is
@@ -422,13 +457,14 @@ private:
 
     VmMapping* mapping_;
     vaddr_t base_;
+    uint mmu_flags_;
     paddr_t phys_[16];
     size_t count_;
     bool aborted_;
 };
 
-VmMappingCoalescer::VmMappingCoalescer(VmMapping* mapping, vaddr_t base)
-    : mapping_(mapping), base_(base), count_(0), aborted_(false) {}
+VmMappingCoalescer::VmMappingCoalescer(VmMapping* mapping, vaddr_t base, uint mmu_flags)
+    : mapping_(mapping), base_(base), mmu_flags_(mmu_flags), count_(0), aborted_(false) {}
 
 VmMappingCoalescer::~VmMappingCoalescer() {
     // Make sure we've flushed or aborted
@@ -440,10 +476,9 @@ zx_status_t VmMappingCoalescer::Flush() {
         return ZX_OK;
     }
 
-    uint flags = mapping_->arch_mmu_flags();
-    if (flags & ARCH_MMU_FLAG_PERM_RWX_MASK) {
+    if (mmu_flags_ & ARCH_MMU_FLAG_PERM_RWX_MASK) {
         size_t mapped;
-        zx_status_t ret = mapping_->aspace()->arch_aspace().Map(base_, phys_, count_, flags,
+        zx_status_t ret = mapping_->aspace()->arch_aspace().Map(base_, phys_, count_, mmu_flags_,
                                                                 &mapped);
         if (ret != ZX_OK) {
             TRACEF("error %d mapping %zu pages starting at va %#" PRIxPTR "\n", ret, count_, base_);
@@ -497,12 +532,37 @@ zx_status_t VmMapping::MapRange(size_t offset, size_t len, bool commit) {
     // iterate through the range, grabbing a page from the underlying object and
     // mapping it in
     size_t o;
-    VmMappingCoalescer coalescer(this, base_ + offset);
+    VmMappingCoalescer coalescer(this, base_ + offset, arch_mmu_flags_);
     for (o = offset; o < offset + len; o += PAGE_SIZE) {
         uint64_t vmo_offset = object_offset_ + o;
 
         zx_status_t status;
         paddr_t pa;
+
+        // map aligned large page runs directly so they get a single translation; the coalescer
+        // only batches a handful of base pages at a time
+        if ((flags_ & VMAR_FLAG_LARGE_PAGES) && IS_ALIGNED(base_ + o, kLargePageSize) &&
+            IS_ALIGNED(vmo_offset, kLargePageSize) && offset + len - o >= kLargePageSize &&
+            object_->GetLargePageLocked(vmo_offset, commit, &pa) == ZX_OK) {
+            status = coalescer.Flush();
+            if (status != ZX_OK) {
+                return status;
+            }
+            if (arch_mmu_flags_ & ARCH_MMU_FLAG_PERM_RWX_MASK) {
+                const size_t count = kLargePageSize / PAGE_SIZE;
+                size_t mapped;
+                status = aspace_->arch_aspace().MapContiguous(base_ + o, pa, count,
+                                                              arch_mmu_flags_, &mapped);
+                if (status != ZX_OK) {
+                    return status;
+                }
+                DEBUG_ASSERT(mapped == count);
+                kcounter_add(vm_large_page_mapped, 1);
+            }
+            o += kLargePageSize - PAGE_SIZE;
+            continue;
+        }
+
         status = object_->GetPageLocked(vmo_offset, pf_flags, nullptr, nullptr, nullptr, &pa);
         if (status != ZX_OK) {
             // no page to map
@@ -543,6 +603,26 @@ zx_status_t VmMapping::DecommitRange(size_t offset, size_t len) {
     return object_->DecommitRange(object_offset_ + offset, len);
 }
 
+zx_status_t VmMapping::ReplacePages(vaddr_t base, size_t len, list_node* pages) {
+    canary_.Assert();
+    LTRACEF("%p [%#zx+%#zx], base %#" PRIxPTR ", len %#zx\n",
+            this, base_, size_, base, len);
+
+    Guard<fbl::Mutex> guard{aspace_->lock()};
+    if (state_ != LifeCycleState::ALIVE) {
+        return ZX_ERR_BAD_STATE;
+    }
+    if (base < base_ || base + len < base || base + len > base_ + size_) {
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+    if (!(arch_mmu_flags_ & ARCH_MMU_FLAG_PERM_WRITE)) {
+        return ZX_ERR_ACCESS_DENIED;
+    }
+    // VmObject::ReplacePages will typically call back into our instance's
+    // VmMapping::UnmapVmoRangeLocked.
+    return object_->ReplacePages(object_offset_ + (base - base_), len, pages);
+}
+
 zx_status_t VmMapping::DestroyLocked() {
     canary_.Assert();
     DEBUG_ASSERT(aspace_->lock()->lock().IsHeld());
@@ -639,6 +719,10 @@ zx_status_t VmMapping::PageFault(vaddr_t va, const uint pf_flags, PageRequest* p
     currently_faulting_ = true;
     auto ac = fbl::MakeAutoCall([&]() { currently_faulting_ = false; });
 
+    if ((flags_ & VMAR_FLAG_LARGE_PAGES) && LargePageFaultLocked(va, pf_flags) == ZX_OK) {
+        return ZX_OK;
+    }
+
     // fault in or grab an existing page
     paddr_t new_pa;
     vm_page_t* page;
@@ -727,6 +811,14 @@ zx_status_t VmMapping::PageFault(vaddr_t va, const uint pf_flags, PageRequest* p
             return ZX_ERR_NO_MEMORY;
         }
         DEBUG_ASSERT(mapped == 1);
+
+        kcounter_add(vm_fault_demand_mapped, 1);
+
+        // on a read fault, opportunistically map the neighboring pages the vmo already has so a
+        // sequential scan does not take a trap per page
+        if (!(pf_flags & (VMM_PF_FLAG_WRITE | VMM_PF_FLAG_GUEST)) && fault_around_pages > 1) {
+            FaultAroundLocked(va, mmu_flags);
+        }
     }
 
 // TODO: figure out what to do with this
@@ -740,6 +832,127 @@ zx_status_t VmMapping::PageFault(vaddr_t va, const uint pf_flags, PageRequest* p
     return ZX_OK;
 }
 
+// Called from PageFault() with the aspace and object locks held and |va| freshly mapped.
+// Analysis is disabled for the same object_->lock() aliasing reason as ActivateLocked().
+void VmMapping::FaultAroundLocked(vaddr_t va, uint mmu_flags) TA_NO_THREAD_SAFETY_ANALYSIS {
+    DEBUG_ASSERT(aspace_->lock()->lock().IsHeld());
+    DEBUG_ASSERT(object_->lock()->lock().IsHeld());
+    DEBUG_ASSERT(!(mmu_flags & ARCH_MMU_FLAG_PERM_WRITE));
+
+    if (!object_->is_paged()) {
+        return;
+    }
+
+    // clip the aligned window around va to this mapping
+    const size_t window = fault_around_pages * PAGE_SIZE;
+    const size_t va_offset = va - base_;
+    const vaddr_t window_start = ROUNDDOWN(va, window);
+    const size_t start_offset = (window_start > base_) ? window_start - base_ : 0;
+    const size_t end_offset = MIN(window_start + window - base_, size_);
+    DEBUG_ASSERT(va_offset >= start_offset && va_offset < end_offset);
+
+    VmMappingCoalescer coalescer(this, base_ + start_offset, mmu_flags);
+    size_t mapped = 0;
+    for (size_t offset = start_offset; offset < end_offset; offset += PAGE_SIZE) {
+        if (offset == va_offset) {
+            continue;
+        }
+
+        // only take pages that are already resident, never fault or allocate from here
+        paddr_t pa;
+        zx_status_t status = object_->GetPageLocked(offset + object_offset_, 0, nullptr, nullptr,
+                                                    nullptr, &pa);
+        if (status != ZX_OK) {
+            continue;
+        }
+
+        // leave anything that is already mapped alone
+        const vaddr_t addr = base_ + offset;
+        paddr_t existing_pa;
+        uint existing_flags;
+        if (aspace_->arch_aspace().Query(addr, &existing_pa, &existing_flags) == ZX_OK) {
+            continue;
+        }
+
+#if ARCH_ARM64
+        if (mmu_flags & ARCH_MMU_FLAG_PERM_EXECUTE) {
+            arch_sync_cache_range(reinterpret_cast<addr_t>(paddr_to_physmap(pa)), PAGE_SIZE);
+        }
+#endif
+
+        if (coalescer.Append(addr, pa) != ZX_OK) {
+            return;
+        }
+        mapped++;
+    }
+
+    if (coalescer.Flush() != ZX_OK) {
+        return;
+    }
+
+    LTRACEF("fault around va %#" PRIxPTR " mapped %zu pages\n", va, mapped);
+    kcounter_add(vm_fault_around_mapped, mapped);
+}
+
+// Called from PageFault() with the aspace and object locks held, for the same reason as
+// FaultAroundLocked() analysis is disabled.
+zx_status_t VmMapping::LargePageFaultLocked(vaddr_t va, uint pf_flags) TA_NO_THREAD_SAFETY_ANALYSIS {
+    DEBUG_ASSERT(aspace_->lock()->lock().IsHeld());
+    DEBUG_ASSERT(object_->lock()->lock().IsHeld());
+
+    // the large page has to fit in the mapping and line up with the vmo
+    const vaddr_t large_va = ROUNDDOWN(va, kLargePageSize);
+    if (large_va < base_ || large_va - base_ + kLargePageSize > size_) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    const uint64_t large_offset = large_va - base_ + object_offset_;
+    if (!IS_ALIGNED(large_offset, kLargePageSize)) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
+    // Only write faults commit memory. A read fault maps a run the vmo already has and otherwise
+    // gets the zero page like any other mapping.
+    const bool write = pf_flags & VMM_PF_FLAG_WRITE;
+    paddr_t pa;
+    zx_status_t status = object_->GetLargePageLocked(large_offset, write, &pa);
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    uint mmu_flags = arch_mmu_flags_;
+    if (!write) {
+        mmu_flags &= ~ARCH_MMU_FLAG_PERM_WRITE;
+    }
+
+    // Replace whatever base pages are mapped in the range, typically the zero page from earlier
+    // read faults, with the single translation.
+    const size_t count = kLargePageSize / PAGE_SIZE;
+    status = aspace_->arch_aspace().Unmap(large_va, count, nullptr);
+    if (status != ZX_OK) {
+        TRACEF("failed to remove base pages before mapping large page\n");
+        return status;
+    }
+
+    size_t mapped;
+    status = aspace_->arch_aspace().MapContiguous(large_va, pa, count, mmu_flags, &mapped);
+    if (status != ZX_OK) {
+        TRACEF("failed to map large page\n");
+        return status;
+    }
+    DEBUG_ASSERT(mapped == count);
+
+    LTRACEF("mapped large page pa %#" PRIxPTR " at va %#" PRIxPTR "\n", pa, large_va);
+
+#if ARCH_ARM64
+    if (!(pf_flags & VMM_PF_FLAG_GUEST) && (arch_mmu_flags_ & ARCH_MMU_FLAG_PERM_EXECUTE)) {
+        arch_sync_cache_range(large_va, kLargePageSize);
+    }
+#endif
+
+    kcounter_add(vm_large_page_mapped, 1);
+    return ZX_OK;
+}
+
 // We disable thread safety analysis here because one of the common uses of this
 // function is for splitting one mapping object into several that will be backed
 // by the same VmObject.  In that case, object_->lock() gets aliased across all
@@ -11,6 +11,7 @@
 #include <inttypes.h>
 #include <ktl/move.h>
 #include <lib/console.h>
+#include <lib/counters.h>
 #include <stdlib.h>
 #include <string.h>
 #include <trace.h>
@@ -23,6 +24,9 @@
 
 #define LOCAL_TRACE MAX(VM_GLOBAL_TRACE, 0)
 
+KCOUNTER(vm_large_page_committed, "kernel.vm.large_page.committed");
+KCOUNTER(vm_large_page_alloc_failed, "kernel.vm.large_page.alloc_failed");
+
 namespace {
 
 void ZeroPage(paddr_t pa) {
@@ -518,7 +522,8 @@ zx_status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_no
     if (page_source_) {
         ASSERT(page_request);
 
-        zx_status_t status = page_source_->GetPage(offset, page_request, &p, &pa);
+        zx_status_t status = page_source_->GetPage(offset, page_request, &p, &pa,
+                                                   ReadaheadLimitLocked(offset));
         if (status != ZX_OK) {
             return status;
         }
@@ -581,6 +586,123 @@ zx_status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_no
     return ZX_OK;
 }
 
+zx_status_t VmObjectPaged::GetLargePageLocked(uint64_t offset, bool commit, paddr_t* pa_out) {
+    canary_.Assert();
+    DEBUG_ASSERT(lock_.lock().IsHeld());
+    DEBUG_ASSERT(IS_ALIGNED(offset, kLargePageSize));
+
+    // Pages shared with a parent or supplied by a pager arrive one at a time and
+    // can't be gathered into a run.
+    if (parent_ || page_source_) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
+    uint64_t end;
+    if (add_overflow(offset, kLargePageSize, &end) || end > size_) {
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+
+    // see if the range is already backed by a contiguous run
+    size_t count = 0;
+    paddr_t base = 0;
+    bool contiguous = true;
+    page_list_.ForEveryPageInRange(
+        [&count, &base, &contiguous, offset](const auto p, uint64_t off) {
+            if (count == 0) {
+                base = p->paddr() - (off - offset);
+            } else if (p->paddr() != base + (off - offset)) {
+                contiguous = false;
+                return ZX_ERR_STOP;
+            }
+            count++;
+            return ZX_ERR_NEXT;
+        },
+        offset, end);
+
+    const size_t num_pages = kLargePageSize / PAGE_SIZE;
+    if (count == num_pages && contiguous && IS_ALIGNED(base, kLargePageSize)) {
+        *pa_out = base;
+        return ZX_OK;
+    }
+    if (count != 0 || !commit) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
+    list_node page_list;
+    list_initialize(&page_list);
+
+    paddr_t pa;
+    zx_status_t status = pmm_alloc_contiguous(num_pages, pmm_alloc_flags_, kLargePageSizeShift,
+                                              &pa, &page_list);
+    if (status != ZX_OK) {
+        LTRACEF("failed to allocate large page at offset %#" PRIx64 "\n", offset);
+        kcounter_add(vm_large_page_alloc_failed, 1);
+        return status;
+    }
+
+    for (uint64_t off = offset; off < end; off += PAGE_SIZE) {
+        vm_page_t* p = list_remove_head_type(&page_list, vm_page_t, queue_node);
+        DEBUG_ASSERT(p);
+
+        InitializeVmPage(p);
+
+        // TODO: remove once pmm returns zeroed pages
+        ZeroPage(p);
+
+        status = page_list_.AddPage(p, off);
+        DEBUG_ASSERT(status == ZX_OK);
+    }
+
+    // if ARM and not fully cached, clean/invalidate the pages after zeroing them
+#if ARCH_ARM64
+    if (cache_policy_ != ARCH_MMU_FLAG_CACHED) {
+        arch_clean_invalidate_cache_range((addr_t)paddr_to_physmap(pa), kLargePageSize);
+    }
+#endif
+
+    // other mappings may have the zero page mapped in this range, so unmap them
+    RangeChangeUpdateLocked(offset, kLargePageSize);
+
+    kcounter_add(vm_large_page_committed, 1);
+
+    *pa_out = pa;
+    return ZX_OK;
+}
+
+uint64_t VmObjectPaged::ReadaheadLimitLocked(uint64_t offset) {
+    DEBUG_ASSERT(offset < size_);
+
+    if (readahead_max_ == 0) {
+        return 0;
+    }
+
+    // only ask for pages we don't have, otherwise the request would never be fully supplied
+    const uint64_t end = offset + MIN(readahead_max_, size_ - offset);
+    uint64_t limit = PAGE_SIZE;
+    while (offset + limit < end && !page_list_.GetPage(offset + limit)) {
+        limit += PAGE_SIZE;
+    }
+    return limit;
+}
+
+uint64_t VmObjectPaged::GetReadaheadMax() {
+    Guard<fbl::Mutex> guard{&lock_};
+    return readahead_max_;
+}
+
+zx_status_t VmObjectPaged::SetReadaheadMax(uint64_t bytes) {
+    if (!page_source_) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    if (bytes > kMaxReadahead) {
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+
+    Guard<fbl::Mutex> guard{&lock_};
+    readahead_max_ = ROUNDDOWN(bytes, PAGE_SIZE);
+    return ZX_OK;
+}
+
 zx_status_t VmObjectPaged::CommitRange(uint64_t offset, uint64_t len) {
     canary_.Assert();
     LTRACEF("offset %#" PRIx64 ", len %#" PRIx64 "\n", offset, len);
@@ -1229,6 +1351,59 @@ zx_status_t VmObjectPaged::SupplyPages(uint64_t offset, uint64_t len, VmPageSpli
     return ZX_OK;
 }
 
+zx_status_t VmObjectPaged::ReplacePages(uint64_t offset, uint64_t len, list_node* pages) {
+    canary_.Assert();
+    LTRACEF("offset %#" PRIx64 ", len %#" PRIx64 "\n", offset, len);
+    DEBUG_ASSERT(IS_PAGE_ALIGNED(offset) && IS_PAGE_ALIGNED(len));
+
+    Guard<fbl::Mutex> guard{&lock_};
+
+    uint64_t end;
+    if (add_overflow(offset, len, &end) || size_ < end) {
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+
+    // Pages supplied by a page source, or shared with a parent or clones of this vmo,
+    // cannot be replaced without the replacement being observable as more than a write.
+    if ((options_ & kContiguous) || cache_policy_ != ARCH_MMU_FLAG_CACHED ||
+        page_source_ || parent_ || children_list_len_ || AnyPagesPinnedLocked(offset, len)) {
+        return ZX_ERR_BAD_STATE;
+    }
+
+    // unmap all of the pages in this range on all the mapping regions
+    RangeChangeUpdateLocked(offset, len);
+
+    page_list_.FreePages(offset, end);
+
+    uint64_t page_offset = offset;
+    while (page_offset < end) {
+        vm_page_t* p = list_remove_head_type(pages, vm_page_t, queue_node);
+        DEBUG_ASSERT(p);
+        const uint32_t state = p->state;
+        p->state = VM_PAGE_STATE_OBJECT;
+        p->object.pin_count = 0;
+
+        zx_status_t status = page_list_.AddPage(p, page_offset);
+        if (status != ZX_OK) {
+            // Return every page to |pages|, in order. The range has already been
+            // decommitted, which is harmless as the caller is about to overwrite it.
+            p->state = state;
+            list_add_head(pages, &p->queue_node);
+            while (page_offset > offset) {
+                page_offset -= PAGE_SIZE;
+                bool removed = page_list_.RemovePage(page_offset, &p);
+                DEBUG_ASSERT(removed);
+                p->state = state;
+                list_add_head(pages, &p->queue_node);
+            }
+            return status;
+        }
+        page_offset += PAGE_SIZE;
+    }
+
+    return ZX_OK;
+}
+
 zx_status_t VmObjectPaged::InvalidateCache(const uint64_t offset, const uint64_t len) {
     return CacheOp(offset, len, CacheOpType::Invalidate);
 }
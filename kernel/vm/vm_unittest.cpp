@@ -1044,6 +1044,104 @@ static bool arch_noncontiguous_map() {
     END_TEST;
 }
 
+// Maps an aligned contiguous run through the page array interface and checks that
+// unmapping and protecting single pages inside it leaves the rest intact.
+static bool arch_large_page_map() {
+    BEGIN_TEST;
+
+    const size_t count = kLargePageSize / PAGE_SIZE;
+    paddr_t pa;
+    struct list_node phys_list = LIST_INITIAL_VALUE(phys_list);
+    zx_status_t status = pmm_alloc_contiguous(count, 0, kLargePageSizeShift, &pa, &phys_list);
+    if (status != ZX_OK) {
+        unittest_printf("not enough contiguous memory, skipping\n");
+        END_TEST;
+    }
+
+    fbl::AllocChecker ac;
+    fbl::Array<paddr_t> phys(new (&ac) paddr_t[count], count);
+    ASSERT_TRUE(ac.check(), "");
+    for (size_t i = 0; i < count; ++i) {
+        phys[i] = pa + i * PAGE_SIZE;
+    }
+
+    {
+        ArchVmAspace aspace;
+        status = aspace.Init(USER_ASPACE_BASE, USER_ASPACE_SIZE, 0);
+        ASSERT_EQ(ZX_OK, status, "failed to init aspace\n");
+
+        size_t mapped;
+        vaddr_t base = ROUNDUP(USER_ASPACE_BASE + 1, kLargePageSize);
+        status = aspace.Map(base, phys.get(), count, kArchRwFlags, &mapped);
+        ASSERT_EQ(ZX_OK, status, "failed large map\n");
+        EXPECT_EQ(count, mapped, "weird large map\n");
+
+        // punch a hole and drop write on another page
+        status = aspace.Unmap(base + 5 * PAGE_SIZE, 1, &mapped);
+        EXPECT_EQ(ZX_OK, status, "failed unmap\n");
+        status = aspace.Protect(base + 7 * PAGE_SIZE, 1, ARCH_MMU_FLAG_PERM_READ);
+        EXPECT_EQ(ZX_OK, status, "failed protect\n");
+
+        for (size_t i = 0; i < count; ++i) {
+            paddr_t paddr;
+            uint mmu_flags;
+            status = aspace.Query(base + i * PAGE_SIZE, &paddr, &mmu_flags);
+            if (i == 5) {
+                EXPECT_EQ(ZX_ERR_NOT_FOUND, status, "hole still mapped\n");
+                continue;
+            }
+            EXPECT_EQ(ZX_OK, status, "bad large map\n");
+            EXPECT_EQ(phys[i], paddr, "bad large map\n");
+            EXPECT_EQ(i == 7 ? ARCH_MMU_FLAG_PERM_READ : kArchRwFlags, mmu_flags,
+                      "bad large map\n");
+        }
+
+        status = aspace.Destroy();
+        EXPECT_EQ(ZX_OK, status, "failed to destroy aspace\n");
+    }
+
+    pmm_free(&phys_list);
+
+    END_TEST;
+}
+
+// Commits a large page run in a vmo and looks it up again.
+static bool vmo_large_page_test() {
+    BEGIN_TEST;
+
+    fbl::RefPtr<VmObject> vmo;
+    zx_status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, 0u, 2 * kLargePageSize, &vmo);
+    ASSERT_EQ(ZX_OK, status, "vmobject creation\n");
+
+    Guard<fbl::Mutex> guard{vmo->lock()};
+
+    paddr_t pa;
+    status = vmo->GetLargePageLocked(0, false, &pa);
+    EXPECT_EQ(ZX_ERR_NOT_SUPPORTED, status, "lookup of uncommitted run\n");
+
+    status = vmo->GetLargePageLocked(0, true, &pa);
+    if (status == ZX_ERR_NO_MEMORY) {
+        unittest_printf("not enough contiguous memory, skipping\n");
+        END_TEST;
+    }
+    ASSERT_EQ(ZX_OK, status, "commit large page\n");
+    EXPECT_TRUE(IS_ALIGNED(pa, kLargePageSize), "unaligned large page\n");
+
+    paddr_t pa2;
+    status = vmo->GetLargePageLocked(0, false, &pa2);
+    EXPECT_EQ(ZX_OK, status, "lookup of committed run\n");
+    EXPECT_EQ(pa, pa2, "different run\n");
+
+    // a run that is only partly committed can't be used
+    status = vmo->GetPageLocked(kLargePageSize, VMM_PF_FLAG_WRITE | VMM_PF_FLAG_SW_FAULT,
+                                nullptr, nullptr, nullptr, nullptr);
+    EXPECT_EQ(ZX_OK, status, "commit single page\n");
+    status = vmo->GetLargePageLocked(kLargePageSize, true, &pa2);
+    EXPECT_EQ(ZX_ERR_NOT_SUPPORTED, status, "partly committed run\n");
+
+    END_TEST;
+}
+
 // Basic test that checks adding/removing a page
 static bool vmpl_add_remove_page_test() {
     BEGIN_TEST;
@@ -1347,7 +1445,9 @@ VM_UNITTEST(vmo_double_remap_test)
 VM_UNITTEST(vmo_read_write_smoke_test)
 VM_UNITTEST(vmo_cache_test)
 VM_UNITTEST(vmo_lookup_test)
+VM_UNITTEST(vmo_large_page_test)
 VM_UNITTEST(arch_noncontiguous_map)
+VM_UNITTEST(arch_large_page_map)
 // Uncomment for debugging
 // VM_UNITTEST(dump_all_aspaces)  // Run last
 UNITTEST_END_TESTCASE(vm_tests, "vm", "Virtual memory tests");
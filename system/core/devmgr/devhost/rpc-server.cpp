@@ -576,6 +576,28 @@ static zx_status_t fidl_file_getbuffer(void* ctx, uint32_t flags, fidl_txn_t* tx
     return fuchsia_io_FileGetBuffer_reply(txn, ZX_ERR_NOT_SUPPORTED, nullptr);
 }
 
+static zx_status_t fidl_file_sharebuffer(void* ctx, uint64_t size, fidl_txn_t* txn) {
+    return fuchsia_io_FileShareBuffer_reply(txn, ZX_ERR_NOT_SUPPORTED, ZX_HANDLE_INVALID);
+}
+
+static zx_status_t fidl_file_readshared(void* ctx, uint64_t count, fidl_txn_t* txn) {
+    return fuchsia_io_FileReadShared_reply(txn, ZX_ERR_NOT_SUPPORTED, 0);
+}
+
+static zx_status_t fidl_file_readsharedat(void* ctx, uint64_t count, uint64_t offset,
+                                          fidl_txn_t* txn) {
+    return fuchsia_io_FileReadSharedAt_reply(txn, ZX_ERR_NOT_SUPPORTED, 0);
+}
+
+static zx_status_t fidl_file_writeshared(void* ctx, uint64_t count, fidl_txn_t* txn) {
+    return fuchsia_io_FileWriteShared_reply(txn, ZX_ERR_NOT_SUPPORTED, 0);
+}
+
+static zx_status_t fidl_file_writesharedat(void* ctx, uint64_t count, uint64_t offset,
+                                           fidl_txn_t* txn) {
+    return fuchsia_io_FileWriteSharedAt_reply(txn, ZX_ERR_NOT_SUPPORTED, 0);
+}
+
 static const fuchsia_io_File_ops_t kFileOps = []() {
     fuchsia_io_File_ops_t ops;
     ops.Read = fidl_file_read;
@@ -587,6 +609,11 @@ static const fuchsia_io_File_ops_t kFileOps = []() {
     ops.GetFlags = fidl_file_getflags;
     ops.SetFlags = fidl_file_setflags;
     ops.GetBuffer = fidl_file_getbuffer;
+    ops.ShareBuffer = fidl_file_sharebuffer;
+    ops.ReadShared = fidl_file_readshared;
+    ops.ReadSharedAt = fidl_file_readsharedat;
+    ops.WriteShared = fidl_file_writeshared;
+    ops.WriteSharedAt = fidl_file_writesharedat;
     return ops;
 }();
 
@@ -29,6 +29,10 @@
 
 #define TFTP_TIMEOUT_SECS 1
 
+// Images are paved while they are received, so at most this much of an image is buffered
+// between tftp and the paver.
+#define PAVER_BUFFER_SIZE (16u * 1024 * 1024)
+
 #define NB_IMAGE_PREFIX_LEN (strlen(NB_IMAGE_PREFIX))
 #define NB_FILENAME_PREFIX_LEN (strlen(NB_FILENAME_PREFIX))
 
@@ -53,13 +57,17 @@ struct file_info_t {
         size_t size; // Total size of file
         zx_handle_t process;
 
-        // Buffer used for stashing data from tftp until it can be written out to the paver
+        // Ring buffer used for stashing data from tftp until it can be written out to the
+        // paver. Offsets in the file map to offsets in the buffer modulo |buffer_size|.
         zx_handle_t buffer_handle;
         uint8_t* buffer;
+        size_t buffer_size;
         std::atomic<unsigned int> buf_refcount;
-        std::atomic<size_t> offset; // Buffer write offset (read offset is stored locally)
+        std::atomic<size_t> offset;      // Buffer write offset
+        std::atomic<size_t> read_offset; // Buffer read offset
         thrd_t buf_copy_thrd;
-        sync_completion_t data_ready; // Allows read thread to block on buffer writes
+        sync_completion_t data_ready;  // Allows read thread to block on buffer writes
+        sync_completion_t space_ready; // Allows netsvc to block on buffer reads
     } paver;
 };
 
@@ -105,6 +113,9 @@ static ssize_t file_open_read(const char* filename, void* cookie) {
 
 static zx_status_t alloc_paver_buffer(file_info_t* file_info, size_t size) {
     zx_status_t status;
+    if (size > PAVER_BUFFER_SIZE) {
+        size = PAVER_BUFFER_SIZE;
+    }
     status = zx_vmo_create(size, 0, &file_info->paver.buffer_handle);
     if (status != ZX_OK) {
         printf("netsvc: unable to allocate buffer VMO\n");
@@ -120,13 +131,14 @@ static zx_status_t alloc_paver_buffer(file_info_t* file_info, size_t size) {
         return status;
     }
     file_info->paver.buffer = reinterpret_cast<uint8_t*>(buffer);
+    file_info->paver.buffer_size = size;
     return ZX_OK;
 }
 
 static zx_status_t dealloc_paver_buffer(file_info_t* file_info) {
     zx_status_t status =
         zx_vmar_unmap(zx_vmar_root_self(), reinterpret_cast<uintptr_t>(file_info->paver.buffer),
-                      file_info->paver.size);
+                      file_info->paver.buffer_size);
     if (status != ZX_OK) {
         printf("netsvc: failed to unmap paver buffer: %s\n", zx_status_get_string(status));
         goto done;
@@ -159,8 +171,10 @@ static int drain_pipe(void* arg) {
 
 // Pushes all data from the paver buffer (filled by netsvc) into the paver input pipe. When
 // there's no data to copy, blocks on data_ready until more data is written into the buffer.
+// Signals space_ready whenever data is consumed, to let netsvc reuse that part of the buffer.
 static int paver_copy_buffer(void* arg) {
     file_info_t* file_info = reinterpret_cast<file_info_t*>(arg);
+    const size_t buffer_size = file_info->paver.buffer_size;
     size_t read_ndx = 0;
     int result = 0;
     zx_time_t last_reported = zx_clock_get_monotonic();
@@ -179,14 +193,21 @@ static int paver_copy_buffer(void* arg) {
             goto done;
         }
         while (read_ndx < write_ndx) {
-            ssize_t r = write(file_info->paver.fd, &file_info->paver.buffer[read_ndx],
-                              write_ndx - read_ndx);
+            // Don't write past the end of the buffer; the rest has wrapped around to its start.
+            size_t buf_ndx = read_ndx % buffer_size;
+            size_t len = write_ndx - read_ndx;
+            if (len > buffer_size - buf_ndx) {
+                len = buffer_size - buf_ndx;
+            }
+            ssize_t r = write(file_info->paver.fd, &file_info->paver.buffer[buf_ndx], len);
             if (r <= 0) {
                 printf("netsvc: couldn't write to paver fd: %ld\n", r);
                 result = TFTP_ERR_IO;
                 goto done;
             }
             read_ndx += r;
+            atomic_store(&file_info->paver.read_offset, read_ndx);
+            sync_completion_signal(&file_info->paver.space_ready);
             zx_time_t curr_time = zx_clock_get_monotonic();
             if (zx_time_sub_time(curr_time, last_reported) >= ZX_SEC(1)) {
                 float complete =
@@ -204,6 +225,8 @@ done:
     if (refcount == 1) {
         dealloc_paver_buffer(file_info);
     }
+    // Wake netsvc, if it is waiting for space in the buffer, to let it know we're gone.
+    sync_completion_signal(&file_info->paver.space_ready);
 
     // wait for the paver to complete, as executing the paver concurrently has
     // undefined behavior.
@@ -318,6 +341,7 @@ static tftp_status paver_open_write(const char* filename, size_t size, file_info
     // may be done with it first so we use a refcount to decide when to deallocate it
     std::atomic_store(&file_info->paver.buf_refcount, 2u);
     std::atomic_store(&file_info->paver.offset, 0ul);
+    std::atomic_store(&file_info->paver.read_offset, 0ul);
     std::atomic_store(&paver_exit_code, 0);
     std::atomic_store(&paving_in_progress, true);
 
@@ -414,9 +438,42 @@ static tftp_status file_write(const void* data, size_t* length, off_t offset, vo
             (offset + *length) > file_info->paver.size) {
             return TFTP_ERR_INVALID_ARGS;
         }
-        memcpy(&file_info->paver.buffer[offset], data, *length);
-        size_t new_offset = offset + *length;
-        atomic_store(&file_info->paver.offset, new_offset);
+        // Wait until the paver copy thread has made room in the buffer. Data arrives in order,
+        // so |offset| is where the last write ended.
+        const size_t buffer_size = file_info->paver.buffer_size;
+        size_t write_ndx = static_cast<size_t>(offset);
+        size_t read_ndx;
+        for (;;) {
+            sync_completion_reset(&file_info->paver.space_ready);
+            read_ndx = atomic_load(&file_info->paver.read_offset);
+            if (write_ndx - read_ndx < buffer_size) {
+                break;
+            }
+            if (atomic_load(&file_info->paver.buf_refcount) < 2) {
+                printf("netsvc: paver copy thread exited prematurely\n");
+                return TFTP_ERR_IO;
+            }
+            // Like the paver copy thread, wait at least as long as the tftp timeouts allow.
+            if (sync_completion_wait(&file_info->paver.space_ready,
+                                     ZX_SEC(5 * TFTP_TIMEOUT_SECS)) != ZX_OK) {
+                printf("netsvc: timed out while waiting for room in paver buffer\n");
+                return TFTP_ERR_TIMED_OUT;
+            }
+        }
+
+        // Copy as much as fits before the end of the buffer or the unread data; tftp writes the
+        // rest of the block in another call.
+        size_t buf_ndx = write_ndx % buffer_size;
+        size_t len = *length;
+        if (len > buffer_size - (write_ndx - read_ndx)) {
+            len = buffer_size - (write_ndx - read_ndx);
+        }
+        if (len > buffer_size - buf_ndx) {
+            len = buffer_size - buf_ndx;
+        }
+        memcpy(&file_info->paver.buffer[buf_ndx], data, len);
+        *length = len;
+        atomic_store(&file_info->paver.offset, write_ndx + len);
         // Wake the paver thread, if it is waiting for data
         sync_completion_signal(&file_info->paver.data_ready);
         return TFTP_NO_ERROR;
@@ -72,10 +72,13 @@ public:
     void BlockQueue(block_op_t* op, block_impl_queue_callback completion_cb, void* cookie);
     zx_status_t GetStats(const void* cmd, size_t cmd_len, void* reply, size_t reply_len,
                          size_t* out_actual);
+    zx_status_t GetSchedulerStats(const void* cmd, size_t cmd_len, void* reply,
+                                  size_t reply_len, size_t* out_actual);
 
 private:
     static int ServerThread(void* arg);
     zx_status_t GetFifos(zx_handle_t* out_buf, size_t out_len, size_t* out_actual);
+    zx_status_t GetQueueFifo(zx_handle_t* out_buf, size_t out_len, size_t* out_actual);
     zx_status_t AttachVmo(const void* in_buf, size_t in_len, vmoid_t* out_buf,
                           size_t out_len, size_t* out_actual);
     zx_status_t Rebind();
@@ -124,6 +127,21 @@ zx_status_t BlockDevice::GetFifos(zx_handle_t* out_buf, size_t out_len, size_t*
     return ZX_OK;
 }
 
+zx_status_t BlockDevice::GetQueueFifo(zx_handle_t* out_buf, size_t out_len,
+                                      size_t* out_actual) {
+    if (out_len < sizeof(zx_handle_t)) {
+        return ZX_ERR_INVALID_ARGS;
+    }
+    zx::fifo fifo;
+    zx_status_t status = server_manager_.StartQueue(&fifo);
+    if (status != ZX_OK) {
+        return status;
+    }
+    *out_buf = fifo.release();
+    *out_actual = sizeof(zx_handle_t);
+    return ZX_OK;
+}
+
 zx_status_t BlockDevice::AttachVmo(const void* in_buf, size_t in_len, vmoid_t* out_buf,
                                    size_t out_len, size_t* out_actual) {
     if ((in_len < sizeof(zx_handle_t)) || (out_len < sizeof(vmoid_t))) {
@@ -175,6 +193,8 @@ zx_status_t BlockDevice::DdkIoctl(uint32_t op, const void* cmd, size_t cmd_len,
     switch (op) {
     case IOCTL_BLOCK_GET_FIFOS:
         return GetFifos(reinterpret_cast<zx_handle_t*>(reply), reply_len, out_actual);
+    case IOCTL_BLOCK_GET_QUEUE_FIFO:
+        return GetQueueFifo(reinterpret_cast<zx_handle_t*>(reply), reply_len, out_actual);
     case IOCTL_BLOCK_ATTACH_VMO:
         return AttachVmo(cmd, cmd_len, reinterpret_cast<vmoid_t*>(reply), reply_len, out_actual);
     case IOCTL_BLOCK_FIFO_CLOSE: {
@@ -201,6 +221,9 @@ zx_status_t BlockDevice::DdkIoctl(uint32_t op, const void* cmd, size_t cmd_len,
     case IOCTL_BLOCK_GET_STATS: {
         return GetStats(cmd, cmd_len, reply, reply_len, out_actual);
     }
+    case IOCTL_BLOCK_GET_SCHED_STATS: {
+        return GetSchedulerStats(cmd, cmd_len, reply, reply_len, out_actual);
+    }
     case IOCTL_BLOCK_GET_TYPE_GUID: {
         if (!parent_partition_protocol_.is_valid()) {
             return ZX_ERR_NOT_SUPPORTED;
@@ -493,6 +516,20 @@ zx_status_t BlockDevice::GetStats(const void* cmd, size_t cmd_len, void* reply,
     }
 }
 
+zx_status_t BlockDevice::GetSchedulerStats(const void* cmd, size_t cmd_len, void* reply,
+                                           size_t reply_len, size_t* out_actual) {
+    if (cmd_len != sizeof(bool)) {
+        return ZX_ERR_INVALID_ARGS;
+    }
+    block_sched_stats_t* out = reinterpret_cast<block_sched_stats_t*>(reply);
+    if (reply_len < sizeof(*out)) {
+        return ZX_ERR_BUFFER_TOO_SMALL;
+    }
+    server_manager_.GetSchedulerStats(*reinterpret_cast<const bool*>(cmd), out);
+    *out_actual = sizeof(*out);
+    return ZX_OK;
+}
+
 zx_status_t BlockDevice::Bind(void* ctx, zx_device_t* dev) {
     auto bdev = std::make_unique<BlockDevice>(dev);
 
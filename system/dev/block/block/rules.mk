@@ -10,6 +10,7 @@ MODULE_TYPE := driver
 
 MODULE_SRCS := \
     $(LOCAL_DIR)/block.cpp \
+    $(LOCAL_DIR)/scheduler.cpp \
     $(LOCAL_DIR)/server.cpp \
     $(LOCAL_DIR)/server-manager.cpp \
     $(LOCAL_DIR)/txn-group.cpp \
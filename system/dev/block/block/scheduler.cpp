@@ -0,0 +1,187 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ddk/debug.h>
+#include <fbl/alloc_checker.h>
+
+#include "scheduler.h"
+
+namespace {
+
+// Returns true if |next| may be appended to the operation of |msg|.
+bool CanMerge(const block_msg_t* msg, const block_msg_t* next, uint64_t max_transfer) {
+    const auto& rw = msg->op.rw;
+    const auto& next_rw = next->op.rw;
+    return next_rw.command == rw.command &&
+           next_rw.vmo == rw.vmo &&
+           next_rw.offset_dev == rw.offset_dev + rw.length &&
+           next_rw.offset_vmo == rw.offset_vmo + rw.length &&
+           static_cast<uint64_t>(rw.length) + next_rw.length <= max_transfer;
+}
+
+// Returns true if the device ranges of |a| and |b| overlap.
+bool Overlaps(const block_msg_t* a, const block_msg_t* b) {
+    return a->op.rw.offset_dev < b->op.rw.offset_dev + b->op.rw.length &&
+           b->op.rw.offset_dev < a->op.rw.offset_dev + a->op.rw.length;
+}
+
+size_t ReadCounter(std::atomic<size_t>* counter, bool clear) {
+    return clear ? counter->exchange(0, std::memory_order_relaxed)
+                 : counter->load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+void SchedulerStats::Read(bool clear, block_sched_stats_t* out) {
+    out->total_requests = ReadCounter(&total_requests, clear);
+    out->merged_requests = ReadCounter(&merged_requests, clear);
+    out->total_ops = ReadCounter(&total_ops, clear);
+    out->queue_depth_sum = ReadCounter(&queue_depth_sum, clear);
+    out->max_queue_depth = ReadCounter(&max_queue_depth, clear);
+    out->throttled = ReadCounter(&throttled, clear);
+}
+
+void SchedulerStats::Dispatch(size_t requests, size_t depth) {
+    total_requests.fetch_add(requests, std::memory_order_relaxed);
+    merged_requests.fetch_add(requests - 1, std::memory_order_relaxed);
+    total_ops.fetch_add(1, std::memory_order_relaxed);
+    queue_depth_sum.fetch_add(depth, std::memory_order_relaxed);
+    size_t max = max_queue_depth.load(std::memory_order_relaxed);
+    while (depth > max &&
+           !max_queue_depth.compare_exchange_weak(max, depth, std::memory_order_relaxed)) {
+    }
+}
+
+zx_status_t IoScheduler::Create(const block_info_t& info, fbl::unique_ptr<IoScheduler>* out) {
+    const char* name = getenv("block.scheduler");
+    fbl::AllocChecker ac;
+    if (name != nullptr && strcmp(name, "fifo") == 0) {
+        out->reset(new (&ac) FifoScheduler());
+    } else {
+        if (name != nullptr && strcmp(name, "elevator") != 0) {
+            zxlogf(ERROR, "block: Unknown scheduler '%s', using 'elevator'\n", name);
+        }
+        out->reset(new (&ac) ElevatorScheduler(info));
+    }
+    if (!ac.check()) {
+        return ZX_ERR_NO_MEMORY;
+    }
+    return ZX_OK;
+}
+
+void FifoScheduler::Insert(block_msg_t* msg) {
+    queue_.push_back(msg);
+}
+
+block_msg_t* FifoScheduler::Pop() {
+    return queue_.pop_front();
+}
+
+ElevatorScheduler::ElevatorScheduler(const block_info_t& info)
+    : max_transfer_(info.max_transfer_size / info.block_size != 0
+                        ? info.max_transfer_size / info.block_size
+                        : UINT32_MAX),
+      // Writes are typically background writeback, which can afford to wait
+      // for reads a while longer.
+      classes_{{kMaxDepth / 2}, {2 * kMaxDepth}} {}
+
+bool ElevatorScheduler::empty() const {
+    for (const Class& cls : classes_) {
+        if (!cls.sorted.is_empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ElevatorScheduler::Conflicts(const block_msg_t* msg) const {
+    const bool write = (msg->op.command & BLOCK_OP_MASK) != BLOCK_OP_READ;
+    const uint64_t end = msg->op.rw.offset_dev + msg->op.rw.length;
+    for (uint32_t i = 0; i < kPriorityCount; i++) {
+        // Reads may pass each other.
+        if (i == kRead && !write) {
+            continue;
+        }
+        for (const block_msg_t& other : classes_[i].sorted) {
+            if (other.op.rw.offset_dev >= end) {
+                break;
+            }
+            if (Overlaps(msg, &other)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void ElevatorScheduler::Insert(block_msg_t* msg) {
+    Class* cls = &classes_[(msg->op.command & BLOCK_OP_MASK) == BLOCK_OP_READ ? kRead : kWrite];
+    msg->extra.merged = nullptr;
+    msg->extra.deadline = dispatched_ + cls->max_delay;
+
+    // Messages usually arrive in ascending order, so search from the back.
+    // Messages for the same offset stay in order of arrival.
+    const uint64_t offset = msg->op.rw.offset_dev;
+    auto iter = cls->sorted.end();
+    while (iter != cls->sorted.begin()) {
+        auto prev = iter;
+        --prev;
+        if (prev->op.rw.offset_dev <= offset) {
+            break;
+        }
+        iter = prev;
+    }
+    cls->sorted.insert(iter, msg);
+    cls->arrivals.push_back(msg);
+}
+
+block_msg_t* ElevatorScheduler::Pop() {
+    // A message which has been passed over for too long goes first.
+    for (Class& cls : classes_) {
+        if (!cls.arrivals.is_empty() && cls.arrivals.front().extra.deadline <= dispatched_) {
+            return Take(&cls, &cls.arrivals.front());
+        }
+    }
+
+    for (Class& cls : classes_) {
+        if (cls.sorted.is_empty()) {
+            continue;
+        }
+        // Continue from where the last operation of this class ended, or
+        // start over from the lowest offset.
+        for (block_msg_t& msg : cls.sorted) {
+            if (msg.op.rw.offset_dev >= cls.head) {
+                return Take(&cls, &msg);
+            }
+        }
+        return Take(&cls, &cls.sorted.front());
+    }
+    return nullptr;
+}
+
+block_msg_t* ElevatorScheduler::Take(Class* cls, block_msg_t* msg) {
+    auto next = cls->sorted.make_iterator(*msg);
+    ++next;
+    cls->sorted.erase(*msg);
+    cls->arrivals.erase(*msg);
+
+    block_msg_t* tail = msg;
+    while (next != cls->sorted.end() && CanMerge(msg, &*next, max_transfer_)) {
+        block_msg_t* merged = &*next;
+        ++next;
+        cls->sorted.erase(*merged);
+        cls->arrivals.erase(*merged);
+        msg->op.rw.length += merged->op.rw.length;
+        tail->extra.merged = merged;
+        tail = merged;
+    }
+
+    cls->head = msg->op.rw.offset_dev + msg->op.rw.length;
+    dispatched_++;
+    return msg;
+}
@@ -0,0 +1,140 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include <fbl/macros.h>
+#include <fbl/unique_ptr.h>
+#include <zircon/device/block.h>
+#include <zircon/types.h>
+
+#include "server.h"
+
+// Statistics of the schedulers of all block servers started on a device.
+//
+// Updated without synchronization between counters, so a snapshot may be
+// slightly inconsistent.
+struct SchedulerStats {
+    void Read(bool clear, block_sched_stats_t* out);
+
+    // Records the dispatch of an operation made up of |requests| requests,
+    // with |depth| operations (including it) outstanding at the device.
+    void Dispatch(size_t requests, size_t depth);
+
+    std::atomic<size_t> total_requests = {};
+    std::atomic<size_t> merged_requests = {};
+    std::atomic<size_t> total_ops = {};
+    std::atomic<size_t> queue_depth_sum = {};
+    std::atomic<size_t> max_queue_depth = {};
+    std::atomic<size_t> throttled = {};
+};
+
+// The stage of a block server between its input queue and the device, which
+// decides the order in which read and write requests are dispatched.
+//
+// The block server only inserts requests which may be reordered relative to
+// each other: requests separated by a barrier, requests other than reads and
+// writes, and requests which conflict (see Conflicts()), never meet in the
+// scheduler.
+//
+// Not thread-safe; used only by the thread of a single block server.
+class IoScheduler {
+public:
+    virtual ~IoScheduler() = default;
+
+    // Creates the scheduler named by the "block.scheduler" boot option, which
+    // may be "fifo" or "elevator" (the default).
+    static zx_status_t Create(const block_info_t& info, fbl::unique_ptr<IoScheduler>* out);
+
+    virtual bool empty() const = 0;
+
+    // Returns true if |msg| must not be reordered with the messages already in
+    // the scheduler, because it overlaps one of them on the device and either
+    // of the two is a write.
+    virtual bool Conflicts(const block_msg_t* msg) const = 0;
+
+    // Takes ownership of a read or write message.
+    virtual void Insert(block_msg_t* msg) = 0;
+
+    // Removes the message which should be dispatched next. Other messages may
+    // be merged into its operation, chained through |extra.merged|.
+    virtual block_msg_t* Pop() = 0;
+
+    // Returns the number of operations the scheduler wants outstanding at the
+    // device, so that it may reorder the rest, or zero if it has no limit.
+    virtual size_t max_depth() const = 0;
+};
+
+// Dispatches messages in the order they arrive, without merging them.
+class FifoScheduler : public IoScheduler {
+public:
+    FifoScheduler() = default;
+
+    bool empty() const override { return queue_.is_empty(); }
+    // Messages are dispatched in order of arrival, so they never conflict.
+    bool Conflicts(const block_msg_t* msg) const override { return false; }
+    void Insert(block_msg_t* msg) override;
+    block_msg_t* Pop() override;
+    size_t max_depth() const override { return 0; }
+
+private:
+    DISALLOW_COPY_ASSIGN_AND_MOVE(FifoScheduler);
+
+    BlockMsgQueue queue_;
+};
+
+// Dispatches reads before writes, each in ascending order of device offset
+// (wrapping around to the lowest offset after the highest), and merges
+// requests which are contiguous both on the device and in the same VMO.
+//
+// So that reads can overtake writes which arrived earlier, limits the number
+// of outstanding operations. A request is never passed over by more than a
+// fixed number of other operations.
+class ElevatorScheduler : public IoScheduler {
+public:
+    explicit ElevatorScheduler(const block_info_t& info);
+
+    bool empty() const override;
+    bool Conflicts(const block_msg_t* msg) const override;
+    void Insert(block_msg_t* msg) override;
+    block_msg_t* Pop() override;
+    size_t max_depth() const override { return kMaxDepth; }
+
+private:
+    DISALLOW_COPY_ASSIGN_AND_MOVE(ElevatorScheduler);
+
+    static constexpr size_t kMaxDepth = 64;
+
+    enum Priority : uint32_t {
+        kRead,
+        kWrite,
+        kPriorityCount,
+    };
+
+    struct Class {
+        // The number of later operations which may be dispatched before a
+        // message of this class.
+        const uint64_t max_delay;
+        // Ordered by device offset.
+        BlockMsgQueue sorted;
+        // Ordered by arrival.
+        BlockMsgSchedulerQueue arrivals;
+        // The device offset following the last operation dispatched.
+        uint64_t head = 0;
+    };
+
+    // Removes |msg| from its class, and merges the messages which follow it.
+    block_msg_t* Take(Class* cls, block_msg_t* msg);
+
+    // The largest operation which may be dispatched, in blocks.
+    const uint64_t max_transfer_;
+    Class classes_[kPriorityCount];
+    // The number of operations dispatched so far.
+    uint64_t dispatched_ = 0;
+};
@@ -7,6 +7,7 @@
 #include <utility>
 
 #include <ddk/debug.h>
+#include <fbl/algorithm.h>
 
 #include "server-manager.h"
 
@@ -38,7 +39,7 @@ zx_status_t ServerManager::StartServer(ddk::BlockProtocolClient* protocol, zx::f
     ZX_DEBUG_ASSERT(server_ == nullptr);
     BlockServer* server;
     fzl::fifo<block_fifo_request_t, block_fifo_response_t> fifo;
-    zx_status_t status = BlockServer::Create(protocol, &fifo, &server);
+    zx_status_t status = BlockServer::Create(protocol, &stats_, &fifo, &server);
     if (status != ZX_OK) {
         return status;
     }
@@ -52,6 +53,28 @@ zx_status_t ServerManager::StartServer(ddk::BlockProtocolClient* protocol, zx::f
     return ZX_OK;
 }
 
+zx_status_t ServerManager::StartQueue(zx::fifo* out_fifo) {
+    if (!IsFifoServerRunning()) {
+        return ZX_ERR_BAD_STATE;
+    }
+    if (queue_count_ == fbl::count_of(queue_servers_)) {
+        return ZX_ERR_NO_RESOURCES;
+    }
+    BlockServer* server;
+    fzl::fifo<block_fifo_request_t, block_fifo_response_t> fifo;
+    zx_status_t status = server_->CreateQueue(queue_count_ + 1, &fifo, &server);
+    if (status != ZX_OK) {
+        return status;
+    }
+    if (thrd_create(&queue_threads_[queue_count_], &RunQueue, server) != thrd_success) {
+        delete server;
+        return ZX_ERR_NO_MEMORY;
+    }
+    queue_servers_[queue_count_++] = server;
+    *out_fifo = zx::fifo(fifo.release());
+    return ZX_OK;
+}
+
 zx_status_t ServerManager::CloseFifoServer() {
     switch (GetState()) {
     case ThreadState::Running:
@@ -76,12 +99,23 @@ zx_status_t ServerManager::AttachVmo(zx::vmo vmo, vmoid_t* out_vmoid) {
 }
 
 void ServerManager::JoinServer() {
+    // The additional queues may outlive the first one, if the client closed only its
+    // first Fifo. Shutting down a queue which has already terminated returns immediately.
+    for (uint32_t i = 0; i < queue_count_; i++) {
+        queue_servers_[i]->ShutDown();
+        thrd_join(queue_threads_[i], nullptr);
+    }
     thrd_join(thread_, nullptr);
     FreeServer();
 }
 
 void ServerManager::FreeServer() {
     SetState(ThreadState::None);
+    for (uint32_t i = 0; i < queue_count_; i++) {
+        delete queue_servers_[i];
+        queue_servers_[i] = nullptr;
+    }
+    queue_count_ = 0;
     delete server_;
     server_ = nullptr;
 }
@@ -101,3 +135,8 @@ int ServerManager::RunServer(void* arg) {
     manager->SetState(ThreadState::Joinable);
     return 0;
 }
+
+int ServerManager::RunQueue(void* arg) {
+    reinterpret_cast<BlockServer*>(arg)->Serve();
+    return 0;
+}
@@ -13,6 +13,7 @@
 #include <lib/zx/vmo.h>
 #include <zircon/types.h>
 
+#include "scheduler.h"
 #include "server.h"
 
 // ServerManager controls the state of a background thread (or threads) servicing Fifo
@@ -30,6 +31,13 @@ public:
     // Returns an error if the Fifo server is already running.
     zx_status_t StartServer(ddk::BlockProtocolClient* protocol, zx::fifo* out_fifo);
 
+    // Adds another queue to the currently executing server, served by its own
+    // background thread.
+    //
+    // Returns an error if a server is not currently running, or if it already
+    // has BLOCK_MAX_QUEUES queues.
+    zx_status_t StartQueue(zx::fifo* out_fifo);
+
     // Ensures the FIFO server has terminated.
     //
     // When this function returns, it is guaranteed that the next call to |StartServer()|
@@ -41,6 +49,12 @@ public:
     // Returns an error if a server is not currently running.
     zx_status_t AttachVmo(zx::vmo vmo, vmoid_t* out_vmoid);
 
+    // Returns the scheduler statistics of all servers started by this manager,
+    // and clears them if |clear| is true.
+    void GetSchedulerStats(bool clear, block_sched_stats_t* out) {
+        stats_.Read(clear, out);
+    }
+
 private:
     enum class ThreadState : uint32_t {
         // No server is currently executing.
@@ -67,6 +81,11 @@ private:
     // closes their end of the Fifo.
     static int RunServer(void* arg);
 
+    // Runs an additional queue of the server. Unlike |RunServer|, does not change the
+    // state of the manager when the queue terminates: the queue is only joined along
+    // with the rest of the server.
+    static int RunQueue(void* arg);
+
     ThreadState GetState() const {
         return static_cast<ThreadState>(state_.load());
     }
@@ -78,4 +97,11 @@ private:
     thrd_t thread_;
     std::atomic<uint32_t> state_;
     BlockServer* server_ = nullptr;
+
+    // Queues beyond the first, which is served by |server_| and |thread_|.
+    thrd_t queue_threads_[BLOCK_MAX_QUEUES - 1];
+    BlockServer* queue_servers_[BLOCK_MAX_QUEUES - 1] = {};
+    uint32_t queue_count_ = 0;
+
+    SchedulerStats stats_;
 };
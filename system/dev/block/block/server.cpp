@@ -20,6 +20,7 @@
 #include <zircon/device/block.h>
 #include <zircon/syscalls.h>
 
+#include "scheduler.h"
 #include "server.h"
 
 namespace {
@@ -28,7 +29,9 @@ namespace {
 // to terminate.
 constexpr zx_signals_t kSignalFifoTerminate   = ZX_USER_SIGNAL_0;
 // This signal is set on the FIFO when, after the thread enqueueing operations
-// has encountered a barrier, all prior operations have completed.
+// has encountered a barrier, all prior operations have completed; or when,
+// after the scheduler has stopped dispatching operations to let the device
+// catch up, enough of them have completed.
 constexpr zx_signals_t kSignalFifoOpsComplete = ZX_USER_SIGNAL_1;
 // Signalled on the fifo when it has finished terminating.
 // (If we need to free up user signals, this could easily be transformed
@@ -64,8 +67,18 @@ void BlockComplete(BlockMsg* msg, zx_status_t status) {
 
 void BlockCompleteCb(void* cookie, zx_status_t status, block_op_t* bop) {
     ZX_DEBUG_ASSERT(bop != nullptr);
-    BlockMsg msg(static_cast<block_msg_t*>(cookie));
-    BlockComplete(&msg, status);
+    // Complete each of the messages the scheduler merged into this operation.
+    block_msg_t* next = static_cast<block_msg_t*>(cookie);
+    while (next != nullptr) {
+        BlockMsg msg(next);
+        next = msg.extra()->merged;
+        BlockComplete(&msg, status);
+    }
+}
+
+bool IsReadWrite(const block_msg_t* msg) {
+    const uint32_t op = msg->op.command & BLOCK_OP_MASK;
+    return op == BLOCK_OP_READ || op == BLOCK_OP_WRITE;
 }
 
 uint32_t OpcodeToCommand(uint32_t opcode) {
@@ -112,6 +125,7 @@ void BlockServer::BarrierComplete() {
     // signal. We'll never "miss" a signal, because we process
     // the queue AFTER unsetting it.
     barrier_in_progress_.store(false);
+    throttled_.store(false);
     fifo_.signal(kSignalFifoOpsComplete, 0);
     InQueueDrainer();
 }
@@ -119,7 +133,7 @@ void BlockServer::BarrierComplete() {
 void BlockServer::TerminateQueue() {
     InQueueDrainer();
     while (true) {
-        if (pending_count_.load() == 0 && in_queue_.is_empty()) {
+        if (pending_count_.load() == 0 && in_queue_.is_empty() && scheduler_->empty()) {
             return;
         }
         zx_signals_t signals = kSignalFifoOpsComplete;
@@ -144,6 +158,7 @@ zx_status_t BlockServer::Read(block_fifo_request_t* requests, size_t* count) {
         TerminateQueue();
         ZX_ASSERT(pending_count_.load() == 0);
         ZX_ASSERT(in_queue_.is_empty());
+        ZX_ASSERT(scheduler_->empty());
         fifo_.signal(0, kSignalFifoTerminated);
     });
 
@@ -179,7 +194,7 @@ zx_status_t BlockServer::Read(block_fifo_request_t* requests, size_t* count) {
     }
 }
 
-zx_status_t BlockServer::FindVmoIDLocked(vmoid_t* out) {
+zx_status_t IoBufferTable::FindVmoIDLocked(vmoid_t* out) {
     for (vmoid_t i = last_id_; i < std::numeric_limits<vmoid_t>::max(); i++) {
         if (!tree_.find(i).IsValid()) {
             *out = i;
@@ -197,10 +212,10 @@ zx_status_t BlockServer::FindVmoIDLocked(vmoid_t* out) {
     return ZX_ERR_NO_RESOURCES;
 }
 
-zx_status_t BlockServer::AttachVmo(zx::vmo vmo, vmoid_t* out) {
+zx_status_t IoBufferTable::Attach(zx::vmo vmo, vmoid_t* out) {
     zx_status_t status;
     vmoid_t id;
-    fbl::AutoLock server_lock(&server_lock_);
+    fbl::AutoLock lock(&lock_);
     if ((status = FindVmoIDLocked(&id)) != ZX_OK) {
         return status;
     }
@@ -215,10 +230,36 @@ zx_status_t BlockServer::AttachVmo(zx::vmo vmo, vmoid_t* out) {
     return ZX_OK;
 }
 
+zx_status_t IoBufferTable::Detach(vmoid_t vmoid) {
+    fbl::AutoLock lock(&lock_);
+    auto iobuf = tree_.find(vmoid);
+    if (!iobuf.IsValid()) {
+        return ZX_ERR_IO;
+    }
+    tree_.erase(*iobuf);
+    return ZX_OK;
+}
+
+fbl::RefPtr<IoBuffer> IoBufferTable::Find(vmoid_t vmoid) {
+    fbl::AutoLock lock(&lock_);
+    auto iobuf = tree_.find(vmoid);
+    if (!iobuf.IsValid()) {
+        return nullptr;
+    }
+    return iobuf.CopyPointer();
+}
+
+zx_status_t BlockServer::AttachVmo(zx::vmo vmo, vmoid_t* out) {
+    return iobufs_->Attach(std::move(vmo), out);
+}
+
 void BlockServer::TxnEnd() {
     size_t old_count = pending_count_.fetch_sub(1);
     ZX_ASSERT(old_count > 0);
-    if ((old_count == 1) && barrier_in_progress_.load()) {
+    // The scheduler resumes once half of its operations have completed, so
+    // that it dispatches them in batches rather than one at a time.
+    if (((old_count == 1) && barrier_in_progress_.load()) ||
+        ((old_count == scheduler_->max_depth() / 2 + 1) && throttled_.load())) {
         // Since we're avoiding locking, and there is a gap between
         // "pending count decremented" and "FIFO signalled", it's possible
         // that we'll receive spurious wakeup requests.
@@ -226,18 +267,68 @@ void BlockServer::TxnEnd() {
     }
 }
 
+void BlockServer::AdmitToScheduler() {
+    while (!in_queue_.is_empty()) {
+        auto msg = in_queue_.begin();
+        if (deferred_barrier_before_) {
+            msg->op.command |= BLOCK_FL_BARRIER_BEFORE;
+            deferred_barrier_before_ = false;
+        }
+        // A message which overlaps one in the scheduler waits, like one after a
+        // barrier, until every message before it has been dispatched.
+        if ((msg->op.command & BLOCK_FL_BARRIER_BEFORE) || !IsReadWrite(&*msg) ||
+            scheduler_->Conflicts(&*msg)) {
+            return;
+        }
+        if (msg->op.command & BLOCK_FL_BARRIER_AFTER) {
+            deferred_barrier_before_ = true;
+        }
+        in_queue_.pop_front();
+        msg->op.command &= ~BLOCK_FL_BARRIER_AFTER;
+        scheduler_->Insert(&*msg);
+    }
+}
+
+void BlockServer::Dispatch(block_msg_t* msg) {
+    size_t requests = 1;
+    for (block_msg_t* merged = msg->extra.merged; merged != nullptr;
+         merged = merged->extra.merged) {
+        requests++;
+    }
+    size_t depth = pending_count_.fetch_add(requests) + requests;
+    stats_->Dispatch(requests, depth);
+    msg->op.command |= queue_flags_;
+    bp_->Queue(&msg->op, BlockCompleteCb, msg);
+}
+
 void BlockServer::InQueueDrainer() {
+    const size_t max_depth = scheduler_->max_depth();
     while (true) {
+        AdmitToScheduler();
+
+        while (!scheduler_->empty()) {
+            if (max_depth != 0 && pending_count_.load() >= max_depth) {
+                // Let the device catch up, so that later messages may still be
+                // reordered ahead of those in the scheduler. TxnEnd signals us
+                // once enough operations have completed, unless they already
+                // have.
+                throttled_.store(true);
+                if (pending_count_.load() > max_depth / 2) {
+                    stats_->throttled.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                throttled_.store(false);
+            }
+            Dispatch(scheduler_->Pop());
+        }
+
         if (in_queue_.is_empty()) {
             return;
         }
 
+        // The next message may not be reordered with those before it, which
+        // have all been dispatched.
         auto msg = in_queue_.begin();
-        if (deferred_barrier_before_) {
-            msg->op.command |= BLOCK_FL_BARRIER_BEFORE;
-            deferred_barrier_before_ = false;
-        }
-
         if (msg->op.command & BLOCK_FL_BARRIER_BEFORE) {
             barrier_in_progress_.store(true);
             if (pending_count_.load() > 0) {
@@ -250,7 +341,6 @@ void BlockServer::InQueueDrainer() {
         if (msg->op.command & BLOCK_FL_BARRIER_AFTER) {
             deferred_barrier_before_ = true;
         }
-        pending_count_.fetch_add(1);
         in_queue_.pop_front();
         // Underlying block device drivers should not see block barriers
         // which are already handled by the block midlayer.
@@ -258,19 +348,47 @@ void BlockServer::InQueueDrainer() {
         // This may be altered in the future if block devices
         // are capable of implementing hardware barriers.
         msg->op.command &= ~(BLOCK_FL_BARRIER_BEFORE | BLOCK_FL_BARRIER_AFTER);
-        bp_->Queue(&msg->op, BlockCompleteCb, &*msg);
+        if (IsReadWrite(&*msg)) {
+            scheduler_->Insert(&*msg);
+        } else {
+            Dispatch(&*msg);
+        }
     }
 }
 
-zx_status_t BlockServer::Create(ddk::BlockProtocolClient* bp, fzl::fifo<block_fifo_request_t,
-                                block_fifo_response_t>* fifo_out, BlockServer** out) {
+zx_status_t BlockServer::Create(ddk::BlockProtocolClient* bp, SchedulerStats* stats,
+                                fzl::fifo<block_fifo_request_t,
+                                          block_fifo_response_t>* fifo_out,
+                                BlockServer** out) {
     fbl::AllocChecker ac;
-    BlockServer* bs = new (&ac) BlockServer(bp);
+    fbl::RefPtr<IoBufferTable> iobufs = fbl::AdoptRef(new (&ac) IoBufferTable());
+    if (!ac.check()) {
+        return ZX_ERR_NO_MEMORY;
+    }
+    return CreateServer(bp, stats, std::move(iobufs), 0, fifo_out, out);
+}
+
+zx_status_t BlockServer::CreateQueue(uint32_t queue, fzl::fifo<block_fifo_request_t,
+                                     block_fifo_response_t>* fifo_out, BlockServer** out) {
+    return CreateServer(bp_, stats_, iobufs_, queue, fifo_out, out);
+}
+
+zx_status_t BlockServer::CreateServer(ddk::BlockProtocolClient* bp, SchedulerStats* stats,
+                                      fbl::RefPtr<IoBufferTable> iobufs, uint32_t queue,
+                                      fzl::fifo<block_fifo_request_t,
+                                                block_fifo_response_t>* fifo_out,
+                                      BlockServer** out) {
+    fbl::AllocChecker ac;
+    BlockServer* bs = new (&ac) BlockServer(bp, stats, std::move(iobufs), queue);
     if (!ac.check()) {
         return ZX_ERR_NO_MEMORY;
     }
 
     zx_status_t status;
+    if ((status = IoScheduler::Create(bs->info_, &bs->scheduler_)) != ZX_OK) {
+        delete bs;
+        return status;
+    }
     if ((status = fzl::create_fifo(BLOCK_FIFO_MAX_DEPTH, 0, fifo_out, &bs->fifo_)) != ZX_OK) {
         delete bs;
         return status;
@@ -301,12 +419,8 @@ zx_status_t BlockServer::ProcessReadWriteRequest(block_fifo_request_t* request)
     reqid_t reqid = request->reqid;
     groupid_t group = request->group;
 
-    // TODO(ZX-1586): Reduce the usage of this lock (only used to protect
-    // IoBuffers).
-    fbl::AutoLock server_lock(&server_lock_);
-
-    auto iobuf = tree_.find(request->vmoid);
-    if (!iobuf.IsValid()) {
+    fbl::RefPtr<IoBuffer> iobuf = iobufs_->Find(request->vmoid);
+    if (iobuf == nullptr) {
         // Operation which is not accessing a valid vmo.
         return ZX_ERR_IO;
     }
@@ -332,7 +446,7 @@ zx_status_t BlockServer::ProcessReadWriteRequest(block_fifo_request_t* request)
         return status;
     }
     block_msg_extra_t* extra = msg.extra();
-    extra->iobuf = iobuf.CopyPointer();
+    extra->iobuf = iobuf;
     extra->server = this;
     extra->reqid = reqid;
     extra->group = group;
@@ -359,7 +473,7 @@ zx_status_t BlockServer::ProcessReadWriteRequest(block_fifo_request_t* request)
                     return status;
                 }
                 block_msg_extra_t* extra = msg.extra();
-                extra->iobuf = iobuf.CopyPointer();
+                extra->iobuf = iobuf;
                 extra->server = this;
                 extra->reqid = reqid;
                 extra->group = group;
@@ -393,18 +507,9 @@ zx_status_t BlockServer::ProcessReadWriteRequest(block_fifo_request_t* request)
 }
 
 zx_status_t BlockServer::ProcessCloseVmoRequest(block_fifo_request_t* request) {
-    fbl::AutoLock server_lock(&server_lock_);
-
-    auto iobuf = tree_.find(request->vmoid);
-    if (!iobuf.IsValid()) {
-        // Operation which is not accessing a valid vmo
-        return ZX_ERR_IO;
-    }
-
-    // TODO(smklein): Ensure that "iobuf" is not being used by
+    // TODO(smklein): Ensure that the IoBuffer is not being used by
     // any in-flight txns.
-    tree_.erase(*iobuf);
-    return ZX_OK;
+    return iobufs_->Detach(request->vmoid);
 }
 
 zx_status_t BlockServer::ProcessFlushRequest(block_fifo_request_t* request) {
@@ -423,6 +528,33 @@ zx_status_t BlockServer::ProcessFlushRequest(block_fifo_request_t* request) {
     return ZX_OK;
 }
 
+zx_status_t BlockServer::ProcessTrimRequest(block_fifo_request_t* request) {
+    if (!(info_.flags & BLOCK_FLAG_TRIM_SUPPORT)) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    if (request->length < 1) {
+        return ZX_ERR_INVALID_ARGS;
+    }
+
+    zx_status_t status;
+    BlockMsg msg;
+    if ((status = BlockMsg::Create(block_op_size_, &msg)) != ZX_OK) {
+        return status;
+    }
+    block_msg_extra_t* extra = msg.extra();
+    extra->iobuf = nullptr;
+    extra->server = this;
+    extra->reqid = request->reqid;
+    extra->group = request->group;
+    // BLOCKIO_TRIM does not share its value with BLOCK_OP_TRIM; only the flags carry over.
+    block_op_t* bop = msg.op();
+    bop->trim.command = BLOCK_OP_TRIM | OpcodeToCommand(request->opcode & BLOCKIO_FLAG_MASK);
+    bop->trim.length = request->length;
+    bop->trim.offset_dev = request->dev_offset;
+    in_queue_.push_back(msg.release());
+    return ZX_OK;
+}
+
 void BlockServer::ProcessRequest(block_fifo_request_t* request) {
     zx_status_t status;
     switch (request->opcode & BLOCKIO_OP_MASK) {
@@ -441,6 +573,11 @@ void BlockServer::ProcessRequest(block_fifo_request_t* request) {
             TxnComplete(status, request->reqid, request->group);
         }
         break;
+    case BLOCKIO_TRIM:
+        if ((status = ProcessTrimRequest(request)) != ZX_OK) {
+            TxnComplete(status, request->reqid, request->group);
+        }
+        break;
     default:
         fprintf(stderr, "Unrecognized Block Server operation: %x\n",
                 request->opcode);
@@ -492,16 +629,21 @@ zx_status_t BlockServer::Serve() {
     }
 }
 
-BlockServer::BlockServer(ddk::BlockProtocolClient* bp) :
-    bp_(bp), block_op_size_(0), pending_count_(0), barrier_in_progress_(false),
-    last_id_(VMOID_INVALID + 1) {
+BlockServer::BlockServer(ddk::BlockProtocolClient* bp, SchedulerStats* stats,
+                         fbl::RefPtr<IoBufferTable> iobufs, uint32_t queue) :
+    bp_(bp), block_op_size_(0), iobufs_(std::move(iobufs)), queue_flags_(0),
+    pending_count_(0), barrier_in_progress_(false), throttled_(false), stats_(stats) {
     size_t block_op_size;
     bp->Query(&info_, &block_op_size);
+    if (info_.flags & BLOCK_FLAG_MULTI_QUEUE) {
+        queue_flags_ = (queue << BLOCK_FL_QUEUE_SHIFT) & BLOCK_FL_QUEUE_MASK;
+    }
 }
 
 BlockServer::~BlockServer() {
     ZX_ASSERT(pending_count_.load() == 0);
     ZX_ASSERT(in_queue_.is_empty());
+    ZX_ASSERT(scheduler_ == nullptr || scheduler_->empty());
 }
 
 void BlockServer::ShutDown() {
@@ -54,7 +54,30 @@ private:
     const vmoid_t vmoid_;
 };
 
+// The set of VMOs attached to a block server, shared by all of its queues.
+class IoBufferTable : public fbl::RefCounted<IoBufferTable> {
+public:
+    IoBufferTable() = default;
+
+    zx_status_t Attach(zx::vmo vmo, vmoid_t* out) TA_EXCL(lock_);
+    zx_status_t Detach(vmoid_t vmoid) TA_EXCL(lock_);
+
+    // Returns nullptr if |vmoid| is not attached.
+    fbl::RefPtr<IoBuffer> Find(vmoid_t vmoid) TA_EXCL(lock_);
+
+private:
+    DISALLOW_COPY_ASSIGN_AND_MOVE(IoBufferTable);
+
+    zx_status_t FindVmoIDLocked(vmoid_t* out) TA_REQ(lock_);
+
+    fbl::Mutex lock_;
+    fbl::WAVLTree<vmoid_t, fbl::RefPtr<IoBuffer>> tree_ TA_GUARDED(lock_);
+    vmoid_t last_id_ TA_GUARDED(lock_) = VMOID_INVALID + 1;
+};
+
 class BlockServer;
+class IoScheduler;
+struct SchedulerStats;
 
 typedef struct block_msg_extra block_msg_extra_t;
 typedef struct block_msg block_msg_t;
@@ -63,10 +86,17 @@ typedef struct block_msg block_msg_t;
 // C++ libraries while also using "block_op_t"s, which may require extra space.
 struct block_msg_extra {
     fbl::DoublyLinkedListNodeState<block_msg_t*> dll_node_state;
+    // Used by the IoScheduler, alongside |dll_node_state|.
+    fbl::DoublyLinkedListNodeState<block_msg_t*> sched_node_state;
     fbl::RefPtr<IoBuffer> iobuf;
     BlockServer* server;
     reqid_t reqid;
     groupid_t group;
+    // Messages merged into this one's operation by the IoScheduler, which are
+    // completed along with it.
+    block_msg_t* merged;
+    // The IoScheduler dispatch count by which this message must be dispatched.
+    uint64_t deadline;
 };
 
 // A single unit of work transmitted to the underlying block layer.
@@ -87,6 +117,14 @@ struct DoublyLinkedListTraits {
 
 using BlockMsgQueue = fbl::DoublyLinkedList<block_msg_t*, DoublyLinkedListTraits>;
 
+struct SchedulerListTraits {
+    static fbl::DoublyLinkedListNodeState<block_msg_t*>& node_state(block_msg_t& obj) {
+        return obj.extra.sched_node_state;
+    }
+};
+
+using BlockMsgSchedulerQueue = fbl::DoublyLinkedList<block_msg_t*, SchedulerListTraits>;
+
 // C++ safe wrapper around block_msg_t.
 //
 // It's difficult to allocate a dynamic-length "block_op" as requested by the
@@ -143,17 +181,31 @@ private:
     block_msg_t* bop_;
 };
 
+// Serves the requests of a single FIFO.
+//
+// A client may be served through several FIFOs ("queues"), each with its own
+// BlockServer and thread, so that requests are not limited to the rate at which
+// one thread can dispatch them. The queues share their attached VMOs, but
+// nothing else: barriers and transaction groups only order requests within
+// a single queue.
 class BlockServer {
 public:
-    // Creates a new BlockServer.
+    // Creates a new BlockServer, serving queue zero of a new client.
+    // |stats| must outlive the server.
     static zx_status_t Create(
-        ddk::BlockProtocolClient* bp,
+        ddk::BlockProtocolClient* bp, SchedulerStats* stats,
         fzl::fifo<block_fifo_request_t, block_fifo_response_t>* fifo_out,
         BlockServer** out);
 
+    // Creates a BlockServer for another queue of the client served by this
+    // BlockServer, sharing its attached VMOs.
+    zx_status_t CreateQueue(uint32_t queue,
+                            fzl::fifo<block_fifo_request_t, block_fifo_response_t>* fifo_out,
+                            BlockServer** out);
+
     // Starts the BlockServer using the current thread
-    zx_status_t Serve() TA_EXCL(server_lock_);
-    zx_status_t AttachVmo(zx::vmo vmo, vmoid_t* out) TA_EXCL(server_lock_);
+    zx_status_t Serve();
+    zx_status_t AttachVmo(zx::vmo vmo, vmoid_t* out);
 
     // Updates the total number of pending txns, possibly signals
     // the queue-draining thread to wake up if they are waiting
@@ -173,13 +225,22 @@ public:
     ~BlockServer();
 private:
     DISALLOW_COPY_ASSIGN_AND_MOVE(BlockServer);
-    BlockServer(ddk::BlockProtocolClient* bp);
+    BlockServer(ddk::BlockProtocolClient* bp, SchedulerStats* stats,
+                fbl::RefPtr<IoBufferTable> iobufs, uint32_t queue);
+
+    // Shared by Create and CreateQueue.
+    static zx_status_t CreateServer(ddk::BlockProtocolClient* bp, SchedulerStats* stats,
+                                    fbl::RefPtr<IoBufferTable> iobufs, uint32_t queue,
+                                    fzl::fifo<block_fifo_request_t,
+                                              block_fifo_response_t>* fifo_out,
+                                    BlockServer** out);
 
     // Helper for processing a single message read from the FIFO.
     void ProcessRequest(block_fifo_request_t* request);
-    zx_status_t ProcessReadWriteRequest(block_fifo_request_t* request) TA_EXCL(server_lock_);
-    zx_status_t ProcessCloseVmoRequest(block_fifo_request_t* request) TA_EXCL(server_lock_);
+    zx_status_t ProcessReadWriteRequest(block_fifo_request_t* request);
+    zx_status_t ProcessCloseVmoRequest(block_fifo_request_t* request);
     zx_status_t ProcessFlushRequest(block_fifo_request_t* request);
+    zx_status_t ProcessTrimRequest(block_fifo_request_t* request);
 
     // Helper for the server to react to a signal that a barrier
     // operation has completed. Unsets the local "waiting for barrier"
@@ -193,16 +254,26 @@ private:
     void TerminateQueue();
 
     // Attempts to enqueue all operations on the |in_queue_|. Stops
-    // when either the queue is empty, or a BARRIER_BEFORE is reached and
-    // operations are in-flight.
+    // when either the queue is empty, a BARRIER_BEFORE is reached and
+    // operations are in-flight, or the scheduler is waiting for in-flight
+    // operations to complete.
     void InQueueDrainer();
 
-    zx_status_t FindVmoIDLocked(vmoid_t* out) TA_REQ(server_lock_);
+    // Moves messages from the front of |in_queue_| to the scheduler, up to
+    // the first message which may not be reordered with those before it.
+    void AdmitToScheduler();
+
+    // Sends an operation, and any messages merged into it, to the device.
+    void Dispatch(block_msg_t* msg);
 
     fzl::fifo<block_fifo_response_t, block_fifo_request_t> fifo_;
     block_info_t info_;
     ddk::BlockProtocolClient* bp_;
     size_t block_op_size_;
+    const fbl::RefPtr<IoBufferTable> iobufs_;
+    // Identifies this queue to devices with several hardware queues (see
+    // BLOCK_FL_QUEUE_MASK), or zero if the device has only one.
+    uint32_t queue_flags_;
 
     // BARRIER_AFTER is implemented by sticking "BARRIER_BEFORE" on the
     // next operation that arrives.
@@ -210,9 +281,9 @@ private:
     BlockMsgQueue in_queue_;
     std::atomic<size_t> pending_count_;
     std::atomic<bool> barrier_in_progress_;
+    // Set while the scheduler is waiting for in-flight operations to complete.
+    std::atomic<bool> throttled_;
+    fbl::unique_ptr<IoScheduler> scheduler_;
+    SchedulerStats* const stats_;
     TransactionGroup groups_[MAX_TXN_GROUP_COUNT];
-
-    fbl::Mutex server_lock_;
-    fbl::WAVLTree<vmoid_t, fbl::RefPtr<IoBuffer>> tree_ TA_GUARDED(server_lock_);
-    vmoid_t last_id_ TA_GUARDED(server_lock_);
 };
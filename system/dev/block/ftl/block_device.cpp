@@ -16,6 +16,11 @@ namespace {
 
 constexpr char kDeviceName[] = "ftl";
 
+// How long the device has to be idle before garbage is collected. Collecting
+// garbage while idle means that blocks with stale pages need not be recycled
+// while a later write waits for free pages.
+constexpr zx_duration_t kGarbageCollectionDelay = ZX_MSEC(500);
+
 zx_status_t Format(void* ctx, fidl_txn_t* txn)  {
     ftl::BlockDevice* device = reinterpret_cast<ftl::BlockDevice*>(ctx);
     zx_status_t status = device->Format();
@@ -162,6 +167,7 @@ void BlockDevice::BlockImplQuery(block_info_t* info_out, size_t* block_op_size_o
     info_out->block_count = params_.num_pages;
     info_out->block_size = params_.page_size;
     info_out->max_transfer_size = BLOCK_MAX_TRANSFER_UNBOUNDED;
+    info_out->flags = BLOCK_FLAG_TRIM_SUPPORT;
     *block_op_size_out = sizeof(FtlOp);
 }
 
@@ -179,6 +185,14 @@ void BlockDevice::BlockImplQueue(block_op_t* operation, block_impl_queue_callbac
         }
         break;
     }
+    case BLOCK_OP_TRIM: {
+        if (operation->trim.offset_dev >= max_pages || !operation->trim.length ||
+            (max_pages - operation->trim.offset_dev) < operation->trim.length) {
+            completion_cb(cookie, ZX_ERR_OUT_OF_RANGE, operation);
+            return;
+        }
+        break;
+    }
     case BLOCK_OP_FLUSH:
         break;
 
@@ -283,17 +297,33 @@ int BlockDevice::WorkerThread() {
                 sync_completion_reset(&wake_signal_);
                 break;
             } else {
+                // Collect garbage once the device has been idle for a while,
+                // one cycle at a time so that a new operation waits for at
+                // most one cycle. The FTL stops collecting once little of its
+                // free space is taken by stale pages.
+                //
                 // Flush any pending data after 15 seconds of inactivity. This is
                 // meant to reduce the chances of data loss if power is removed.
                 // This value is only a guess.
-                zx_duration_t timeout = pending_flush_ ? ZX_SEC(15) : ZX_TIME_INFINITE;
+                zx_duration_t timeout = ZX_TIME_INFINITE;
+                if (pending_gc_) {
+                    timeout = collecting_ ? 0 : kGarbageCollectionDelay;
+                } else if (pending_flush_) {
+                    timeout = ZX_SEC(15);
+                }
                 zx_status_t status = sync_completion_wait(&wake_signal_, timeout);
                 if (status == ZX_ERR_TIMED_OUT) {
-                    Flush();
-                    pending_flush_ = false;
+                    if (pending_gc_) {
+                        collecting_ = true;
+                        pending_gc_ = CollectGarbage();
+                    } else {
+                        Flush();
+                        pending_flush_ = false;
+                    }
                 }
             }
         }
+        collecting_ = false;
 
         zx_status_t status = ZX_OK;
 
@@ -301,9 +331,16 @@ int BlockDevice::WorkerThread() {
         case BLOCK_OP_WRITE:
         case BLOCK_OP_READ:
             pending_flush_ = true;
+            pending_gc_ |= operation->op.command == BLOCK_OP_WRITE;
             status = ReadWriteData(&operation->op);
             break;
 
+        case BLOCK_OP_TRIM:
+            pending_flush_ = true;
+            pending_gc_ = true;
+            status = TrimData(&operation->op);
+            break;
+
         case BLOCK_OP_FLUSH: {
             status = Flush();
             pending_flush_ = false;
@@ -360,6 +397,19 @@ zx_status_t BlockDevice::ReadWriteData(block_op_t* operation) {
     return ZX_OK;
 }
 
+zx_status_t BlockDevice::TrimData(block_op_t* operation) {
+    uint32_t offset = static_cast<uint32_t>(operation->trim.offset_dev);
+    ZX_DEBUG_ASSERT(offset == operation->trim.offset_dev);
+
+    zxlogf(SPEW, "FTL: BLK To trim %d blocks at %d :\n", operation->trim.length, offset);
+    zx_status_t status = volume_->Trim(offset, operation->trim.length);
+    if (status != ZX_OK) {
+        zxlogf(ERROR, "FTL: Failed to trim ftl\n");
+        return status;
+    }
+    return ZX_OK;
+}
+
 zx_status_t BlockDevice::Flush() {
     zx_status_t status = volume_->Flush();
     if (status != ZX_OK) {
@@ -371,4 +421,19 @@ zx_status_t BlockDevice::Flush() {
     return status;
 }
 
+bool BlockDevice::CollectGarbage() {
+    zx_status_t status = volume_->GarbageCollect();
+    if (status == ZX_ERR_STOP) {
+        zxlogf(TRACE, "FTL: Finished garbage collection\n");
+        return false;
+    }
+    if (status != ZX_OK) {
+        zxlogf(ERROR, "FTL: garbage collection failed\n");
+        return false;
+    }
+    // Recycled pages were moved, so their new locations have to be flushed.
+    pending_flush_ = true;
+    return true;
+}
+
 }  // namespace ftl.
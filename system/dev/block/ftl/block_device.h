@@ -105,8 +105,13 @@ class BlockDevice : public DeviceType,
 
     // Implementation of the actual commands.
     zx_status_t ReadWriteData(block_op_t* operation);
+    zx_status_t TrimData(block_op_t* operation);
     zx_status_t Flush();
 
+    // Performs one cycle of garbage collection. Returns false when there is
+    // nothing left to collect.
+    bool CollectGarbage();
+
     BlockParams params_ = {};
 
     fbl::Mutex lock_;
@@ -115,6 +120,8 @@ class BlockDevice : public DeviceType,
 
     bool thread_created_ = false;
     bool pending_flush_ = false;
+    bool pending_gc_ = false;  // Data was written or trimmed since the last collection.
+    bool collecting_ = false;  // Garbage is being collected while the device is idle.
 
     sync_completion_t wake_signal_;
     thrd_t worker_;
@@ -20,8 +20,10 @@ constexpr uint32_t kPageSize = 1024;
 constexpr uint32_t kNumPages = 20;
 constexpr char kMagic = 'f';
 constexpr uint8_t kGuid[ZBI_PARTITION_GUID_LEN] = {'g', 'u', 'i', 'd'};
+constexpr int kGarbageCollectionCycles = 3;
 
-block_info_t kInfo = {kNumPages, kPageSize, BLOCK_MAX_TRANSFER_UNBOUNDED, 0, 0};
+block_info_t kInfo = {kNumPages, kPageSize, BLOCK_MAX_TRANSFER_UNBOUNDED,
+                      BLOCK_FLAG_TRIM_SUPPORT, 0};
 
 bool CheckPattern(const void* buffer, size_t size, char pattern = kMagic) {
     const char* data = reinterpret_cast<const char*>(buffer);
@@ -67,8 +69,15 @@ class FakeVolume : public ftl::Volume {
     bool written() const { return written_; }
     bool flushed() const { return flushed_; }
     bool formatted() const { return formatted_; }
+    bool trimmed() const { return trimmed_; }
     uint32_t first_page() const { return first_page_; }
     int num_pages() const { return num_pages_; }
+    int gc_cycles() const { return gc_cycles_; }
+
+    // Waits until there is no more garbage to collect.
+    bool WaitForGarbageCollection() {
+        return sync_completion_wait(&gc_done_, ZX_SEC(5)) == ZX_OK;
+    }
 
     // Volume interface.
     const char* Init(std::unique_ptr<ftl::NdmDriver> driver) final {
@@ -101,8 +110,20 @@ class FakeVolume : public ftl::Volume {
         flushed_ = true;
         return ZX_OK;
     }
-    zx_status_t Trim(uint32_t first_page, uint32_t num_pages) final { return ZX_OK; }
-    zx_status_t GarbageCollect() final { return ZX_OK; }
+    zx_status_t Trim(uint32_t first_page, uint32_t num_pages) final {
+        first_page_ = first_page;
+        num_pages_ = num_pages;
+        trimmed_ = true;
+        return ZX_OK;
+    }
+    zx_status_t GarbageCollect() final {
+        if (gc_cycles_ == kGarbageCollectionCycles) {
+            sync_completion_signal(&gc_done_);
+            return ZX_ERR_STOP;
+        }
+        gc_cycles_++;
+        return ZX_OK;
+    }
     zx_status_t GetStats(Stats* stats) final  { return ZX_OK; }
 
   private:
@@ -112,6 +133,9 @@ class FakeVolume : public ftl::Volume {
     bool written_ = false;
     bool flushed_ = false;
     bool formatted_ = false;
+    bool trimmed_ = false;
+    int gc_cycles_ = 0;
+    sync_completion_t gc_done_;
 };
 
 bool TrivialLifetimeTest() {
@@ -459,6 +483,61 @@ bool QueueMultipleTest() {
     END_TEST;
 }
 
+bool TrimTest() {
+    BEGIN_TEST;
+    BlockDeviceTest test;
+    ftl::BlockDevice* device = test.device();
+    ASSERT_TRUE(device);
+
+    Operation operation(test.op_size(), &test);
+    block_op_t* op = operation.GetOperation();
+    ASSERT_TRUE(op);
+
+    op->trim.command = BLOCK_OP_TRIM;
+    op->trim.length = 2;
+    op->trim.offset_dev = kNumPages - 1;
+    device->BlockImplQueue(op, &BlockDeviceTest::CompletionCb, &operation);
+    ASSERT_TRUE(test.Wait());
+    ASSERT_EQ(ZX_ERR_OUT_OF_RANGE, operation.status());
+
+    op->trim.offset_dev = 7;
+    device->BlockImplQueue(op, &BlockDeviceTest::CompletionCb, &operation);
+    ASSERT_TRUE(test.Wait());
+    ASSERT_EQ(ZX_OK, operation.status());
+
+    FakeVolume* volume = test.volume();
+    EXPECT_TRUE(volume->trimmed());
+    EXPECT_EQ(2, volume->num_pages());
+    EXPECT_EQ(7, volume->first_page());
+    END_TEST;
+}
+
+// Tests that garbage is collected after a write, once the device is idle.
+bool GarbageCollectTest() {
+    BEGIN_TEST;
+    BlockDeviceTest test;
+    ftl::BlockDevice* device = test.device();
+    ASSERT_TRUE(device);
+
+    Operation operation(test.op_size(), &test);
+    ASSERT_TRUE(operation.SetVmo());
+    block_op_t* op = operation.GetOperation();
+    ASSERT_TRUE(op);
+
+    op->rw.command = BLOCK_OP_WRITE;
+    op->rw.length = 1;
+    op->rw.offset_dev = 0;
+    memset(operation.buffer(), kMagic, kPageSize);
+    device->BlockImplQueue(op, &BlockDeviceTest::CompletionCb, &operation);
+    ASSERT_TRUE(test.Wait());
+    ASSERT_EQ(ZX_OK, operation.status());
+
+    FakeVolume* volume = test.volume();
+    ASSERT_TRUE(volume->WaitForGarbageCollection());
+    EXPECT_EQ(kGarbageCollectionCycles, volume->gc_cycles());
+    END_TEST;
+}
+
 bool FormatTest() {
     BEGIN_TEST;
     BlockDeviceTest test;
@@ -494,6 +573,8 @@ RUN_TEST_SMALL(QueueOneTest)
 RUN_TEST_SMALL(ReadWriteTest)
 RUN_TEST_SMALL(FlushTest)
 RUN_TEST_SMALL(QueueMultipleTest)
+RUN_TEST_SMALL(TrimTest)
+RUN_TEST_SMALL(GarbageCollectTest)
 RUN_TEST_SMALL(FormatTest)
 RUN_TEST_SMALL(SuspendTest)
 END_TEST_CASE(BlockDeviceTests)
@@ -21,6 +21,8 @@ VPartition::VPartition(VPartitionManager* vpm, size_t entry_index, size_t block_
 
     memcpy(&info_, &mgr_->Info(), sizeof(block_info_t));
     info_.block_count = 0;
+    // Trims are not translated to the underlying device.
+    info_.flags &= ~BLOCK_FLAG_TRIM_SUPPORT;
 }
 
 VPartition::~VPartition() = default;
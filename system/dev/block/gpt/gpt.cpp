@@ -142,6 +142,19 @@ void gpt_queue(void* ctx, block_op_t* bop, block_impl_queue_callback completion_
         bop->rw.offset_dev += gpt->gpt_entry.first;
         break;
     }
+    case BLOCK_OP_TRIM: {
+        size_t blocks = bop->trim.length;
+        size_t max = get_lba_count(gpt);
+
+        if ((bop->trim.offset_dev >= max) ||
+            ((max - bop->trim.offset_dev) < blocks)) {
+            completion_cb(cookie, ZX_ERR_OUT_OF_RANGE, bop);
+            return;
+        }
+
+        bop->trim.offset_dev += gpt->gpt_entry.first;
+        break;
+    }
     case BLOCK_OP_FLUSH:
         break;
     default:
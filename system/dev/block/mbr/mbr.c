@@ -102,6 +102,19 @@ static void mbr_queue(void* ctx, block_op_t* bop, block_impl_queue_callback comp
         bop->rw.offset_dev += mbr->partition.start_sector_lba;
         break;
     }
+    case BLOCK_OP_TRIM: {
+        size_t blocks = bop->trim.length;
+        size_t max = mbr->partition.sector_partition_length;
+
+        if ((bop->trim.offset_dev >= max) ||
+            ((max - bop->trim.offset_dev) < blocks)) {
+            completion_cb(cookie, ZX_ERR_INVALID_ARGS, bop);
+            return;
+        }
+
+        bop->trim.offset_dev += mbr->partition.start_sector_lba;
+        break;
+    }
     case BLOCK_OP_FLUSH:
         break;
     default:
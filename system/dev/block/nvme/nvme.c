@@ -61,27 +61,38 @@ static_assert(PAGE_SIZE == (1ULL << PAGE_SHIFT), "");
 
 #define PAGE_MASK (PAGE_SIZE - 1ULL)
 
-// Limit maximum transfer size to 1MB which fits comfortably
-// within our single scatter gather page per utxn setup
-#define MAX_XFER (1024*1024)
+// Limit maximum transfer size to what the single scatter gather page of
+// a utxn can describe.  The page holds 511 entries after the first, which
+// is enough for every page an unaligned transfer of this size touches.
+#define MAX_XFER (2 * 1024 * 1024 - PAGE_SIZE)
+
+// The most I/O queue pairs we create.  We ask for one per cpu, limited by
+// this, the controller, and the interrupt vectors we are granted.
+#define MAX_IO_QUEUES BLOCK_MAX_QUEUES
 
 // Maximum submission and completion queue item counts, for
 // queues that are a single page in size.
 #define SQMAX (PAGE_SIZE / sizeof(nvme_cmd_t))
 #define CQMAX (PAGE_SIZE / sizeof(nvme_cpl_t))
 
-// global driver state bits
+// queue state bits
 #define FLAG_IRQ_THREAD_STARTED  0x0001
 #define FLAG_IO_THREAD_STARTED   0x0002
+
+// global driver state bits
 #define FLAG_SHUTDOWN            0x0004
 
 #define FLAG_HAS_VWC             0x0100
 
+typedef struct nvme_device nvme_device_t;
+
+// An I/O submission queue and its completion queue, each with its own
+// interrupt vector where available, and serviced by its own threads.
 typedef struct {
-    mmio_buffer_t mmio;
+    nvme_device_t* nvme;
     zx_handle_t irqh;
-    zx_handle_t bti;
     uint32_t flags;
+    uint16_t id;           // nvme queue id (1-based; 0 is the admin queue)
     mtx_t lock;
 
     // io queue doorbell registers
@@ -90,7 +101,6 @@ typedef struct {
 
     nvme_cpl_t* io_cq;
     nvme_cmd_t* io_sq;
-    uint32_t io_nsid;
     uint16_t io_cq_head;
     uint16_t io_cq_toggle;
     uint16_t io_sq_tail;
@@ -114,6 +124,21 @@ typedef struct {
     // it has work to do.
     sync_completion_t io_signal;
 
+    // source of physical pages for the queues and utxn scatter lists
+    io_buffer_t iob;
+
+    thrd_t irqthread;
+    thrd_t iothread;
+
+    // pool of utxns
+    nvme_utxn_t utxn[UTXN_COUNT];
+} nvme_queue_t;
+
+struct nvme_device {
+    mmio_buffer_t mmio;
+    zx_handle_t bti;
+    uint32_t flags;
+
     uint32_t max_xfer;
     block_info_t info;
 
@@ -140,15 +165,16 @@ typedef struct {
 
     size_t iosz;
 
-    // source of physical pages for queues and admin commands
+    // source of physical pages for admin queues and commands
     io_buffer_t iob;
 
-    thrd_t irqthread;
-    thrd_t iothread;
+    // interrupt vectors configured; I/O queue N uses vector N, and the
+    // admin queue shares vector 0 with the first I/O queue
+    uint32_t irq_count;
 
-    // pool of utxns
-    nvme_utxn_t utxn[UTXN_COUNT];
-} nvme_device_t;
+    uint32_t queue_count;
+    nvme_queue_t queues[MAX_IO_QUEUES];
+};
 
 
 // We break IO transactions down into one or more "micro transactions" (utxn)
@@ -157,26 +183,26 @@ typedef struct {
 // queued to the NVME device.  This id is the same as its index into the
 // pool of utxns and the bitmask of free txns, to simplify management.
 //
-// We maintain a pool of 63 of these, which is the number of commands
-// that can be submitted to NVME via a single page submit queue.
+// Each I/O queue maintains a pool of 63 of these, which is the number of
+// commands that can be submitted to NVME via a single page submit queue.
 //
 // The utxns are not protected by locks.  Instead, after initialization,
-// they may only be touched by the io thread, which is responsible for
-// queueing commands and dequeuing completion messages.
+// they may only be touched by the io thread of their queue, which is
+// responsible for queueing commands and dequeuing completion messages.
 
-static nvme_utxn_t* utxn_get(nvme_device_t* nvme) {
-    uint64_t n = __builtin_ffsll(nvme->utxn_avail);
+static nvme_utxn_t* utxn_get(nvme_queue_t* q) {
+    uint64_t n = __builtin_ffsll(q->utxn_avail);
     if (n == 0) {
         return NULL;
     }
     n--;
-    nvme->utxn_avail &= ~(1ULL << n);
-    return nvme->utxn + n;
+    q->utxn_avail &= ~(1ULL << n);
+    return q->utxn + n;
 }
 
-static void utxn_put(nvme_device_t* nvme, nvme_utxn_t* utxn) {
+static void utxn_put(nvme_queue_t* q, nvme_utxn_t* utxn) {
     uint64_t n = utxn->id;
-    nvme->utxn_avail |= (1ULL << n);
+    q->utxn_avail |= (1ULL << n);
 }
 
 static zx_status_t nvme_admin_cq_get(nvme_device_t* nvme, nvme_cpl_t* cpl) {
@@ -215,60 +241,62 @@ static zx_status_t nvme_admin_sq_put(nvme_device_t* nvme, nvme_cmd_t* cmd) {
     return ZX_OK;
 }
 
-static zx_status_t nvme_io_cq_get(nvme_device_t* nvme, nvme_cpl_t* cpl) {
-    if ((readw(&nvme->io_cq[nvme->io_cq_head].status) & 1) != nvme->io_cq_toggle) {
+static zx_status_t nvme_io_cq_get(nvme_queue_t* q, nvme_cpl_t* cpl) {
+    if ((readw(&q->io_cq[q->io_cq_head].status) & 1) != q->io_cq_toggle) {
         return ZX_ERR_SHOULD_WAIT;
     }
-    *cpl = nvme->io_cq[nvme->io_cq_head];
+    *cpl = q->io_cq[q->io_cq_head];
 
     // advance the head pointer, wrapping and inverting toggle at max
-    uint16_t next = (nvme->io_cq_head + 1) & (CQMAX - 1);
-    if ((nvme->io_cq_head = next) == 0) {
-        nvme->io_cq_toggle ^= 1;
+    uint16_t next = (q->io_cq_head + 1) & (CQMAX - 1);
+    if ((q->io_cq_head = next) == 0) {
+        q->io_cq_toggle ^= 1;
     }
 
     // note the new sq head reported by hw
-    nvme->io_sq_head = cpl->sq_head;
+    q->io_sq_head = cpl->sq_head;
     return ZX_OK;
 }
 
-static void nvme_io_cq_ack(nvme_device_t* nvme) {
+static void nvme_io_cq_ack(nvme_queue_t* q) {
     // ring the doorbell
-    writel(nvme->io_cq_head, nvme->io_cq_head_db);
+    writel(q->io_cq_head, q->io_cq_head_db);
 }
 
-static zx_status_t nvme_io_sq_put(nvme_device_t* nvme, nvme_cmd_t* cmd) {
-    uint16_t next = (nvme->io_sq_tail + 1) & (SQMAX - 1);
+static zx_status_t nvme_io_sq_put(nvme_queue_t* q, nvme_cmd_t* cmd) {
+    uint16_t next = (q->io_sq_tail + 1) & (SQMAX - 1);
 
     // if head+1 == tail: queue is full
-    if (next == nvme->io_sq_head) {
+    if (next == q->io_sq_head) {
         return ZX_ERR_SHOULD_WAIT;
     }
 
-    nvme->io_sq[nvme->io_sq_tail] = *cmd;
-    nvme->io_sq_tail = next;
+    q->io_sq[q->io_sq_tail] = *cmd;
+    q->io_sq_tail = next;
 
     // ring the doorbell
-    writel(next, nvme->io_sq_tail_db);
+    writel(next, q->io_sq_tail_db);
     return ZX_OK;
 }
 
 static int irq_thread(void* arg) {
-    nvme_device_t* nvme = arg;
+    nvme_queue_t* q = arg;
+    nvme_device_t* nvme = q->nvme;
     for (;;) {
         zx_status_t r;
-        if ((r = zx_interrupt_wait(nvme->irqh, NULL)) != ZX_OK) {
-            zxlogf(ERROR, "nvme: irq wait failed: %d\n", r);
+        if ((r = zx_interrupt_wait(q->irqh, NULL)) != ZX_OK) {
+            zxlogf(ERROR, "nvme: queue %u: irq wait failed: %d\n", q->id, r);
             break;
         }
 
+        // the admin queue shares the first queue's vector
         nvme_cpl_t cpl;
-        if (nvme_admin_cq_get(nvme, &cpl) == ZX_OK) {
+        if ((q == &nvme->queues[0]) && (nvme_admin_cq_get(nvme, &cpl) == ZX_OK)) {
             nvme->admin_result = cpl;
             sync_completion_signal(&nvme->admin_signal);
         }
 
-        sync_completion_signal(&nvme->io_signal);
+        sync_completion_signal(&q->io_signal);
     }
     return 0;
 }
@@ -305,7 +333,8 @@ static inline void txn_complete(nvme_txn_t* txn, zx_status_t status) {
 // Attempt to generate utxns and queue nvme commands for a txn
 // Returns true if this could not be completed due to temporary
 // lack of resources or false if either it succeeded or errored out.
-static bool io_process_txn(nvme_device_t* nvme, nvme_txn_t* txn) {
+static bool io_process_txn(nvme_queue_t* q, nvme_txn_t* txn) {
+    nvme_device_t* nvme = q->nvme;
     zx_handle_t vmo = txn->op.rw.vmo;
     nvme_utxn_t* utxn;
     zx_paddr_t* pages;
@@ -314,7 +343,7 @@ static bool io_process_txn(nvme_device_t* nvme, nvme_txn_t* txn) {
     for (;;) {
         // If there are no available utxns, we can't proceed
         // and we tell the caller to retain the txn (true)
-        if ((utxn = utxn_get(nvme)) == NULL) {
+        if ((utxn = utxn_get(q)) == NULL) {
             return true;
         }
 
@@ -370,7 +399,7 @@ static bool io_process_txn(nvme_device_t* nvme, nvme_txn_t* txn) {
         zxlogf(SPEW, "nvme: pages[] = { %016zx, %016zx, %016zx, %016zx, ... }\n",
                pages[0], pages[1], pages[2], pages[3]);
 
-        if ((r = nvme_io_sq_put(nvme, &cmd)) != ZX_OK) {
+        if ((r = nvme_io_sq_put(q, &cmd)) != ZX_OK) {
             zxlogf(ERROR, "nvme: could not submit cmd (txn=%p id=%u)\n", txn, utxn->id);
             break;
         }
@@ -387,9 +416,9 @@ static bool io_process_txn(nvme_device_t* nvme, nvme_txn_t* txn) {
         // move this txn to the active list and tell the
         // caller not to retain the txn (false)
         if (txn->op.rw.length == 0) {
-            mtx_lock(&nvme->lock);
-            list_add_tail(&nvme->active_txns, &txn->node);
-            mtx_unlock(&nvme->lock);
+            mtx_lock(&q->lock);
+            list_add_tail(&q->active_txns, &txn->node);
+            mtx_unlock(&q->lock);
             return false;
         }
     }
@@ -398,17 +427,17 @@ static bool io_process_txn(nvme_device_t* nvme, nvme_txn_t* txn) {
     if ((r = zx_pmt_unpin(utxn->pmt)) != ZX_OK) {
         zxlogf(ERROR, "nvme: cannot unpin io buffer: %d\n", r);
     }
-    utxn_put(nvme, utxn);
+    utxn_put(q, utxn);
 
-    mtx_lock(&nvme->lock);
+    mtx_lock(&q->lock);
     txn->flags |= TXN_FLAG_FAILED;
     if (txn->pending_utxns) {
         // if there are earlier uncompleted IOs we become active now
         // and will finish erroring out when they complete
-        list_add_tail(&nvme->active_txns, &txn->node);
+        list_add_tail(&q->active_txns, &txn->node);
         txn = NULL;
     }
-    mtx_unlock(&nvme->lock);
+    mtx_unlock(&q->lock);
 
     if (txn != NULL) {
         txn_complete(txn, ZX_ERR_INTERNAL);
@@ -418,40 +447,40 @@ static bool io_process_txn(nvme_device_t* nvme, nvme_txn_t* txn) {
     return false;
 }
 
-static void io_process_txns(nvme_device_t* nvme) {
+static void io_process_txns(nvme_queue_t* q) {
     nvme_txn_t* txn;
 
     for (;;) {
-        mtx_lock(&nvme->lock);
-        txn = list_remove_head_type(&nvme->pending_txns, nvme_txn_t, node);
-        mtx_unlock(&nvme->lock);
+        mtx_lock(&q->lock);
+        txn = list_remove_head_type(&q->pending_txns, nvme_txn_t, node);
+        mtx_unlock(&q->lock);
 
         if (txn == NULL) {
             return;
         }
 
-        if (io_process_txn(nvme, txn)) {
+        if (io_process_txn(q, txn)) {
             // put txn back at front of queue for further processing later
-            mtx_lock(&nvme->lock);
-            list_add_head(&nvme->pending_txns, &txn->node);
-            mtx_unlock(&nvme->lock);
+            mtx_lock(&q->lock);
+            list_add_head(&q->pending_txns, &txn->node);
+            mtx_unlock(&q->lock);
             return;
         }
     }
 }
 
-static void io_process_cpls(nvme_device_t* nvme) {
+static void io_process_cpls(nvme_queue_t* q) {
     bool ring_doorbell = false;
     nvme_cpl_t cpl;
 
-    while (nvme_io_cq_get(nvme, &cpl) == ZX_OK) {
+    while (nvme_io_cq_get(q, &cpl) == ZX_OK) {
         ring_doorbell = true;
 
         if (cpl.cmd_id >= UTXN_COUNT) {
             zxlogf(ERROR, "nvme: unexpected cmd id %u\n", cpl.cmd_id);
             continue;
         }
-        nvme_utxn_t* utxn = nvme->utxn + cpl.cmd_id;
+        nvme_utxn_t* utxn = q->utxn + cpl.cmd_id;
         nvme_txn_t* txn = utxn->txn;
 
         if (txn == NULL) {
@@ -478,43 +507,43 @@ static void io_process_cpls(nvme_device_t* nvme) {
 
         // release the microtransaction
         utxn->txn = NULL;
-        utxn_put(nvme, utxn);
+        utxn_put(q, utxn);
 
         txn->pending_utxns--;
         if ((txn->pending_utxns == 0) && (txn->op.rw.length == 0)) {
             // remove from either pending or active list
-            mtx_lock(&nvme->lock);
+            mtx_lock(&q->lock);
             list_delete(&txn->node);
-            mtx_unlock(&nvme->lock);
+            mtx_unlock(&q->lock);
             zxlogf(TRACE, "nvme: txn %p %s\n", txn, txn->flags & TXN_FLAG_FAILED ? "error" : "okay");
             txn_complete(txn, txn->flags & TXN_FLAG_FAILED ? ZX_ERR_IO : ZX_OK);
         }
     }
 
     if (ring_doorbell) {
-        nvme_io_cq_ack(nvme);
+        nvme_io_cq_ack(q);
     }
 }
 
 static int io_thread(void* arg) {
-    nvme_device_t* nvme = arg;
+    nvme_queue_t* q = arg;
     for (;;) {
-        if (sync_completion_wait(&nvme->io_signal, ZX_TIME_INFINITE)) {
+        if (sync_completion_wait(&q->io_signal, ZX_TIME_INFINITE)) {
             break;
         }
-        if (nvme->flags & FLAG_SHUTDOWN) {
+        if (q->nvme->flags & FLAG_SHUTDOWN) {
             //TODO: cancel out pending IO
-            zxlogf(INFO, "nvme: io thread exiting\n");
+            zxlogf(INFO, "nvme: queue %u: io thread exiting\n", q->id);
             break;
         }
 
-        sync_completion_reset(&nvme->io_signal);
+        sync_completion_reset(&q->io_signal);
 
         // process completion messages
-        io_process_cpls(nvme);
+        io_process_cpls(q);
 
         // process work queue
-        io_process_txns(nvme);
+        io_process_txns(q);
 
     }
     return 0;
@@ -564,11 +593,16 @@ static void nvme_queue(void* ctx, block_op_t* op, block_impl_queue_callback comp
            txn->opcode == NVME_OP_WRITE ? "wr" : "rd",
            txn->op.rw.length + 1U, txn->op.rw.offset_dev);
 
-    mtx_lock(&nvme->lock);
-    list_add_tail(&nvme->pending_txns, &txn->node);
-    mtx_unlock(&nvme->lock);
+    // Operations from different queues of the block server are submitted
+    // to different hardware queues, so that they are processed in parallel.
+    uint32_t index = (txn->op.command & BLOCK_FL_QUEUE_MASK) >> BLOCK_FL_QUEUE_SHIFT;
+    nvme_queue_t* q = &nvme->queues[index % nvme->queue_count];
 
-    sync_completion_signal(&nvme->io_signal);
+    mtx_lock(&q->lock);
+    list_add_tail(&q->pending_txns, &txn->node);
+    mtx_unlock(&q->lock);
+
+    sync_completion_signal(&q->io_signal);
 }
 
 static void nvme_query(void* ctx, block_info_t* info_out, size_t* block_op_size_out) {
@@ -602,26 +636,33 @@ static void nvme_release(void* ctx) {
         mmio_buffer_release(&nvme->mmio);
         // TODO: risks a handle use-after-close, will be resolved by IRQ api
         // changes coming soon
-        zx_handle_close(nvme->irqh);
-    }
-    if (nvme->flags & FLAG_IRQ_THREAD_STARTED) {
-        thrd_join(nvme->irqthread, &r);
-    }
-    if (nvme->flags & FLAG_IO_THREAD_STARTED) {
-        sync_completion_signal(&nvme->io_signal);
-        thrd_join(nvme->iothread, &r);
+        for (unsigned n = 0; n < MAX_IO_QUEUES; n++) {
+            zx_handle_close(nvme->queues[n].irqh);
+        }
     }
+    for (unsigned n = 0; n < MAX_IO_QUEUES; n++) {
+        nvme_queue_t* q = &nvme->queues[n];
+        if (q->flags & FLAG_IRQ_THREAD_STARTED) {
+            thrd_join(q->irqthread, &r);
+        }
+        if (q->flags & FLAG_IO_THREAD_STARTED) {
+            sync_completion_signal(&q->io_signal);
+            thrd_join(q->iothread, &r);
+        }
 
-    // error out any pending txns
-    mtx_lock(&nvme->lock);
-    nvme_txn_t* txn;
-    while ((txn = list_remove_head_type(&nvme->active_txns, nvme_txn_t, node)) != NULL) {
-        txn_complete(txn, ZX_ERR_PEER_CLOSED);
-    }
-    while ((txn = list_remove_head_type(&nvme->pending_txns, nvme_txn_t, node)) != NULL) {
-        txn_complete(txn, ZX_ERR_PEER_CLOSED);
+        // error out any pending txns
+        mtx_lock(&q->lock);
+        nvme_txn_t* txn;
+        while ((txn = list_remove_head_type(&q->active_txns, nvme_txn_t, node)) != NULL) {
+            txn_complete(txn, ZX_ERR_PEER_CLOSED);
+        }
+        while ((txn = list_remove_head_type(&q->pending_txns, nvme_txn_t, node)) != NULL) {
+            txn_complete(txn, ZX_ERR_PEER_CLOSED);
+        }
+        mtx_unlock(&q->lock);
+
+        io_buffer_release(&q->iob);
     }
-    mtx_unlock(&nvme->lock);
 
     io_buffer_release(&nvme->iob);
     free(nvme);
@@ -668,13 +709,17 @@ static void infostring(const char* prefix, uint8_t* str, size_t len) {
 #define wr32(v,r) writel(v, nvme->mmio.vaddr + NVME_REG_##r)
 #define wr64(v,r) writell(v, nvme->mmio.vaddr + NVME_REG_##r)
 
-// dedicated pages from the page pool
+// dedicated pages from the admin page pool
 #define IDX_ADMIN_SQ   0
 #define IDX_ADMIN_CQ   1
-#define IDX_IO_SQ      2
-#define IDX_IO_CQ      3
-#define IDX_SCRATCH    4
-#define IDX_UTXN_POOL  5 // this must always be last
+#define IDX_SCRATCH    2
+
+#define ADMIN_PAGE_COUNT 3
+
+// dedicated pages from the page pool of each io queue
+#define IDX_IO_SQ      0
+#define IDX_IO_CQ      1
+#define IDX_UTXN_POOL  2 // this must always be last
 
 #define IO_PAGE_COUNT  (IDX_UTXN_POOL + UTXN_COUNT)
 
@@ -690,6 +735,93 @@ static inline uint32_t U16(uint8_t* x) {
 
 #define WAIT_MS 5000
 
+// Allocates the pages of io queue |index| and starts its threads.  The
+// queues themselves are created on the controller by nvme_queue_create().
+static zx_status_t nvme_queue_init(nvme_device_t* nvme, uint32_t index, uint64_t cap) {
+    nvme_queue_t* q = &nvme->queues[index];
+    q->id = index + 1;
+
+    // allocate pages for the queues and the utxn scatter lists
+    if (io_buffer_init(&q->iob, nvme->bti, PAGE_SIZE * IO_PAGE_COUNT, IO_BUFFER_RW) ||
+        io_buffer_physmap(&q->iob)) {
+        zxlogf(ERROR, "nvme: queue %u: could not allocate io buffers\n", q->id);
+        return ZX_ERR_NO_MEMORY;
+    }
+
+    // initialize the microtransaction pool
+    q->utxn_avail = 0x7FFFFFFFFFFFFFFFULL;
+    for (unsigned n = 0; n < UTXN_COUNT; n++) {
+        q->utxn[n].id = n;
+        q->utxn[n].phys = q->iob.phys_list[IDX_UTXN_POOL + n];
+        q->utxn[n].virt = q->iob.virt + (IDX_UTXN_POOL + n) * PAGE_SIZE;
+    }
+
+    // registers and buffers for IO queues
+    q->io_sq_tail_db = nvme->mmio.vaddr + NVME_REG_SQnTDBL(q->id, cap);
+    q->io_cq_head_db = nvme->mmio.vaddr + NVME_REG_CQnHDBL(q->id, cap);
+
+    q->io_sq = q->iob.virt + PAGE_SIZE * IDX_IO_SQ;
+    q->io_sq_head = 0;
+    q->io_sq_tail = 0;
+
+    q->io_cq = q->iob.virt + PAGE_SIZE * IDX_IO_CQ;
+    q->io_cq_head = 0;
+    q->io_cq_toggle = 1;
+
+    if (pci_map_interrupt(&nvme->pci, index, &q->irqh) != ZX_OK) {
+        zxlogf(ERROR, "nvme: queue %u: could not map irq\n", q->id);
+        return ZX_ERR_INTERNAL;
+    }
+
+    char name[ZX_MAX_NAME_LEN];
+    snprintf(name, sizeof(name), "nvme-irq-thread-%u", q->id);
+    if (thrd_create_with_name(&q->irqthread, irq_thread, q, name)) {
+        zxlogf(ERROR, "nvme; cannot create irq thread\n");
+        return ZX_ERR_INTERNAL;
+    }
+    q->flags |= FLAG_IRQ_THREAD_STARTED;
+
+    snprintf(name, sizeof(name), "nvme-io-thread-%u", q->id);
+    if (thrd_create_with_name(&q->iothread, io_thread, q, name)) {
+        zxlogf(ERROR, "nvme; cannot create io thread\n");
+        return ZX_ERR_INTERNAL;
+    }
+    q->flags |= FLAG_IO_THREAD_STARTED;
+    return ZX_OK;
+}
+
+// Creates the completion and submission queues of io queue |index|, which
+// must have been initialized by nvme_queue_init().
+static zx_status_t nvme_queue_create(nvme_device_t* nvme, uint32_t index) {
+    nvme_queue_t* q = &nvme->queues[index];
+    nvme_cmd_t cmd;
+
+    // create the IO completion queue, interrupting on the queue's own vector
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.cmd = NVME_CMD_CID(0) | NVME_CMD_PRP | NVME_CMD_NORMAL | NVME_CMD_OPC(NVME_ADMIN_OP_CREATE_IOCQ);
+    cmd.dptr.prp[0] = q->iob.phys_list[IDX_IO_CQ];
+    cmd.u.raw[0] = ((CQMAX - 1) << 16) | q->id; // queue size, queue id
+    cmd.u.raw[1] = (index << 16) | 2 | 1; // irq vector, irq enable, phys contig
+
+    if (nvme_admin_txn(nvme, &cmd, NULL) != ZX_OK) {
+        zxlogf(ERROR, "nvme: queue %u: completion queue creation op failed\n", q->id);
+        return ZX_ERR_INTERNAL;
+    }
+
+    // create the IO submit queue
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.cmd = NVME_CMD_CID(0) | NVME_CMD_PRP | NVME_CMD_NORMAL | NVME_CMD_OPC(NVME_ADMIN_OP_CREATE_IOSQ);
+    cmd.dptr.prp[0] = q->iob.phys_list[IDX_IO_SQ];
+    cmd.u.raw[0] = ((SQMAX - 1) << 16) | q->id; // queue size, queue id
+    cmd.u.raw[1] = (q->id << 16) | 0 | 1; // cqid, qprio, phys contig
+
+    if (nvme_admin_txn(nvme, &cmd, NULL) != ZX_OK) {
+        zxlogf(ERROR, "nvme: queue %u: submit queue creation op failed\n", q->id);
+        return ZX_ERR_INTERNAL;
+    }
+    return ZX_OK;
+}
+
 static zx_status_t nvme_init(nvme_device_t* nvme) {
     uint32_t n = rd32(VS);
     uint64_t cap = rd64(CAP);
@@ -712,22 +844,14 @@ static zx_status_t nvme_init(nvme_device_t* nvme) {
         zxlogf(ERROR, "nvme: minimum page size larger than platform page size\n");
         return ZX_ERR_NOT_SUPPORTED;
     }
-    // allocate pages for various queues and the utxn scatter lists
+    // allocate pages for the admin queues and commands
     // TODO: these should all be RO to hardware apart from the scratch io page(s)
-    if (io_buffer_init(&nvme->iob, nvme->bti, PAGE_SIZE * IO_PAGE_COUNT, IO_BUFFER_RW) ||
+    if (io_buffer_init(&nvme->iob, nvme->bti, PAGE_SIZE * ADMIN_PAGE_COUNT, IO_BUFFER_RW) ||
         io_buffer_physmap(&nvme->iob)) {
         zxlogf(ERROR, "nvme: could not allocate io buffers\n");
         return ZX_ERR_NO_MEMORY;
     }
 
-    // initialize the microtransaction pool
-    nvme->utxn_avail = 0x7FFFFFFFFFFFFFFFULL;
-    for (unsigned n = 0; n < UTXN_COUNT; n++) {
-        nvme->utxn[n].id = n;
-        nvme->utxn[n].phys = nvme->iob.phys_list[IDX_UTXN_POOL + n];
-        nvme->utxn[n].virt = nvme->iob.virt + (IDX_UTXN_POOL + n) * PAGE_SIZE;
-    }
-
     if (rd32(CSTS) & NVME_CSTS_RDY) {
         zxlogf(INFO, "nvme: controller is active. resetting...\n");
         wr32(rd32(CC) & ~NVME_CC_EN, CC); // disable
@@ -777,32 +901,14 @@ static zx_status_t nvme_init(nvme_device_t* nvme) {
     nvme->admin_cq_head = 0;
     nvme->admin_cq_toggle = 1;
 
-    // registers and buffers for IO queues
-    nvme->io_sq_tail_db = nvme->mmio.vaddr + NVME_REG_SQnTDBL(1, cap);
-    nvme->io_cq_head_db = nvme->mmio.vaddr + NVME_REG_CQnHDBL(1, cap);
-
-    nvme->io_sq = nvme->iob.virt + PAGE_SIZE * IDX_IO_SQ;
-    nvme->io_sq_head = 0;
-    nvme->io_sq_tail = 0;
-
-    nvme->io_cq = nvme->iob.virt + PAGE_SIZE * IDX_IO_CQ;
-    nvme->io_cq_head = 0;
-    nvme->io_cq_toggle = 1;
-
     // scratch page for admin ops
     void* scratch = nvme->iob.virt + PAGE_SIZE * IDX_SCRATCH;
 
-    if (thrd_create_with_name(&nvme->irqthread, irq_thread, nvme, "nvme-irq-thread")) {
-        zxlogf(ERROR, "nvme; cannot create irq thread\n");
-        return ZX_ERR_INTERNAL;
-    }
-    nvme->flags |= FLAG_IRQ_THREAD_STARTED;
-
-    if (thrd_create_with_name(&nvme->iothread, io_thread, nvme, "nvme-io-thread")) {
-        zxlogf(ERROR, "nvme; cannot create io thread\n");
-        return ZX_ERR_INTERNAL;
+    // the first io queue's irq thread also services the admin queue
+    zx_status_t status;
+    if ((status = nvme_queue_init(nvme, 0, cap)) != ZX_OK) {
+        return status;
     }
-    nvme->flags |= FLAG_IO_THREAD_STARTED;
 
     nvme_cmd_t cmd;
 
@@ -880,42 +986,46 @@ static zx_status_t nvme_init(nvme_device_t* nvme) {
     FEATURE(ONCS, WRITE_UNCORRECTABLE);
     FEATURE(ONCS, COMPARE);
 
-    // set feature (number of queues) to 1 iosq and 1 iocq
+    // set feature (number of queues) to one iosq and iocq per irq vector
+    uint32_t want = nvme->irq_count;
     memset(&cmd, 0, sizeof(cmd));
     cmd.cmd = NVME_CMD_CID(0) | NVME_CMD_PRP | NVME_CMD_NORMAL | NVME_CMD_OPC(NVME_ADMIN_OP_SET_FEATURE);
     cmd.u.raw[0] = NVME_FEATURE_NUMBER_OF_QUEUES;
-    cmd.u.raw[1] = 0;
+    cmd.u.raw[1] = ((want - 1) << 16) | (want - 1);
 
     nvme_cpl_t cpl;
     if (nvme_admin_txn(nvme, &cmd, &cpl) != ZX_OK) {
         zxlogf(ERROR, "nvme: set feature (number queues) op failed\n");
         return ZX_ERR_INTERNAL;
     }
-    zxlogf(INFO,"cpl.cmd %08x\n", cpl.cmd);
 
-    // create the IO completion queue
-    memset(&cmd, 0, sizeof(cmd));
-    cmd.cmd = NVME_CMD_CID(0) | NVME_CMD_PRP | NVME_CMD_NORMAL | NVME_CMD_OPC(NVME_ADMIN_OP_CREATE_IOCQ);
-    cmd.dptr.prp[0] = nvme->iob.phys_list[IDX_IO_CQ];
-    cmd.u.raw[0] = ((CQMAX - 1) << 16) | 1; // queue size, queue id
-    cmd.u.raw[1] = (0 << 16) | 2 | 1; // irq vector, irq enable, phys contig
-
-    if (nvme_admin_txn(nvme, &cmd, NULL) != ZX_OK) {
-        zxlogf(ERROR, "nvme: completion queue creation op failed\n");
-        return ZX_ERR_INTERNAL;
+    // the controller reports how many queues it allocated, which may be
+    // more or fewer than we asked for
+    uint32_t nsqa = (cpl.cmd & 0xFFFF) + 1;
+    uint32_t ncqa = (cpl.cmd >> 16) + 1;
+    zxlogf(INFO, "nvme: io queues: requested %u, allocated %u sq/%u cq\n", want, nsqa, ncqa);
+    if (want > nsqa) {
+        want = nsqa;
+    }
+    if (want > ncqa) {
+        want = ncqa;
     }
 
-    // create the IO submit queue
-    memset(&cmd, 0, sizeof(cmd));
-    cmd.cmd = NVME_CMD_CID(0) | NVME_CMD_PRP | NVME_CMD_NORMAL | NVME_CMD_OPC(NVME_ADMIN_OP_CREATE_IOSQ);
-    cmd.dptr.prp[0] = nvme->iob.phys_list[IDX_IO_SQ];
-    cmd.u.raw[0] = ((SQMAX - 1) << 16) | 1; // queue size, queue id
-    cmd.u.raw[1] = (1 << 16) | 0 | 1; // cqid, qprio, phys contig
+    if ((status = nvme_queue_create(nvme, 0)) != ZX_OK) {
+        return status;
+    }
+    nvme->queue_count = 1;
 
-    if (nvme_admin_txn(nvme, &cmd, NULL) != ZX_OK) {
-        zxlogf(ERROR, "nvme: submit queue creation op failed\n");
-        return ZX_ERR_INTERNAL;
+    // Further queues only add parallelism, so make do without them if they
+    // cannot be created.
+    while (nvme->queue_count < want) {
+        if ((nvme_queue_init(nvme, nvme->queue_count, cap) != ZX_OK) ||
+            (nvme_queue_create(nvme, nvme->queue_count) != ZX_OK)) {
+            break;
+        }
+        nvme->queue_count++;
     }
+    zxlogf(INFO, "nvme: using %u io queues\n", nvme->queue_count);
 
     // identify namespace 1
     memset(&cmd, 0, sizeof(cmd));
@@ -956,6 +1066,9 @@ static zx_status_t nvme_init(nvme_device_t* nvme) {
     nvme->info.block_count = ni->NSSZ;
     nvme->info.block_size = 1 << NVME_LBAFMT_LBADS(fmt);
     nvme->info.max_transfer_size = BLOCK_MAX_TRANSFER_UNBOUNDED;
+    if (nvme->queue_count > 1) {
+        nvme->info.flags |= BLOCK_FLAG_MULTI_QUEUE;
+    }
 
     if (NVME_LBAFMT_MS(fmt)) {
         zxlogf(ERROR, "nvme: cannot handle LBA format with metadata\n");
@@ -998,9 +1111,13 @@ static zx_status_t nvme_bind(void* ctx, zx_device_t* dev) {
     if ((nvme = calloc(1, sizeof(nvme_device_t))) == NULL) {
         return ZX_ERR_NO_MEMORY;
     }
-    list_initialize(&nvme->pending_txns);
-    list_initialize(&nvme->active_txns);
-    mtx_init(&nvme->lock, mtx_plain);
+    for (unsigned n = 0; n < MAX_IO_QUEUES; n++) {
+        nvme_queue_t* q = &nvme->queues[n];
+        q->nvme = nvme;
+        list_initialize(&q->pending_txns);
+        list_initialize(&q->active_txns);
+        mtx_init(&q->lock, mtx_plain);
+    }
     mtx_init(&nvme->admin_lock, mtx_plain);
 
     if (device_get_protocol(dev, ZX_PROTOCOL_PCI, &nvme->pci)) {
@@ -1012,14 +1129,27 @@ static zx_status_t nvme_bind(void* ctx, zx_device_t* dev) {
         goto fail;
     }
 
+    // With MSI-X, ask for a vector per cpu, so that each io queue may have
+    // its own.  Otherwise there is a single vector, and a single io queue.
+    uint32_t ncpu = zx_system_get_num_cpus();
     uint32_t modes[3] = {
         ZX_PCIE_IRQ_MODE_MSI_X, ZX_PCIE_IRQ_MODE_MSI, ZX_PCIE_IRQ_MODE_LEGACY,
     };
     uint32_t nirq = 0;
     for (unsigned n = 0; n < countof(modes); n++) {
-        if ((pci_query_irq_mode(&nvme->pci, modes[n], &nirq) == ZX_OK) &&
-            (pci_set_irq_mode(&nvme->pci, modes[n], 1) == ZX_OK)) {
-            zxlogf(INFO, "nvme: irq mode %u, irq count %u (#%u)\n", modes[n], nirq, n);
+        if (pci_query_irq_mode(&nvme->pci, modes[n], &nirq) != ZX_OK) {
+            continue;
+        }
+        uint32_t count = 1;
+        if (modes[n] == ZX_PCIE_IRQ_MODE_MSI_X) {
+            count = nirq < ncpu ? nirq : ncpu;
+            if (count > MAX_IO_QUEUES) {
+                count = MAX_IO_QUEUES;
+            }
+        }
+        if (pci_set_irq_mode(&nvme->pci, modes[n], count) == ZX_OK) {
+            zxlogf(INFO, "nvme: irq mode %u, irq count %u/%u (#%u)\n", modes[n], count, nirq, n);
+            nvme->irq_count = count;
             goto irq_configured;
         }
     }
@@ -1027,10 +1157,6 @@ static zx_status_t nvme_bind(void* ctx, zx_device_t* dev) {
     goto fail;
 
 irq_configured:
-    if (pci_map_interrupt(&nvme->pci, 0, &nvme->irqh) != ZX_OK) {
-        zxlogf(ERROR, "nvme: could not map irq\n");
-        goto fail;
-    }
     if (pci_enable_bus_master(&nvme->pci, true)) {
         zxlogf(ERROR, "nvme: cannot enable bus mastering\n");
         goto fail;
@@ -10,12 +10,14 @@
 #include <threads.h>
 
 #include <ddk/driver.h>
+#include <fbl/alloc_checker.h>
 #include <fbl/auto_lock.h>
 #include <lib/fzl/owned-vmo-mapper.h>
 #include <lib/zx/vmo.h>
 #include <zircon/assert.h>
 #include <zircon/boot/image.h>
 #include <zircon/device/block.h>
+#include <zircon/syscalls.h>
 #include <zircon/types.h>
 
 #include "ramdisk.h"
@@ -148,9 +150,26 @@ void Ramdisk::BlockImplQueue(block_op_t* bop, block_impl_queue_callback completi
             sync_completion_signal(&signal_);
         }
         break;
-    case BLOCK_OP_FLUSH:
-        txn->Complete(ZX_OK);
+    case BLOCK_OP_FLUSH: {
+        // Writes are durable as soon as they complete, unless they may be discarded on
+        // wakeup. Only then must a flush wait for the writes queued ahead of it.
+        bool ordered;
+        {
+            fbl::AutoLock lock(&lock_);
+            ordered = !dead_ &&
+                      (flags_ & fuchsia_hardware_ramdisk_RAMDISK_FLAG_DISCARD_NOT_FLUSHED_ON_WAKE);
+            if (ordered) {
+                txn_list_.push_back(txn);
+            }
+        }
+
+        if (ordered) {
+            sync_completion_signal(&signal_);
+        } else {
+            txn->Complete(ZX_OK);
+        }
         break;
+    }
     default:
         txn->Complete(ZX_ERR_NOT_SUPPORTED);
         break;
@@ -161,6 +180,9 @@ zx_status_t Ramdisk::FidlSetFlags(uint32_t flags, fidl_txn_t* txn) {
     {
         fbl::AutoLock lock(&lock_);
         flags_ = flags;
+        if (!(flags_ & fuchsia_hardware_ramdisk_RAMDISK_FLAG_DISCARD_NOT_FLUSHED_ON_WAKE)) {
+            unflushed_.reset();
+        }
     }
     return fuchsia_hardware_ramdisk_RamdiskSetFlags_reply(txn, ZX_OK);
 }
@@ -168,6 +190,9 @@ zx_status_t Ramdisk::FidlSetFlags(uint32_t flags, fidl_txn_t* txn) {
 zx_status_t Ramdisk::FidlWake(fidl_txn_t* txn) {
     {
         fbl::AutoLock lock(&lock_);
+        if (flags_ & fuchsia_hardware_ramdisk_RAMDISK_FLAG_DISCARD_NOT_FLUSHED_ON_WAKE) {
+            DiscardUnflushedLocked();
+        }
         asleep_ = false;
         memset(&block_counts_, 0, sizeof(block_counts_));
         pre_sleep_write_block_count_ = 0;
@@ -176,6 +201,36 @@ zx_status_t Ramdisk::FidlWake(fidl_txn_t* txn) {
     return fuchsia_hardware_ramdisk_RamdiskWake_reply(txn, ZX_OK);
 }
 
+zx_status_t Ramdisk::SaveUnflushedLocked(size_t dev_offset, size_t length) {
+    fbl::AllocChecker ac;
+    fbl::Array<uint8_t> old_data(new (&ac) uint8_t[length], length);
+    if (!ac.check()) {
+        return ZX_ERR_NO_MEMORY;
+    }
+    memcpy(old_data.get(), static_cast<uint8_t*>(mapping_.start()) + dev_offset, length);
+    unflushed_.push_back({dev_offset, std::move(old_data)}, &ac);
+    return ac.check() ? ZX_OK : ZX_ERR_NO_MEMORY;
+}
+
+void Ramdisk::DiscardUnflushedLocked() {
+    const bool random = flags_ & fuchsia_hardware_ramdisk_RAMDISK_FLAG_DISCARD_RANDOM;
+    // Undo the newest writes first, so that a block written more than once since the last
+    // flush is restored to its flushed contents.
+    for (size_t i = unflushed_.size(); i-- > 0;) {
+        if (random) {
+            uint8_t coin;
+            zx_cprng_draw(&coin, sizeof(coin));
+            if (coin & 1) {
+                continue;
+            }
+        }
+        const UnflushedWrite& write = unflushed_[i];
+        memcpy(static_cast<uint8_t*>(mapping_.start()) + write.dev_offset, write.old_data.get(),
+               write.old_data.size());
+    }
+    unflushed_.reset();
+}
+
 zx_status_t Ramdisk::FidlSleepAfter(uint64_t block_count, fidl_txn_t* txn) {
     {
         fbl::AutoLock lock(&lock_);
@@ -220,7 +275,7 @@ zx_status_t Ramdisk::BlockPartitionGetName(char* out_name, size_t capacity) {
 void Ramdisk::ProcessRequests() {
     zx_status_t status = ZX_OK;
     Transaction* txn = nullptr;
-    bool dead, asleep, defer;
+    bool dead, asleep, defer, discard;
     uint64_t blocks = 0;
     TransactionList deferred_list;
 
@@ -232,6 +287,8 @@ void Ramdisk::ProcessRequests() {
                 dead = dead_;
                 asleep = asleep_;
                 defer = (flags_ & fuchsia_hardware_ramdisk_RAMDISK_FLAG_RESUME_ON_WAKE) != 0;
+                discard = (flags_ &
+                           fuchsia_hardware_ramdisk_RAMDISK_FLAG_DISCARD_NOT_FLUSHED_ON_WAKE) != 0;
                 blocks = pre_sleep_write_block_count_;
 
                 if (!asleep) {
@@ -258,6 +315,23 @@ void Ramdisk::ProcessRequests() {
             }
         }
 
+        if (txn->op.command == BLOCK_OP_FLUSH) {
+            // Flushes are only queued while writes may be discarded on wakeup. A flush
+            // issued while asleep cannot make the preceding writes durable.
+            if (asleep && defer) {
+                deferred_list.push_back(txn);
+                continue;
+            } else if (asleep) {
+                status = ZX_ERR_UNAVAILABLE;
+            } else {
+                fbl::AutoLock lock(&lock_);
+                unflushed_.reset();
+                status = ZX_OK;
+            }
+            txn->Complete(status);
+            continue;
+        }
+
         uint64_t txn_blocks = txn->op.rw.length;
         if (txn->op.command == BLOCK_OP_READ || blocks == 0 || blocks > txn_blocks) {
             // If the ramdisk is not configured to sleep after x blocks, or the number of blocks in
@@ -287,7 +361,16 @@ void Ramdisk::ProcessRequests() {
                 status = ZX_ERR_UNAVAILABLE;
             }
         } else { // BLOCK_OP_WRITE
-            status = zx_vmo_read(txn->op.rw.vmo, addr, vmo_offset, length);
+            if (discard) {
+                // The overwritten data is saved and replaced together, so that a concurrent
+                // wakeup cannot undo a write which has not been made.
+                fbl::AutoLock lock(&lock_);
+                if ((status = SaveUnflushedLocked(dev_offset, length)) == ZX_OK) {
+                    status = zx_vmo_read(txn->op.rw.vmo, addr, vmo_offset, length);
+                }
+            } else {
+                status = zx_vmo_read(txn->op.rw.vmo, addr, vmo_offset, length);
+            }
 
             if (status == ZX_OK && blocks < txn->op.rw.length && defer) {
                 // If the first part of the transaction succeeded but the entire transaction is not
@@ -9,7 +9,9 @@
 #include <ddktl/device.h>
 #include <ddktl/protocol/block.h>
 #include <ddktl/protocol/block/partition.h>
+#include <fbl/array.h>
 #include <fbl/mutex.h>
+#include <fbl/vector.h>
 #include <fuchsia/hardware/ramdisk/c/fidl.h>
 #include <lib/fidl-utils/bind.h>
 #include <lib/fzl/owned-vmo-mapper.h>
@@ -73,6 +75,14 @@ private:
     // Processes requests made to the ramdisk until it is unbound.
     void ProcessRequests();
 
+    // Records the contents of |length| bytes at |dev_offset|, which are about to be
+    // overwritten, so that the write can be undone if it is not flushed.
+    zx_status_t SaveUnflushedLocked(size_t dev_offset, size_t length) TA_REQ(lock_);
+
+    // Undoes the writes which have not been flushed, or a random subset of them if
+    // |RAMDISK_FLAG_DISCARD_RANDOM| is set.
+    void DiscardUnflushedLocked() TA_REQ(lock_);
+
     static const fuchsia_hardware_ramdisk_Ramdisk_ops* Ops() {
         using Binder = fidl::Binder<Ramdisk>;
 
@@ -118,6 +128,11 @@ private:
     // sent to the ramdisk while it is considered "alseep" should be processed
     // when the ramdisk wakes up. This is implemented by utilizing a "deferred
     // list" of requests, which are immediately re-issued on wakeup.
+    // - RAMDISK_FLAG_DISCARD_NOT_FLUSHED_ON_WAKE: This flag identifies if writes
+    // which have not been flushed should be undone on wakeup. The previous contents
+    // of written blocks are kept in |unflushed_| until the next flush.
+    // - RAMDISK_FLAG_DISCARD_RANDOM: This flag limits the writes undone on wakeup
+    // to a random subset.
     uint32_t flags_ TA_GUARDED(lock_) = 0;
 
     // True if the ramdisk is "sleeping", and deferring all upcoming requests,
@@ -128,6 +143,14 @@ private:
     uint64_t pre_sleep_write_block_count_ TA_GUARDED(lock_) = 0;
     fuchsia_hardware_ramdisk_BlockWriteCounts block_counts_ TA_GUARDED(lock_) {};
 
+    // A write made since the last flush, and the data it overwrote.
+    struct UnflushedWrite {
+        size_t dev_offset;
+        fbl::Array<uint8_t> old_data;
+    };
+    // Writes made since the last flush, oldest first.
+    fbl::Vector<UnflushedWrite> unflushed_ TA_GUARDED(lock_);
+
     thrd_t worker_ = {};
     char name_[ZBI_PARTITION_NAME_LEN];
 };
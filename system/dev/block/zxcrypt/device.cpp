@@ -3,6 +3,7 @@
 // found in the LICENSE file.
 
 #include <inttypes.h>
+#include <limits.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
@@ -22,6 +23,7 @@
 #include <zircon/device/block.h>
 #include <zircon/errors.h>
 #include <zircon/status.h>
+#include <zircon/syscalls.h>
 #include <zircon/thread_annotations.h>
 #include <zircon/types.h>
 #include <zxcrypt/volume.h>
@@ -39,6 +41,12 @@ namespace {
 // Cap largest transaction to a quarter of the VMO buffer.
 const uint32_t kMaxTransferSize = Volume::kBufferSize / 4;
 
+// Requests are split between workers in portions of at least this many bytes; smaller requests are
+// transformed by a single worker.  Whole pages, so that each portion of a read can be mapped
+// separately.
+const uint32_t kMinStripeSize = 64 * 1024;
+static_assert(kMinStripeSize % PAGE_SIZE == 0, "kMinStripeSize must be page aligned");
+
 // Kick off |Init| thread when binding.
 int InitThread(void* arg) {
     return static_cast<Device*>(arg)->Init();
@@ -167,17 +175,22 @@ zx_status_t Device::Init() {
         return rc;
     }
 
-    // Start workers
-    // TODO(aarongreen): Investigate performance implications of adding more workers.
+    // Start workers, one per CPU.
     if ((rc = zx::port::create(0, &port_)) != ZX_OK) {
         zxlogf(ERROR, "zx::port::create failed: %s\n", zx_status_get_string(rc));
         return rc;
     }
-    for (size_t i = 0; i < kNumWorkers; ++i) {
+    uint32_t num_workers = fbl::clamp(zx_system_get_num_cpus(), 1U, kMaxWorkers);
+    workers_.reset(new (&ac) Worker[num_workers]);
+    if (!ac.check()) {
+        zxlogf(ERROR, "failed to allocate %zu bytes\n", num_workers * sizeof(Worker));
+        return ZX_ERR_NO_MEMORY;
+    }
+    for (uint32_t i = 0; i < num_workers; ++i) {
         zx::port port;
         port_.duplicate(ZX_RIGHT_SAME_RIGHTS, &port);
         if ((rc = workers_[i].Start(this, *volume, std::move(port))) != ZX_OK) {
-            zxlogf(ERROR, "failed to start worker %zu: %s\n", i, zx_status_get_string(rc));
+            zxlogf(ERROR, "failed to start worker %" PRIu32 ": %s\n", i, zx_status_get_string(rc));
             return rc;
         }
         ++info->num_workers;
@@ -292,6 +305,8 @@ void Device::BlockImplQuery(block_info_t* out_info, size_t* out_op_size) {
     info_->block_protocol.Query(out_info, out_op_size);
     out_info->block_count -= info_->reserved_blocks;
     out_info->max_transfer_size = fbl::min(kMaxTransferSize, out_info->max_transfer_size);
+    // Trims are not passed through to the underlying device.
+    out_info->flags &= ~BLOCK_FLAG_TRIM_SUPPORT;
     *out_op_size = info_->op_size;
 }
 
@@ -533,16 +548,60 @@ void Device::EnqueueWrite(block_op_t* block) {
     }
 }
 
+void Device::BlockTransformed(block_op_t* block, zx_status_t status) {
+    LOG_ENTRY_ARGS("block=%p, status=%s", block, zx_status_get_string(status));
+    ZX_DEBUG_ASSERT(info_);
+
+    extra_op_t* extra = BlockToExtra(block, info_->op_size);
+    if (status != ZX_OK) {
+        zx_status_t expected = ZX_OK;
+        extra->stripe_status.compare_exchange_strong(expected, status);
+    }
+    if (extra->stripes.fetch_sub(1) != 1) {
+        return;
+    }
+
+    status = extra->stripe_status.load();
+    switch (block->command & BLOCK_OP_MASK) {
+    case BLOCK_OP_WRITE:
+        BlockForward(block, status);
+        break;
+    case BLOCK_OP_READ:
+    default:
+        BlockComplete(block, status);
+        break;
+    }
+}
+
 void Device::SendToWorker(block_op_t* block) {
     LOG_ENTRY_ARGS("block=%p", block);
     zx_status_t rc;
 
-    zx_port_packet_t packet;
-    Worker::MakeRequest(&packet, Worker::kBlockRequest, block);
-    if ((rc = port_.queue(&packet)) != ZX_OK) {
-        zxlogf(ERROR, "zx::port::queue failed: %s\n", zx_status_get_string(rc));
-        BlockComplete(block, rc);
-        return;
+    // Split the request into as many portions as there are workers, unless that would make them
+    // smaller than |kMinStripeSize|.
+    uint32_t length = block->rw.length;
+    uint32_t min_stripe = fbl::max(kMinStripeSize / info_->block_size, 1U);
+    uint32_t num = fbl::min(info_->num_workers, (length + min_stripe - 1) / min_stripe);
+    uint32_t stripe = length;
+    if (num > 1) {
+        stripe = fbl::round_up((length + num - 1) / num, min_stripe);
+        num = (length + stripe - 1) / stripe;
+    } else {
+        num = 1;
+    }
+
+    // The request may be completed by a worker as soon as the last portion is queued.
+    extra_op_t* extra = BlockToExtra(block, info_->op_size);
+    extra->stripes.store(num);
+    extra->stripe_status.store(ZX_OK);
+    for (uint32_t off = 0, i = 0; i < num; off += stripe, ++i) {
+        zx_port_packet_t packet;
+        Worker::MakeRequest(&packet, Worker::kBlockRequest, block, off,
+                            fbl::min(stripe, length - off));
+        if ((rc = port_.queue(&packet)) != ZX_OK) {
+            zxlogf(ERROR, "zx::port::queue failed: %s\n", zx_status_get_string(rc));
+            BlockTransformed(block, rc);
+        }
     }
 }
 
@@ -19,6 +19,7 @@
 #include <ddktl/protocol/block/volume.h>
 #include <fbl/macros.h>
 #include <fbl/mutex.h>
+#include <fbl/unique_ptr.h>
 #include <lib/zx/port.h>
 #include <lib/zx/vmar.h>
 #include <lib/zx/vmo.h>
@@ -98,18 +99,23 @@ public:
     // Returns a completed |block| request to the caller of |BlockQueue|.
     void BlockComplete(block_op_t* block, zx_status_t status) __TA_EXCLUDES(mtx_);
 
+    // Called by a worker when it has finished transforming its portion of |block|.  Once all the
+    // portions have been transformed, sends a write to the parent device, or completes a read.
+    void BlockTransformed(block_op_t* block, zx_status_t status) __TA_EXCLUDES(mtx_);
+
 private:
     DISALLOW_COPY_ASSIGN_AND_MOVE(Device);
 
-    // TODO(aarongreen): Investigate performance impact of changing this.
-    // Number of encrypting/decrypting workers
-    static const size_t kNumWorkers = 2;
+    // Upper bound on the number of encrypting/decrypting workers, which is otherwise the number of
+    // CPUs.
+    static constexpr uint32_t kMaxWorkers = 16;
 
     // Adds |block| to the write queue if not null, and sends to the workers as many write requests
     // as fit in the space available in the write buffer.
     void EnqueueWrite(block_op_t* block = nullptr) __TA_EXCLUDES(mtx_);
 
-    // Sends a block I/O request to a worker to be encrypted or decrypted.
+    // Sends a block I/O request to the workers to be encrypted or decrypted.  Large requests are
+    // split between several workers.
     void SendToWorker(block_op_t* block) __TA_EXCLUDES(mtx_);
 
     // Callback used for block ops sent to the parent device.  Restores the fields saved by
@@ -162,7 +168,7 @@ private:
     thrd_t init_;
 
     // Threads that performs encryption/decryption.
-    Worker workers_[kNumWorkers];
+    fbl::unique_ptr<Worker[]> workers_;
 
     // Port used to send write/read operations to be encrypted/decrypted.
     zx::port port_;
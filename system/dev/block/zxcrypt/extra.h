@@ -11,6 +11,8 @@
 #include <zircon/listnode.h>
 #include <zircon/types.h>
 
+#include <atomic>
+
 namespace zxcrypt {
 
 // |extra_op_t| is the extra information placed in the tail end of |block_op_t|s queued against a
@@ -28,6 +30,11 @@ struct extra_op_t {
     // Memory region to use for cryptographic transformations.
     uint8_t* data;
 
+    // The number of portions of the request still being transformed by workers, and the first
+    // error any of them encountered.  See |Device::SendToWorker|.
+    std::atomic_uint32_t stripes;
+    std::atomic<zx_status_t> stripe_status;
+
     // The remaining are used to save fields of the original block request which may be altered
     zx_handle_t vmo;
     uint32_t length;
@@ -34,7 +34,8 @@ Worker::~Worker() {
     LOG_ENTRY();
 }
 
-void Worker::MakeRequest(zx_port_packet_t* packet, uint64_t op, void* arg) {
+void Worker::MakeRequest(zx_port_packet_t* packet, uint64_t op, void* arg, uint32_t off,
+                         uint32_t len) {
     static_assert(sizeof(uintptr_t) <= sizeof(uint64_t), "cannot store pointer as uint64_t");
     ZX_DEBUG_ASSERT(packet);
     packet->key = 0;
@@ -42,6 +43,8 @@ void Worker::MakeRequest(zx_port_packet_t* packet, uint64_t op, void* arg) {
     packet->status = ZX_OK;
     packet->user.u64[0] = op;
     packet->user.u64[1] = reinterpret_cast<uint64_t>(arg);
+    packet->user.u64[2] = off;
+    packet->user.u64[3] = len;
 }
 
 zx_status_t Worker::Start(Device* device, const Volume& volume, zx::port&& port) {
@@ -100,44 +103,49 @@ zx_status_t Worker::Run() {
 
         // Dispatch block request
         block_op_t* block = reinterpret_cast<block_op_t*>(packet.user.u64[1]);
+        uint32_t off = static_cast<uint32_t>(packet.user.u64[2]);
+        uint32_t len = static_cast<uint32_t>(packet.user.u64[3]);
         switch (block->command & BLOCK_OP_MASK) {
         case BLOCK_OP_WRITE:
-            device_->BlockForward(block, EncryptWrite(block));
+            rc = EncryptWrite(block, off, len);
             break;
 
         case BLOCK_OP_READ:
-            device_->BlockComplete(block, DecryptRead(block));
+            rc = DecryptRead(block, off, len);
             break;
 
         default:
-            device_->BlockComplete(block, ZX_ERR_NOT_SUPPORTED);
+            rc = ZX_ERR_NOT_SUPPORTED;
         }
+        device_->BlockTransformed(block, rc);
     }
 }
 
-zx_status_t Worker::EncryptWrite(block_op_t* block) {
-    LOG_ENTRY_ARGS("block=%p", block);
+zx_status_t Worker::EncryptWrite(block_op_t* block, uint32_t off, uint32_t len) {
+    LOG_ENTRY_ARGS("block=%p, off=%" PRIu32 ", len=%" PRIu32, block, off, len);
     zx_status_t rc;
 
     // Convert blocks to bytes
     extra_op_t* extra = BlockToExtra(block, device_->op_size());
     uint32_t length;
-    uint64_t offset_dev, offset_vmo;
-    if (mul_overflow(block->rw.length, device_->block_size(), &length) ||
-        mul_overflow(block->rw.offset_dev, device_->block_size(), &offset_dev) ||
-        mul_overflow(extra->offset_vmo, device_->block_size(), &offset_vmo)) {
+    uint64_t offset_dev, offset_vmo, offset_data;
+    if (mul_overflow(len, device_->block_size(), &length) ||
+        mul_overflow(block->rw.offset_dev + off, device_->block_size(), &offset_dev) ||
+        mul_overflow(extra->offset_vmo + off, device_->block_size(), &offset_vmo) ||
+        mul_overflow(off, device_->block_size(), &offset_data)) {
         zxlogf(ERROR,
                "overflow; length=%" PRIu32 "; offset_dev=%" PRIu64 "; offset_vmo=%" PRIu64 "\n",
-               block->rw.length, block->rw.offset_dev, extra->offset_vmo);
+               len, block->rw.offset_dev + off, extra->offset_vmo + off);
         return ZX_ERR_OUT_OF_RANGE;
     }
 
     // Copy and encrypt the plaintext
-    if ((rc = zx_vmo_read(extra->vmo, extra->data, offset_vmo, length)) != ZX_OK) {
+    uint8_t* data = extra->data + offset_data;
+    if ((rc = zx_vmo_read(extra->vmo, data, offset_vmo, length)) != ZX_OK) {
         zxlogf(ERROR, "zx_vmo_read() failed: %s\n", zx_status_get_string(rc));
         return rc;
     }
-    if ((rc = encrypt_.Encrypt(extra->data, offset_dev, length, extra->data) != ZX_OK)) {
+    if ((rc = encrypt_.Encrypt(data, offset_dev, length, data) != ZX_OK)) {
         zxlogf(ERROR, "failed to encrypt: %s\n", zx_status_get_string(rc));
         return rc;
     }
@@ -145,19 +153,19 @@ zx_status_t Worker::EncryptWrite(block_op_t* block) {
     return ZX_OK;
 }
 
-zx_status_t Worker::DecryptRead(block_op_t* block) {
-    LOG_ENTRY_ARGS("block=%p", block);
+zx_status_t Worker::DecryptRead(block_op_t* block, uint32_t off, uint32_t len) {
+    LOG_ENTRY_ARGS("block=%p, off=%" PRIu32 ", len=%" PRIu32, block, off, len);
     zx_status_t rc;
 
     // Convert blocks to bytes
     uint32_t length;
     uint64_t offset_dev, offset_vmo;
-    if (mul_overflow(block->rw.length, device_->block_size(), &length) ||
-        mul_overflow(block->rw.offset_dev, device_->block_size(), &offset_dev) ||
-        mul_overflow(block->rw.offset_vmo, device_->block_size(), &offset_vmo)) {
+    if (mul_overflow(len, device_->block_size(), &length) ||
+        mul_overflow(block->rw.offset_dev + off, device_->block_size(), &offset_dev) ||
+        mul_overflow(block->rw.offset_vmo + off, device_->block_size(), &offset_vmo)) {
         zxlogf(ERROR,
                "overflow; length=%" PRIu32 "; offset_dev=%" PRIu64 "; offset_vmo=%" PRIu64 "\n",
-               block->rw.length, block->rw.offset_dev, block->rw.offset_vmo);
+               len, block->rw.offset_dev + off, block->rw.offset_vmo + off);
         return ZX_ERR_OUT_OF_RANGE;
     }
 
@@ -32,8 +32,11 @@ public:
     static constexpr uint64_t kBlockRequest = 0x1;
     static constexpr uint64_t kStopRequest = 0x2;
 
-    // Configure the given |packet| to be an |op| request, with an optional |arg|.
-    static void MakeRequest(zx_port_packet_t* packet, uint64_t op, void* arg = nullptr);
+    // Configure the given |packet| to be an |op| request, with an optional |arg|.  Block requests
+    // also give the |len| blocks at |off| from the start of the request which are to be
+    // transformed.
+    static void MakeRequest(zx_port_packet_t* packet, uint64_t op, void* arg = nullptr,
+                            uint32_t off = 0, uint32_t len = 0);
 
     // Starts the worker, which will service requests sent from the given |device| on the given
     // |port|.  Cryptographic operations will use the key material from the given |volume|.
@@ -51,12 +54,12 @@ private:
     static int WorkerRun(void* arg) { return static_cast<Worker*>(arg)->Run(); }
     zx_status_t Run();
 
-    // Copies the plaintext data to be written to the write buffer location given in |block|'s extra
-    // information, and encrypts it before sending it to the parent device.
-    zx_status_t EncryptWrite(block_op_t* block);
+    // Copies the |len| blocks at |off| of the plaintext data to be written to the write buffer
+    // location given in |block|'s extra information, and encrypts them there.
+    zx_status_t EncryptWrite(block_op_t* block, uint32_t off, uint32_t len);
 
-    // Maps the ciphertext data in |block|, and decrypts it in place before completing the block op.
-    zx_status_t DecryptRead(block_op_t* block);
+    // Maps the |len| blocks at |off| of the ciphertext data in |block|, and decrypts them in place.
+    zx_status_t DecryptRead(block_op_t* block, uint32_t off, uint32_t len);
 
     // The cipher objects used to perform cryptographic.  See notes on "random access" in
     // crypto/cipher.h.
@@ -77,6 +77,8 @@ static zx_status_t ktrace_ioctl(void* ctx, uint32_t op,
         zx_ktrace_control(get_root_resource(), KTRACE_ACTION_REWIND, 0, NULL);
         return ZX_OK;
     }
+    case IOCTL_KTRACE_SNAPSHOT:
+        return zx_ktrace_control(get_root_resource(), KTRACE_ACTION_SNAPSHOT, 0, NULL);
     default:
         return ZX_ERR_INVALID_ARGS;
     }
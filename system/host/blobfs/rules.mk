@@ -13,6 +13,7 @@ MODULE_TYPE := hostapp
 MODULE_SRCS := \
     $(LOCAL_DIR)/main.cpp \
     system/ulib/bitmap/raw-bitmap.cpp \
+    system/ulib/bitmap/summary.cpp \
 
 MODULE_HOST_LIBS := \
     system/ulib/blobfs.hostlib \
@@ -39,6 +39,7 @@ MODULE_HOST_LIBS := \
     system/ulib/fvm-host.hostlib \
     system/ulib/fvm.hostlib \
     system/ulib/minfs.hostlib \
+    third_party/ulib/cksum.hostlib \
     third_party/ulib/lz4.hostlib \
     third_party/ulib/uboringssl.hostlib \
     third_party/ulib/zstd.hostlib \
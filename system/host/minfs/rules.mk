@@ -13,6 +13,7 @@ MODULE_TYPE := hostapp
 MODULE_SRCS := \
     $(LOCAL_DIR)/main.cpp \
     system/ulib/bitmap/raw-bitmap.cpp \
+    system/ulib/bitmap/summary.cpp \
 
 MODULE_COMPILEFLAGS := \
     -Werror-implicit-function-declaration \
@@ -30,6 +31,7 @@ MODULE_HOST_LIBS := \
     system/ulib/fbl.hostlib \
     system/ulib/fs.hostlib \
     system/ulib/minfs.hostlib \
+    third_party/ulib/cksum.hostlib \
     system/ulib/fs-host.hostlib \
 
 MODULE_PACKAGE := bin
@@ -77,6 +77,14 @@
 // clears the counters
 #define IOCTL_BLOCK_GET_STATS   \
     IOCTL(IOCTL_KIND_DEFAULT, IOCTL_FAMILY_BLOCK, 18)
+// Add another FIFO to the currently running FIFO server; acquire the handle to it.
+// Each FIFO is served by its own thread, and shares the VMOs attached to the server.
+#define IOCTL_BLOCK_GET_QUEUE_FIFO \
+    IOCTL(IOCTL_KIND_GET_HANDLE, IOCTL_FAMILY_BLOCK, 19)
+// Returns statistics of the I/O scheduler of the FIFO server, and optionally
+// clears them
+#define IOCTL_BLOCK_GET_SCHED_STATS \
+    IOCTL(IOCTL_KIND_DEFAULT, IOCTL_FAMILY_BLOCK, 20)
 
 // Block Impl ioctls (specific to each block device):
 
@@ -84,6 +92,9 @@
 #define BLOCK_FLAG_REMOVABLE 0x00000002
 #define BLOCK_FLAG_BOOTPART 0x00000004  // block device has bootdata partition map
                                         // provided by device metadata
+#define BLOCK_FLAG_MULTI_QUEUE 0x00000008 // block device steers ops to hardware queues
+                                          // by BLOCK_FL_QUEUE_MASK
+#define BLOCK_FLAG_TRIM_SUPPORT 0x00000010 // block device supports BLOCKIO_TRIM
 
 #define BLOCK_MAX_TRANSFER_UNBOUNDED 0xFFFFFFFF
 
@@ -106,6 +117,15 @@ typedef struct {
     size_t total_blocks_written;
 } block_stats_t;
 
+typedef struct {
+    size_t total_requests;  // Requests dispatched to the device
+    size_t merged_requests; // Requests merged into the operation of an adjacent request
+    size_t total_ops;       // Operations dispatched to the device
+    size_t queue_depth_sum; // Sum of the operations outstanding as each one was dispatched
+    size_t max_queue_depth; // Most operations outstanding at once
+    size_t throttled;       // Times dispatch paused for outstanding operations to complete
+} block_sched_stats_t;
+
 // ssize_t ioctl_block_get_info(int fd, block_info_t* out);
 IOCTL_WRAPPER_OUT(ioctl_block_get_info, IOCTL_BLOCK_GET_INFO, block_info_t);
 
@@ -139,6 +159,17 @@ IOCTL_WRAPPER_INOUT(ioctl_block_attach_vmo, IOCTL_BLOCK_ATTACH_VMO, zx_handle_t,
 // ssize_t ioctl_block_fifo_close(int fd);
 IOCTL_WRAPPER(ioctl_block_fifo_close, IOCTL_BLOCK_FIFO_CLOSE);
 
+// The maximum number of FIFOs served for a single client, including the one
+// returned by IOCTL_BLOCK_GET_FIFOS.
+#define BLOCK_MAX_QUEUES 16
+
+// ssize_t ioctl_block_get_queue_fifo(int fd, zx_handle_t* fifo_out);
+IOCTL_WRAPPER_OUT(ioctl_block_get_queue_fifo, IOCTL_BLOCK_GET_QUEUE_FIFO, zx_handle_t);
+
+// ssize_t ioctl_block_get_sched_stats(int fd, bool* clear, block_sched_stats_t* out);
+IOCTL_WRAPPER_INOUT(ioctl_block_get_sched_stats, IOCTL_BLOCK_GET_SCHED_STATS, bool,
+                    block_sched_stats_t);
+
 #define GUID_LEN 16
 #define NAME_LEN 24
 #define MAX_FVM_VSLICE_REQUESTS 16
@@ -281,6 +312,10 @@ typedef uint16_t groupid_t;
 #define BLOCKIO_FLUSH          0x00000003
 // Detaches the VMO from the block device.
 #define BLOCKIO_CLOSE_VMO      0x00000004
+// Tells the device that the contents of 'length' blocks starting at 'dev_offset'
+// are no longer needed. 'vmoid' and 'vmo_offset' are ignored.
+// Only supported by devices which report BLOCK_FLAG_TRIM_SUPPORT.
+#define BLOCKIO_TRIM           0x00000005
 #define BLOCKIO_OP_MASK        0x000000FF
 
 // Require that this operation will not begin until all prior operations
@@ -429,6 +429,15 @@ typedef struct zx_info_resource {
 // Terminate this job if the system is low on memory.
 #define ZX_PROP_JOB_KILL_ON_OOM             15u
 
+// Maximum number of bytes the kernel may request from a VMO's pager ahead of
+// sequential faults, a size_t. Zero, the default, disables readahead.
+#define ZX_PROP_VMO_READAHEAD_MAX           16u
+
+// Largest number of bytes a socket endpoint's receive buffer may grow to as
+// it adapts to the throughput of its reader, a size_t. It may not be raised
+// above the kernel.socket.rx-buf-limit-max boot option.
+#define ZX_PROP_SOCKET_RX_BUF_LIMIT         17u
+
 // Basic thread states, in zx_info_thread_t.state.
 #define ZX_THREAD_STATE_NEW                 ((zx_thread_state_t) 0x0000u)
 #define ZX_THREAD_STATE_RUNNING             ((zx_thread_state_t) 0x0001u)
@@ -2,9 +2,11 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
 #include <atomic>
 #include <errno.h>
 #include <fcntl.h>
+#include <memory>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -62,10 +64,31 @@ static void ops_per_second(uint64_t count, uint64_t nanos) {
     fprintf(stderr, "%g %s/s\n", rate, "ops");
 }
 
+// Sorts the |count| |latencies| and prints their percentiles.
+static void latency_percentiles(zx_duration_t* latencies, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    std::sort(latencies, latencies + count);
+    static const struct {
+        const char* name;
+        double fraction;
+    } kPercentiles[] = {
+        {"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}, {"p99.9", 0.999},
+    };
+    fprintf(stderr, "latency:");
+    for (const auto& p : kPercentiles) {
+        size_t i = static_cast<size_t>(p.fraction * static_cast<double>(count - 1));
+        fprintf(stderr, " %s %zu us,", p.name, latencies[i] / 1000);
+    }
+    fprintf(stderr, " max %zu us\n", latencies[count - 1] / 1000);
+}
+
 typedef struct {
     int fd;
     zx_handle_t vmo;
-    zx_handle_t fifo;
+    zx_handle_t fifos[BLOCK_MAX_QUEUES];
+    size_t queues;
     reqid_t reqid;
     vmoid_t vmoid;
     size_t bufsz;
@@ -77,12 +100,13 @@ static void blkdev_close(blkdev_t* blk) {
         close(blk->fd);
     }
     zx_handle_close(blk->vmo);
-    zx_handle_close(blk->fifo);
+    zx_handle_close_many(blk->fifos, blk->queues);
     memset(blk, 0, sizeof(blkdev_t));
     blk->fd = -1;
 }
 
-static zx_status_t blkdev_open(int fd, const char* dev, size_t bufsz, blkdev_t* blk) {
+static zx_status_t blkdev_open(int fd, const char* dev, size_t bufsz, size_t queues,
+                               blkdev_t* blk) {
     memset(blk, 0, sizeof(blkdev_t));
     blk->fd = fd;
     blk->bufsz = bufsz;
@@ -92,10 +116,16 @@ static zx_status_t blkdev_open(int fd, const char* dev, size_t bufsz, blkdev_t*
         fprintf(stderr, "error: cannot get block device info for '%s'\n", dev);
         goto fail;
     }
-    if (ioctl_block_get_fifos(fd, &blk->fifo) != sizeof(zx_handle_t)) {
+    if (ioctl_block_get_fifos(fd, &blk->fifos[0]) != sizeof(zx_handle_t)) {
         fprintf(stderr, "error: cannot get fifo for '%s'\n", dev);
         goto fail;
     }
+    for (blk->queues = 1; blk->queues < queues; blk->queues++) {
+        if (ioctl_block_get_queue_fifo(fd, &blk->fifos[blk->queues]) != sizeof(zx_handle_t)) {
+            fprintf(stderr, "error: cannot get fifo for queue %zu of '%s'\n", blk->queues, dev);
+            goto fail;
+        }
+    }
     if ((r = zx_vmo_create(bufsz, 0, &blk->vmo)) != ZX_OK) {
         fprintf(stderr, "error: out of memory %d\n", r);
         goto fail;
@@ -120,6 +150,7 @@ fail:
 
 typedef struct {
     blkdev_t* blk;
+    zx_handle_t fifo;
     size_t count;
     size_t xfer;
     uint64_t seed;
@@ -127,8 +158,20 @@ typedef struct {
     bool write;
     bool linear;
 
+    // Transfers are spread across the queues: this queue issues transfers
+    // |queue|, |queue| + |queues|, ... of the |span| transfers covering the
+    // tested range.
+    size_t queue;
+    size_t queues;
+    size_t span;
+
     std::atomic<int> pending;
     sync_completion_t signal;
+
+    // Indexed by request id, shared by all queues: when each request was
+    // written to its fifo, and how long it then took to complete.
+    zx_time_t* issued;
+    zx_duration_t* latencies;
 } bio_random_args_t;
 
 std::atomic<reqid_t> next_reqid(0);
@@ -141,12 +184,12 @@ static int bio_random_thread(void* arg) {
     size_t xfer = a->xfer;
 
     size_t blksize = a->blk->info.block_size;
-    size_t blkcount = ((count * xfer) / blksize) - (xfer / blksize);
+    size_t blkcount = ((a->span * xfer) / blksize) - (xfer / blksize);
 
     rand64_t r64 = RAND63SEED(a->seed);
 
-    zx_handle_t fifo = a->blk->fifo;
-    size_t dev_off = 0;
+    zx_handle_t fifo = a->fifo;
+    size_t dev_off = a->queue * xfer;
 
     while (count > 0) {
         while (a->pending.load() == a->max_pending) {
@@ -163,7 +206,7 @@ static int bio_random_thread(void* arg) {
 
         if (a->linear) {
             req.dev_offset = dev_off;
-            dev_off += xfer;
+            dev_off += xfer * a->queues;
         } else {
             req.dev_offset = (rand64(&r64) % blkcount) * blksize;
         }
@@ -180,8 +223,9 @@ static int bio_random_thread(void* arg) {
         fprintf(stderr, "IO tid=%u vid=%u op=%x len=%zu vof=%zu dof=%zu\n",
                 req.reqid, req.vmoid, req.opcode, req.length, req.vmo_offset, req.dev_offset);
 #endif
-        zx_status_t r = zx_fifo_write(fifo, sizeof(req), &req, 1, NULL);
-        if (r == ZX_ERR_SHOULD_WAIT) {
+        a->issued[req.reqid] = zx_clock_get_monotonic();
+        zx_status_t r;
+        while ((r = zx_fifo_write(fifo, sizeof(req), &req, 1, NULL)) == ZX_ERR_SHOULD_WAIT) {
             r = zx_object_wait_one(fifo, ZX_FIFO_WRITABLE | ZX_FIFO_PEER_CLOSED,
                                    ZX_TIME_INFINITE, NULL);
             if (r != ZX_OK) {
@@ -189,8 +233,8 @@ static int bio_random_thread(void* arg) {
                 zx_handle_close(fifo);
                 return -1;
             }
-            continue;
-        } else if (r < 0) {
+        }
+        if (r < 0) {
             fprintf(stderr, "error: failed writing fifo\n");
             zx_handle_close(fifo);
             return -1;
@@ -202,17 +246,12 @@ static int bio_random_thread(void* arg) {
     return 0;
 }
 
-
-static zx_status_t bio_random(bio_random_args_t* a, uint64_t* _total, zx_duration_t* _res) {
-
-    thrd_t t;
-    int r;
+// Reads the responses to the requests issued by bio_random_thread.
+static int bio_complete_thread(void* arg) {
+    auto* a = reinterpret_cast<bio_random_args_t*>(arg);
 
     size_t count = a->count;
-    zx_handle_t fifo = a->blk->fifo;
-
-    zx_time_t t0 = zx_clock_get_monotonic();
-    thrd_create(&t, bio_random_thread, a);
+    zx_handle_t fifo = a->fifo;
 
     while (count > 0) {
         block_fifo_response_t resp;
@@ -234,26 +273,72 @@ static zx_status_t bio_random(bio_random_args_t* a, uint64_t* _total, zx_duratio
                     resp.status, count);
             goto fail;
         }
+        a->latencies[resp.reqid] = zx_time_sub_time(zx_clock_get_monotonic(),
+                                                    a->issued[resp.reqid]);
         count--;
         if (a->pending.fetch_sub(1) == a->max_pending) {
             sync_completion_signal(&a->signal);
         }
     }
+    return 0;
+
+fail:
+    zx_handle_close(fifo);
+    return -1;
+}
+
+// Runs one submitting and one completing thread for each of the |a->queues| queues,
+// each issuing its share of the |a->count| transfers described by |a|.
+static zx_status_t bio_random(const bio_random_args_t* a, uint64_t* _total,
+                              zx_duration_t* _res) {
+    static bio_random_args_t args[BLOCK_MAX_QUEUES];
+    thrd_t submit[BLOCK_MAX_QUEUES];
+    thrd_t complete[BLOCK_MAX_QUEUES];
+
+    for (size_t q = 0; q < a->queues; q++) {
+        bio_random_args_t* qa = &args[q];
+        qa->blk = a->blk;
+        qa->fifo = a->blk->fifos[q];
+        qa->count = a->count / a->queues + (q < a->count % a->queues ? 1 : 0);
+        qa->xfer = a->xfer;
+        qa->seed = a->seed + q;
+        qa->max_pending = a->max_pending;
+        qa->write = a->write;
+        qa->linear = a->linear;
+        qa->queue = q;
+        qa->queues = a->queues;
+        qa->span = a->count;
+        qa->issued = a->issued;
+        qa->latencies = a->latencies;
+    }
+
+    zx_time_t t0 = zx_clock_get_monotonic();
+    for (size_t q = 0; q < a->queues; q++) {
+        thrd_create(&submit[q], bio_random_thread, &args[q]);
+        thrd_create(&complete[q], bio_complete_thread, &args[q]);
+    }
+
+    int r;
+    bool failed = false;
+    for (size_t q = 0; q < a->queues; q++) {
+        thrd_join(complete[q], &r);
+        failed |= (r != 0);
+    }
 
     zx_time_t t1;
     t1 = zx_clock_get_monotonic();
 
-    fprintf(stderr, "waiting for thread to exit...\n");
-    thrd_join(t, &r);
+    fprintf(stderr, "waiting for threads to exit...\n");
+    for (size_t q = 0; q < a->queues; q++) {
+        thrd_join(submit[q], &r);
+    }
+    if (failed) {
+        return ZX_ERR_IO;
+    }
 
     *_res = zx_time_sub_time(t1, t0);
     *_total = a->count * a->xfer;
     return ZX_OK;
-
-fail:
-    zx_handle_close(a->blk->fifo);
-    thrd_join(t, &r);
-    return ZX_ERR_IO;
 }
 
 void usage(void) {
@@ -261,7 +346,9 @@ void usage(void) {
                     "\n"
                     "args:  -bs <num>     transfer block size (multiple of 4K)\n"
                     "       -tt <num>     total bytes to transfer\n"
-                    "       -mo <num>     maximum outstanding ops (1..128)\n"
+                    "       -mo <num>     maximum outstanding ops per queue (1..128)\n"
+                    "       -q <num>      number of fifo queues, each served by its own\n"
+                    "                     thread in the block server (1..16)\n"
                     "       -read         test reading from the block device (default)\n"
                     "       -write        test writing to the block device\n"
                     "       -live-dangerously  required if using \"-write\"\n"
@@ -292,6 +379,7 @@ int main(int argc, char** argv) {
     a.max_pending = 128;
     a.write = false;
     a.linear = true;
+    a.queues = 1;
     const char* output_file = nullptr;
 
     size_t total = 0;
@@ -317,6 +405,12 @@ int main(int argc, char** argv) {
                 error("error: max pending must be between 1 and 128\n");
             }
             a.max_pending = static_cast<int>(n);
+        } else if (!strcmp(argv[0], "-q")) {
+            needparam();
+            a.queues = number(argv[0]);
+            if ((a.queues < 1) || (a.queues > BLOCK_MAX_QUEUES)) {
+                error("error: queues must be between 1 and %d\n", BLOCK_MAX_QUEUES);
+            }
         } else if (!strcmp(argv[0], "-read")) {
             a.write = false;
         } else if (!strcmp(argv[0], "-write")) {
@@ -355,7 +449,7 @@ int main(int argc, char** argv) {
         fprintf(stderr, "error: cannot open '%s'\n", device_filename);
         return -1;
     }
-    if (blkdev_open(fd, device_filename, 8*1024*1024, &blk) != ZX_OK) {
+    if (blkdev_open(fd, device_filename, 8*1024*1024, a.queues, &blk) != ZX_OK) {
         return -1;
     }
 
@@ -367,6 +461,11 @@ int main(int argc, char** argv) {
     }
     a.count = total / a.xfer;
 
+    std::unique_ptr<zx_time_t[]> issued(new zx_time_t[a.count]);
+    std::unique_ptr<zx_duration_t[]> latencies(new zx_duration_t[a.count]);
+    a.issued = issued.get();
+    a.latencies = latencies.get();
+
     zx_duration_t res = 0;
     total = 0;
     if (bio_random(&a, &total, &res) != ZX_OK) {
@@ -377,6 +476,7 @@ int main(int argc, char** argv) {
     bytes_per_second(total, res);
     fprintf(stderr, "%zu ops in %zu ns: ", a.count, res);
     ops_per_second(a.count, res);
+    latency_percentiles(latencies.get(), a.count);
 
     if (output_file) {
         perftest::ResultsSet results;
@@ -384,6 +484,10 @@ int main(int argc, char** argv) {
             "fuchsia.zircon", "BlockDeviceThroughput", "bytes/second");
         double time_in_seconds = static_cast<double>(res) / 1e9;
         test_case->AppendValue(static_cast<double>(total) / time_in_seconds);
+        test_case = results.AddTestCase("fuchsia.zircon", "BlockDeviceLatency", "nanoseconds");
+        for (size_t i = 0; i < a.count; i++) {
+            test_case->AppendValue(static_cast<double>(latencies[i]));
+        }
         if (!results.WriteJSONFile(output_file)) {
             return 1;
         }
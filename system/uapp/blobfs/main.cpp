@@ -99,6 +99,10 @@ int usage() {
             "\n"
             "options: -r|--readonly  Mount filesystem read-only\n"
             "         -m|--metrics   Collect filesystem metrics\n"
+            "         -p|--pager     Read and verify uncompressed blobs on demand\n"
+            "         -c|--cache-size <MB>\n"
+            "                        Keep up to <MB> of closed blobs in memory, evicting\n"
+            "                        the least recently used first\n"
             "         -h|--help      Display this message\n"
             "\n"
             "On Fuchsia, blobfs takes the block device argument by handle.\n"
@@ -120,11 +124,13 @@ int ProcessArgs(int argc, char** argv, CommandFunction* func, blobfs::MountOptio
             {"readonly", no_argument, nullptr, 'r'},
             {"metrics", no_argument, nullptr, 'm'},
             {"journal", no_argument, nullptr, 'j'},
+            {"pager", no_argument, nullptr, 'p'},
+            {"cache-size", required_argument, nullptr, 'c'},
             {"help", no_argument, nullptr, 'h'},
             {nullptr, 0, nullptr, 0},
         };
         int opt_index;
-        int c = getopt_long(argc, argv, "rmjh", opts, &opt_index);
+        int c = getopt_long(argc, argv, "rmjpc:h", opts, &opt_index);
         if (c < 0) {
             break;
         }
@@ -138,6 +144,13 @@ int ProcessArgs(int argc, char** argv, CommandFunction* func, blobfs::MountOptio
         case 'j':
             options->journal = true;
             break;
+        case 'p':
+            options->paging = true;
+            break;
+        case 'c':
+            options->cache_policy = blobfs::CachePolicy::EvictLeastRecentlyUsed;
+            options->cache_max_bytes = strtoull(optarg, nullptr, 10) << 20;
+            break;
         case 'h':
         default:
             return usage();
@@ -51,10 +51,13 @@ void do_test(uint32_t duration_sec, const TestArgs& test_args) {
     status = zx_event_create(0u, &event);
     assert(status == ZX_OK);
 
-    // Storage space for our messages' stuff.
-    fbl::unique_ptr<uint8_t[]> data;
+    // Storage space for our messages' stuff. The data buffer is page-aligned so that large
+    // messages can be read without a copy.
+    uint8_t* data = nullptr;
     if (test_args.size) {
-        data.reset(new uint8_t[test_args.size]);
+        data = static_cast<uint8_t*>(
+            aligned_alloc(ZX_PAGE_SIZE, fbl::round_up(test_args.size, ZX_PAGE_SIZE)));
+        assert(data);
         for (uint32_t i = 0; i < test_args.size; i++)
             data[i] = static_cast<uint8_t>(i);
     }
@@ -65,7 +68,7 @@ void do_test(uint32_t duration_sec, const TestArgs& test_args) {
     // Pre-queue |test_args.queue| messages (there'll always be this many messages in the queue).
     for (uint32_t i = 0; i < test_args.queue; i++) {
         duplicate_handles(test_args.handles, event, handles.get());
-        status = zx_channel_write(mp[0], 0u, data.get(), test_args.size,
+        status = zx_channel_write(mp[0], 0u, data, test_args.size,
                                   handles.get(), test_args.handles);
         assert(status == ZX_OK);
     }
@@ -79,13 +82,13 @@ void do_test(uint32_t duration_sec, const TestArgs& test_args) {
     for (;;) {
         big_its++;
         for (uint32_t i = 0; i < big_it_size; i++) {
-            status = zx_channel_write(mp[0], 0, data.get(), test_args.size,
+            status = zx_channel_write(mp[0], 0, data, test_args.size,
                                       handles.get(), test_args.handles);
             assert(status == ZX_OK);
 
             uint32_t r_size = test_args.size;
             uint32_t r_handles = test_args.handles;
-            status = zx_channel_read(mp[1], 0u, data.get(), handles.get(), r_size,
+            status = zx_channel_read(mp[1], 0u, data, handles.get(), r_size,
                                      r_handles, &r_size, &r_handles);
             assert(status == ZX_OK);
             assert(r_size == test_args.size);
@@ -107,6 +110,7 @@ void do_test(uint32_t duration_sec, const TestArgs& test_args) {
     assert(status == ZX_OK);
     status = zx_handle_close(mp[1]);
     assert(status == ZX_OK);
+    free(data);
 
     double real_duration = static_cast<double>(zx_time_sub_time(end_ns, start_ns)) / 1000000000.0;
     double its_per_second = static_cast<double>(big_its) * big_it_size / real_duration;
@@ -217,6 +221,11 @@ int main(int argc, char** argv) {
                 {10, 0, 1},
                 {100, 0, 1},
                 {1000, 0, 1},
+                {4096, 0, 0},
+                {8192, 0, 0},
+                {16384, 0, 0},
+                {32768, 0, 0},
+                {65536, 0, 0},
             };
             for (size_t i = 0; i < fbl::count_of(suite); i++)
                 do_test(duration, suite[i]);
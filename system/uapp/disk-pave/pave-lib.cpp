@@ -8,12 +8,16 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
+#include <threads.h>
 
 #include <block-client/cpp/client.h>
 #include <crypto/bytes.h>
+#include <digest/digest.h>
 #include <fbl/algorithm.h>
 #include <fbl/array.h>
 #include <fbl/auto_call.h>
+#include <fbl/function.h>
+#include <fbl/macros.h>
 #include <fbl/unique_fd.h>
 #include <fbl/vector.h>
 #include <fs-management/fvm.h>
@@ -24,10 +28,11 @@
 #include <fvm/sparse-reader.h>
 #include <lib/cksum.h>
 #include <lib/fzl/fdio.h>
-#include <lib/fzl/resizeable-vmo-mapper.h>
 #include <lib/fzl/vmo-mapper.h>
+#include <lib/sync/completion.h>
 #include <lib/zx/fifo.h>
 #include <lib/zx/vmo.h>
+#include <zircon/assert.h>
 #include <zircon/boot/image.h>
 #include <zircon/device/block.h>
 #include <zircon/device/device.h>
@@ -110,14 +115,8 @@ inline fvm::extent_descriptor_t* GetExtent(fvm::partition_descriptor_t* pd, size
         extent * sizeof(fvm::extent_descriptor_t));
 }
 
-// Registers a FIFO
-zx_status_t RegisterFastBlockIo(const fbl::unique_fd& fd, const zx::vmo& vmo,
-                                vmoid_t* vmoid_out, block_client::Client* client_out) {
-    zx::fifo fifo;
-    if (ioctl_block_get_fifos(fd.get(), fifo.reset_and_get_address()) < 0) {
-        ERROR("Couldn't attach fifo to partition\n");
-        return ZX_ERR_IO;
-    }
+// Attaches a VMO to a block device, for use in fast block I/O
+zx_status_t AttachVmo(const fbl::unique_fd& fd, const zx::vmo& vmo, vmoid_t* vmoid_out) {
     zx::vmo dup;
     if (vmo.duplicate(ZX_RIGHT_SAME_RIGHTS, &dup) != ZX_OK) {
         ERROR("Couldn't duplicate buffer vmo\n");
@@ -128,6 +127,21 @@ zx_status_t RegisterFastBlockIo(const fbl::unique_fd& fd, const zx::vmo& vmo,
         ERROR("Couldn't attach VMO\n");
         return ZX_ERR_IO;
     }
+    return ZX_OK;
+}
+
+// Registers a FIFO
+zx_status_t RegisterFastBlockIo(const fbl::unique_fd& fd, const zx::vmo& vmo,
+                                vmoid_t* vmoid_out, block_client::Client* client_out) {
+    zx::fifo fifo;
+    if (ioctl_block_get_fifos(fd.get(), fifo.reset_and_get_address()) < 0) {
+        ERROR("Couldn't attach fifo to partition\n");
+        return ZX_ERR_IO;
+    }
+    zx_status_t status;
+    if ((status = AttachVmo(fd, vmo, vmoid_out)) != ZX_OK) {
+        return status;
+    }
     return block_client::Client::Create(std::move(fifo), client_out);
 }
 
@@ -212,104 +226,6 @@ zx_status_t StreamFvmPartition(fvm::SparseReader* reader, PartitionInfo* part,
     return ZX_OK;
 }
 
-// Stream a raw (non-FVM) partition to a vmo.
-zx_status_t StreamPayloadToVmo(fzl::ResizeableVmoMapper& mapper, const fbl::unique_fd& src_fd,
-                               uint32_t block_size_bytes, size_t* payload_size) {
-    zx_status_t status;
-    ssize_t r;
-    size_t vmo_offset = 0;
-
-    while ((r = read(src_fd.get(), &reinterpret_cast<uint8_t*>(mapper.start())[vmo_offset],
-                     mapper.size() - vmo_offset)) > 0) {
-        vmo_offset += r;
-        if (mapper.size() - vmo_offset == 0) {
-            // The buffer is full, let's grow the VMO.
-            if ((status = mapper.Grow(mapper.size() << 1)) != ZX_OK) {
-                ERROR("Failed to grow VMO\n");
-                return status;
-            }
-        }
-    }
-
-    if (r < 0) {
-        ERROR("Error reading partition data\n");
-        return static_cast<zx_status_t>(r);
-    }
-
-    if (vmo_offset % block_size_bytes) {
-        // We have a partial block to write.
-        const size_t rounded_length = fbl::round_up(vmo_offset, block_size_bytes);
-        memset(&reinterpret_cast<uint8_t*>(mapper.start())[vmo_offset], 0,
-               rounded_length - vmo_offset);
-        vmo_offset = rounded_length;
-    }
-    *payload_size = vmo_offset;
-    return ZX_OK;
-}
-
-// Writes a raw (non-FVM) partition to a block device from a VMO.
-zx_status_t WriteVmoToBlock(const zx::vmo& vmo, size_t vmo_size,
-                            const fbl::unique_fd& partition_fd, uint32_t block_size_bytes) {
-    ZX_ASSERT(vmo_size % block_size_bytes == 0);
-
-    vmoid_t vmoid;
-    block_client::Client client;
-    zx_status_t status = RegisterFastBlockIo(partition_fd, vmo, &vmoid, &client);
-    if (status != ZX_OK) {
-        ERROR("Cannot register fast block I/O\n");
-        return status;
-    }
-
-    block_fifo_request_t request;
-    request.group = 0;
-    request.vmoid = vmoid;
-    request.opcode = BLOCKIO_WRITE;
-
-    uint64_t length = vmo_size / block_size_bytes;
-    if (length > UINT32_MAX) {
-        ERROR("Error writing partition data: Too large\n");
-        return ZX_ERR_OUT_OF_RANGE;
-    }
-    request.length = static_cast<uint32_t>(length);
-    request.vmo_offset = 0;
-    request.dev_offset = 0;
-
-    if ((status = client.Transaction(&request, 1)) != ZX_OK) {
-        ERROR("Error writing partition data: %s\n", zx_status_get_string(status));
-        return status;
-    }
-    return ZX_OK;
-}
-
-// Writes a raw (non-FVM) partition to a skip-block device from a VMO.
-zx_status_t WriteVmoToSkipBlock(const zx::vmo& vmo, size_t vmo_size,
-                                const fzl::FdioCaller& caller, uint32_t block_size_bytes) {
-    ZX_ASSERT(vmo_size % block_size_bytes == 0);
-
-    zx::vmo dup;
-    zx_status_t status;
-    if ((status = vmo.duplicate(ZX_RIGHT_SAME_RIGHTS, &dup)) != ZX_OK) {
-        ERROR("Couldn't duplicate buffer vmo\n");
-        return status;
-    }
-
-    fuchsia_hardware_skipblock_ReadWriteOperation operation = {
-        .vmo = dup.release(),
-        .vmo_offset = 0,
-        .block = 0,
-        .block_count = static_cast<uint32_t>(vmo_size / block_size_bytes),
-    };
-    bool bad_block_grown;
-
-    fuchsia_hardware_skipblock_SkipBlockWrite(caller.borrow_channel(), &operation, &status,
-                                              &bad_block_grown);
-    if (status != ZX_OK) {
-        ERROR("Error writing partition data: %s\n", zx_status_get_string(status));
-        return status;
-    }
-    return ZX_OK;
-}
-
 // Checks first few bytes of buffer to ensure it is a ZBI.
 // Also validates architecture in kernel header matches the target.
 bool ValidateKernelZbi(const uint8_t* buffer, size_t size, Arch arch) {
@@ -342,18 +258,20 @@ bool ValidateKernelZbi(const uint8_t* buffer, size_t size, Arch arch) {
 }
 
 // Parses a partition and validates that it matches the expected format.
-zx_status_t ValidateKernelPayload(const fzl::ResizeableVmoMapper& mapper, size_t vmo_size,
-                                  Partition partition_type, Arch arch) {
+//
+// The payload is validated before any of it is written, so |buffer| holds only its first |size|
+// bytes.
+zx_status_t ValidateKernelPayload(const uint8_t* buffer, size_t size, Partition partition_type,
+                                  Arch arch) {
     // TODO(surajmalhotra): Re-enable this as soon as we have a good way to
     // determine whether the payload is signed or not. (Might require bootserver
     // changes).
     if (false) {
-        const auto* buffer = reinterpret_cast<uint8_t*>(mapper.start());
         switch (partition_type) {
         case Partition::kZirconA:
         case Partition::kZirconB:
         case Partition::kZirconR:
-            if (!ValidateKernelZbi(buffer, vmo_size, arch)) {
+            if (!ValidateKernelZbi(buffer, size, arch)) {
                 ERROR("Invalid ZBI payload!");
                 return ZX_ERR_BAD_STATE;
             }
@@ -369,6 +287,219 @@ zx_status_t ValidateKernelPayload(const fzl::ResizeableVmoMapper& mapper, size_t
     return ZX_OK;
 }
 
+// A raw (non-FVM) payload is streamed to its partition through kStreamChunkCount buffers of
+// kStreamChunkSize bytes: while one chunk of the payload is written to the partition by a writer
+// thread, the next is read into another buffer. This bounds the memory needed to pave a partition,
+// and overlaps reading the payload with writing it.
+constexpr size_t kStreamChunkSize = 4 << 20;
+constexpr size_t kStreamChunkCount = 2;
+
+// Each chunk has a VMO of its own, so that every write starts at offset zero in its VMO.
+struct StreamChunk {
+    zx::vmo vmo;
+    fzl::VmoMapper mapper;
+    vmoid_t vmoid;
+};
+
+// Writes the first |length| bytes of |chunk| to |dev_offset| bytes into the partition. Both are
+// multiples of the partition's block size.
+using ChunkWriter = fbl::Function<zx_status_t(const StreamChunk& chunk, size_t dev_offset,
+                                              size_t length)>;
+
+// Runs a thread which writes the chunks handed to it, one at a time.
+class PayloadWriter {
+public:
+    explicit PayloadWriter(ChunkWriter write) : write_(std::move(write)) {
+        sync_completion_signal(&idle_);
+    }
+    ~PayloadWriter() { Finish(); }
+
+    zx_status_t Start() {
+        if (thrd_create_with_name(&thread_, Run, this, "pave-writer") != thrd_success) {
+            return ZX_ERR_NO_RESOURCES;
+        }
+        running_ = true;
+        return ZX_OK;
+    }
+
+    // Waits for the previous chunk to be written, and then hands over |chunk|. Returns the
+    // error of an earlier write, if any, in which case |chunk| is not written.
+    zx_status_t Write(const StreamChunk* chunk, size_t dev_offset, size_t length) {
+        ZX_DEBUG_ASSERT(length > 0);
+        sync_completion_wait(&idle_, ZX_TIME_INFINITE);
+        if (status_ != ZX_OK) {
+            return status_;
+        }
+        sync_completion_reset(&idle_);
+        job_ = {chunk, dev_offset, length};
+        sync_completion_signal(&work_);
+        return ZX_OK;
+    }
+
+    // Waits for the last chunk to be written, stops the thread, and returns the first error of
+    // any write.
+    zx_status_t Finish() {
+        if (!running_) {
+            return status_;
+        }
+        sync_completion_wait(&idle_, ZX_TIME_INFINITE);
+        job_ = {nullptr, 0, 0};
+        sync_completion_signal(&work_);
+        thrd_join(thread_, nullptr);
+        running_ = false;
+        return status_;
+    }
+
+private:
+    DISALLOW_COPY_ASSIGN_AND_MOVE(PayloadWriter);
+
+    struct Job {
+        const StreamChunk* chunk;
+        size_t dev_offset;
+        size_t length;
+    };
+
+    static int Run(void* arg) {
+        auto* writer = static_cast<PayloadWriter*>(arg);
+        for (;;) {
+            sync_completion_wait(&writer->work_, ZX_TIME_INFINITE);
+            sync_completion_reset(&writer->work_);
+            const Job job = writer->job_;
+            if (job.chunk == nullptr) {
+                return 0;
+            }
+            writer->status_ = writer->write_(*job.chunk, job.dev_offset, job.length);
+            sync_completion_signal(&writer->idle_);
+        }
+    }
+
+    ChunkWriter write_;
+    thrd_t thread_;
+    bool running_ = false;
+
+    // Handed between the threads by |work_| and |idle_|.
+    Job job_ = {};
+    zx_status_t status_ = ZX_OK;
+
+    // Signaled when |job_| holds a chunk to write.
+    sync_completion_t work_;
+    // Signaled when the writer thread is not writing a chunk.
+    sync_completion_t idle_;
+};
+
+// Streams a raw (non-FVM) payload from |src_fd| to its partition through |chunks|, zero-padding
+// the last chunk to a multiple of |block_size_bytes|, and logs the SHA-256 digest of the payload.
+zx_status_t StreamPayloadToPartition(StreamChunk* chunks, size_t chunk_size,
+                                     const fbl::unique_fd& src_fd, uint32_t block_size_bytes,
+                                     Partition partition_type, Arch arch, ChunkWriter write) {
+    ZX_DEBUG_ASSERT(chunk_size % block_size_bytes == 0);
+
+    digest::Digest digest;
+    zx_status_t status;
+    if ((status = digest.Init()) != ZX_OK) {
+        ERROR("Failed to initialize payload digest\n");
+        return status;
+    }
+
+    PayloadWriter writer(std::move(write));
+    if ((status = writer.Start()) != ZX_OK) {
+        ERROR("Failed to start payload writer thread\n");
+        return status;
+    }
+
+    size_t payload_size = 0;
+    bool done = false;
+    for (size_t c = 0; !done; c = (c + 1) % kStreamChunkCount) {
+        // |writer| is done with this chunk: the last one handed to it was the previous chunk.
+        auto* buffer = reinterpret_cast<uint8_t*>(chunks[c].mapper.start());
+        size_t length = 0;
+        while (length < chunk_size) {
+            ssize_t r = read(src_fd.get(), &buffer[length], chunk_size - length);
+            if (r < 0) {
+                ERROR("Error reading partition data\n");
+                return static_cast<zx_status_t>(r);
+            } else if (r == 0) {
+                done = true;
+                break;
+            }
+            length += r;
+        }
+        if (length == 0) {
+            break;
+        }
+
+        if (payload_size == 0 &&
+            (status = ValidateKernelPayload(buffer, length, partition_type, arch)) != ZX_OK) {
+            ERROR("Failed to validate partition\n");
+            return status;
+        }
+        digest.Update(buffer, length);
+
+        const size_t dev_offset = payload_size;
+        payload_size += length;
+        if (length % block_size_bytes) {
+            // We have a partial block to write.
+            const size_t rounded_length = fbl::round_up(length, block_size_bytes);
+            memset(&buffer[length], 0, rounded_length - length);
+            length = rounded_length;
+        }
+        if ((status = writer.Write(&chunks[c], dev_offset, length)) != ZX_OK) {
+            ERROR("Error writing partition data: %s\n", zx_status_get_string(status));
+            return status;
+        }
+    }
+    if ((status = writer.Finish()) != ZX_OK) {
+        ERROR("Error writing partition data: %s\n", zx_status_get_string(status));
+        return status;
+    }
+
+    char hex[digest::Digest::kLength * 2 + 1];
+    digest.Final();
+    digest.ToString(hex, sizeof(hex));
+    LOG("Wrote %zu bytes, SHA-256 %s\n", payload_size, hex);
+    return ZX_OK;
+}
+
+// Returns a ChunkWriter which writes chunks to a block device over |client|.
+ChunkWriter BlockChunkWriter(const block_client::Client& client, uint32_t block_size_bytes) {
+    return [&client, block_size_bytes](const StreamChunk& chunk, size_t dev_offset,
+                                       size_t length) {
+        block_fifo_request_t request;
+        request.group = 0;
+        request.vmoid = chunk.vmoid;
+        request.opcode = BLOCKIO_WRITE;
+        request.length = static_cast<uint32_t>(length / block_size_bytes);
+        request.vmo_offset = 0;
+        request.dev_offset = dev_offset / block_size_bytes;
+        return client.Transaction(&request, 1);
+    };
+}
+
+// Returns a ChunkWriter which writes chunks to a skip-block device through |caller|.
+ChunkWriter SkipBlockChunkWriter(const fzl::FdioCaller& caller, uint32_t block_size_bytes) {
+    return [&caller, block_size_bytes](const StreamChunk& chunk, size_t dev_offset,
+                                       size_t length) {
+        zx::vmo dup;
+        zx_status_t status;
+        if ((status = chunk.vmo.duplicate(ZX_RIGHT_SAME_RIGHTS, &dup)) != ZX_OK) {
+            ERROR("Couldn't duplicate buffer vmo\n");
+            return status;
+        }
+
+        fuchsia_hardware_skipblock_ReadWriteOperation operation = {
+            .vmo = dup.release(),
+            .vmo_offset = 0,
+            .block = static_cast<uint32_t>(dev_offset / block_size_bytes),
+            .block_count = static_cast<uint32_t>(length / block_size_bytes),
+        };
+        bool bad_block_grown;
+
+        fuchsia_hardware_skipblock_SkipBlockWrite(caller.borrow_channel(), &operation, &status,
+                                                  &bad_block_grown);
+        return status;
+    };
+}
+
 // Attempt to bind an FVM driver to a partition fd.
 fbl::unique_fd TryBindToFvmDriver(const fbl::unique_fd& partition_fd,
                                   zx::duration timeout) {
@@ -897,32 +1028,40 @@ zx_status_t PartitionPave(fbl::unique_ptr<DevicePartitioner> partitioner,
         return status;
     }
 
-    const size_t vmo_sz = fbl::round_up(1LU << 20, block_size_bytes);
-    fzl::ResizeableVmoMapper mapper;
-    if ((status = mapper.CreateAndMap(vmo_sz, "partition-pave")) != ZX_OK) {
-        ERROR("Failed to create stream VMO\n");
-        return status;
-    }
-    // The streamed partition size may not line up with the mapped vmo size.
-    size_t payload_size = 0;
-    if ((status = StreamPayloadToVmo(mapper, payload_fd, block_size_bytes,
-                                     &payload_size)) != ZX_OK) {
-        ERROR("Failed to stream partition to VMO\n");
-        return status;
-    }
-    if ((status = ValidateKernelPayload(mapper, payload_size, partition_type, arch)) != ZX_OK) {
-        ERROR("Failed to validate partition\n");
-        return status;
+    const size_t chunk_size = fbl::round_up(kStreamChunkSize, block_size_bytes);
+    StreamChunk chunks[kStreamChunkCount];
+    for (StreamChunk& chunk : chunks) {
+        if ((status = chunk.mapper.CreateAndMap(chunk_size, ZX_VM_PERM_READ | ZX_VM_PERM_WRITE,
+                                                nullptr, &chunk.vmo)) != ZX_OK) {
+            ERROR("Failed to create stream VMO\n");
+            return status;
+        }
     }
+
     if (partitioner->UseSkipBlockInterface()) {
         fzl::FdioCaller caller(std::move(partition_fd));
-        status = WriteVmoToSkipBlock(mapper.vmo(), payload_size, caller, block_size_bytes);
+        status = StreamPayloadToPartition(chunks, chunk_size, payload_fd, block_size_bytes,
+                                          partition_type, arch,
+                                          SkipBlockChunkWriter(caller, block_size_bytes));
         partition_fd = caller.release();
     } else {
-        status = WriteVmoToBlock(mapper.vmo(), payload_size, partition_fd, block_size_bytes);
+        block_client::Client client;
+        if ((status = RegisterFastBlockIo(partition_fd, chunks[0].vmo, &chunks[0].vmoid,
+                                          &client)) != ZX_OK) {
+            ERROR("Cannot register fast block I/O\n");
+            return status;
+        }
+        for (size_t c = 1; c < kStreamChunkCount; c++) {
+            if ((status = AttachVmo(partition_fd, chunks[c].vmo, &chunks[c].vmoid)) != ZX_OK) {
+                return status;
+            }
+        }
+        status = StreamPayloadToPartition(chunks, chunk_size, payload_fd, block_size_bytes,
+                                          partition_type, arch,
+                                          BlockChunkWriter(client, block_size_bytes));
     }
     if (status != ZX_OK) {
-        ERROR("Failed to write partition to block\n");
+        ERROR("Failed to stream partition\n");
         return status;
     }
 
@@ -83,6 +83,7 @@ zx_status_t get_kmem_stats(zx_info_kmem_stats_t* kmem_stats) {
 void print_help(char** argv, FILE* f) {
     fprintf(f, "Usage: %s [options]\n", argv[0]);
     fprintf(f, "options:\n");
+    fprintf(f, "\t-b:                   run each test's benchmark once and exit\n");
     fprintf(f, "\t-h:                   This help\n");
     fprintf(f, "\t-t [time in seconds]: stop all tests after the time has elapsed\n");
     fprintf(f, "\t-v:                   verbose, status output\n");
@@ -94,11 +95,15 @@ int main(int argc, char** argv) {
     zx_status_t status;
 
     bool verbose = false;
+    bool benchmark = false;
     zx::duration run_duration = zx::duration::infinite();
 
     int c;
-    while ((c = getopt(argc, argv, "ht:v")) > 0) {
+    while ((c = getopt(argc, argv, "bht:v")) > 0) {
         switch (c) {
+        case 'b':
+            benchmark = true;
+            break;
         case 'h':
             print_help(argv, stdout);
             return 0;
@@ -130,6 +135,27 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    if (benchmark) {
+        for (auto& test : StressTest::tests()) {
+            printf("Initializing %s test\n", test->name());
+            status = test->Init(verbose, kmem_stats);
+            if (status != ZX_OK) {
+                fprintf(stderr, "error initializing test\n");
+                return 1;
+            }
+
+            printf("Benchmarking %s\n", test->name());
+            status = test->Benchmark();
+            if (status == ZX_ERR_NOT_SUPPORTED) {
+                printf("%s has no benchmark\n", test->name());
+            } else if (status != ZX_OK) {
+                fprintf(stderr, "error running benchmark: %s\n", zx_status_get_string(status));
+                return 1;
+            }
+        }
+        return 0;
+    }
+
     if (run_duration != zx::duration::infinite()) {
         printf("Running stress tests for %" PRIu64 " seconds\n", run_duration.to_secs());
     } else {
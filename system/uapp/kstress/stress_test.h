@@ -42,6 +42,11 @@ public:
     // been shut down.
     virtual zx_status_t Stop() = 0;
 
+    // Called instead of Start()/Stop() when running in benchmark mode. Runs a
+    // fixed workload to completion and prints its results. Tests without a
+    // benchmark return ZX_ERR_NOT_SUPPORTED.
+    virtual zx_status_t Benchmark() { return ZX_ERR_NOT_SUPPORTED; }
+
     // Return the name of the test in C string format
     virtual const char* name() const = 0;
 
@@ -7,6 +7,7 @@
 #include <fbl/ref_ptr.h>
 #include <fbl/unique_ptr.h>
 #include <lib/zx/thread.h>
+#include <lib/zx/time.h>
 #include <lib/zx/vmar.h>
 #include <lib/zx/vmo.h>
 #include <zircon/status.h>
@@ -34,11 +35,13 @@ public:
 
     virtual zx_status_t Start();
     virtual zx_status_t Stop();
+    virtual zx_status_t Benchmark();
 
     virtual const char* name() const { return "VM Stress"; }
 
 private:
     int stress_thread();
+    zx_status_t commit_benchmark(uint32_t num_threads);
 
     thrd_t threads_[16]{};
 
@@ -210,3 +213,102 @@ zx_status_t VmStressTest::Stop() {
 
     return ZX_OK;
 }
+
+// Commit/Decommit Benchmark
+//
+// Every worker thread owns a private VMO and repeatedly commits and decommits
+// all of it for a fixed amount of time. Since the VMOs are not shared the
+// only thing the workers contend on is the kernel's physical page allocator,
+// so the aggregate pages/sec as the number of threads grows shows how well
+// page allocation scales with cores.
+zx_status_t VmStressTest::commit_benchmark(uint32_t num_threads) {
+    constexpr uint64_t kVmoSize = 4 * 1024 * 1024;
+    constexpr zx::duration kRunTime = zx::sec(2);
+
+    struct Worker {
+        zx::vmo vmo;
+        thrd_t thread;
+        uint64_t pages;
+        zx_status_t status;
+        const std::atomic<bool>* stop;
+    };
+
+    fbl::unique_ptr<Worker[]> workers{new Worker[num_threads]{}};
+    std::atomic<bool> stop{false};
+
+    for (uint32_t i = 0; i < num_threads; i++) {
+        auto status = zx::vmo::create(kVmoSize, 0, &workers[i].vmo);
+        if (status != ZX_OK) {
+            return status;
+        }
+        workers[i].stop = &stop;
+    }
+
+    auto worker = [](void* arg) -> int {
+        Worker* w = static_cast<Worker*>(arg);
+        while (!w->stop->load()) {
+            w->status = w->vmo.op_range(ZX_VMO_OP_COMMIT, 0, kVmoSize, nullptr, 0);
+            if (w->status != ZX_OK) {
+                break;
+            }
+            w->status = w->vmo.op_range(ZX_VMO_OP_DECOMMIT, 0, kVmoSize, nullptr, 0);
+            if (w->status != ZX_OK) {
+                break;
+            }
+            w->pages += kVmoSize / PAGE_SIZE;
+        }
+        return 0;
+    };
+
+    zx::time start = zx::clock::get_monotonic();
+    for (uint32_t i = 0; i < num_threads; i++) {
+        if (thrd_create_with_name(&workers[i].thread, worker, &workers[i], "vmstress_bench") !=
+            thrd_success) {
+            fprintf(stderr, "failed to create benchmark thread %u of %u\n", i, num_threads);
+            stop.store(true);
+            for (uint32_t j = 0; j < i; j++) {
+                thrd_join(workers[j].thread, nullptr);
+            }
+            return ZX_ERR_NO_RESOURCES;
+        }
+    }
+
+    zx::nanosleep(zx::deadline_after(kRunTime));
+    stop.store(true);
+
+    uint64_t total_pages = 0;
+    zx_status_t status = ZX_OK;
+    for (uint32_t i = 0; i < num_threads; i++) {
+        thrd_join(workers[i].thread, nullptr);
+        total_pages += workers[i].pages;
+        if (workers[i].status != ZX_OK) {
+            status = workers[i].status;
+        }
+    }
+    zx::duration elapsed = zx::clock::get_monotonic() - start;
+
+    if (status != ZX_OK) {
+        fprintf(stderr, "commit/decommit failed, error %d (%s)\n",
+                status, zx_status_get_string(status));
+        return status;
+    }
+
+    const uint64_t pages_per_sec = total_pages * ZX_SEC(1) / elapsed.get();
+    PrintfAlways("%2u threads: %10" PRIu64 " pages/sec committed+decommitted, "
+                 "%10" PRIu64 " pages/sec per thread\n",
+                 num_threads, pages_per_sec, pages_per_sec / num_threads);
+    return ZX_OK;
+}
+
+zx_status_t VmStressTest::Benchmark() {
+    for (uint32_t num_threads = 1;; num_threads = fbl::min(num_threads * 2, num_cpus_)) {
+        zx_status_t status = commit_benchmark(num_threads);
+        if (status != ZX_OK) {
+            return status;
+        }
+        if (num_threads >= num_cpus_) {
+            break;
+        }
+    }
+    return ZX_OK;
+}
@@ -156,8 +156,27 @@ total submitted blocks written: %zu
            stats.total_blocks_read, stats.total_writes, stats.total_blocks_written);
 }
 
+void PrintSchedulerMetrics(const block_sched_stats_t& stats) {
+    double average_depth = stats.total_ops == 0
+                               ? 0
+                               : static_cast<double>(stats.queue_depth_sum) /
+                                     static_cast<double>(stats.total_ops);
+    printf(R"(
+Block I/O scheduler metrics
+requests dispatched:            %zu
+requests merged:                %zu
+operations dispatched:          %zu
+average queue depth:            %.1f
+maximum queue depth:            %zu
+times throttled:                %zu
+)",
+           stats.total_requests, stats.merged_requests, stats.total_ops, average_depth,
+           stats.max_queue_depth, stats.throttled);
+}
+
 // Retrieves metrics for the block device at dev. Clears metrics if clear is true.
-zx_status_t GetBlockMetrics(const char* dev, bool clear, block_stats_t* stats) {
+zx_status_t GetBlockMetrics(const char* dev, bool clear, block_stats_t* stats,
+                            block_sched_stats_t* sched_stats) {
     fbl::unique_fd fd(open(dev, O_RDONLY));
     if (!fd) {
         fprintf(stderr, "Error opening %s, errno %d (%s)\n", dev, errno, strerror(errno));
@@ -168,6 +187,11 @@ zx_status_t GetBlockMetrics(const char* dev, bool clear, block_stats_t* stats) {
         fprintf(stderr, "Error getting stats for %s\n", dev);
         return static_cast<zx_status_t>(rc);
     }
+    rc = ioctl_block_get_sched_stats(fd.get(), &clear, sched_stats);
+    if (rc < 0) {
+        fprintf(stderr, "Error getting scheduler stats for %s\n", dev);
+        return static_cast<zx_status_t>(rc);
+    }
     return ZX_OK;
 }
 
@@ -287,10 +311,12 @@ void RunBlockMetrics(const fbl::StringBuffer<PATH_MAX> path, const StorageMetric
 
     zx_status_t rc;
     block_stats_t stats;
+    block_sched_stats_t sched_stats;
     if (device_path != nullptr) {
-        rc = GetBlockMetrics(device_path, options.clear_block, &stats);
+        rc = GetBlockMetrics(device_path, options.clear_block, &stats, &sched_stats);
         if (rc == ZX_OK) {
             PrintBlockMetrics(device_path, stats);
+            PrintSchedulerMetrics(sched_stats);
         } else {
             fprintf(stderr, "storage-metrics could not retrieve block metrics for %s,"
                             " status %d\n",
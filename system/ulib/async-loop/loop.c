@@ -26,6 +26,12 @@
 // The port wait key associated with the dispatcher's control messages.
 #define KEY_CONTROL (0u)
 
+// The most packets read from the port by a single wait.
+#define BATCH_SIZE (16u)
+
+// The number of entries the pending task heap starts out with room for.
+#define TASK_HEAP_INITIAL_CAPACITY (16u)
+
 static zx_time_t async_loop_now(async_dispatcher_t* dispatcher);
 static zx_status_t async_loop_begin_wait(async_dispatcher_t* dispatcher, async_wait_t* wait);
 static zx_status_t async_loop_cancel_wait(async_dispatcher_t* dispatcher, async_wait_t* wait);
@@ -69,6 +75,15 @@ typedef struct thread_record {
     thrd_t thread;
 } thread_record_t;
 
+// An entry of the pending task heap.  The deadline is copied out of the task so
+// that sifting does not touch the tasks themselves, and the sequence number
+// keeps tasks with equal deadlines in the order they were posted.
+typedef struct task_heap_entry {
+    zx_time_t deadline;
+    uint64_t sequence;
+    async_task_t* task;
+} task_heap_entry_t;
+
 const async_loop_config_t kAsyncLoopConfigAttachToThread = {
     .make_default_for_current_thread = true};
 const async_loop_config_t kAsyncLoopConfigNoAttachToThread = {
@@ -86,13 +101,29 @@ typedef struct async_loop {
     mtx_t lock; // guards the lists and the dispatching tasks flag
     bool dispatching_tasks; // true while the loop is busy dispatching tasks
     list_node_t wait_list; // most recently added first
-    list_node_t task_list; // pending tasks, earliest deadline first
+    // Pending tasks, as a binary min-heap ordered by deadline and then by
+    // posting order.  See |async_loop_insert_task_locked|.
+    task_heap_entry_t* task_heap;
+    size_t task_count;
+    size_t task_capacity;
+    uint64_t task_sequence; // sequence number of the next task posted
     list_node_t due_list; // due tasks, earliest deadline first
     list_node_t thread_list; // earliest created thread first
     list_node_t exception_list; // most recently added first
+
+    // Packets read from the port by a single wait but not yet dispatched.
+    // |batch_pending| may be read without the lock as a hint.
+    bool batch_reading; // true while a thread is reading a batch into |batch|
+    size_t batch_head; // index of the next packet to dispatch
+    size_t batch_count; // index past the last packet to dispatch
+    atomic_size_t batch_pending; // batch_count - batch_head
+    zx_port_packet_t batch[BATCH_SIZE];
 } async_loop_t;
 
 static zx_status_t async_loop_run_once(async_loop_t* loop, zx_time_t deadline);
+static zx_status_t async_loop_read_packet(async_loop_t* loop, zx_time_t deadline,
+                                          zx_port_packet_t* out_packet);
+static bool async_loop_cancel_batched_packets_locked(async_loop_t* loop, uint64_t key);
 static zx_status_t async_loop_dispatch_wait(async_loop_t* loop, async_wait_t* wait,
                                             zx_status_t status, const zx_packet_signal_t* signal);
 static zx_status_t async_loop_dispatch_tasks(async_loop_t* loop);
@@ -109,7 +140,8 @@ static zx_status_t async_loop_dispatch_exception(async_loop_t* loop,
                                                  zx_status_t status,
                                                  const zx_port_packet_t* report);
 static void async_loop_wake_threads(async_loop_t* loop);
-static void async_loop_insert_task_locked(async_loop_t* loop, async_task_t* task);
+static zx_status_t async_loop_insert_task_locked(async_loop_t* loop, async_task_t* task);
+static async_task_t* async_loop_remove_task_locked(async_loop_t* loop, size_t index);
 static void async_loop_restart_timer_locked(async_loop_t* loop);
 static void async_loop_invoke_prologue(async_loop_t* loop);
 static void async_loop_invoke_epilogue(async_loop_t* loop);
@@ -153,12 +185,12 @@ zx_status_t async_loop_create(const async_loop_config_t* config, async_loop_t**
         return ZX_ERR_NO_MEMORY;
     atomic_init(&loop->state, ASYNC_LOOP_RUNNABLE);
     atomic_init(&loop->active_threads, 0u);
+    atomic_init(&loop->batch_pending, 0u);
 
     loop->dispatcher.ops = &async_loop_ops;
     loop->config = *config;
     mtx_init(&loop->lock, mtx_plain);
     list_initialize(&loop->wait_list);
-    list_initialize(&loop->task_list);
     list_initialize(&loop->due_list);
     list_initialize(&loop->thread_list);
     list_initialize(&loop->exception_list);
@@ -192,6 +224,7 @@ void async_loop_destroy(async_loop_t* loop) {
     zx_handle_close(loop->port);
     zx_handle_close(loop->timer);
     mtx_destroy(&loop->lock);
+    free(loop->task_heap);
     free(loop);
 }
 
@@ -216,14 +249,19 @@ void async_loop_shutdown(async_loop_t* loop) {
         async_task_t* task = node_to_task(node);
         async_loop_dispatch_task(loop, task, ZX_ERR_CANCELED);
     }
-    while ((node = list_remove_head(&loop->task_list))) {
-        async_task_t* task = node_to_task(node);
+    while (loop->task_count) {
+        async_task_t* task = async_loop_remove_task_locked(loop, 0u);
         async_loop_dispatch_task(loop, task, ZX_ERR_CANCELED);
     }
     while ((node = list_remove_head(&loop->exception_list))) {
         async_exception_t* exception = node_to_exception(node);
         async_loop_dispatch_exception(loop, exception, ZX_ERR_CANCELED, NULL);
     }
+    // Every packet left in the batch belongs to a wait or exception which has
+    // just been canceled, or to a receiver, whose packets are discarded with
+    // the port.
+    loop->batch_head = loop->batch_count = 0u;
+    atomic_store_explicit(&loop->batch_pending, 0u, memory_order_release);
 
     if (loop->config.make_default_for_current_thread) {
         ZX_DEBUG_ASSERT(async_get_default_dispatcher() == &loop->dispatcher);
@@ -259,7 +297,7 @@ static zx_status_t async_loop_run_once(async_loop_t* loop, zx_time_t deadline) {
         return ZX_ERR_CANCELED;
 
     zx_port_packet_t packet;
-    zx_status_t status = zx_port_wait(loop->port, deadline, &packet);
+    zx_status_t status = async_loop_read_packet(loop, deadline, &packet);
     if (status != ZX_OK)
         return status;
 
@@ -308,6 +346,71 @@ static zx_status_t async_loop_run_once(async_loop_t* loop, zx_time_t deadline) {
     return ZX_ERR_INTERNAL;
 }
 
+static zx_status_t async_loop_read_packet(async_loop_t* loop, zx_time_t deadline,
+                                          zx_port_packet_t* out_packet) {
+    // Take the next packet of the last batch, if any remain.
+    if (atomic_load_explicit(&loop->batch_pending, memory_order_acquire) != 0u) {
+        bool found = false;
+        mtx_lock(&loop->lock);
+        if (loop->batch_head != loop->batch_count) {
+            *out_packet = loop->batch[loop->batch_head++];
+            atomic_store_explicit(&loop->batch_pending, loop->batch_count - loop->batch_head,
+                                  memory_order_release);
+            found = true;
+        }
+        mtx_unlock(&loop->lock);
+        if (found)
+            return ZX_OK;
+    }
+
+    // Read a batch of packets only while a single thread is running the loop.
+    // Other threads block in |port_wait| rather than taking packets from the
+    // batch, so batching would serialize work that they could share.
+    bool batch = false;
+    if (atomic_load_explicit(&loop->active_threads, memory_order_acquire) == 1u) {
+        mtx_lock(&loop->lock);
+        if (!loop->batch_reading && loop->batch_head == loop->batch_count) {
+            loop->batch_reading = true;
+            loop->batch_head = loop->batch_count = 0u;
+            batch = true;
+        }
+        mtx_unlock(&loop->lock);
+    }
+    if (!batch)
+        return zx_port_wait(loop->port, deadline, out_packet);
+
+    // The batch is empty and only this thread fills it, so it may be written
+    // without holding the lock.
+    size_t actual = 0u;
+    zx_status_t status = zx_port_wait_many(loop->port, deadline, loop->batch, BATCH_SIZE,
+                                           &actual);
+    mtx_lock(&loop->lock);
+    loop->batch_reading = false;
+    if (status == ZX_OK) {
+        *out_packet = loop->batch[0];
+        loop->batch_head = 1u;
+        loop->batch_count = actual;
+        atomic_store_explicit(&loop->batch_pending, actual - 1u, memory_order_release);
+    }
+    mtx_unlock(&loop->lock);
+    return status;
+}
+
+// Removes every packet with |key| from the last batch, so that it is not
+// dispatched after its wait or exception port has been canceled.
+static bool async_loop_cancel_batched_packets_locked(async_loop_t* loop, uint64_t key) {
+    size_t count = loop->batch_head;
+    for (size_t i = loop->batch_head; i < loop->batch_count; i++) {
+        if (loop->batch[i].key != key)
+            loop->batch[count++] = loop->batch[i];
+    }
+    bool removed = count != loop->batch_count;
+    loop->batch_count = count;
+    atomic_store_explicit(&loop->batch_pending, loop->batch_count - loop->batch_head,
+                          memory_order_release);
+    return removed;
+}
+
 async_dispatcher_t* async_loop_get_dispatcher(async_loop_t* loop) {
     // Note: The loop's implementation inherits from async_t so we can upcast to it.
     return (async_dispatcher_t*)loop;
@@ -350,20 +453,9 @@ static zx_status_t async_loop_dispatch_tasks(async_loop_t* loop) {
         list_node_t* node;
         if (list_is_empty(&loop->due_list)) {
             zx_time_t due_time = async_loop_now((async_dispatcher_t*)loop);
-            list_node_t* tail = NULL;
-            list_for_every(&loop->task_list, node) {
-                if (node_to_task(node)->deadline > due_time)
-                    break;
-                tail = node;
-            }
-            if (tail) {
-                list_node_t* head = loop->task_list.next;
-                loop->task_list.next = tail->next;
-                tail->next->prev = &loop->task_list;
-                loop->due_list.next = head;
-                head->prev = &loop->due_list;
-                loop->due_list.prev = tail;
-                tail->next = &loop->due_list;
+            while (loop->task_count && loop->task_heap[0].deadline <= due_time) {
+                async_task_t* task = async_loop_remove_task_locked(loop, 0u);
+                list_add_tail(&loop->due_list, task_to_node(task));
             }
         }
 
@@ -525,9 +617,13 @@ static zx_status_t async_loop_cancel_wait(async_dispatcher_t* async, async_wait_
 
     // Next, cancel the wait.  This may be racing with another thread that
     // has read the wait's packet but not yet dispatched it.  So if we fail
-    // to cancel then we assume we lost the race.
+    // to cancel then we assume we lost the race.  The packet may also have
+    // been read as part of a batch which has not been dispatched yet.
     zx_status_t status = zx_port_cancel(loop->port, wait->object,
                                         (uintptr_t)wait);
+    if (status == ZX_ERR_NOT_FOUND &&
+        async_loop_cancel_batched_packets_locked(loop, (uintptr_t)wait))
+        status = ZX_OK;
     if (status == ZX_OK) {
         list_delete(node);
     } else {
@@ -549,15 +645,15 @@ static zx_status_t async_loop_post_task(async_dispatcher_t* async, async_task_t*
 
     mtx_lock(&loop->lock);
 
-    async_loop_insert_task_locked(loop, task);
-    if (!loop->dispatching_tasks &&
-        task_to_node(task)->prev == &loop->task_list) {
+    zx_status_t status = async_loop_insert_task_locked(loop, task);
+    if (status == ZX_OK && !loop->dispatching_tasks &&
+        loop->task_heap[0].task == task) {
         // Task inserted at head.  Earliest deadline changed.
         async_loop_restart_timer_locked(loop);
     }
 
     mtx_unlock(&loop->lock);
-    return ZX_OK;
+    return status;
 }
 
 static zx_status_t async_loop_cancel_task(async_dispatcher_t* async, async_task_t* task) {
@@ -569,24 +665,26 @@ static zx_status_t async_loop_cancel_task(async_dispatcher_t* async, async_task_
     // destroyed in case the client is counting on the handler not being
     // invoked again past this point.  Also, the task we're removing here
     // might be present in the dispatcher's |due_list| if it is pending
-    // dispatch instead of in the loop's |task_list| as usual.  The same
-    // logic works in both cases.
+    // dispatch instead of in the loop's |task_heap| as usual.
 
     mtx_lock(&loop->lock);
-    list_node_t* node = task_to_node(task);
-    if (!list_in_list(node)) {
+    if (task->state.reserved[1] != (uintptr_t)loop) {
+        list_node_t* node = task_to_node(task);
+        if (!list_in_list(node)) {
+            mtx_unlock(&loop->lock);
+            return ZX_ERR_NOT_FOUND;
+        }
+        list_delete(node);
         mtx_unlock(&loop->lock);
-        return ZX_ERR_NOT_FOUND;
+        return ZX_OK;
     }
 
     // Determine whether the head task was canceled and following task has
     // a later deadline.  If so, we will bump the timer along to that deadline.
-    bool must_restart = !loop->dispatching_tasks &&
-                        node->prev == &loop->task_list &&
-                        node->next != &loop->task_list &&
-                        node_to_task(node->next)->deadline > task->deadline;
-    list_delete(node);
-    if (must_restart)
+    size_t index = task->state.reserved[0];
+    async_loop_remove_task_locked(loop, index);
+    if (!loop->dispatching_tasks && index == 0u && loop->task_count &&
+        loop->task_heap[0].deadline > task->deadline)
         async_loop_restart_timer_locked(loop);
 
     mtx_unlock(&loop->lock);
@@ -681,6 +779,7 @@ static zx_status_t async_loop_unbind_exception_port(async_dispatcher_t* async,
 
     if (status == ZX_OK) {
         list_delete(node);
+        async_loop_cancel_batched_packets_locked(loop, key);
     }
 
     mtx_unlock(&loop->lock);
@@ -701,27 +800,102 @@ static zx_status_t async_loop_resume_from_exception(async_dispatcher_t* async,
     return zx_task_resume_from_exception(task, loop->port, options);
 }
 
-static void async_loop_insert_task_locked(async_loop_t* loop, async_task_t* task) {
-    // TODO(ZX-976): We assume that tasks are inserted in quasi-monotonic order and
-    // that insertion into the task queue will typically take no more than a few steps.
-    // If this assumption proves false and the cost of insertion becomes a problem, we
-    // should consider using a more efficient representation for maintaining order.
-    list_node_t* node;
-    for (node = loop->task_list.prev; node != &loop->task_list; node = node->prev) {
-        if (task->deadline >= node_to_task(node)->deadline)
+static inline bool task_heap_entry_less(const task_heap_entry_t* a,
+                                        const task_heap_entry_t* b) {
+    return a->deadline < b->deadline ||
+           (a->deadline == b->deadline && a->sequence < b->sequence);
+}
+
+// Stores |entry| at |index| of the heap and records the index in the task's
+// state.  While a task is in the heap, its state holds its index and the loop
+// itself.  The loop's address is never that of a list node, which is how
+// |async_loop_cancel_task| tells a task in the heap from one in |due_list|.
+static inline void task_heap_set(async_loop_t* loop, size_t index,
+                                 const task_heap_entry_t* entry) {
+    loop->task_heap[index] = *entry;
+    entry->task->state.reserved[0] = index;
+    entry->task->state.reserved[1] = (uintptr_t)loop;
+}
+
+// Moves |entry|, destined for the hole at |index|, towards the root of the heap
+// until the heap is ordered again.
+static void task_heap_sift_up(async_loop_t* loop, size_t index, task_heap_entry_t entry) {
+    while (index > 0u) {
+        size_t parent = (index - 1u) / 2u;
+        if (!task_heap_entry_less(&entry, &loop->task_heap[parent]))
+            break;
+        task_heap_set(loop, index, &loop->task_heap[parent]);
+        index = parent;
+    }
+    task_heap_set(loop, index, &entry);
+}
+
+// Moves |entry|, destined for the hole at |index|, towards the leaves of the
+// heap until the heap is ordered again.
+static void task_heap_sift_down(async_loop_t* loop, size_t index, task_heap_entry_t entry) {
+    for (;;) {
+        size_t child = 2u * index + 1u;
+        if (child >= loop->task_count)
             break;
+        if (child + 1u < loop->task_count &&
+            task_heap_entry_less(&loop->task_heap[child + 1u], &loop->task_heap[child]))
+            child++;
+        if (!task_heap_entry_less(&loop->task_heap[child], &entry))
+            break;
+        task_heap_set(loop, index, &loop->task_heap[child]);
+        index = child;
+    }
+    task_heap_set(loop, index, &entry);
+}
+
+// Adds |task| to the pending task heap in O(log n) time.  Returns
+// ZX_ERR_NO_MEMORY if the heap needed to grow and could not.
+static zx_status_t async_loop_insert_task_locked(async_loop_t* loop, async_task_t* task) {
+    if (loop->task_count == loop->task_capacity) {
+        size_t capacity = loop->task_capacity ? loop->task_capacity * 2u
+                                              : TASK_HEAP_INITIAL_CAPACITY;
+        task_heap_entry_t* heap = realloc(loop->task_heap, capacity * sizeof(*heap));
+        if (!heap)
+            return ZX_ERR_NO_MEMORY;
+        loop->task_heap = heap;
+        loop->task_capacity = capacity;
+    }
+
+    task_heap_entry_t entry = {
+        .deadline = task->deadline,
+        .sequence = loop->task_sequence++,
+        .task = task};
+    task_heap_sift_up(loop, loop->task_count++, entry);
+    return ZX_OK;
+}
+
+// Removes the task at |index| of the pending task heap in O(log n) time, and
+// returns it with its state cleared.
+static async_task_t* async_loop_remove_task_locked(async_loop_t* loop, size_t index) {
+    ZX_DEBUG_ASSERT(index < loop->task_count);
+
+    async_task_t* task = loop->task_heap[index].task;
+    task->state = (async_state_t)ASYNC_STATE_INIT;
+
+    // Fill the hole with the last entry, which may belong either above or
+    // below it.
+    task_heap_entry_t last = loop->task_heap[--loop->task_count];
+    if (index < loop->task_count) {
+        if (index > 0u && task_heap_entry_less(&last, &loop->task_heap[(index - 1u) / 2u])) {
+            task_heap_sift_up(loop, index, last);
+        } else {
+            task_heap_sift_down(loop, index, last);
+        }
     }
-    list_add_after(node, task_to_node(task));
+    return task;
 }
 
 static void async_loop_restart_timer_locked(async_loop_t* loop) {
     zx_time_t deadline;
     if (list_is_empty(&loop->due_list)) {
-        list_node_t* head = list_peek_head(&loop->task_list);
-        if (!head)
+        if (!loop->task_count)
             return;
-        async_task_t* task = node_to_task(head);
-        deadline = task->deadline;
+        deadline = loop->task_heap[0].deadline;
         if (deadline == ZX_TIME_INFINITE)
             return;
     } else {
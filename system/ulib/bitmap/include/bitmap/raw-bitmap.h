@@ -20,9 +20,12 @@ namespace bitmap {
 namespace internal {
 
 DECLARE_HAS_MEMBER_FN(has_grow, Grow);
+DECLARE_HAS_MEMBER_FN(has_summary, GetSummary);
 
 } // namespace internal
 
+class BitmapSummary;
+
 const size_t kBits = sizeof(size_t) * CHAR_BIT;
 
 // Translates a max bit into a final index in the bitmap array.
@@ -80,11 +83,23 @@ public:
     // Clear all bits in the bitmap.
     void ClearAll() override;
 
+    // Must be called after the underlying storage has been modified other
+    // than through this bitmap (for example, by reading it from disk), so
+    // that the summary of the storage (if any) is recomputed.
+    void StorageModified();
+
 protected:
+    // Returns the summary of the storage, rebuilding it if necessary, or
+    // nullptr if the storage is not summarized.
+    const BitmapSummary* GetValidSummary() const;
+
     // The size of this bitmap, in bits.
     size_t size_ = 0;
     // Owned by bits_, cached
     size_t* data_ = nullptr;
+    // Owned by bits_, cached. Only present for storage which provides
+    // GetSummary (such as SummaryStorage).
+    BitmapSummary* summary_ = nullptr;
 };
 
 // A simple bitmap backed by generic storage.
@@ -96,6 +111,9 @@ protected:
 //   - zx_status_t Grow(size_t size)
 //      (optional) To expand the underlying storage to fit at least |size|
 //      bytes.
+//   - BitmapSummary* GetSummary()
+//      (optional) To access a summary of the storage, which speeds up
+//      scanning large bitmaps.
 template <typename Storage>
 class RawBitmapGeneric final : public RawBitmapBase {
 public:
@@ -122,6 +140,8 @@ public:
         zx_status_t status = bits_.Grow(new_bitsize);
         if (status != ZX_OK) {
             return status;
+        } else if ((status = ResetSummary(new_len)) != ZX_OK) {
+            return status;
         }
 
         // Clear all the "newly grown" bytes
@@ -151,12 +171,15 @@ public:
         size_ = size;
         if (size_ == 0) {
             data_ = nullptr;
+            summary_ = nullptr;
             return ZX_OK;
         }
         size_t last_idx = LastIdx(size);
         zx_status_t status = bits_.Allocate(sizeof(size_t) * (last_idx + 1));
         if (status != ZX_OK) {
             return status;
+        } else if ((status = ResetSummary(last_idx + 1)) != ZX_OK) {
+            return status;
         }
         data_ = static_cast<size_t*>(bits_.GetData());
         ClearAll();
@@ -169,6 +192,21 @@ public:
     const Storage* StorageUnsafe() const { return &bits_; }
 
 private:
+    // Resizes the summary of the storage (if any) to describe |words| words.
+    template <typename U = Storage>
+    typename std::enable_if<internal::has_summary<U>::value, zx_status_t>::type
+    ResetSummary(size_t words) {
+        zx_status_t status = bits_.GetSummary()->Reset(words);
+        summary_ = (status == ZX_OK) ? bits_.GetSummary() : nullptr;
+        return status;
+    }
+
+    template <typename U = Storage>
+    typename std::enable_if<!internal::has_summary<U>::value, zx_status_t>::type
+    ResetSummary(size_t words) {
+        return ZX_OK;
+    }
+
     // The storage backing this bitmap.
     Storage bits_;
 };
@@ -10,10 +10,12 @@
 
 #include <zircon/process.h>
 #include <zircon/types.h>
+#include <bitmap/summary.h>
 #include <fbl/algorithm.h>
 #include <fbl/alloc_checker.h>
 #include <fbl/array.h>
 #include <fbl/macros.h>
+#include <fbl/unique_ptr.h>
 
 #if !defined _KERNEL && defined __Fuchsia__
 #include <lib/zx/vmo.h>
@@ -58,6 +60,32 @@ private:
     size_t storage_[(N + sizeof(size_t) - 1) / sizeof(size_t)];
 };
 
+// Adds a BitmapSummary to another kind of storage, which allows
+// RawBitmapGeneric to skip over entirely set or entirely clear regions when
+// scanning. This is worthwhile for large bitmaps which are mostly full, such
+// as filesystem allocation maps, at the cost of roughly 2/kBits of the size
+// of the storage and a little extra work in Set and Clear.
+//
+// The summary is allocated separately from the storage, so it does not move
+// if the storage is moved.
+template <typename Storage>
+class SummaryStorage : public Storage {
+public:
+    zx_status_t Allocate(size_t size) {
+        if (summary_ == nullptr) {
+            fbl::AllocChecker ac;
+            summary_.reset(new (&ac) BitmapSummary());
+            if (!ac.check()) {
+                return ZX_ERR_NO_MEMORY;
+            }
+        }
+        return Storage::Allocate(size);
+    }
+    BitmapSummary* GetSummary() { return summary_.get(); }
+private:
+    fbl::unique_ptr<BitmapSummary> summary_;
+};
+
 #if !defined _KERNEL && defined __Fuchsia__
 class VmoStorage {
 public:
@@ -0,0 +1,83 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <stddef.h>
+
+#include <fbl/array.h>
+#include <fbl/macros.h>
+#include <zircon/types.h>
+
+namespace bitmap {
+
+// A hierarchical summary of the words of a raw bitmap, which allows scans to
+// skip over runs of words which are entirely set or entirely clear.
+//
+// The summary consists of two trees: one marking "full" words (all bits set),
+// and one marking "empty" words (all bits clear). Level zero of each tree has
+// one bit per word of the bitmap; each level above it has one bit per word of
+// the level below, which is set if the entire word below is set. Each level
+// therefore lets a scan skip kBits times as much of the bitmap as the level
+// below it, so finding the next free bit of a mostly-full bitmap takes time
+// logarithmic (rather than linear) in the size of the bitmap.
+//
+// The summary is a cache of the bitmap's storage. It is kept up to date by
+// RawBitmapBase::Set and RawBitmapBase::Clear, and is rebuilt lazily after
+// the storage is modified in any other way.
+class BitmapSummary {
+public:
+    DISALLOW_COPY_ASSIGN_AND_MOVE(BitmapSummary);
+    BitmapSummary() = default;
+
+    // Resizes the summary to describe |words| words of storage, and marks it
+    // invalid.
+    zx_status_t Reset(size_t words);
+
+    bool valid() const { return valid_; }
+    void Invalidate() { valid_ = false; }
+
+    // Recomputes the entire summary from |data|, and marks it valid.
+    void Rebuild(const size_t* data);
+
+    // Recomputes the summary of words [first_idx, last_idx] of |data|. Does
+    // nothing while the summary is invalid.
+    void Update(const size_t* data, size_t first_idx, size_t last_idx);
+
+    // Returns the index of the first word in [idx, last_idx) which is not
+    // entirely |is_set|, or |last_idx| if every such word is.
+    size_t Skip(bool is_set, size_t idx, size_t last_idx) const;
+
+    // Returns the index of the last word in (first_idx, idx] which is not
+    // entirely |is_set|, or |first_idx| if every such word is.
+    size_t ReverseSkip(bool is_set, size_t first_idx, size_t idx) const;
+
+private:
+    // Enough levels to summarize kBits^kMaxLevels words.
+    static constexpr size_t kMaxLevels = 8;
+    using Tree = fbl::Array<size_t>[kMaxLevels];
+
+    void RebuildTree(Tree& tree, const size_t* data, bool is_set);
+    void UpdateTree(Tree& tree, const size_t* data, size_t first_idx, size_t last_idx,
+                    bool is_set);
+
+    // Returns the first clear bit of |level| of |tree| in [bit, end), or
+    // |end| if there is none.
+    size_t NextClear(const Tree& tree, size_t level, size_t bit, size_t end) const;
+
+    // Returns true and sets |out| to the last clear bit of |level| of |tree| in
+    // [begin, bit], if there is one.
+    bool PrevClear(const Tree& tree, size_t level, size_t bit, size_t begin, size_t* out) const;
+
+    size_t words_ = 0;
+    size_t level_count_ = 0;
+    // The number of meaningful bits in each level. Bits past the end of a
+    // level are set, so they never appear to need scanning.
+    size_t level_bits_[kMaxLevels] = {};
+    Tree full_;
+    Tree empty_;
+    bool valid_ = false;
+};
+
+} // namespace bitmap
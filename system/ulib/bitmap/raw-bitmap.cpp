@@ -4,6 +4,7 @@
 
 #include <bitmap/raw-bitmap.h>
 #include <bitmap/storage.h>
+#include <bitmap/summary.h>
 
 #include <limits.h>
 #include <stddef.h>
@@ -89,6 +90,7 @@ bool RawBitmapBase::Scan(size_t bitoff, size_t bitmax, bool is_set,
     if (bitoff >= bitmax) {
         return true;
     }
+    const BitmapSummary* summary = GetValidSummary();
     size_t i = FirstIdx(bitoff);
     while (true) {
         size_t masked = MaskBits(data_[i], i, bitoff, bitmax, is_set);
@@ -102,6 +104,10 @@ bool RawBitmapBase::Scan(size_t bitoff, size_t bitmax, bool is_set,
             return true;
         }
         ++i;
+        if (summary) {
+            // Skip the words which lie entirely within the range and match.
+            i = summary->Skip(is_set, i, LastIdx(bitmax));
+        }
     }
 }
 
@@ -111,6 +117,7 @@ bool RawBitmapBase::ReverseScan(size_t bitoff, size_t bitmax, bool is_set,
     if (bitoff >= bitmax) {
         return true;
     }
+    const BitmapSummary* summary = GetValidSummary();
     size_t i = LastIdx(bitmax);
     while (true) {
         size_t masked = MaskBits(data_[i], i, bitoff, bitmax, is_set);
@@ -124,6 +131,10 @@ bool RawBitmapBase::ReverseScan(size_t bitoff, size_t bitmax, bool is_set,
             return true;
         }
         --i;
+        if (summary) {
+            // Skip the words which lie entirely within the range and match.
+            i = summary->ReverseSkip(is_set, FirstIdx(bitoff), i);
+        }
     }
 }
 
@@ -187,6 +198,9 @@ zx_status_t RawBitmapBase::Set(size_t bitoff, size_t bitmax) {
     for (size_t i = first_idx; i <= last_idx; ++i) {
         data_[i] |= GetMask(i == first_idx, i == last_idx, bitoff, bitmax);
     }
+    if (summary_) {
+        summary_->Update(data_, first_idx, last_idx);
+    }
     return ZX_OK;
 }
 
@@ -202,6 +216,9 @@ zx_status_t RawBitmapBase::Clear(size_t bitoff, size_t bitmax) {
     for (size_t i = first_idx; i <= last_idx; ++i) {
         data_[i] &= ~(GetMask(i == first_idx, i == last_idx, bitoff, bitmax));
     }
+    if (summary_) {
+        summary_->Update(data_, first_idx, last_idx);
+    }
     return ZX_OK;
 }
 
@@ -213,6 +230,22 @@ void RawBitmapBase::ClearAll() {
     for (size_t i = 0; i <= last_idx; ++i) {
         data_[i] = 0;
     }
+    if (summary_) {
+        summary_->Rebuild(data_);
+    }
+}
+
+void RawBitmapBase::StorageModified() {
+    if (summary_) {
+        summary_->Invalidate();
+    }
+}
+
+const BitmapSummary* RawBitmapBase::GetValidSummary() const {
+    if (summary_ && !summary_->valid()) {
+        summary_->Rebuild(data_);
+    }
+    return summary_;
 }
 
 } // namespace bitmap
@@ -13,6 +13,7 @@ MODULE_COMPILEFLAGS += -fvisibility=hidden
 MODULE_SRCS += \
     $(LOCAL_DIR)/raw-bitmap.cpp \
     $(LOCAL_DIR)/rle-bitmap.cpp \
+    $(LOCAL_DIR)/summary.cpp \
 
 MODULE_STATIC_LIBS := \
     system/ulib/zx \
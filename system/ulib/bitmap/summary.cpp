@@ -0,0 +1,205 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <bitmap/raw-bitmap.h>
+#include <bitmap/summary.h>
+
+#include <limits.h>
+#include <stddef.h>
+
+#include <fbl/algorithm.h>
+#include <fbl/alloc_checker.h>
+#include <zircon/assert.h>
+#include <zircon/types.h>
+
+namespace bitmap {
+namespace {
+
+constexpr size_t kOnes = ~size_t(0);
+
+// Neither of these may be passed zero.
+#if (SIZE_MAX == UINT_MAX)
+#define CLZ(x) __builtin_clz(x)
+#define CTZ(x) __builtin_ctz(x)
+#elif (SIZE_MAX == ULONG_MAX)
+#define CLZ(x) __builtin_clzl(x)
+#define CTZ(x) __builtin_ctzl(x)
+#elif (SIZE_MAX == ULLONG_MAX)
+#define CLZ(x) __builtin_clzll(x)
+#define CTZ(x) __builtin_ctzll(x)
+#else
+#error "Unsupported size_t length"
+#endif
+
+constexpr size_t WordsFor(size_t bits) {
+    return (bits + kBits - 1) / kBits;
+}
+
+// Returns true if |word| is entirely |is_set|.
+constexpr bool Uniform(size_t word, bool is_set) {
+    return word == (is_set ? kOnes : 0);
+}
+
+void AssignBit(size_t* words, size_t bit, bool value) {
+    const size_t mask = size_t(1) << (bit % kBits);
+    if (value) {
+        words[bit / kBits] |= mask;
+    } else {
+        words[bit / kBits] &= ~mask;
+    }
+}
+
+} // namespace
+
+zx_status_t BitmapSummary::Reset(size_t words) {
+    valid_ = false;
+    words_ = words;
+    level_count_ = 0;
+    if (words == 0) {
+        return ZX_OK;
+    }
+
+    size_t bits = words;
+    while (true) {
+        ZX_ASSERT(level_count_ < kMaxLevels);
+        const size_t level_words = WordsFor(bits);
+        fbl::AllocChecker ac;
+        full_[level_count_].reset(new (&ac) size_t[level_words], level_words);
+        if (!ac.check()) {
+            return ZX_ERR_NO_MEMORY;
+        }
+        empty_[level_count_].reset(new (&ac) size_t[level_words], level_words);
+        if (!ac.check()) {
+            return ZX_ERR_NO_MEMORY;
+        }
+        level_bits_[level_count_++] = bits;
+        if (level_words == 1) {
+            return ZX_OK;
+        }
+        bits = level_words;
+    }
+}
+
+void BitmapSummary::Rebuild(const size_t* data) {
+    RebuildTree(full_, data, true);
+    RebuildTree(empty_, data, false);
+    valid_ = true;
+}
+
+void BitmapSummary::RebuildTree(Tree& tree, const size_t* data, bool is_set) {
+    for (size_t level = 0; level < level_count_; level++) {
+        const size_t* below = level == 0 ? data : tree[level - 1].get();
+        // Level zero summarizes |data| in the sense of |is_set|; every level above it
+        // summarizes the set bits of the level below.
+        const bool below_set = level == 0 ? is_set : true;
+        size_t* words = tree[level].get();
+        const size_t bits = level_bits_[level];
+        for (size_t i = 0; i < WordsFor(bits); i++) {
+            size_t word = 0;
+            const size_t count = fbl::min(kBits, bits - i * kBits);
+            for (size_t j = 0; j < count; j++) {
+                word |= size_t(Uniform(below[i * kBits + j], below_set)) << j;
+            }
+            if (count < kBits) {
+                word |= kOnes << count;
+            }
+            words[i] = word;
+        }
+    }
+}
+
+void BitmapSummary::Update(const size_t* data, size_t first_idx, size_t last_idx) {
+    if (!valid_) {
+        return;
+    }
+    ZX_DEBUG_ASSERT(last_idx < words_);
+    UpdateTree(full_, data, first_idx, last_idx, true);
+    UpdateTree(empty_, data, first_idx, last_idx, false);
+}
+
+void BitmapSummary::UpdateTree(Tree& tree, const size_t* data, size_t first_idx,
+                               size_t last_idx, bool is_set) {
+    for (size_t i = first_idx; i <= last_idx; i++) {
+        AssignBit(tree[0].get(), i, Uniform(data[i], is_set));
+    }
+    for (size_t level = 1; level < level_count_; level++) {
+        first_idx /= kBits;
+        last_idx /= kBits;
+        const size_t* below = tree[level - 1].get();
+        for (size_t i = first_idx; i <= last_idx; i++) {
+            AssignBit(tree[level].get(), i, below[i] == kOnes);
+        }
+    }
+}
+
+size_t BitmapSummary::Skip(bool is_set, size_t idx, size_t last_idx) const {
+    ZX_DEBUG_ASSERT(valid_);
+    ZX_DEBUG_ASSERT(last_idx < words_);
+    if (idx >= last_idx) {
+        return idx;
+    }
+    return NextClear(is_set ? full_ : empty_, 0, idx, last_idx);
+}
+
+size_t BitmapSummary::ReverseSkip(bool is_set, size_t first_idx, size_t idx) const {
+    ZX_DEBUG_ASSERT(valid_);
+    ZX_DEBUG_ASSERT(idx < words_);
+    size_t out;
+    if (idx <= first_idx ||
+        !PrevClear(is_set ? full_ : empty_, 0, idx, first_idx + 1, &out)) {
+        return fbl::min(idx, first_idx);
+    }
+    return out;
+}
+
+size_t BitmapSummary::NextClear(const Tree& tree, size_t level, size_t bit, size_t end) const {
+    while (bit < end) {
+        const size_t word = ~tree[level][bit / kBits] & (kOnes << (bit % kBits));
+        if (word != 0) {
+            return fbl::min(bit - bit % kBits + CTZ(word), end);
+        }
+        // The remainder of this word is uniform. The level above identifies the
+        // next word of this level which is not.
+        const size_t next = bit / kBits + 1;
+        const size_t next_end = WordsFor(end);
+        if (level + 1 == level_count_ || next >= next_end) {
+            return end;
+        }
+        const size_t found = NextClear(tree, level + 1, next, next_end);
+        if (found >= next_end) {
+            return end;
+        }
+        bit = found * kBits;
+    }
+    return end;
+}
+
+bool BitmapSummary::PrevClear(const Tree& tree, size_t level, size_t bit, size_t begin,
+                              size_t* out) const {
+    while (true) {
+        const size_t word = ~tree[level][bit / kBits] &
+                            (kOnes >> (kBits - 1 - bit % kBits));
+        if (word != 0) {
+            const size_t found = bit - bit % kBits + (kBits - 1 - CLZ(word));
+            if (found < begin) {
+                return false;
+            }
+            *out = found;
+            return true;
+        }
+        // The start of this word is uniform. The level above identifies the
+        // previous word of this level which is not.
+        const size_t word_idx = bit / kBits;
+        if (level + 1 == level_count_ || word_idx * kBits <= begin) {
+            return false;
+        }
+        size_t found;
+        if (!PrevClear(tree, level + 1, word_idx - 1, begin / kBits, &found)) {
+            return false;
+        }
+        bit = found * kBits + kBits - 1;
+    }
+}
+
+} // namespace bitmap
@@ -118,7 +118,11 @@ zx_status_t Allocator::ResetFromStorage(fs::ReadTxn txn) {
     const auto info = space_manager_->Info();
     txn.Enqueue(block_map_vmoid_, 0, BlockMapStartBlock(info), BlockMapBlocks(info));
     txn.Enqueue(node_map_vmoid_, 0, NodeMapStartBlock(info), NodeMapBlocks(info));
-    return txn.Transact();
+    if ((status = txn.Transact()) != ZX_OK) {
+        return status;
+    }
+    block_map_.StorageModified();
+    return ZX_OK;
 }
 
 const zx::vmo& Allocator::GetBlockMapVmo() const {
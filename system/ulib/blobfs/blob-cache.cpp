@@ -33,6 +33,10 @@ void BlobCache::Reset() {
 }
 
 void BlobCache::ResetLocked() {
+    lru_list_.clear();
+    lru_bytes_ = 0;
+    lru_nodes_ = 0;
+
     // All nodes in closed_hash_ have been leaked. If we're attempting to reset the
     // cache, these nodes must be explicitly deleted.
     CacheNode* node = nullptr;
@@ -41,6 +45,50 @@ void BlobCache::ResetLocked() {
     }
 }
 
+void BlobCache::SetCacheLimits(uint64_t max_bytes, size_t max_nodes) {
+    fbl::AutoLock lock(&hash_lock_);
+    max_bytes_ = max_bytes;
+    max_nodes_ = max_nodes;
+    EvictLruLocked(max_bytes_, max_nodes_);
+}
+
+void BlobCache::SetMetrics(BlobfsMetrics* metrics) {
+    fbl::AutoLock lock(&hash_lock_);
+    metrics_ = metrics;
+}
+
+void BlobCache::OnMemoryPressure() {
+    TRACE_DURATION("blobfs", "BlobCache::OnMemoryPressure");
+    fbl::AutoLock lock(&hash_lock_);
+    EvictLruLocked(0, 0);
+}
+
+void BlobCache::EvictLruLocked(uint64_t max_bytes, size_t max_nodes) {
+    while (lru_bytes_ > max_bytes || lru_nodes_ > max_nodes) {
+        CacheNode* vnode = lru_list_.pop_front();
+        ZX_DEBUG_ASSERT(vnode != nullptr);
+        const uint64_t bytes = vnode->lru_bytes_;
+        lru_bytes_ -= bytes;
+        lru_nodes_--;
+        vnode->lru_bytes_ = 0;
+        vnode->ActivateLowMemory();
+        if (metrics_ != nullptr) {
+            metrics_->UpdateCacheEviction(bytes);
+        }
+    }
+}
+
+bool BlobCache::RemoveLruLocked(CacheNode* vnode) {
+    if (!vnode->lru_state_.InContainer()) {
+        return false;
+    }
+    lru_list_.erase(*vnode);
+    lru_bytes_ -= vnode->lru_bytes_;
+    lru_nodes_--;
+    vnode->lru_bytes_ = 0;
+    return true;
+}
+
 void BlobCache::ForAllOpenNodes(NextNodeCallback callback) {
     fbl::RefPtr<CacheNode> old_vnode = nullptr;
     fbl::RefPtr<CacheNode> vnode = nullptr;
@@ -138,6 +186,10 @@ zx_status_t BlobCache::LookupLocked(const uint8_t* key, fbl::RefPtr<CacheNode>*
                 release_cvar_.Wait(&hash_lock_);
                 continue;
             }
+            // An open node is always in memory.
+            if (metrics_ != nullptr) {
+                metrics_->UpdateCacheLookup(true);
+            }
             return ZX_OK;
         }
         break;
@@ -224,6 +276,18 @@ void BlobCache::Downgrade(CacheNode* raw_vnode) {
         break;
     case CachePolicy::NeverEvict:
         break;
+    case CachePolicy::EvictLeastRecentlyUsed: {
+        const uint64_t bytes = vnode->MemoryUsage();
+        if (bytes == 0) {
+            break;
+        }
+        vnode->lru_bytes_ = bytes;
+        lru_list_.push_back(raw_vnode);
+        lru_bytes_ += bytes;
+        lru_nodes_++;
+        EvictLruLocked(max_bytes_, max_nodes_);
+        break;
+    }
     default:
         ZX_ASSERT_MSG(false, "Unexpected cache policy");
     }
@@ -239,6 +303,12 @@ fbl::RefPtr<CacheNode> BlobCache::UpgradeLocked(const uint8_t* key) {
     if (raw_vnode == nullptr) {
         return nullptr;
     }
+    // A closed node which kept its memory can be reused without being read and verified again.
+    bool hit = RemoveLruLocked(raw_vnode) ||
+               (cache_policy_ == CachePolicy::NeverEvict && raw_vnode->MemoryUsage() > 0);
+    if (metrics_ != nullptr) {
+        metrics_->UpdateCacheLookup(hit);
+    }
     open_hash_.insert(raw_vnode);
     // To have existed in the closed_hash_, this RefPtr must have been leaked.
     // See the complement of this adoption in Downgrade.
@@ -20,6 +20,7 @@
 #include <blobfs/iterator/node-populator.h>
 #include <blobfs/iterator/vector-extent-iterator.h>
 #include <blobfs/latency-event.h>
+#include <blobfs/pager.h>
 #include <blobfs/writeback.h>
 #include <cobalt-client/cpp/timer.h>
 #include <digest/digest.h>
@@ -100,6 +101,10 @@ zx_status_t Blob::InitVmos() {
         return ZX_OK;
     }
 
+    if (ShouldPage()) {
+        return InitPaged();
+    }
+
     // Reverts blob back to uninitialized state on error.
     auto cleanup = fbl::MakeAutoCall([this]() { BlobCloseHandles(); });
 
@@ -142,6 +147,53 @@ zx_status_t Blob::InitVmos() {
     return ZX_OK;
 }
 
+bool Blob::ShouldPage() const {
+    // Compressed blobs can only be decompressed as a whole.
+    constexpr uint32_t kCompressedFlags = kBlobFlagLZ4Compressed | kBlobFlagZSTDCompressed;
+    return blobfs_->Pager() != nullptr && (inode_.header.flags & kCompressedFlags) == 0;
+}
+
+zx_status_t Blob::InitPaged() {
+    TRACE_DURATION("blobfs", "Blobfs::InitPaged", "size", inode_.blob_size, "blocks",
+                   inode_.block_count);
+    // The pager services faults on its own thread, so hand it a snapshot of the blob's extents
+    // rather than letting it walk the allocator.
+    fbl::Vector<Extent> extents;
+    AllocatedExtentIterator extent_iter(blobfs_->GetAllocator(), GetMapIndex());
+    while (!extent_iter.Done()) {
+        const Extent* extent;
+        zx_status_t status = extent_iter.Next(&extent);
+        if (status != ZX_OK) {
+            return status;
+        }
+        extents.push_back(*extent);
+    }
+
+    fbl::RefPtr<PagedBlob> paged;
+    zx_status_t status = blobfs_->Pager()->CreateBlob(inode_, std::move(extents), &paged);
+    if (status != ZX_OK) {
+        FS_TRACE_ERROR("Failed to create paged vmo; error: %d\n", status);
+        return status;
+    }
+    auto detach = fbl::MakeAutoCall([this, &paged]() { blobfs_->Pager()->Detach(paged.get()); });
+
+    fbl::StringBuffer<ZX_MAX_NAME_LEN> vmo_name;
+    FormatVmoName(kBlobVmoNamePrefix, &vmo_name, Ino());
+    paged->vmo().set_property(ZX_PROP_NAME, vmo_name.c_str(), vmo_name.length());
+
+    zx::vmo vmo;
+    if ((status = paged->vmo().duplicate(ZX_RIGHT_SAME_RIGHTS, &vmo)) != ZX_OK) {
+        return status;
+    } else if ((status = mapping_.Map(std::move(vmo), 0, ZX_VM_PERM_READ)) != ZX_OK) {
+        FS_TRACE_ERROR("Failed to map paged vmo; error: %d\n", status);
+        return status;
+    }
+
+    detach.cancel();
+    paged_ = std::move(paged);
+    return ZX_OK;
+}
+
 zx_status_t Blob::InitCompressed(CompressionAlgorithm algorithm) {
     TRACE_DURATION("blobfs", "Blobfs::InitCompressed", "size", inode_.blob_size, "blocks",
                    inode_.block_count);
@@ -777,8 +829,23 @@ zx_status_t Blob::VerifyBlob(Blobfs* bs, uint32_t node_index) {
     vn->PopulateInode(node_index);
 
     // If we are unable to read in the blob from disk, this should also be a VerifyBlob error.
-    // Since InitVmos calls Verify as its final step, we can just return its result here.
-    return vn->InitVmos();
+    // For blobs which are read eagerly, InitVmos calls Verify as its final step.
+    zx_status_t status = vn->InitVmos();
+    if (status != ZX_OK || !vn->paged_) {
+        return status;
+    }
+
+    // Paged blobs are only verified as they are read, so read all of it.
+    constexpr size_t kVerifyChunkSize = 16 * kBlobfsBlockSize;
+    fbl::unique_ptr<uint8_t[]> buffer(new uint8_t[kVerifyChunkSize]);
+    const size_t merkle_bytes = MerkleTreeBlocks(vn->inode_) * kBlobfsBlockSize;
+    for (size_t off = 0; off < vn->inode_.blob_size; off += kVerifyChunkSize) {
+        size_t len = fbl::min(kVerifyChunkSize, vn->inode_.blob_size - off);
+        if ((status = vn->mapping_.vmo().read(buffer.get(), merkle_bytes + off, len)) != ZX_OK) {
+            return status;
+        }
+    }
+    return ZX_OK;
 }
 
 BlobCache& Blob::Cache() {
@@ -798,12 +865,29 @@ bool Blob::ShouldCache() const {
 void Blob::ActivateLowMemory() {
     // We shouldn't be putting the blob into a low-memory state while it is still mapped.
     ZX_ASSERT(clone_watcher_.object() == ZX_HANDLE_INVALID);
-    if (mapping_.vmo()) {
+    if (paged_) {
+        if (blobfs_->Pager() != nullptr) {
+            blobfs_->Pager()->Detach(paged_.get());
+        }
+        paged_.reset();
+    } else if (mapping_.vmo()) {
         blobfs_->DetachVmo(vmoid_);
     }
     mapping_.Reset();
 }
 
+uint64_t Blob::MemoryUsage() const {
+    if (!mapping_.vmo()) {
+        return 0;
+    }
+    // Paged blobs only hold the pages which have been touched.
+    zx_info_vmo_t info;
+    if (mapping_.vmo().get_info(ZX_INFO_VMO, &info, sizeof(info), nullptr, nullptr) != ZX_OK) {
+        return mapping_.size();
+    }
+    return info.committed_bytes;
+}
+
 Blob::~Blob() {
     ActivateLowMemory();
 }
@@ -562,6 +562,10 @@ Blobfs::~Blobfs() {
 
     Cache().Reset();
 
+    // Every blob has been detached from the pager by now, but the pager thread may still be
+    // using the block device.
+    pager_.reset();
+
     if (blockfd_) {
         ioctl_block_fifo_close(Fd());
     }
@@ -579,6 +583,8 @@ zx_status_t Blobfs::Create(fbl::unique_fd fd, const MountOptions& options, const
     auto fs = fbl::unique_ptr<Blobfs>(new Blobfs(std::move(fd), info));
     fs->SetReadonly(options.readonly);
     fs->Cache().SetCachePolicy(options.cache_policy);
+    fs->Cache().SetCacheLimits(options.cache_max_bytes, options.cache_max_nodes);
+    fs->Cache().SetMetrics(&fs->LocalMetrics());
     if (options.metrics) {
         fs->LocalMetrics().Collect();
     }
@@ -598,6 +604,13 @@ zx_status_t Blobfs::Create(fbl::unique_fd fd, const MountOptions& options, const
         return status;
     }
 
+    if (options.paging) {
+        if ((status = BlobPager::Create(fs.get(), &fs->pager_)) != ZX_OK) {
+            FS_TRACE_ERROR("blobfs: Failed to create pager: %d\n", status);
+            return status;
+        }
+    }
+
     RawBitmap block_map;
     // Keep the block_map aligned to a block multiple
     if ((status = block_map.Reset(BlockMapBlocks(fs->info_) * kBlobfsBlockBits)) < 0) {
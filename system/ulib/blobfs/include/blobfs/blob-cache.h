@@ -10,6 +10,7 @@
 
 #include <digest/digest.h>
 #include <fbl/condition_variable.h>
+#include <fbl/intrusive_double_list.h>
 #include <fbl/intrusive_wavl_tree.h>
 #include <fbl/function.h>
 #include <fbl/mutex.h>
@@ -39,8 +40,20 @@ enum class CachePolicy {
     //
     // This option costs a significant amount of memory, but it results in high performance.
     NeverEvict,
+
+    // Closed nodes keep their memory until the closed set exceeds its byte or node budget
+    // (see |BlobCache::SetCacheLimits()|), or until |BlobCache::OnMemoryPressure()| is invoked.
+    // |ActivateLowMemory()| is then invoked on the least recently closed nodes first.
+    //
+    // This option keeps frequently reopened blobs in memory, while bounding the cost of
+    // the closed set.
+    EvictLeastRecentlyUsed,
 };
 
+// Default budgets for closed nodes under |CachePolicy::EvictLeastRecentlyUsed|.
+constexpr uint64_t kDefaultCacheMaxBytes = 64 * (1 << 20);
+constexpr size_t kDefaultCacheMaxNodes = 512;
+
 // BlobCache contains a collection of weak pointers to vnodes.
 //
 // This cache also helps manage the lifecycle of these vnodes, controlling what is cached
@@ -66,6 +79,20 @@ public:
     // Refer to the declaration of |CachePolicy| for more information.
     void SetCachePolicy(CachePolicy policy) { cache_policy_ = policy; }
 
+    // Bounds the memory and number of closed nodes which may hold memory under
+    // |CachePolicy::EvictLeastRecentlyUsed|, evicting nodes immediately if necessary.
+    void SetCacheLimits(uint64_t max_bytes, size_t max_nodes);
+
+    // Records cache hits, misses, and evictions in |metrics|, which must outlive the cache.
+    // |metrics| is only updated while holding the cache's lock.
+    void SetMetrics(BlobfsMetrics* metrics);
+
+    // Invokes |ActivateLowMemory()| on every closed node which still holds memory under
+    // |CachePolicy::EvictLeastRecentlyUsed|.
+    //
+    // Intended to be invoked when the system is running low on memory.
+    void OnMemoryPressure();
+
     // Iterates over all non-evicted cached nodes with strong references, invoking |callback| on
     // each one.
     //
@@ -138,6 +165,13 @@ private:
     // Resets the cache by deleting all members |closed_hash_|.
     void ResetLocked() __TA_REQUIRES(hash_lock_);
 
+    // Invokes |ActivateLowMemory()| on the least recently used members of |lru_list_| until
+    // it holds no more than |max_bytes| bytes and |max_nodes| nodes.
+    void EvictLruLocked(uint64_t max_bytes, size_t max_nodes) __TA_REQUIRES(hash_lock_);
+
+    // Removes |vnode| from |lru_list_|, if it is there. Returns true if it was removed.
+    bool RemoveLruLocked(CacheNode* vnode) __TA_REQUIRES(hash_lock_);
+
     // We need to define this structure to allow the CacheNodes to be indexable by a key
     // which is larger than a primitive type: the keys are 'Digest::kLength'
     // bytes long.
@@ -157,6 +191,7 @@ private:
                                            CacheNode*,
                                            MerkleRootTraits,
                                            CacheNode::TypeWavlTraits>;
+    using LruList = fbl::DoublyLinkedList<CacheNode*, CacheNode::LruTraits>;
 
     CachePolicy cache_policy_ = CachePolicy::EvictImmediately;
 
@@ -173,6 +208,16 @@ private:
     // This variable lets those callers wait until SOME node has been removed from the
     // |open_hash_|, at which point their |Lookup()| may have a different result.
     fbl::ConditionVariable release_cvar_;
+
+    // Members of |closed_hash_| which still hold memory, from least to most recently closed.
+    // Only used by |CachePolicy::EvictLeastRecentlyUsed|.
+    LruList lru_list_ __TA_GUARDED(hash_lock_){};
+    uint64_t lru_bytes_ __TA_GUARDED(hash_lock_) = 0;
+    size_t lru_nodes_ __TA_GUARDED(hash_lock_) = 0;
+    uint64_t max_bytes_ __TA_GUARDED(hash_lock_) = kDefaultCacheMaxBytes;
+    size_t max_nodes_ __TA_GUARDED(hash_lock_) = kDefaultCacheMaxNodes;
+
+    BlobfsMetrics* metrics_ __TA_GUARDED(hash_lock_) = nullptr;
 };
 
 } // namespace blobfs
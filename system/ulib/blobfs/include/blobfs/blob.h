@@ -41,6 +41,7 @@
 namespace blobfs {
 
 class Blobfs;
+class PagedBlob;
 
 using digest::Digest;
 
@@ -168,6 +169,7 @@ private:
     BlobCache& Cache() final;
     bool ShouldCache() const final;
     void ActivateLowMemory() final;
+    uint64_t MemoryUsage() const final;
 
     ////////////////
     // Other methods.
@@ -217,12 +219,17 @@ private:
 
     // Reads both VMOs into memory, if we haven't already.
     //
-    // TODO(ZX-1481): When we have can register the Blob Store as a pager
-    // service, and it can properly handle pages faults on a vnode's contents,
-    // then we can avoid reading the entire blob up-front. Until then, read
-    // the contents of a VMO into memory when it is opened.
+    // If blobfs was mounted with paging enabled, uncompressed blobs are instead
+    // backed by the pager: only the merkle tree is read here, and data is read
+    // and verified as its pages are touched.
     zx_status_t InitVmos();
 
+    // Initializes an uncompressed blob whose data is supplied by the pager.
+    zx_status_t InitPaged();
+
+    // Returns true if this blob's data should be supplied by the pager.
+    bool ShouldPage() const;
+
     // Initializes a compressed blob by reading it from disk and decompressing it.
     // Does not verify the blob.
     zx_status_t InitCompressed(CompressionAlgorithm algorithm);
@@ -252,6 +259,8 @@ private:
     // 2) The Blob itself, aligned to the nearest kBlobfsBlockSize
     fzl::OwnedVmoMapper mapping_;
     vmoid_t vmoid_ = {};
+    // Non-null if |mapping_| is backed by the pager, in which case |vmoid_| is unused.
+    fbl::RefPtr<PagedBlob> paged_;
 
     // Watches any clones of "vmo_" provided to clients.
     // Observes the ZX_VMO_ZERO_CHILDREN signal.
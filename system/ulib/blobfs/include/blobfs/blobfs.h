@@ -51,6 +51,7 @@
 #include <blobfs/journal.h>
 #include <blobfs/metrics.h>
 #include <blobfs/node-reserver.h>
+#include <blobfs/pager.h>
 #include <blobfs/writeback.h>
 
 #include <atomic>
@@ -65,7 +66,12 @@ struct MountOptions {
     bool readonly = false;
     bool metrics = false;
     bool journal = false;
+    // Reads and verifies uncompressed blobs on demand, as their pages are touched.
+    bool paging = false;
     CachePolicy cache_policy = CachePolicy::EvictImmediately;
+    // Budgets for closed blobs under CachePolicy::EvictLeastRecentlyUsed.
+    uint64_t cache_max_bytes = kDefaultCacheMaxBytes;
+    size_t cache_max_nodes = kDefaultCacheMaxNodes;
 };
 
 class Blobfs : public fs::ManagedVfs,
@@ -138,6 +144,9 @@ public:
 
     Allocator* GetAllocator() { return allocator_.get(); }
 
+    // Returns the pager used to populate blobs on demand, or nullptr if paging is disabled.
+    BlobPager* Pager() { return pager_.get(); }
+
     Inode* GetNode(uint32_t node_index) { return allocator_->GetNode(node_index); }
     zx_status_t ReserveBlocks(size_t num_blocks, fbl::Vector<ReservedExtent>* out_extents) {
         return allocator_->ReserveBlocks(num_blocks, out_extents);
@@ -263,6 +272,7 @@ private:
     block_client::Client fifo_client_;
 
     fbl::unique_ptr<Allocator> allocator_;
+    fbl::unique_ptr<BlobPager> pager_;
 
     fzl::ResizeableVmoMapper info_mapping_;
     vmoid_t info_vmoid_ = {};
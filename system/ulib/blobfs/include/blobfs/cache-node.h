@@ -9,6 +9,7 @@
 #endif
 
 #include <digest/digest.h>
+#include <fbl/intrusive_double_list.h>
 #include <fbl/intrusive_wavl_tree.h>
 #include <fbl/function.h>
 #include <fbl/mutex.h>
@@ -31,6 +32,10 @@ public:
     struct TypeWavlTraits {
         static WAVLTreeNodeState& node_state(CacheNode& b) { return b.type_wavl_state_; }
     };
+    using LruNodeState = fbl::DoublyLinkedListNodeState<CacheNode*>;
+    struct LruTraits {
+        static LruNodeState& node_state(CacheNode& b) { return b.lru_state_; }
+    };
 
     bool InContainer() const {
         return type_wavl_state_.InContainer();
@@ -79,14 +84,27 @@ public:
     // The implementation of this method must not attempt to acquire a reference to |this|.
     virtual void ActivateLowMemory() = 0;
 
+    // Returns the number of bytes of memory which |ActivateLowMemory()| would release.
+    //
+    // The implementation of this method must not invoke any other CacheNode methods.
+    // The implementation of this method must not attempt to acquire a reference to |this|.
+    virtual uint64_t MemoryUsage() const = 0;
+
     // Returns the node's digest.
     const uint8_t* GetKey() const {
         return &digest_[0];
     }
 
 private:
+    friend class BlobCache;
     friend struct TypeWavlTraits;
+    friend struct LruTraits;
     WAVLTreeNodeState type_wavl_state_ = {};
+    // Links closed nodes which still hold memory, when the cache evicts least recently used
+    // nodes. Guarded by the BlobCache's lock.
+    LruNodeState lru_state_ = {};
+    // The memory charged to the cache for this node while it is linked by |lru_state_|.
+    uint64_t lru_bytes_ = 0;
     uint8_t digest_[Digest::kLength] = {};
 };
 
@@ -29,7 +29,7 @@ constexpr uint64_t kCompressionMinBlocksSaved = 8;
 constexpr uint64_t kCompressionMinBytesSaved = kCompressionMinBlocksSaved * kBlobfsBlockSize;
 
 #ifdef __Fuchsia__
-using RawBitmap = bitmap::RawBitmapGeneric<bitmap::VmoStorage>;
+using RawBitmap = bitmap::RawBitmapGeneric<bitmap::SummaryStorage<bitmap::VmoStorage>>;
 #else
 using RawBitmap = bitmap::RawBitmapGeneric<bitmap::DefaultStorage>;
 #endif
@@ -65,6 +65,19 @@ public:
     // since mounting.
     void UpdateMerkleVerify(uint64_t size_data, uint64_t size_merkle, const fs::Duration& duration);
 
+    // Updates aggregate information about blob data read and verified on demand
+    // by the pager since mounting.
+    void UpdatePagedRead(uint64_t size, const fs::Duration& read_duration,
+                         const fs::Duration& verify_duration);
+
+    // Updates aggregate information about looking up blobs in the cache, which
+    // |hit| if the blob was open or still held in memory after being closed.
+    void UpdateCacheLookup(bool hit);
+
+    // Updates aggregate information about closed blobs which the cache has
+    // evicted from memory.
+    void UpdateCacheEviction(uint64_t size);
+
 private:
 
     bool collecting_metrics_ = false;
@@ -110,6 +123,22 @@ private:
     uint64_t blobs_verified_total_size_merkle_ = 0;
     zx::ticks total_verification_time_ticks_ = {};
 
+    // PAGING STATS
+
+    // Updated only by the pager thread.
+    uint64_t paged_reads_ = 0;
+    uint64_t bytes_paged_in_ = 0;
+    zx::ticks total_paged_read_time_ticks_ = {};
+    zx::ticks total_paged_verify_time_ticks_ = {};
+
+    // CACHE STATS
+
+    // Updated only while holding the BlobCache's lock.
+    uint64_t cache_hits_ = 0;
+    uint64_t cache_misses_ = 0;
+    uint64_t cache_evictions_ = 0;
+    uint64_t cache_evicted_bytes_ = 0;
+
     // FVM STATS
     // TODO(smklein)
 };
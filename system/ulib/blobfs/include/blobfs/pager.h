@@ -0,0 +1,129 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file contains the pager which populates blob VMOs on demand.
+
+#pragma once
+
+#ifndef __Fuchsia__
+#error Fuchsia-only Header
+#endif
+
+#include <threads.h>
+
+#include <blobfs/format.h>
+#include <blobfs/transaction-manager.h>
+#include <digest/digest.h>
+#include <fbl/intrusive_wavl_tree.h>
+#include <fbl/macros.h>
+#include <fbl/mutex.h>
+#include <fbl/ref_counted.h>
+#include <fbl/ref_ptr.h>
+#include <fbl/unique_ptr.h>
+#include <fbl/vector.h>
+#include <lib/fzl/owned-vmo-mapper.h>
+#include <lib/zx/handle.h>
+#include <lib/zx/port.h>
+#include <lib/zx/vmo.h>
+#include <zircon/device/block.h>
+
+namespace blobfs {
+
+using digest::Digest;
+
+// A blob whose VMO is populated by the BlobPager.
+//
+// Faults are serviced on the pager thread, so a PagedBlob holds its own copy of everything
+// needed to locate and verify the blob's contents, rather than referring back to the Blob
+// or to the allocator (both of which are owned by the dispatcher thread).
+class PagedBlob : public fbl::RefCounted<PagedBlob>,
+                  public fbl::WAVLTreeContainable<fbl::RefPtr<PagedBlob>> {
+public:
+    DISALLOW_COPY_ASSIGN_AND_MOVE(PagedBlob);
+
+    uint64_t GetKey() const { return key_; }
+
+    // The pager-backed VMO. It has the same layout as an eagerly-read blob: the merkle tree,
+    // followed by the data, each aligned to kBlobfsBlockSize.
+    const zx::vmo& vmo() const { return vmo_; }
+
+private:
+    friend class BlobPager;
+
+    PagedBlob(const Inode& inode, uint64_t data_start, fbl::Vector<Extent> extents);
+
+    uint64_t MerkleBytes() const;
+    uint64_t VmoSize() const;
+
+    uint64_t key_ = 0;
+    const Digest digest_;
+    const uint64_t blob_size_;
+    const uint64_t merkle_blocks_;
+    const uint64_t data_blocks_;
+    // The first block of the data section of the underlying device.
+    const uint64_t data_start_;
+    // The extents of the blob, in blob-block order.
+    const fbl::Vector<Extent> extents_;
+
+    zx::vmo vmo_;
+    // A read-only view of the (resident) merkle tree at the start of |vmo_|.
+    fzl::OwnedVmoMapper merkle_;
+};
+
+// Owns a kernel pager and the thread which services its page requests.
+//
+// Data pages of a blob are read from disk and verified against the blob's merkle tree only
+// when they are first touched, so opening a large, sparsely-used blob costs I/O and memory
+// proportional to the pages actually used rather than to the size of the blob.
+class BlobPager {
+public:
+    DISALLOW_COPY_ASSIGN_AND_MOVE(BlobPager);
+
+    static zx_status_t Create(TransactionManager* txn_manager, fbl::unique_ptr<BlobPager>* out);
+
+    // Stops the pager thread. Blobs which are still attached are no longer serviced.
+    ~BlobPager();
+
+    // Creates a pager-backed VMO for the blob described by |inode|, which occupies |extents|.
+    //
+    // The merkle tree is read into the VMO up front; data is read and verified against the
+    // inode's merkle root as it faults.
+    zx_status_t CreateBlob(const Inode& inode, fbl::Vector<Extent> extents,
+                           fbl::RefPtr<PagedBlob>* out);
+
+    // Stops servicing page requests for |blob|. Outstanding and future requests on its VMO fail.
+    void Detach(PagedBlob* blob);
+
+private:
+    // Size of the buffer used to read blob data from disk before supplying it to a VMO.
+    static constexpr uint64_t kTransferBufferSize = 256 * kBlobfsBlockSize;
+
+    BlobPager(TransactionManager* txn_manager);
+
+    static int PagerThread(void* arg);
+    int Run();
+
+    // Reads, verifies, and supplies the pages containing [offset, offset + length) of |blob|.
+    zx_status_t PopulateRange(PagedBlob* blob, uint64_t offset, uint64_t length);
+
+    // Enqueues reads of |block_count| blocks of |blob|, starting at |block|, into |vmoid|.
+    static zx_status_t EnqueueBlocks(fs::ReadTxn* txn, vmoid_t vmoid, const PagedBlob& blob,
+                                     uint64_t block, uint64_t block_count);
+
+    TransactionManager* txn_manager_;
+    zx::handle pager_;
+    zx::port port_;
+    thrd_t thread_;
+    bool thread_started_ = false;
+
+    // Only accessed by the pager thread.
+    fzl::OwnedVmoMapper transfer_;
+    vmoid_t transfer_vmoid_ = VMOID_INVALID;
+
+    fbl::Mutex lock_;
+    uint64_t next_key_ __TA_GUARDED(lock_) = 1;
+    fbl::WAVLTree<uint64_t, fbl::RefPtr<PagedBlob>> blobs_ __TA_GUARDED(lock_);
+};
+
+} // namespace blobfs
@@ -49,6 +49,16 @@ void BlobfsMetrics::Dump() const {
                   TicksToMs(total_read_from_disk_time_ticks_),
                   bytes_read_from_disk_ / mb,
                   TicksToMs(total_verification_time_ticks_));
+    FS_TRACE_INFO("Paging Info:\n");
+    FS_TRACE_INFO("  Paged in %zu MB in %zu reads, %zu ms reading, %zu ms verifying\n",
+                  bytes_paged_in_ / mb, paged_reads_,
+                  TicksToMs(total_paged_read_time_ticks_),
+                  TicksToMs(total_paged_verify_time_ticks_));
+    FS_TRACE_INFO("Cache Info:\n");
+    FS_TRACE_INFO("  Looked up %zu cached blobs, %zu uncached blobs\n", cache_hits_,
+                  cache_misses_);
+    FS_TRACE_INFO("  Evicted %zu blobs (%zu MB)\n", cache_evictions_,
+                  cache_evicted_bytes_ / mb);
 }
 
 void BlobfsMetrics::UpdateAllocation(uint64_t size_data, const fs::Duration& duration) {
@@ -113,4 +123,31 @@ void BlobfsMetrics::UpdateMerkleVerify(uint64_t size_data, uint64_t size_merkle,
     }
 }
 
+void BlobfsMetrics::UpdatePagedRead(uint64_t size, const fs::Duration& read_duration,
+                                    const fs::Duration& verify_duration) {
+    if (Collecting()) {
+        paged_reads_++;
+        bytes_paged_in_ += size;
+        total_paged_read_time_ticks_ += read_duration;
+        total_paged_verify_time_ticks_ += verify_duration;
+    }
+}
+
+void BlobfsMetrics::UpdateCacheLookup(bool hit) {
+    if (Collecting()) {
+        if (hit) {
+            cache_hits_++;
+        } else {
+            cache_misses_++;
+        }
+    }
+}
+
+void BlobfsMetrics::UpdateCacheEviction(uint64_t size) {
+    if (Collecting()) {
+        cache_evictions_++;
+        cache_evicted_bytes_ += size;
+    }
+}
+
 } // namespace blobfs
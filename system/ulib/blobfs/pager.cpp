@@ -0,0 +1,304 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string.h>
+
+#include <blobfs/pager.h>
+#include <digest/merkle-tree.h>
+#include <fbl/algorithm.h>
+#include <fbl/auto_call.h>
+#include <fbl/auto_lock.h>
+#include <fs/block-txn.h>
+#include <fs/ticker.h>
+#include <fs/trace.h>
+#include <trace/event.h>
+#include <zircon/device/block.h>
+#include <zircon/status.h>
+#include <zircon/syscalls.h>
+#include <zircon/syscalls/port.h>
+
+#include <utility>
+
+namespace blobfs {
+
+using digest::MerkleTree;
+
+PagedBlob::PagedBlob(const Inode& inode, uint64_t data_start, fbl::Vector<Extent> extents)
+    : digest_(inode.merkle_root_hash), blob_size_(inode.blob_size),
+      merkle_blocks_(MerkleTreeBlocks(inode)), data_blocks_(BlobDataBlocks(inode)),
+      data_start_(data_start), extents_(std::move(extents)) {}
+
+uint64_t PagedBlob::MerkleBytes() const {
+    return merkle_blocks_ * kBlobfsBlockSize;
+}
+
+uint64_t PagedBlob::VmoSize() const {
+    return (merkle_blocks_ + data_blocks_) * kBlobfsBlockSize;
+}
+
+BlobPager::BlobPager(TransactionManager* txn_manager) : txn_manager_(txn_manager) {}
+
+BlobPager::~BlobPager() {
+    if (thread_started_) {
+        // The pager thread exits when it observes a user packet.
+        zx_port_packet_t packet = {};
+        packet.type = ZX_PKT_TYPE_USER;
+        ZX_ASSERT(port_.queue(&packet) == ZX_OK);
+        thrd_join(thread_, nullptr);
+    }
+    if (transfer_vmoid_ != VMOID_INVALID) {
+        txn_manager_->DetachVmo(transfer_vmoid_);
+    }
+    // Closing |pager_| fails any further requests on VMOs which are still attached.
+    fbl::AutoLock lock(&lock_);
+    blobs_.clear();
+}
+
+zx_status_t BlobPager::Create(TransactionManager* txn_manager, fbl::unique_ptr<BlobPager>* out) {
+    fbl::unique_ptr<BlobPager> pager(new BlobPager(txn_manager));
+
+    zx_status_t status;
+    if ((status = zx_pager_create(0, pager->pager_.reset_and_get_address())) != ZX_OK) {
+        FS_TRACE_ERROR("blobfs: Failed to create pager: %d\n", status);
+        return status;
+    } else if ((status = zx::port::create(0, &pager->port_)) != ZX_OK) {
+        FS_TRACE_ERROR("blobfs: Failed to create pager port: %d\n", status);
+        return status;
+    } else if ((status = pager->transfer_.CreateAndMap(kTransferBufferSize,
+                                                       "blobfs-pager-transfer")) != ZX_OK) {
+        FS_TRACE_ERROR("blobfs: Failed to create pager transfer buffer: %d\n", status);
+        return status;
+    } else if ((status = txn_manager->AttachVmo(pager->transfer_.vmo(),
+                                                &pager->transfer_vmoid_)) != ZX_OK) {
+        FS_TRACE_ERROR("blobfs: Failed to attach pager transfer buffer: %d\n", status);
+        return status;
+    }
+
+    if (thrd_create_with_name(&pager->thread_, BlobPager::PagerThread, pager.get(),
+                              "blobfs-pager") != thrd_success) {
+        return ZX_ERR_NO_RESOURCES;
+    }
+    pager->thread_started_ = true;
+
+    *out = std::move(pager);
+    return ZX_OK;
+}
+
+zx_status_t BlobPager::CreateBlob(const Inode& inode, fbl::Vector<Extent> extents,
+                                  fbl::RefPtr<PagedBlob>* out) {
+    TRACE_DURATION("blobfs", "BlobPager::CreateBlob", "size", inode.blob_size);
+    fbl::RefPtr<PagedBlob> blob = fbl::AdoptRef(
+        new PagedBlob(inode, DataStartBlock(txn_manager_->Info()), std::move(extents)));
+
+    {
+        fbl::AutoLock lock(&lock_);
+        blob->key_ = next_key_++;
+    }
+
+    zx_status_t status = zx_pager_create_vmo(pager_.get(), 0, port_.get(), blob->key_,
+                                             blob->VmoSize(),
+                                             blob->vmo_.reset_and_get_address());
+    if (status != ZX_OK) {
+        FS_TRACE_ERROR("blobfs: Failed to create pager vmo: %d\n", status);
+        return status;
+    }
+    auto detach = fbl::MakeAutoCall([&blob, this]() {
+        zx_pager_detach_vmo(pager_.get(), blob->vmo_.get());
+    });
+
+    // The merkle tree is needed to verify every data page, so read it in up front.
+    const uint64_t merkle_bytes = blob->MerkleBytes();
+    if (merkle_bytes != 0) {
+        fs::Ticker ticker(txn_manager_->LocalMetrics().Collecting());
+        zx::vmo merkle_vmo;
+        if ((status = zx::vmo::create(merkle_bytes, 0, &merkle_vmo)) != ZX_OK) {
+            return status;
+        }
+        vmoid_t merkle_vmoid;
+        if ((status = txn_manager_->AttachVmo(merkle_vmo, &merkle_vmoid)) != ZX_OK) {
+            FS_TRACE_ERROR("blobfs: Failed to attach merkle vmo: %d\n", status);
+            return status;
+        }
+        {
+            auto detach_merkle = fbl::MakeAutoCall([this, merkle_vmoid]() {
+                txn_manager_->DetachVmo(merkle_vmoid);
+            });
+            fs::ReadTxn txn(txn_manager_);
+            if ((status = EnqueueBlocks(&txn, merkle_vmoid, *blob, 0, blob->merkle_blocks_))
+                != ZX_OK) {
+                return status;
+            } else if ((status = txn.Transact()) != ZX_OK) {
+                FS_TRACE_ERROR("blobfs: Failed to read merkle tree: %d\n", status);
+                return status;
+            }
+        }
+        txn_manager_->LocalMetrics().UpdateMerkleDiskRead(merkle_bytes, ticker.End());
+
+        if ((status = zx_pager_supply_pages(pager_.get(), blob->vmo_.get(), 0, merkle_bytes,
+                                            merkle_vmo.get(), 0)) != ZX_OK) {
+            FS_TRACE_ERROR("blobfs: Failed to supply merkle tree: %d\n", status);
+            return status;
+        }
+
+        // The tree is now resident in the blob's VMO; view it from there rather than keeping
+        // a second copy around for verification.
+        zx::vmo merkle_view;
+        if ((status = blob->vmo_.duplicate(ZX_RIGHT_SAME_RIGHTS, &merkle_view)) != ZX_OK) {
+            return status;
+        } else if ((status = blob->merkle_.Map(std::move(merkle_view), merkle_bytes,
+                                               ZX_VM_PERM_READ)) != ZX_OK) {
+            return status;
+        }
+    }
+
+    {
+        fbl::AutoLock lock(&lock_);
+        blobs_.insert(blob);
+    }
+    detach.cancel();
+    *out = std::move(blob);
+    return ZX_OK;
+}
+
+void BlobPager::Detach(PagedBlob* blob) {
+    {
+        fbl::AutoLock lock(&lock_);
+        if (blob->InContainer()) {
+            blobs_.erase(*blob);
+        }
+    }
+    zx_pager_detach_vmo(pager_.get(), blob->vmo_.get());
+}
+
+int BlobPager::PagerThread(void* arg) {
+    return reinterpret_cast<BlobPager*>(arg)->Run();
+}
+
+int BlobPager::Run() {
+    while (true) {
+        zx_port_packet_t packet;
+        zx_status_t status = port_.wait(zx::time::infinite(), &packet);
+        if (status != ZX_OK) {
+            FS_TRACE_ERROR("blobfs: Pager port wait failed: %d\n", status);
+            return -1;
+        }
+        if (packet.type == ZX_PKT_TYPE_USER) {
+            return 0;
+        }
+        // ZX_PAGER_VMO_COMPLETE needs no cleanup; the blob left |blobs_| when it was detached.
+        if (packet.type != ZX_PKT_TYPE_PAGE_REQUEST ||
+            packet.page_request.command != ZX_PAGER_VMO_READ) {
+            continue;
+        }
+
+        fbl::RefPtr<PagedBlob> blob;
+        {
+            fbl::AutoLock lock(&lock_);
+            auto iter = blobs_.find(packet.key);
+            if (!iter.IsValid()) {
+                // Raced with Detach; the request has already been failed.
+                continue;
+            }
+            blob = iter.CopyPointer();
+        }
+
+        status = PopulateRange(blob.get(), packet.page_request.offset,
+                               packet.page_request.length);
+        if (status != ZX_OK) {
+            char name[Digest::kLength * 2 + 1];
+            ZX_ASSERT(blob->digest_.ToString(name, sizeof(name)) == ZX_OK);
+            FS_TRACE_ERROR("blobfs: Failed to page in %s [%lu, %lu): %s\n", name,
+                           packet.page_request.offset,
+                           packet.page_request.offset + packet.page_request.length,
+                           zx_status_get_string(status));
+            // There is no way to fail a single request, and the faulting thread would otherwise
+            // wait forever. Detaching fails this request and every later one on the blob.
+            Detach(blob.get());
+        }
+    }
+}
+
+zx_status_t BlobPager::PopulateRange(PagedBlob* blob, uint64_t offset, uint64_t length) {
+    TRACE_DURATION("blobfs", "BlobPager::PopulateRange", "offset", offset, "length", length);
+    const uint64_t merkle_bytes = blob->MerkleBytes();
+    const uint64_t vmo_size = blob->VmoSize();
+    // The merkle tree was supplied when the VMO was created.
+    ZX_DEBUG_ASSERT(offset >= merkle_bytes);
+
+    // Widen the request to whole blocks, which are also whole merkle tree leaves, so that each
+    // leaf is verified in one piece.
+    static_assert(kBlobfsBlockSize == MerkleTree::kNodeSize, "Blocks must match merkle nodes");
+    uint64_t start = fbl::round_down(offset, kBlobfsBlockSize);
+    const uint64_t end = fbl::min(fbl::round_up(offset + length, kBlobfsBlockSize), vmo_size);
+    if (start < merkle_bytes || end <= start) {
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+
+    const void* tree = merkle_bytes ? blob->merkle_.start() : nullptr;
+    const uint64_t tree_size = MerkleTree::GetTreeLength(blob->blob_size_);
+    uint8_t* buffer = static_cast<uint8_t*>(transfer_.start());
+
+    while (start < end) {
+        const uint64_t chunk = fbl::min(end - start, kTransferBufferSize);
+        const uint64_t data_offset = start - merkle_bytes;
+
+        fs::Ticker ticker(txn_manager_->LocalMetrics().Collecting());
+        fs::ReadTxn txn(txn_manager_);
+        zx_status_t status = EnqueueBlocks(&txn, transfer_vmoid_, *blob,
+                                           start / kBlobfsBlockSize, chunk / kBlobfsBlockSize);
+        if (status != ZX_OK) {
+            return status;
+        } else if ((status = txn.Transact()) != ZX_OK) {
+            return status;
+        }
+        fs::Duration read_time = ticker.End();
+        ticker.Reset();
+
+        // The tail of the final block is padding, which the merkle tree does not cover.
+        const uint64_t data_length = fbl::min(chunk, blob->blob_size_ - data_offset);
+        if (data_length < chunk) {
+            memset(buffer + data_length, 0, chunk - data_length);
+        }
+
+        // The transfer buffer holds the data starting at |data_offset|.
+        status = MerkleTree::Verify(buffer, data_offset, blob->blob_size_, tree, tree_size,
+                                    data_offset, data_length, blob->digest_);
+        txn_manager_->LocalMetrics().UpdatePagedRead(chunk, read_time, ticker.End());
+        if (status != ZX_OK) {
+            return status;
+        }
+
+        // Supplying moves the pages out of the transfer buffer and into the blob's VMO.
+        if ((status = zx_pager_supply_pages(pager_.get(), blob->vmo_.get(), start, chunk,
+                                            transfer_.vmo().get(), 0)) != ZX_OK) {
+            return status;
+        }
+        start += chunk;
+    }
+    return ZX_OK;
+}
+
+zx_status_t BlobPager::EnqueueBlocks(fs::ReadTxn* txn, vmoid_t vmoid, const PagedBlob& blob,
+                                     uint64_t block, uint64_t block_count) {
+    const uint64_t end = block + block_count;
+    uint64_t extent_block = 0;
+    for (const Extent& extent : blob.extents_) {
+        const uint64_t extent_end = extent_block + extent.Length();
+        if (extent_end > block && extent_block < end) {
+            const uint64_t first = fbl::max(block, extent_block);
+            const uint64_t last = fbl::min(end, extent_end);
+            txn->Enqueue(vmoid, first - block,
+                         blob.data_start_ + extent.Start() + (first - extent_block),
+                         last - first);
+        }
+        if (extent_end >= end) {
+            return ZX_OK;
+        }
+        extent_block = extent_end;
+    }
+    FS_TRACE_ERROR("blobfs: Blob extents do not cover blocks [%lu, %lu)\n", block, end);
+    return ZX_ERR_IO_DATA_INTEGRITY;
+}
+
+} // namespace blobfs
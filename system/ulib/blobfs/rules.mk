@@ -39,6 +39,7 @@ COMMON_TARGET_SRCS := \
     $(LOCAL_DIR)/iterator/node-populator.cpp \
     $(LOCAL_DIR)/journal.cpp \
     $(LOCAL_DIR)/metrics.cpp \
+    $(LOCAL_DIR)/pager.cpp \
     $(LOCAL_DIR)/writeback.cpp \
 
 TARGET_MODULE_STATIC_LIBS := \
@@ -112,6 +113,7 @@ MODULE_SRCS := \
     $(TEST_DIR)/main.cpp \
     $(TEST_DIR)/node-populator-test.cpp \
     $(TEST_DIR)/node-reserver-test.cpp \
+    $(TEST_DIR)/pager-test.cpp \
     $(TEST_DIR)/utils.cpp \
     $(TEST_DIR)/vector-extent-iterator-test.cpp \
     $(TEST_DIR)/writeback-test.cpp \
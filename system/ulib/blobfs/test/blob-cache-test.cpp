@@ -11,6 +11,9 @@
 namespace blobfs {
 namespace {
 
+// The memory held by a TestNode which is using memory.
+constexpr uint64_t kNodeMemory = 8192;
+
 // A mock Node, comparable to Blob.
 //
 // "ShouldCache" mimics the internal Vnode state machine.
@@ -37,6 +40,10 @@ public:
         using_memory_ = false;
     }
 
+    uint64_t MemoryUsage() const final {
+        return using_memory_ ? kNodeMemory : 0;
+    }
+
     bool UsingMemory() {
         return using_memory_;
     }
@@ -380,6 +387,113 @@ bool CachePolicyNeverEvictTest() {
     END_TEST;
 }
 
+// Adds a node using memory to |cache|, and closes it.
+bool AddClosedNodeHelper(BlobCache* cache, const Digest& digest) {
+    BEGIN_HELPER;
+    fbl::RefPtr<TestNode> node = fbl::AdoptRef(new TestNode(digest, cache));
+    node->SetHighMemory();
+    ASSERT_EQ(ZX_OK, cache->Add(node));
+    END_HELPER;
+}
+
+// Reopens the node identified by |digest|, checks if it is still using memory, and closes it
+// again (making it the most recently used node).
+bool CheckUsingMemoryHelper(BlobCache* cache, const Digest& digest, bool using_memory) {
+    BEGIN_HELPER;
+    fbl::RefPtr<CacheNode> cache_node;
+    ASSERT_EQ(ZX_OK, cache->Lookup(digest, &cache_node));
+    auto node = fbl::RefPtr<TestNode>::Downcast(std::move(cache_node));
+    ASSERT_EQ(using_memory, node->UsingMemory());
+    END_HELPER;
+}
+
+bool CachePolicyLruByteLimitTest() {
+    BEGIN_TEST;
+
+    BlobCache cache;
+    cache.SetCachePolicy(CachePolicy::EvictLeastRecentlyUsed);
+    cache.SetCacheLimits(2 * kNodeMemory, 100);
+
+    Digest digests[] = { GenerateDigest(0), GenerateDigest(1), GenerateDigest(2) };
+    for (const Digest& digest : digests) {
+        ASSERT_TRUE(AddClosedNodeHelper(&cache, digest));
+    }
+
+    // Only the two most recently closed nodes fit within the budget.
+    ASSERT_TRUE(CheckUsingMemoryHelper(&cache, digests[0], false));
+    ASSERT_TRUE(CheckUsingMemoryHelper(&cache, digests[1], true));
+    ASSERT_TRUE(CheckUsingMemoryHelper(&cache, digests[2], true));
+
+    END_TEST;
+}
+
+bool CachePolicyLruNodeLimitTest() {
+    BEGIN_TEST;
+
+    BlobCache cache;
+    cache.SetCachePolicy(CachePolicy::EvictLeastRecentlyUsed);
+    cache.SetCacheLimits(100 * kNodeMemory, 1);
+
+    Digest digests[] = { GenerateDigest(0), GenerateDigest(1) };
+    for (const Digest& digest : digests) {
+        ASSERT_TRUE(AddClosedNodeHelper(&cache, digest));
+    }
+
+    ASSERT_TRUE(CheckUsingMemoryHelper(&cache, digests[0], false));
+    ASSERT_TRUE(CheckUsingMemoryHelper(&cache, digests[1], true));
+
+    // Shrinking the budget evicts immediately.
+    cache.SetCacheLimits(100 * kNodeMemory, 0);
+    ASSERT_TRUE(CheckUsingMemoryHelper(&cache, digests[1], false));
+
+    END_TEST;
+}
+
+bool CachePolicyLruReopenTest() {
+    BEGIN_TEST;
+
+    BlobCache cache;
+    cache.SetCachePolicy(CachePolicy::EvictLeastRecentlyUsed);
+    cache.SetCacheLimits(2 * kNodeMemory, 100);
+
+    Digest digests[] = { GenerateDigest(0), GenerateDigest(1), GenerateDigest(2) };
+    ASSERT_TRUE(AddClosedNodeHelper(&cache, digests[0]));
+    ASSERT_TRUE(AddClosedNodeHelper(&cache, digests[1]));
+
+    // Reopening the first node makes it the most recently used, so the second node
+    // is evicted to make room for the third.
+    ASSERT_TRUE(CheckUsingMemoryHelper(&cache, digests[0], true));
+    ASSERT_TRUE(AddClosedNodeHelper(&cache, digests[2]));
+
+    ASSERT_TRUE(CheckUsingMemoryHelper(&cache, digests[1], false));
+    ASSERT_TRUE(CheckUsingMemoryHelper(&cache, digests[0], true));
+    ASSERT_TRUE(CheckUsingMemoryHelper(&cache, digests[2], true));
+
+    END_TEST;
+}
+
+bool CachePolicyLruMemoryPressureTest() {
+    BEGIN_TEST;
+
+    BlobCache cache;
+    cache.SetCachePolicy(CachePolicy::EvictLeastRecentlyUsed);
+
+    Digest digests[] = { GenerateDigest(0), GenerateDigest(1) };
+    for (const Digest& digest : digests) {
+        ASSERT_TRUE(AddClosedNodeHelper(&cache, digest));
+    }
+
+    // Open nodes are left alone.
+    fbl::RefPtr<CacheNode> cache_node;
+    ASSERT_EQ(ZX_OK, cache.Lookup(digests[0], &cache_node));
+    auto open_node = fbl::RefPtr<TestNode>::Downcast(std::move(cache_node));
+
+    cache.OnMemoryPressure();
+    ASSERT_TRUE(open_node->UsingMemory());
+    ASSERT_TRUE(CheckUsingMemoryHelper(&cache, digests[1], false));
+
+    END_TEST;
+}
 
 } // namespace
 } // namespace blobfs
@@ -397,4 +511,8 @@ RUN_TEST(blobfs::DestructorTest)
 RUN_TEST(blobfs::ForAllOpenNodesTest)
 RUN_TEST(blobfs::CachePolicyEvictImmediatelyTest)
 RUN_TEST(blobfs::CachePolicyNeverEvictTest)
+RUN_TEST(blobfs::CachePolicyLruByteLimitTest)
+RUN_TEST(blobfs::CachePolicyLruNodeLimitTest)
+RUN_TEST(blobfs::CachePolicyLruReopenTest)
+RUN_TEST(blobfs::CachePolicyLruMemoryPressureTest)
 END_TEST_CASE(blobfsBlobCacheTests);
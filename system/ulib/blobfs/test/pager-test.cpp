@@ -0,0 +1,225 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <blobfs/pager.h>
+#include <digest/merkle-tree.h>
+#include <fbl/array.h>
+#include <fbl/auto_lock.h>
+#include <fbl/mutex.h>
+#include <unittest/unittest.h>
+#include <zircon/device/block.h>
+
+namespace blobfs {
+namespace {
+
+using digest::MerkleTree;
+
+// The blob spans several merkle tree leaves, and ends partway through a block.
+constexpr uint64_t kBlobSize = 5 * kBlobfsBlockSize + 100;
+constexpr uint64_t kDiskBlocks = 32;
+
+// A transaction manager backed by an in-memory disk, which only services reads.
+class FakeTransactionManager : public TransactionManager {
+public:
+    FakeTransactionManager()
+        : disk_(new uint8_t[kDiskBlocks * kBlobfsBlockSize], kDiskBlocks * kBlobfsBlockSize) {
+        memset(disk_.get(), 0, disk_.size());
+    }
+
+    uint8_t* DataBlock(uint64_t block) {
+        return disk_.get() + (DataStartBlock(superblock_) + block) * kBlobfsBlockSize;
+    }
+
+    uint32_t FsBlockSize() const final { return kBlobfsBlockSize; }
+    uint32_t DeviceBlockSize() const final { return kBlobfsBlockSize; }
+    groupid_t BlockGroupID() final { return 0; }
+
+    zx_status_t Transaction(block_fifo_request_t* requests, size_t count) final {
+        fbl::AutoLock lock(&lock_);
+        for (size_t i = 0; i < count; i++) {
+            const block_fifo_request_t& request = requests[i];
+            if ((request.opcode & BLOCKIO_OP_MASK) != BLOCKIO_READ) {
+                return ZX_ERR_NOT_SUPPORTED;
+            } else if (request.vmoid == VMOID_INVALID || request.vmoid > vmos_.size()) {
+                return ZX_ERR_INVALID_ARGS;
+            } else if (request.dev_offset + request.length > kDiskBlocks) {
+                return ZX_ERR_OUT_OF_RANGE;
+            }
+            zx_status_t status = vmos_[request.vmoid - 1].write(
+                disk_.get() + request.dev_offset * kBlobfsBlockSize,
+                request.vmo_offset * kBlobfsBlockSize, request.length * kBlobfsBlockSize);
+            if (status != ZX_OK) {
+                return status;
+            }
+        }
+        return ZX_OK;
+    }
+
+    const Superblock& Info() const final { return superblock_; }
+    zx_status_t AddInodes(fzl::ResizeableVmoMapper* node_map) final {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    zx_status_t AddBlocks(size_t nblocks, RawBitmap* map) final {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    zx_status_t AttachVmo(const zx::vmo& vmo, vmoid_t* out) final {
+        fbl::AutoLock lock(&lock_);
+        zx::vmo dup;
+        zx_status_t status = vmo.duplicate(ZX_RIGHT_SAME_RIGHTS, &dup);
+        if (status != ZX_OK) {
+            return status;
+        }
+        vmos_.push_back(std::move(dup));
+        *out = static_cast<vmoid_t>(vmos_.size());
+        return ZX_OK;
+    }
+    zx_status_t DetachVmo(vmoid_t vmoid) final {
+        fbl::AutoLock lock(&lock_);
+        vmos_[vmoid - 1].reset();
+        return ZX_OK;
+    }
+
+    BlobfsMetrics& LocalMetrics() final { return metrics_; }
+    size_t WritebackCapacity() const final { return 0; }
+    zx_status_t CreateWork(fbl::unique_ptr<WritebackWork>* out, Blob* vnode) final {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    zx_status_t EnqueueWork(fbl::unique_ptr<WritebackWork> work, EnqueueType type) final {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
+private:
+    Superblock superblock_{};
+    BlobfsMetrics metrics_{};
+    fbl::Array<uint8_t> disk_;
+
+    fbl::Mutex lock_;
+    fbl::Vector<zx::vmo> vmos_;
+};
+
+// Writes a blob of kBlobSize bytes to |manager|, split across two extents.
+bool WriteBlob(FakeTransactionManager* manager, fbl::Array<uint8_t>* out_data, Inode* out_inode,
+               fbl::Vector<Extent>* out_extents) {
+    BEGIN_HELPER;
+
+    fbl::Array<uint8_t> data(new uint8_t[kBlobSize], kBlobSize);
+    unsigned int seed = 0;
+    for (size_t i = 0; i < kBlobSize; i++) {
+        data[i] = static_cast<uint8_t>(rand_r(&seed));
+    }
+
+    Inode inode = {};
+    inode.blob_size = kBlobSize;
+    const uint64_t merkle_blocks = MerkleTreeBlocks(inode);
+    const uint64_t data_blocks = BlobDataBlocks(inode);
+    const uint64_t blob_blocks = merkle_blocks + data_blocks;
+    inode.block_count = static_cast<uint32_t>(blob_blocks);
+    ASSERT_GT(merkle_blocks, 0u);
+
+    // Lay out the blob in memory as it is on disk: the merkle tree, followed by the data.
+    fbl::Array<uint8_t> blob(new uint8_t[blob_blocks * kBlobfsBlockSize],
+                             blob_blocks * kBlobfsBlockSize);
+    memset(blob.get(), 0, blob.size());
+    memcpy(blob.get() + merkle_blocks * kBlobfsBlockSize, data.get(), kBlobSize);
+    Digest digest;
+    ASSERT_EQ(ZX_OK, MerkleTree::Create(data.get(), kBlobSize, blob.get(),
+                                        MerkleTree::GetTreeLength(kBlobSize), &digest));
+    ASSERT_EQ(ZX_OK, digest.CopyTo(inode.merkle_root_hash, sizeof(inode.merkle_root_hash)));
+
+    // Place the first three blocks of the blob after the rest of it, so that reads must
+    // cross an extent boundary.
+    fbl::Vector<Extent> extents;
+    extents.push_back(Extent(16, 3));
+    extents.push_back(Extent(2, static_cast<BlockCountType>(blob_blocks - 3)));
+    uint64_t block = 0;
+    for (const Extent& extent : extents) {
+        memcpy(manager->DataBlock(extent.Start()), blob.get() + block * kBlobfsBlockSize,
+               extent.Length() * kBlobfsBlockSize);
+        block += extent.Length();
+    }
+
+    *out_data = std::move(data);
+    *out_inode = inode;
+    *out_extents = std::move(extents);
+    END_HELPER;
+}
+
+bool PagedReadTest() {
+    BEGIN_TEST;
+
+    FakeTransactionManager manager;
+    fbl::Array<uint8_t> data;
+    Inode inode;
+    fbl::Vector<Extent> extents;
+    ASSERT_TRUE(WriteBlob(&manager, &data, &inode, &extents));
+
+    fbl::unique_ptr<BlobPager> pager;
+    ASSERT_EQ(ZX_OK, BlobPager::Create(&manager, &pager));
+    fbl::RefPtr<PagedBlob> blob;
+    ASSERT_EQ(ZX_OK, pager->CreateBlob(inode, std::move(extents), &blob));
+
+    const uint64_t merkle_bytes = MerkleTreeBlocks(inode) * kBlobfsBlockSize;
+    fbl::Array<uint8_t> buffer(new uint8_t[kBlobSize], kBlobSize);
+
+    // Fault in a range in the middle of the blob first, then the whole thing.
+    const uint64_t offset = 3 * kBlobfsBlockSize + 17;
+    ASSERT_EQ(ZX_OK, blob->vmo().read(buffer.get(), merkle_bytes + offset, 1000));
+    ASSERT_EQ(0, memcmp(buffer.get(), data.get() + offset, 1000));
+
+    ASSERT_EQ(ZX_OK, blob->vmo().read(buffer.get(), merkle_bytes, kBlobSize));
+    ASSERT_EQ(0, memcmp(buffer.get(), data.get(), kBlobSize));
+
+    // The padding after the end of the blob reads as zeroes.
+    uint8_t tail[100];
+    ASSERT_EQ(ZX_OK, blob->vmo().read(tail, merkle_bytes + kBlobSize, sizeof(tail)));
+    for (size_t i = 0; i < sizeof(tail); i++) {
+        ASSERT_EQ(0, tail[i]);
+    }
+
+    pager->Detach(blob.get());
+    END_TEST;
+}
+
+bool PagedCorruptionTest() {
+    BEGIN_TEST;
+
+    FakeTransactionManager manager;
+    fbl::Array<uint8_t> data;
+    Inode inode;
+    fbl::Vector<Extent> extents;
+    ASSERT_TRUE(WriteBlob(&manager, &data, &inode, &extents));
+
+    // Corrupt the last data block of the blob, which lives in the second extent.
+    const Extent last = extents[extents.size() - 1];
+    manager.DataBlock(last.Start() + last.Length() - 1)[0] ^= 0xff;
+
+    fbl::unique_ptr<BlobPager> pager;
+    ASSERT_EQ(ZX_OK, BlobPager::Create(&manager, &pager));
+    fbl::RefPtr<PagedBlob> blob;
+    ASSERT_EQ(ZX_OK, pager->CreateBlob(inode, std::move(extents), &blob));
+
+    // Intact pages verify and read normally.
+    const uint64_t merkle_bytes = MerkleTreeBlocks(inode) * kBlobfsBlockSize;
+    uint8_t buffer[100];
+    ASSERT_EQ(ZX_OK, blob->vmo().read(buffer, merkle_bytes, sizeof(buffer)));
+    ASSERT_EQ(0, memcmp(buffer, data.get(), sizeof(buffer)));
+
+    // Corrupted pages are never supplied.
+    ASSERT_NE(ZX_OK, blob->vmo().read(buffer, merkle_bytes + kBlobSize - sizeof(buffer),
+                                      sizeof(buffer)));
+
+    pager->Detach(blob.get());
+    END_TEST;
+}
+
+} // namespace
+} // namespace blobfs
+
+BEGIN_TEST_CASE(blobfsPagerTests)
+RUN_TEST(blobfs::PagedReadTest)
+RUN_TEST(blobfs::PagedCorruptionTest)
+END_TEST_CASE(blobfsPagerTests);
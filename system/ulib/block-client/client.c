@@ -3,6 +3,9 @@
 // found in the LICENSE file.
 
 #include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <threads.h>
 #include <unistd.h>
 
 #include <block-client/client.h>
@@ -129,3 +132,55 @@ zx_status_t block_fifo_txn(fifo_client_t* client, block_fifo_request_t* requests
 
     return client->groups[group].status;
 }
+
+typedef struct fifo_mq_client {
+    size_t count;
+    fifo_client_t* queues[BLOCK_MAX_QUEUES];
+} fifo_mq_client_t;
+
+zx_status_t block_fifo_create_mq_client(const zx_handle_t* fifos, size_t count,
+                                        fifo_mq_client_t** out) {
+    assert(count > 0 && count <= BLOCK_MAX_QUEUES);
+    fifo_mq_client_t* client = calloc(sizeof(fifo_mq_client_t), 1);
+    if (client == NULL) {
+        zx_handle_close_many(fifos, count);
+        return ZX_ERR_NO_MEMORY;
+    }
+    for (size_t i = 0; i < count; i++) {
+        zx_status_t status = block_fifo_create_client(fifos[i], &client->queues[i]);
+        if (status != ZX_OK) {
+            zx_handle_close_many(&fifos[i + 1], count - i - 1);
+            block_fifo_release_mq_client(client);
+            return status;
+        }
+        client->count++;
+    }
+    *out = client;
+    return ZX_OK;
+}
+
+void block_fifo_release_mq_client(fifo_mq_client_t* client) {
+    if (client == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < client->count; i++) {
+        block_fifo_release_client(client->queues[i]);
+    }
+    free(client);
+}
+
+// Returns a small integer unique to the calling thread, assigning one on first use.
+static size_t thread_slot(void) {
+    static atomic_size_t next_slot;
+    static thread_local size_t slot = SIZE_MAX;
+    if (slot == SIZE_MAX) {
+        slot = atomic_fetch_add(&next_slot, 1);
+    }
+    return slot;
+}
+
+zx_status_t block_fifo_mq_txn(fifo_mq_client_t* client, block_fifo_request_t* requests,
+                              size_t count) {
+    return block_fifo_txn(client->queues[thread_slot() % client->count], requests, count);
+}
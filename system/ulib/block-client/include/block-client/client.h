@@ -40,4 +40,28 @@ void block_fifo_release_client(fifo_client_t* client);
 // dev_offset                               read, write
 zx_status_t block_fifo_txn(fifo_client_t* client, block_fifo_request_t* requests, size_t count);
 
+typedef struct fifo_mq_client fifo_mq_client_t;
+
+// Allocates a client for a block server which serves |count| FIFOs: the first
+// obtained with IOCTL_BLOCK_GET_FIFOS, and the rest with IOCTL_BLOCK_GET_QUEUE_FIFO.
+// Each thread issuing transactions through the client is assigned one of the
+// FIFOs, so that transactions from different threads are dispatched by
+// different threads of the block server.
+// This function takes ownership of |fifos|.
+//
+// |count| must be between 1 and BLOCK_MAX_QUEUES.
+zx_status_t block_fifo_create_mq_client(const zx_handle_t* fifos, size_t count,
+                                        fifo_mq_client_t** out);
+
+// Frees a multi-queue block fifo client.
+void block_fifo_release_mq_client(fifo_mq_client_t* client);
+
+// Like block_fifo_txn, using the FIFO assigned to the calling thread.
+//
+// Transactions are only ordered with respect to other transactions issued on
+// the same FIFO, so a thread which relies on barriers must not depend upon the
+// transactions of other threads.
+zx_status_t block_fifo_mq_txn(fifo_mq_client_t* client, block_fifo_request_t* requests,
+                              size_t count);
+
 __END_CDECLS
@@ -30,15 +30,60 @@ namespace crypto {
 
 // The previously opaque crypto implementation context.  Guaranteed to clean up on destruction.
 struct Cipher::Context {
-    Context() { EVP_CIPHER_CTX_init(&impl); }
+    Context() : batched(false) {
+        EVP_CIPHER_CTX_init(&impl);
+        EVP_CIPHER_CTX_init(&data);
+        EVP_CIPHER_CTX_init(&tweak);
+    }
 
-    ~Context() { EVP_CIPHER_CTX_cleanup(&impl); }
+    ~Context() {
+        EVP_CIPHER_CTX_cleanup(&impl);
+        EVP_CIPHER_CTX_cleanup(&data);
+        EVP_CIPHER_CTX_cleanup(&tweak);
+    }
 
     EVP_CIPHER_CTX impl;
+
+    // AES-ECB contexts for |Cipher::TransformBatched|, keyed with the halves of the XTS key.  These
+    // are only initialized if |batched| is set.
+    EVP_CIPHER_CTX data;
+    EVP_CIPHER_CTX tweak;
+    bool batched;
 };
 
 namespace {
 
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "XTS tweaks assume little endian");
+
+// XTS transforms data in 16 byte blocks, each with its own tweak.
+const size_t kXtsBlockSize = 16;
+
+// The number of data units whose initial tweaks are computed together by |TransformBatched|.
+const size_t kXtsBatchUnits = 32;
+
+// Advances an XTS |tweak| to that of the next block of its data unit, by multiplying it by the
+// primitive element of GF(2^128).  This matches BoringSSL's XTS implementation, so that data
+// written by either can be read by the other.
+void XtsNextTweak(uint64_t tweak[2]) {
+    uint64_t res = (tweak[1] >> 63) ? 0x87 : 0;
+    tweak[1] = (tweak[1] << 1) | (tweak[0] >> 63);
+    tweak[0] = (tweak[0] << 1) ^ res;
+}
+
+// XORs the |len| bytes from |in| with the tweaks of a data unit whose first tweak is |first|, and
+// stores them to |out|.
+void XtsApplyTweaks(const uint8_t* in, size_t len, const uint8_t* first, uint8_t* out) {
+    uint64_t tweak[2], block[2];
+    memcpy(tweak, first, sizeof(tweak));
+    for (size_t off = 0; off < len; off += kXtsBlockSize) {
+        memcpy(block, in + off, sizeof(block));
+        block[0] ^= tweak[0];
+        block[1] ^= tweak[1];
+        memcpy(out + off, block, sizeof(block));
+        XtsNextTweak(tweak);
+    }
+}
+
 // Get the cipher for the given |version|.
 zx_status_t GetCipher(Cipher::Algorithm cipher, const EVP_CIPHER** out) {
     switch (cipher) {
@@ -169,6 +214,21 @@ zx_status_t Cipher::Init(Algorithm algo, Direction direction, const Secret& key,
         xprintf_crypto_errors(&rc);
         return rc;
     }
+
+    // BoringSSL's XTS mode encrypts one AES block at a time.  Random access XTS ciphers whose data
+    // units are made of whole blocks can instead encrypt many blocks per call in ECB mode, which
+    // lets the hardware AES paths keep several blocks in flight.
+    if (algo == kAES256_XTS && alignment != 0 && alignment % kXtsBlockSize == 0) {
+        const EVP_CIPHER* ecb = EVP_aes_256_ecb();
+        const uint8_t* key2 = key.get() + key.len() / 2;
+        if (EVP_CipherInit_ex(&ctx_->data, ecb, nullptr, key.get(), nullptr,
+                              direction == kEncrypt) <= 0 ||
+            EVP_CipherInit_ex(&ctx_->tweak, ecb, nullptr, key2, nullptr, 1) <= 0) {
+            xprintf_crypto_errors(&rc);
+            return rc;
+        }
+        ctx_->batched = true;
+    }
     direction_ = direction;
     block_size_ = cipher->block_size;
 
@@ -203,6 +263,9 @@ zx_status_t Cipher::Transform(const uint8_t* in, zx_off_t offset, size_t length,
             xprintf("unaligned offset\n");
             return ZX_ERR_INVALID_ARGS;
         }
+        if (ctx_->batched && length % kXtsBlockSize == 0) {
+            return TransformBatched(in, offset, length, out);
+        }
         iv_[0] = iv0_ + static_cast<uint64_t>(offset / alignment_);
         uint8_t* iv8 = reinterpret_cast<uint8_t*>(iv_.get());
         while (length > 0) {
@@ -222,6 +285,50 @@ zx_status_t Cipher::Transform(const uint8_t* in, zx_off_t offset, size_t length,
     return ZX_OK;
 }
 
+zx_status_t Cipher::TransformBatched(const uint8_t* in, zx_off_t offset, size_t length,
+                                     uint8_t* out) {
+    zx_status_t rc;
+
+    uint64_t unit = iv0_ + static_cast<uint64_t>(offset / alignment_);
+    uint8_t tweaks[kXtsBatchUnits][kXtsBlockSize];
+    while (length > 0) {
+        // The first tweak of each data unit is its IV, encrypted with the second half of the key.
+        size_t num = 0;
+        size_t batch_len = 0;
+        for (; num < kXtsBatchUnits && batch_len < length; ++num) {
+            iv_[0] = unit + num;
+            memcpy(tweaks[num], iv_.get(), kXtsBlockSize);
+            batch_len += fbl::min(length - batch_len, alignment_);
+        }
+        if (EVP_Cipher(&ctx_->tweak, tweaks[0], tweaks[0], num * kXtsBlockSize) <= 0) {
+            xprintf_crypto_errors(&rc);
+            return rc;
+        }
+
+        // Each block is XORed with its tweak both before and after being transformed with the
+        // first half of the key; the transformation itself covers the whole batch at once.
+        for (size_t i = 0; i < num; ++i) {
+            size_t off = i * alignment_;
+            XtsApplyTweaks(in + off, fbl::min(batch_len - off, alignment_), tweaks[i], out + off);
+        }
+        if (EVP_Cipher(&ctx_->data, out, out, batch_len) <= 0) {
+            xprintf_crypto_errors(&rc);
+            return rc;
+        }
+        for (size_t i = 0; i < num; ++i) {
+            size_t off = i * alignment_;
+            XtsApplyTweaks(out + off, fbl::min(batch_len - off, alignment_), tweaks[i], out + off);
+        }
+
+        in += batch_len;
+        out += batch_len;
+        length -= batch_len;
+        unit += num;
+    }
+
+    return ZX_OK;
+}
+
 void Cipher::Reset() {
     ctx_.reset();
     block_size_ = 0;
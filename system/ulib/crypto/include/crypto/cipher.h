@@ -108,6 +108,11 @@ public:
 private:
     DISALLOW_COPY_ASSIGN_AND_MOVE(Cipher);
 
+    // Transforms |length| bytes, which must be a multiple of the AES block size, as described in
+    // |Transform| for a random access AES-XTS cipher.  Processes a batch of data units at a time
+    // with a single call into the AES implementation.
+    zx_status_t TransformBatched(const uint8_t* in, zx_off_t offset, size_t length, uint8_t* out);
+
     // Opaque crypto implementation context.
     struct Context;
 
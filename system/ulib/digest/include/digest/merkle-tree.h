@@ -67,6 +67,15 @@ public:
                               const void* tree, size_t tree_len, size_t offset,
                               size_t length, const Digest& digest);
 
+    // Like |Verify| above, but |data| holds the data starting at |data_offset|
+    // rather than at the start of the |data_len| bytes covered by the tree.
+    // |data_offset| must be a multiple of |kNodeSize| no greater than |offset|,
+    // and |data| must hold the data up to the end of the node containing the end
+    // of the range, or to |data_len|, whichever comes first.
+    static zx_status_t Verify(const void* data, size_t data_offset, size_t data_len,
+                              const void* tree, size_t tree_len, size_t offset,
+                              size_t length, const Digest& digest);
+
     // The stateful instance methods below are only needed when creating a
     // Merkle tree using the Init/Update/Final methods.
     MerkleTree();
@@ -102,10 +111,12 @@ private:
     // offset and length.  It checks integrity using next level up of the given
     // Merkle tree. |tree_len| must be at least as much as returned by
     // |GetTreeLength(data_len)|.  |offset| and |length| must describe a range
-    // wholly within |data_len|.
-    static zx_status_t VerifyLevel(const void* data, size_t data_len,
-                                   const void* tree, size_t offset,
-                                   size_t length, uint64_t level);
+    // wholly within |data_len|.  |data| holds the level starting at
+    // |data_offset|.
+    static zx_status_t VerifyLevel(const void* data, size_t data_offset,
+                                   size_t data_len, const void* tree,
+                                   size_t offset, size_t length,
+                                   uint64_t level);
 
     // See CreateFinal.  This implements that method, with an extra parameter to
     // allow levels other than the bottommost to be padded.
@@ -246,16 +246,29 @@ zx_status_t MerkleTree::CreateFinalInternal(const void* data, void* tree, Digest
 
 zx_status_t MerkleTree::Verify(const void* data, size_t data_len, const void* tree, size_t tree_len,
                                size_t offset, size_t length, const Digest& root) {
+    return Verify(data, 0, data_len, tree, tree_len, offset, length, root);
+}
+
+zx_status_t MerkleTree::Verify(const void* data, size_t data_offset, size_t data_len,
+                               const void* tree, size_t tree_len, size_t offset, size_t length,
+                               const Digest& root) {
+    // A single node of data is checked against the root as a whole.
+    if (data_offset % kNodeSize != 0 || data_offset > offset ||
+        (data_offset != 0 && data_len <= kNodeSize)) {
+        return ZX_ERR_INVALID_ARGS;
+    }
     uint64_t level = 0;
     size_t root_len = data_len;
     while (data_len > kNodeSize) {
         zx_status_t rc;
         // Verify the data in this level.
-        if ((rc = VerifyLevel(data, data_len, tree, offset, length, level)) != ZX_OK) {
+        if ((rc = VerifyLevel(data, data_offset, data_len, tree, offset, length, level)) !=
+            ZX_OK) {
             return rc;
         }
-        // Ascend to the next level up.
+        // Ascend to the next level up.  The tree always holds whole levels.
         data = tree;
+        data_offset = 0;
         root_len = NextLength(data_len);
         data_len = NextAligned(data_len);
         tree = static_cast<const uint8_t*>(tree) + data_len;
@@ -288,8 +301,9 @@ zx_status_t MerkleTree::VerifyRoot(const void* data, size_t root_len, uint64_t l
     return (actual == expected ? ZX_OK : ZX_ERR_IO_DATA_INTEGRITY);
 }
 
-zx_status_t MerkleTree::VerifyLevel(const void* data, size_t data_len, const void* tree,
-                                    size_t offset, size_t length, uint64_t level) {
+zx_status_t MerkleTree::VerifyLevel(const void* data, size_t data_offset, size_t data_len,
+                                    const void* tree, size_t offset, size_t length,
+                                    uint64_t level) {
     zx_status_t rc;
     ZX_DEBUG_ASSERT(offset + length >= offset);
     // Must have more than one node of data and digests to check against.
@@ -304,7 +318,8 @@ zx_status_t MerkleTree::VerifyLevel(const void* data, size_t data_len, const voi
     offset -= offset % kNodeSize;
     size_t finish = fbl::round_up(offset + length, kNodeSize);
     length = fbl::min(finish, data_len) - offset;
-    const uint8_t* in = static_cast<const uint8_t*>(data) + offset;
+    ZX_DEBUG_ASSERT(offset >= data_offset);
+    const uint8_t* in = static_cast<const uint8_t*>(data) + (offset - data_offset);
     // The digests are in the next level up.
     Digest actual;
     const uint8_t* expected = static_cast<const uint8_t*>(tree) + (offset / kDigestsPerNode);
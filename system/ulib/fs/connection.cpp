@@ -19,6 +19,8 @@
 #include <lib/fdio/io.h>
 #include <lib/fdio/vfs.h>
 #include <lib/zx/handle.h>
+#include <lib/zx/vmar.h>
+#include <lib/zx/vmo.h>
 #include <zircon/assert.h>
 
 #include <utility>
@@ -200,6 +202,11 @@ ZXFIDL_OPERATION(FileTruncate)
 ZXFIDL_OPERATION(FileGetFlags)
 ZXFIDL_OPERATION(FileSetFlags)
 ZXFIDL_OPERATION(FileGetBuffer)
+ZXFIDL_OPERATION(FileShareBuffer)
+ZXFIDL_OPERATION(FileReadShared)
+ZXFIDL_OPERATION(FileReadSharedAt)
+ZXFIDL_OPERATION(FileWriteShared)
+ZXFIDL_OPERATION(FileWriteSharedAt)
 
 const fuchsia_io_File_ops kFileOps = {
     .Clone = NodeCloneOp,
@@ -218,6 +225,11 @@ const fuchsia_io_File_ops kFileOps = {
     .GetFlags = FileGetFlagsOp,
     .SetFlags = FileSetFlagsOp,
     .GetBuffer = FileGetBufferOp,
+    .ShareBuffer = FileShareBufferOp,
+    .ReadShared = FileReadSharedOp,
+    .ReadSharedAt = FileReadSharedAtOp,
+    .WriteShared = FileWriteSharedOp,
+    .WriteSharedAt = FileWriteSharedAtOp,
 };
 
 ZXFIDL_OPERATION(DirectoryOpen)
@@ -309,6 +321,8 @@ Connection::~Connection() {
     if (token_) {
         vfs_->TokenDiscard(std::move(token_));
     }
+
+    ReleaseSharedBuffer();
 }
 
 void Connection::AsyncTeardown() {
@@ -552,22 +566,29 @@ zx_status_t Connection::FileWrite(const uint8_t* data_data, size_t data_count, f
         return fuchsia_io_FileWrite_reply(txn, ZX_ERR_BAD_HANDLE, 0);
     }
 
+    size_t actual = 0;
+    zx_status_t status = WriteAtSeek(data_data, data_count, &actual);
+    return fuchsia_io_FileWrite_reply(txn, status, actual);
+}
+
+zx_status_t Connection::WriteAtSeek(const void* data, size_t count, size_t* out_actual) {
     size_t actual = 0;
     zx_status_t status;
     if (flags_ & ZX_FS_FLAG_APPEND) {
         size_t end;
-        status = vnode_->Append(data_data, data_count, &end, &actual);
+        status = vnode_->Append(data, count, &end, &actual);
         if (status == ZX_OK) {
             offset_ = end;
         }
     } else {
-        status = vnode_->Write(data_data, data_count, offset_, &actual);
+        status = vnode_->Write(data, count, offset_, &actual);
         if (status == ZX_OK) {
             offset_ += actual;
         }
     }
-    ZX_DEBUG_ASSERT(actual <= data_count);
-    return fuchsia_io_FileWrite_reply(txn, status, actual);
+    ZX_DEBUG_ASSERT(actual <= count);
+    *out_actual = actual;
+    return status;
 }
 
 zx_status_t Connection::FileWriteAt(const uint8_t* data_data, size_t data_count,
@@ -681,6 +702,115 @@ zx_status_t Connection::FileGetBuffer(uint32_t flags, fidl_txn_t* txn) {
     return fuchsia_io_FileGetBuffer_reply(txn, status, status == ZX_OK ? &buffer : nullptr);
 }
 
+zx_status_t Connection::FileShareBuffer(uint64_t size, fidl_txn_t* txn) {
+    if (IsPathOnly(flags_)) {
+        return fuchsia_io_FileShareBuffer_reply(txn, ZX_ERR_BAD_HANDLE, ZX_HANDLE_INVALID);
+    } else if (size == 0 || size > fuchsia_io_MAX_SHARED_BUFFER) {
+        return fuchsia_io_FileShareBuffer_reply(txn, ZX_ERR_INVALID_ARGS, ZX_HANDLE_INVALID);
+    }
+
+    // The buffer is always allocated here rather than accepted from the
+    // client: a client VMO could be a clone or pager-backed, and touching it
+    // could block this dispatch thread indefinitely. The client gets a
+    // handle which can neither resize the VMO nor be used to map or clone it.
+    zx::vmo buffer;
+    zx_status_t status = zx::vmo::create(size, ZX_VMO_NON_RESIZABLE, &buffer);
+    if (status == ZX_OK) {
+        status = buffer.get_size(&size);
+    }
+    if (status != ZX_OK) {
+        return fuchsia_io_FileShareBuffer_reply(txn, status, ZX_HANDLE_INVALID);
+    }
+
+    zx::vmo client_buffer;
+    status = buffer.duplicate(ZX_RIGHT_READ | ZX_RIGHT_WRITE | ZX_RIGHT_TRANSFER,
+                              &client_buffer);
+    if (status != ZX_OK) {
+        return fuchsia_io_FileShareBuffer_reply(txn, status, ZX_HANDLE_INVALID);
+    }
+
+    uintptr_t addr;
+    status = zx::vmar::root_self()->map(0, buffer, 0, size,
+                                        ZX_VM_PERM_READ | ZX_VM_PERM_WRITE, &addr);
+    if (status != ZX_OK) {
+        return fuchsia_io_FileShareBuffer_reply(txn, status, ZX_HANDLE_INVALID);
+    }
+    ReleaseSharedBuffer();
+    shared_buffer_ = addr;
+    shared_buffer_size_ = size;
+    return fuchsia_io_FileShareBuffer_reply(txn, ZX_OK, client_buffer.release());
+}
+
+void Connection::ReleaseSharedBuffer() {
+    if (shared_buffer_ != 0) {
+        zx::vmar::root_self()->unmap(shared_buffer_, shared_buffer_size_);
+        shared_buffer_ = 0;
+        shared_buffer_size_ = 0;
+    }
+}
+
+zx_status_t Connection::FileReadShared(uint64_t count, fidl_txn_t* txn) {
+    if (!IsReadable(flags_)) {
+        return fuchsia_io_FileReadShared_reply(txn, ZX_ERR_BAD_HANDLE, 0);
+    } else if (shared_buffer_ == 0) {
+        return fuchsia_io_FileReadShared_reply(txn, ZX_ERR_BAD_STATE, 0);
+    } else if (count > shared_buffer_size_) {
+        return fuchsia_io_FileReadShared_reply(txn, ZX_ERR_INVALID_ARGS, 0);
+    }
+    void* buffer = reinterpret_cast<void*>(shared_buffer_);
+    size_t actual = 0;
+    zx_status_t status = vnode_->Read(buffer, count, offset_, &actual);
+    if (status == ZX_OK) {
+        ZX_DEBUG_ASSERT(actual <= count);
+        offset_ += actual;
+    }
+    return fuchsia_io_FileReadShared_reply(txn, status, actual);
+}
+
+zx_status_t Connection::FileReadSharedAt(uint64_t count, uint64_t offset, fidl_txn_t* txn) {
+    if (!IsReadable(flags_)) {
+        return fuchsia_io_FileReadSharedAt_reply(txn, ZX_ERR_BAD_HANDLE, 0);
+    } else if (shared_buffer_ == 0) {
+        return fuchsia_io_FileReadSharedAt_reply(txn, ZX_ERR_BAD_STATE, 0);
+    } else if (count > shared_buffer_size_) {
+        return fuchsia_io_FileReadSharedAt_reply(txn, ZX_ERR_INVALID_ARGS, 0);
+    }
+    void* buffer = reinterpret_cast<void*>(shared_buffer_);
+    size_t actual = 0;
+    zx_status_t status = vnode_->Read(buffer, count, offset, &actual);
+    ZX_DEBUG_ASSERT(actual <= count);
+    return fuchsia_io_FileReadSharedAt_reply(txn, status, actual);
+}
+
+zx_status_t Connection::FileWriteShared(uint64_t count, fidl_txn_t* txn) {
+    if (!IsWritable(flags_)) {
+        return fuchsia_io_FileWriteShared_reply(txn, ZX_ERR_BAD_HANDLE, 0);
+    } else if (shared_buffer_ == 0) {
+        return fuchsia_io_FileWriteShared_reply(txn, ZX_ERR_BAD_STATE, 0);
+    } else if (count > shared_buffer_size_) {
+        return fuchsia_io_FileWriteShared_reply(txn, ZX_ERR_INVALID_ARGS, 0);
+    }
+    const void* buffer = reinterpret_cast<const void*>(shared_buffer_);
+    size_t actual = 0;
+    zx_status_t status = WriteAtSeek(buffer, count, &actual);
+    return fuchsia_io_FileWriteShared_reply(txn, status, actual);
+}
+
+zx_status_t Connection::FileWriteSharedAt(uint64_t count, uint64_t offset, fidl_txn_t* txn) {
+    if (!IsWritable(flags_)) {
+        return fuchsia_io_FileWriteSharedAt_reply(txn, ZX_ERR_BAD_HANDLE, 0);
+    } else if (shared_buffer_ == 0) {
+        return fuchsia_io_FileWriteSharedAt_reply(txn, ZX_ERR_BAD_STATE, 0);
+    } else if (count > shared_buffer_size_) {
+        return fuchsia_io_FileWriteSharedAt_reply(txn, ZX_ERR_INVALID_ARGS, 0);
+    }
+    const void* buffer = reinterpret_cast<const void*>(shared_buffer_);
+    size_t actual = 0;
+    zx_status_t status = vnode_->Write(buffer, count, offset, &actual);
+    ZX_DEBUG_ASSERT(actual <= count);
+    return fuchsia_io_FileWriteSharedAt_reply(txn, status, actual);
+}
+
 zx_status_t Connection::DirectoryOpen(uint32_t flags, uint32_t mode, const char* path_data,
                                       size_t path_size, zx_handle_t object) {
     zx::channel channel(object);
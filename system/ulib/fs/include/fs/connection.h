@@ -95,6 +95,11 @@ public:
     zx_status_t FileGetFlags(fidl_txn_t* txn);
     zx_status_t FileSetFlags(uint32_t flags, fidl_txn_t* txn);
     zx_status_t FileGetBuffer(uint32_t flags, fidl_txn_t* txn);
+    zx_status_t FileShareBuffer(uint64_t size, fidl_txn_t* txn);
+    zx_status_t FileReadShared(uint64_t count, fidl_txn_t* txn);
+    zx_status_t FileReadSharedAt(uint64_t count, uint64_t offset, fidl_txn_t* txn);
+    zx_status_t FileWriteShared(uint64_t count, fidl_txn_t* txn);
+    zx_status_t FileWriteSharedAt(uint64_t count, uint64_t offset, fidl_txn_t* txn);
 
     // Directory Operations.
     zx_status_t DirectoryOpen(uint32_t flags, uint32_t mode, const char* path_data,
@@ -155,6 +160,14 @@ private:
     // protocols, dispatching to |HandleFsSpecificMessage| if the ordinal is not recognized.
     zx_status_t HandleMessage(fidl_msg_t* msg, fidl_txn_t* txn);
 
+    // Writes |count| bytes of |data| at the seek offset, or at the end of the
+    // file if the connection is in append mode, and moves the seek offset past
+    // them.
+    zx_status_t WriteAtSeek(const void* data, size_t count, size_t* out_actual);
+
+    // Unmaps the VMO shared with the client, if any.
+    void ReleaseSharedBuffer();
+
     bool is_open() const { return wait_.object() != ZX_HANDLE_INVALID; }
     void set_closed() { wait_.set_object(ZX_HANDLE_INVALID); }
 
@@ -181,6 +194,11 @@ private:
 
     // Current seek offset.
     size_t offset_{};
+
+    // Mapping of the VMO shared with the client for ReadShared and WriteShared,
+    // or zero if none has been shared.
+    uintptr_t shared_buffer_{};
+    size_t shared_buffer_size_{};
 };
 
 } // namespace fs
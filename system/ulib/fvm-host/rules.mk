@@ -45,5 +45,6 @@ MODULE_HOST_LIBS := \
     system/ulib/fs.hostlib \
     system/ulib/digest.hostlib \
     system/ulib/minfs.hostlib \
+    third_party/ulib/cksum.hostlib \
 
 include make/module.mk
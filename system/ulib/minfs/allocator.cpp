@@ -107,6 +107,8 @@ zx_status_t Allocator::Create(Bcache* bc, SuperblockManager* sb, fs::ReadTxn* tx
     const void* data = allocator->map_.StorageUnsafe()->GetData();
 #endif
     txn->Enqueue(data, 0, allocator->metadata_.MetadataStartBlock(), pool_blocks);
+    // The map is read from disk by |txn| before it is next scanned.
+    allocator->map_.StorageModified();
     *out = std::move(allocator);
     return ZX_OK;
 }
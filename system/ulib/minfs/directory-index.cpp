@@ -0,0 +1,107 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <fbl/algorithm.h>
+#include <fbl/alloc_checker.h>
+#include <minfs/directory-index.h>
+#include <zircon/assert.h>
+
+#include <utility>
+
+namespace minfs {
+
+DirectoryIndex::~DirectoryIndex() = default;
+
+uint64_t DirectoryIndex::NameKey(fbl::StringPiece name, size_t off) {
+    uint64_t hash = DirectoryIndexHash(name);
+    return (hash << 32) | static_cast<uint32_t>(off);
+}
+
+zx_status_t DirectoryIndex::Insert(const Dirent* de, size_t off) {
+    ZX_DEBUG_ASSERT(off < kMinfsMaxDirectorySize);
+    const uint32_t reclen = MinfsReclen(const_cast<Dirent*>(de), off);
+    uint32_t used = 0;
+    fbl::AllocChecker ac;
+    if (de->ino != 0) {
+        used = DirentSize(de->namelen);
+        fbl::unique_ptr<NameNode> node(
+                new (&ac) NameNode(NameKey(fbl::StringPiece(de->name, de->namelen), off)));
+        if (!ac.check()) {
+            return ZX_ERR_NO_MEMORY;
+        }
+        names_.insert(std::move(node));
+    }
+
+    if (de->reclen & kMinfsReclenLast) {
+        last_off_ = static_cast<uint32_t>(off);
+        last_used_ = used;
+    } else if (reclen > used) {
+        fbl::unique_ptr<SlackNode> node(
+                new (&ac) SlackNode(static_cast<uint32_t>(off), reclen, used));
+        if (!ac.check()) {
+            return ZX_ERR_NO_MEMORY;
+        }
+        max_slack_ = fbl::max(max_slack_, node->Slack());
+        slack_.insert(std::move(node));
+    }
+    return ZX_OK;
+}
+
+void DirectoryIndex::Remove(const Dirent* de, size_t off) {
+    if (de->ino != 0) {
+        auto node = names_.erase(NameKey(fbl::StringPiece(de->name, de->namelen), off));
+        ZX_DEBUG_ASSERT(node != nullptr);
+    }
+    // The last record is never removed without inserting its replacement, which updates
+    // |last_off_| in turn.
+    slack_.erase(static_cast<uint32_t>(off));
+}
+
+bool DirectoryIndex::FindCandidate(fbl::StringPiece name, size_t n, size_t* out_off) const {
+    const uint64_t key = NameKey(name, 0);
+    for (auto iter = names_.lower_bound(key); iter.IsValid(); ++iter) {
+        if ((iter->GetKey() >> 32) != (key >> 32)) {
+            break;
+        }
+        if (n-- == 0) {
+            *out_off = static_cast<uint32_t>(iter->GetKey());
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DirectoryIndex::FindSpace(uint32_t reclen, size_t* out_off) {
+    if (max_slack_ >= reclen) {
+        uint32_t max_slack = 0;
+        for (const auto& node : slack_) {
+            if (node.Slack() >= reclen) {
+                *out_off = node.off;
+                return true;
+            }
+            max_slack = fbl::max(max_slack, node.Slack());
+        }
+        // Every record was visited, so the bound is now exact.
+        max_slack_ = max_slack;
+    }
+
+    if (kMinfsMaxDirectorySize - last_off_ - last_used_ >= reclen) {
+        *out_off = last_off_;
+        return true;
+    }
+    return false;
+}
+
+size_t DirectoryIndex::FreeRecordBefore(size_t off) const {
+    // Every free record other than the last is in |slack_|, so if the preceding record is free,
+    // it is the greatest offset in |slack_| below |off|.
+    auto iter = slack_.lower_bound(static_cast<uint32_t>(off));
+    --iter;
+    if (iter.IsValid() && iter->used == 0 && iter->off + iter->reclen == off) {
+        return iter->off;
+    }
+    return off;
+}
+
+} // namespace minfs
@@ -46,6 +46,9 @@ private:
                                blk_t* bno_out);
     zx_status_t CheckDirectory(Inode* inode, ino_t ino,
                                ino_t parent, uint32_t flags);
+    // Verifies that the on-disk index of a directory files each of its live entries exactly
+    // once, in the correct bucket. Rewrites any bucket which does not.
+    zx_status_t CheckDirectoryIndex(Inode* inode, ino_t ino);
     const char* CheckDataBlock(blk_t bno);
     zx_status_t CheckFile(Inode* inode, ino_t ino);
 
@@ -273,6 +276,98 @@ zx_status_t MinfsChecker::CheckDirectory(Inode* inode, ino_t ino,
     return ZX_OK;
 }
 
+namespace {
+
+int CompareIndexSlots(const void* a, const void* b) {
+    const uint32_t off_a = static_cast<const DirectoryIndexSlot*>(a)->off;
+    const uint32_t off_b = static_cast<const DirectoryIndexSlot*>(b)->off;
+    return (off_a > off_b) - (off_a < off_b);
+}
+
+} // namespace
+
+zx_status_t MinfsChecker::CheckDirectoryIndex(Inode* inode, ino_t ino) {
+    const uint32_t buckets = MinfsDirectoryIndexBuckets(inode->size);
+    if (buckets == 0) {
+        return ZX_OK;
+    } else if ((buckets > kMinfsDirectoryIndexMaxBuckets) ||
+               ((inode->size - kMinfsDirectoryIndexOffset) % kMinfsBlockSize != 0)) {
+        FS_TRACE_ERROR("check: ino#%u: bad directory index size %u\n", ino, inode->size);
+        return ZX_ERR_IO_DATA_INTEGRITY;
+    }
+
+    zx_status_t status;
+    fbl::RefPtr<VnodeMinfs> vn;
+    if ((status = VnodeMinfs::Recreate(fs_.get(), ino, &vn)) != ZX_OK) {
+        return status;
+    }
+
+    // File each live entry in the bucket which should hold it, in the order of the records.
+    fbl::AllocChecker ac;
+    fbl::Array<DirectoryIndexBucket> expected(new (&ac) DirectoryIndexBucket[buckets](), buckets);
+    if (!ac.check()) {
+        return ZX_ERR_NO_MEMORY;
+    }
+    size_t off = 0;
+    while (true) {
+        char data[kMinfsMaxDirentSize];
+        Dirent* de = reinterpret_cast<Dirent*>(data);
+        size_t actual;
+        if ((status = vn->ReadInternal(data, sizeof(data), off, &actual)) != ZX_OK) {
+            return status;
+        } else if (actual < MINFS_DIRENT_SIZE) {
+            return ZX_ERR_IO;
+        }
+        if (de->ino != 0) {
+            const uint32_t hash = DirectoryIndexHash(fbl::StringPiece(de->name, de->namelen));
+            DirectoryIndexBucket* bucket = &expected[MinfsDirectoryIndexBucket(hash, buckets)];
+            if (bucket->count == kMinfsDirectoryIndexSlots) {
+                FS_TRACE_ERROR("check: ino#%u: directory index bucket overflows\n", ino);
+                return ZX_ERR_IO_DATA_INTEGRITY;
+            }
+            bucket->slots[bucket->count].hash = hash;
+            bucket->slots[bucket->count].off = static_cast<uint32_t>(off);
+            bucket->count++;
+        }
+        if (de->reclen & kMinfsReclenLast) {
+            break;
+        }
+        off += MinfsReclen(de, off);
+    }
+
+    for (uint32_t n = 0; n < buckets; n++) {
+        DirectoryIndexBucket bucket;
+        const size_t bucket_off = kMinfsDirectoryIndexOffset + n * kMinfsBlockSize;
+        if ((status = vn->ReadExactInternal(&bucket, sizeof(bucket), bucket_off)) != ZX_OK) {
+            return status;
+        }
+        if (bucket.count == expected[n].count) {
+            // The order of the slots within a bucket is arbitrary.
+            qsort(bucket.slots, bucket.count, sizeof(DirectoryIndexSlot), CompareIndexSlots);
+            if (memcmp(bucket.slots, expected[n].slots,
+                       bucket.count * sizeof(DirectoryIndexSlot)) == 0) {
+                continue;
+            }
+        }
+
+        FS_TRACE_WARN("check: ino#%u: directory index bucket %u is incorrect; rebuilding\n",
+                      ino, n);
+        conforming_ = false;
+        blk_t bno;
+        blk_t next_n;
+        if ((status = GetInodeNthBno(inode, static_cast<blk_t>(bucket_off / kMinfsBlockSize),
+                                     &next_n, &bno)) != ZX_OK) {
+            return status;
+        } else if (bno == 0) {
+            FS_TRACE_ERROR("check: ino#%u: directory index bucket %u is missing\n", ino, n);
+            return ZX_ERR_IO_DATA_INTEGRITY;
+        } else if ((status = fs_->WriteDat(bno, &expected[n])) != ZX_OK) {
+            return status;
+        }
+    }
+    return ZX_OK;
+}
+
 const char* MinfsChecker::CheckDataBlock(blk_t bno) {
     if (bno == 0) {
         return "reserved bno";
@@ -451,6 +546,9 @@ zx_status_t MinfsChecker::CheckInode(ino_t ino, ino_t parent, bool dot_or_dotdot
         if ((status = CheckDirectory(&inode, ino, parent, CD_DUMP)) < 0) {
             return status;
         }
+        if ((status = CheckDirectoryIndex(&inode, ino)) < 0) {
+            return status;
+        }
         if ((status = CheckDirectory(&inode, ino, parent, CD_RECURSE)) < 0) {
             return status;
         }
@@ -648,6 +746,18 @@ zx_status_t Fsck(fbl::unique_ptr<Bcache> bc) {
         return status;
     }
 
+    // Check the filesystem as it will be mounted, with every committed transaction applied.
+    if ((status = ReplayJournal(bc.get(), *info)) != ZX_OK) {
+        FS_TRACE_ERROR("Fsck: failed to replay journal: %d\n", status);
+        return status;
+    } else if (bc->Readblk(0, data) < 0) {
+        FS_TRACE_ERROR("minfs: could not read info block\n");
+        return ZX_ERR_IO;
+    } else if ((status = CheckSuperblock(info, bc.get())) != ZX_OK) {
+        FS_TRACE_ERROR("Fsck: check_info failure after replay: %d\n", status);
+        return status;
+    }
+
     MinfsChecker chk;
     if ((status = chk.Init(std::move(bc), info)) != ZX_OK) {
         FS_TRACE_ERROR("Fsck: Init failure: %d\n", status);
@@ -23,7 +23,7 @@
 namespace minfs {
 
 #ifdef __Fuchsia__
-using RawBitmap = bitmap::RawBitmapGeneric<bitmap::VmoStorage>;
+using RawBitmap = bitmap::RawBitmapGeneric<bitmap::SummaryStorage<bitmap::VmoStorage>>;
 using BlockRegion = fuchsia_minfs_BlockRegion;
 #else
 using RawBitmap = bitmap::RawBitmapGeneric<bitmap::DefaultStorage>;
@@ -21,6 +21,8 @@ struct WriteRequest {
     size_t vmo_offset;
     size_t dev_offset;
     size_t length;
+    // File data, which is written in place rather than through the journal.
+    bool data;
 };
 
 // A transaction consisting of enqueued VMOs to be written
@@ -38,20 +40,36 @@ public:
     }
 
     // Identify that a block should be written to disk at a later point in time.
-    void Enqueue(zx_handle_t vmo, uint64_t vmo_offset, uint64_t dev_offset, uint64_t nblocks);
+    void Enqueue(zx_handle_t vmo, uint64_t vmo_offset, uint64_t dev_offset, uint64_t nblocks) {
+        EnqueueRequest(vmo, vmo_offset, dev_offset, nblocks, false);
+    }
+
+    // Identify that a block of file data should be written to disk at a later point in time.
+    //
+    // Unlike metadata, file data bypasses the journal.
+    void EnqueueData(zx_handle_t vmo, uint64_t vmo_offset, uint64_t dev_offset,
+                     uint64_t nblocks) {
+        EnqueueRequest(vmo, vmo_offset, dev_offset, nblocks, true);
+    }
 
     fbl::Vector<WriteRequest>& Requests() { return requests_; }
 
     size_t BlkCount() const;
 
-protected:
-    // Activate the transaction, writing it out to disk.
+    // Returns the number of blocks enqueued which are (or are not) file data.
+    size_t BlkCount(bool data) const;
+
+    // Writes the enqueued file data (or metadata) to its final location on disk.
     //
-    // Each transaction uses the |vmo| / |vmoid| pair supplied, since the
-    // transactions should be all reading from a single in-memory buffer.
-    zx_status_t Flush(zx_handle_t vmo, vmoid_t vmoid);
+    // Each transaction uses the |vmoid| supplied, since the transactions should
+    // be all reading from a single in-memory buffer. Requests remain enqueued
+    // until they are removed by the caller.
+    zx_status_t WriteInPlace(vmoid_t vmoid, bool data);
 
 private:
+    void EnqueueRequest(zx_handle_t vmo, uint64_t vmo_offset, uint64_t dev_offset,
+                        uint64_t nblocks, bool data);
+
     Bcache* bc_;
     fbl::Vector<WriteRequest> requests_;
 };
@@ -0,0 +1,119 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file describes an in-memory index of the records of a MinFS directory, which
+// complements the on-disk index of its entries described in format.h.
+
+#pragma once
+
+#include <fbl/intrusive_wavl_tree.h>
+#include <fbl/macros.h>
+#include <fbl/string_piece.h>
+#include <fbl/unique_ptr.h>
+#include <lib/zircon-internal/fnv1hash.h>
+#include <minfs/format.h>
+#include <zircon/types.h>
+
+namespace minfs {
+
+// Directories smaller than this are cheap enough to walk on each operation, and are
+// never indexed.
+constexpr uint32_t kMinfsDirectoryIndexMinSize = kMinfsBlockSize;
+
+// Returns the hash by which the on-disk directory index files an entry named |name|.
+//
+// The low bits of an FNV-1a hash depend only on the low bits of each character, so names
+// which differ in a few digits would crowd a handful of buckets. The hash is mixed with the
+// MurmurHash3 finalizer to spread them.
+inline uint32_t DirectoryIndexHash(fbl::StringPiece name) {
+    uint32_t hash = fnv1a32(name.data(), name.length());
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+// DirectoryIndex tracks where the records of a single directory live, so that lookup,
+// create, and unlink need not walk every dirent in the directory.
+//
+// Records never move once they have been written: creating an entry either fills a free
+// record or splits the slack off the end of an existing one, and unlinking an entry only
+// coalesces it with neighboring free records. The index therefore only needs to be told
+// about each record which is written or subsumed, and can locate:
+// - Live entries, by a hash of their name.
+// - Records with room for a new entry, by offset.
+//
+// The index is a cache of the on-disk records, and may be discarded and rebuilt from them
+// at any time. Directories which carry an on-disk index look up entries through it instead,
+// so that a lookup need not build this index; this index is then only needed to find space
+// and free neighbors.
+class DirectoryIndex {
+public:
+    DirectoryIndex() = default;
+    DISALLOW_COPY_ASSIGN_AND_MOVE(DirectoryIndex);
+    ~DirectoryIndex();
+
+    // Records that |de| has been written at offset |off| of the directory.
+    //
+    // The name of |de| is only accessed if it is a live entry.
+    zx_status_t Insert(const Dirent* de, size_t off);
+
+    // Forgets the record |de| at offset |off|, which is about to be overwritten or subsumed
+    // by a neighboring record. |de| must match the record which was inserted.
+    void Remove(const Dirent* de, size_t off);
+
+    // Identifies the offset of the |n|th live entry which may be named |name|.
+    //
+    // Distinct names may collide, so callers must compare |name| against the record itself.
+    // Returns false if there are fewer than |n + 1| candidates.
+    bool FindCandidate(fbl::StringPiece name, size_t n, size_t* out_off) const;
+
+    // Identifies the lowest offset at which a new dirent of |reclen| bytes may be appended,
+    // which is the record a walk of the directory would pick. Returns false if the directory
+    // is full.
+    bool FindSpace(uint32_t reclen, size_t* out_off);
+
+    // Returns the offset of the record preceding the record at |off| if it is free, or |off|
+    // otherwise.
+    size_t FreeRecordBefore(size_t off) const;
+
+private:
+    // A live entry, keyed by the hash of its name (upper 32 bits) and its offset (lower 32 bits).
+    struct NameNode : public fbl::WAVLTreeContainable<fbl::unique_ptr<NameNode>> {
+        explicit NameNode(uint64_t key) : key(key) {}
+        uint64_t GetKey() const { return key; }
+
+        const uint64_t key;
+    };
+
+    // A record (other than the last) which has space remaining after its entry, if any.
+    struct SlackNode : public fbl::WAVLTreeContainable<fbl::unique_ptr<SlackNode>> {
+        SlackNode(uint32_t off, uint32_t reclen, uint32_t used)
+            : off(off), reclen(reclen), used(used) {}
+        uint32_t GetKey() const { return off; }
+        uint32_t Slack() const { return reclen - used; }
+
+        const uint32_t off;
+        const uint32_t reclen;
+        // Zero for free records.
+        const uint32_t used;
+    };
+
+    static uint64_t NameKey(fbl::StringPiece name, size_t off);
+
+    fbl::WAVLTree<uint64_t, fbl::unique_ptr<NameNode>> names_;
+    fbl::WAVLTree<uint32_t, fbl::unique_ptr<SlackNode>> slack_;
+
+    // The last record in the directory, which extends to |kMinfsMaxDirectorySize|.
+    uint32_t last_off_ = 0;
+    uint32_t last_used_ = 0;
+
+    // An upper bound on the slack of any record in |slack_|, which avoids scanning |slack_|
+    // for space which cannot exist.
+    uint32_t max_slack_ = 0;
+};
+
+} // namespace minfs
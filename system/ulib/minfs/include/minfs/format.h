@@ -32,7 +32,7 @@ typedef uint32_t ino_t;
 
 constexpr uint64_t kMinfsMagic0         = (0x002153466e694d21ULL);
 constexpr uint64_t kMinfsMagic1         = (0x385000d3d3d3d304ULL);
-constexpr uint32_t kMinfsVersion        = 0x00000007;
+constexpr uint32_t kMinfsVersion        = 0x00000008;
 
 constexpr ino_t    kMinfsRootIno        = 1;
 constexpr uint32_t kMinfsFlagClean      = 0x00000001; // Currently unused
@@ -129,16 +129,67 @@ constexpr size_t kMinfsMinimumSlices = 7;
 
 constexpr uint64_t kMinfsDefaultInodeCount = 32768;
 
+constexpr uint64_t kJournalEntryMagic  = (0x6d696e6a656e7472ULL);
+constexpr uint64_t kJournalCommitMagic = (0x6d696e6a636d6974ULL);
+
+// The first block of the journal. Entries occupy the remaining blocks of the journal as a
+// ring, starting at |start_block| (relative to the block following this one).
+//
+// Images formatted before the journal was written have zeroes in place of |start_block| and
+// |sequence|, which correctly describes an empty journal.
 struct JournalInfo {
     uint64_t magic;
-    uint64_t reserved0;
-    uint64_t reserved1;
+    uint64_t start_block; // Offset of the oldest entry which may need to be replayed.
+    uint64_t sequence;    // Sequence number of the entry at |start_block|.
     uint64_t reserved2;
     uint64_t reserved3;
 };
 
 static_assert(sizeof(JournalInfo) <= kMinfsBlockSize, "Journal info size is too large");
 
+// Returns the number of blocks in the journal described by |info|, including the info block.
+constexpr size_t JournalBlocks(const Superblock& info) {
+    return (info.flags & kMinfsFlagFVM) ? info.journal_slices * (info.slice_size / kMinfsBlockSize)
+                                        : info.dat_block - info.journal_start_block;
+}
+
+// Each journal entry consists of one or more header blocks, the metadata blocks being updated,
+// and a commit block. An entry is only valid if its commit block carries the same sequence
+// number as its header, along with a checksum of the header and metadata blocks.
+//
+// The targets of the first kJournalEntryHeaderMaxBlocks metadata blocks are held in the
+// JournalHeaderBlock. Those of any further metadata blocks are held, in order, by additional
+// header blocks which contain nothing but kJournalEntryTargetsPerBlock block numbers each.
+struct JournalHeaderBlock {
+    uint64_t magic;
+    uint64_t sequence;
+    uint64_t num_blocks;
+    uint64_t reserved;
+    // The destination of each of the |num_blocks| metadata blocks which follow the header.
+    blk_t target_blocks[kJournalEntryHeaderMaxBlocks];
+};
+
+static_assert(sizeof(JournalHeaderBlock) == kMinfsBlockSize, "Journal header is the wrong size");
+
+constexpr blk_t kJournalEntryTargetsPerBlock = kMinfsBlockSize / sizeof(blk_t);
+
+// Returns the number of header blocks in an entry of |num_blocks| metadata blocks.
+constexpr size_t JournalEntryHeaderBlocks(size_t num_blocks) {
+    if (num_blocks <= kJournalEntryHeaderMaxBlocks) {
+        return 1;
+    }
+    const size_t extra = num_blocks - kJournalEntryHeaderMaxBlocks;
+    return 1 + (extra + kJournalEntryTargetsPerBlock - 1) / kJournalEntryTargetsPerBlock;
+}
+
+struct JournalCommitBlock {
+    uint64_t magic;
+    uint64_t sequence;
+    uint32_t checksum;
+};
+
+static_assert(sizeof(JournalCommitBlock) <= kMinfsBlockSize, "Journal commit is too large");
+
 struct Inode {
     uint32_t magic;
     uint32_t size;
@@ -180,7 +231,7 @@ constexpr uint8_t kMinfsMaxNameSize       = 255;
 // The 'dirent->reclen' field may be larger after coalescing
 // entries.
 constexpr uint32_t kMinfsMaxDirentSize    = DirentSize(kMinfsMaxNameSize);
-constexpr uint32_t kMinfsMaxDirectorySize = (((1 << 20) - 1) & (~3));
+constexpr uint32_t kMinfsMaxDirectorySize = (((1 << 22) - 1) & (~3));
 
 static_assert(kMinfsMaxNameSize >= NAME_MAX,
               "MinFS names must be large enough to hold NAME_MAX characters");
@@ -205,6 +256,66 @@ static_assert(kMinfsMaxDirectorySize <= kMinfsReclenMask,
 //   record starts. If the MAX_DIR_SIZE is increased, this 'last' record will
 //   also increase in size.
 
+// Directories whose records outgrow their first block carry an index of their live entries,
+// so that an entry may be found without walking every record. The index is a sequence of
+// buckets, one per block, stored in the directory itself starting at
+// kMinfsDirectoryIndexOffset. A directory is indexed if and only if its size extends past
+// that offset, and its size always ends with the last bucket.
+//
+// Entries are filed by a hash of their name (see DirectoryIndexHash in directory-index.h),
+// using linear hashing: buckets are split in order, one at a time, whenever the directory holds
+// more than kMinfsDirectoryIndexLoad entries per bucket. Buckets are never merged.
+constexpr uint32_t kMinfsDirectoryIndexOffset     = (1 << 22);
+constexpr uint32_t kMinfsDirectoryIndexMaxBuckets = 512;
+
+static_assert(kMinfsMaxDirectorySize <= kMinfsDirectoryIndexOffset,
+              "MinFS directory index must follow the largest possible record");
+static_assert(kMinfsDirectoryIndexOffset % kMinfsBlockSize == 0,
+              "MinFS directory index must be block aligned");
+
+struct DirectoryIndexSlot {
+    uint32_t hash;                  // hash of the entry's name
+    uint32_t off;                   // offset of the entry within the directory
+};
+
+constexpr uint32_t kMinfsDirectoryIndexSlots =
+    (kMinfsBlockSize - 2 * sizeof(uint32_t)) / sizeof(DirectoryIndexSlot);
+// Buckets which have not yet been split in the current round hold twice as many entries as
+// those which have, so the average load is kept under half of a bucket.
+constexpr uint32_t kMinfsDirectoryIndexLoad = kMinfsDirectoryIndexSlots * 3 / 8;
+
+struct DirectoryIndexBucket {
+    uint32_t count;                 // number of valid slots
+    uint32_t reserved;
+    DirectoryIndexSlot slots[kMinfsDirectoryIndexSlots];
+};
+
+static_assert(sizeof(DirectoryIndexBucket) == kMinfsBlockSize,
+              "minfs directory index bucket size is wrong");
+
+// Returns the number of index buckets in a directory of |size| bytes.
+constexpr uint32_t MinfsDirectoryIndexBuckets(uint32_t size) {
+    return (size > kMinfsDirectoryIndexOffset) ?
+           (size - kMinfsDirectoryIndexOffset) / kMinfsBlockSize : 0;
+}
+
+// Returns the largest power of two which is no greater than |buckets|. The buckets below
+// |buckets| minus this value have already been split in the current round.
+constexpr uint32_t MinfsDirectoryIndexRound(uint32_t buckets) {
+    uint32_t round = 1;
+    while (round <= buckets / 2) {
+        round *= 2;
+    }
+    return round;
+}
+
+// Returns the bucket which files an entry whose name hashes to |hash|, out of |buckets|.
+constexpr uint32_t MinfsDirectoryIndexBucket(uint32_t hash, uint32_t buckets) {
+    const uint32_t round = MinfsDirectoryIndexRound(buckets);
+    const uint32_t bucket = hash & (round - 1);
+    return (bucket < buckets - round) ? hash & (2 * round - 1) : bucket;
+}
+
 // blocksize   8K    16K    32K
 // 16 dir =  128K   256K   512K
 // 32 ind =  512M  1024M  2048M
@@ -21,9 +21,16 @@ namespace minfs {
 // Validate header information about the filesystem backed by |bc|.
 zx_status_t CheckSuperblock(const Superblock* info, Bcache* bc);
 
+// Writes every valid entry of the journal of the filesystem described by |info| in place, and
+// marks the journal as empty. Must be invoked before any other metadata is read from disk.
+//
+// On host, a sparse image does not have its journal where |info| says, and its entries cannot
+// be replayed; such an image is rejected with ZX_ERR_BAD_STATE if its journal is not empty.
+zx_status_t ReplayJournal(Bcache* bc, const Superblock& info);
+
 // Run fsck on an unmounted filesystem backed by |bc|.
 //
-// Invokes CheckSuperblock, but also verifies inode and block usage.
+// Invokes CheckSuperblock and ReplayJournal, but also verifies inode and block usage.
 zx_status_t Fsck(fbl::unique_ptr<Bcache> bc);
 
 #ifndef __Fuchsia__
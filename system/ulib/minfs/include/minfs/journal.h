@@ -0,0 +1,129 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file describes the journal which makes updates to MinFS metadata atomic.
+
+#pragma once
+
+#ifndef __Fuchsia__
+#error Fuchsia-only Header
+#endif
+
+#include <fbl/algorithm.h>
+#include <fbl/macros.h>
+#include <fbl/unique_ptr.h>
+#include <fbl/vector.h>
+#include <lib/fzl/owned-vmo-mapper.h>
+#include <minfs/bcache.h>
+#include <minfs/block-txn.h>
+#include <minfs/format.h>
+#include <zircon/device/block.h>
+#include <zircon/types.h>
+
+namespace minfs {
+
+// Journal writes the metadata of each WriteTxn to the journal before writing it in place, so
+// that after a crash, every transaction has either been applied in full or not at all.
+//
+// Transactions are grouped into entries: every transaction which is ready when an entry is
+// started shares its journal write and its flush. Only metadata is journaled. File data is
+// written in place and flushed before the entry which refers to it is written, so metadata
+// never refers to data which has not been written.
+//
+// Metadata is written in place as soon as its entry is durable. Rather than recording
+// revocations, the journal is emptied (by flushing and advancing the start of the journal)
+// before file data overwrites any block which a live entry would restore on replay.
+//
+// The Journal is only accessed by the writeback thread.
+class Journal {
+public:
+    DISALLOW_COPY_ASSIGN_AND_MOVE(Journal);
+
+    // Creates a journal for the filesystem described by |info|, which must already have been
+    // replayed by ReplayJournal (see minfs/fsck.h). The journal writes transactions
+    // out of the writeback buffer |buffer|, attached to |bc| as |buffer_vmoid|.
+    static zx_status_t Create(Bcache* bc, const Superblock& info,
+                              const fzl::OwnedVmoMapper* buffer, vmoid_t buffer_vmoid,
+                              fbl::unique_ptr<Journal>* out);
+    ~Journal();
+
+    // Adds |txn| to the entry being assembled. The requests of |txn| must already refer to
+    // the writeback buffer, and |txn| must remain valid until |Commit| returns. |Create|
+    // guarantees that an entry can hold the largest transaction permitted by
+    // TransactionLimits; a transaction exceeding that fails to commit.
+    //
+    // Returns false, without adding |txn|, if the entry must be committed first.
+    bool Add(WriteTxn* txn);
+
+    // Writes every transaction added since the last commit to disk, and flushes the device.
+    zx_status_t Commit();
+
+    // Flushes the device and marks every entry as applied, leaving the journal empty.
+    zx_status_t Checkpoint();
+
+private:
+    Journal(Bcache* bc, const Superblock& info, const fzl::OwnedVmoMapper* buffer,
+            vmoid_t buffer_vmoid);
+
+    // Returns the maximum number of metadata blocks in a single entry of a journal with
+    // |capacity| blocks available for entries.
+    static size_t MaxEntryBlocks(size_t capacity);
+
+    zx_status_t CommitPending();
+
+    // Writes the header, metadata, and commit blocks of a single entry to the journal.
+    zx_status_t WriteEntry();
+
+    // Returns true if any file data pending commit overwrites a block which a live entry
+    // would restore on replay.
+    bool DataOverlapsLive();
+
+    // Returns true if any file data in |txn| overwrites metadata pending commit.
+    bool DataOverlapsPending(WriteTxn* txn) const;
+
+    // Records |next_| as the start of the journal.
+    zx_status_t WriteInfo();
+
+    // Appends a request to write |length| blocks, starting at the journal offset |offset|.
+    // The request is split if it wraps around the end of the journal.
+    void EnqueueJournalWrite(vmoid_t vmoid, size_t vmo_offset, size_t offset, size_t length);
+
+    Bcache* bc_;
+    const fzl::OwnedVmoMapper* buffer_;
+    const vmoid_t buffer_vmoid_;
+
+    // The header, commit, and info blocks written by the journal itself, followed by the
+    // additional header blocks of entries too large for a single header block.
+    fzl::OwnedVmoMapper blocks_;
+    vmoid_t blocks_vmoid_ = VMOID_INVALID;
+
+    // The location of the info block; entries begin in the following block.
+    const blk_t info_block_;
+    // The number of blocks available for entries.
+    const size_t capacity_;
+    // The maximum number of metadata blocks in a single entry.
+    const size_t max_entry_blocks_;
+    // Metadata in the data section is tracked in |live_|, since only there can it be
+    // overwritten by file data.
+    const blk_t dat_block_;
+
+    // The offset and sequence number of the next entry.
+    size_t next_ = 0;
+    uint64_t sequence_ = 0;
+    // The number of blocks occupied by entries written since the journal was last emptied.
+    size_t used_ = 0;
+
+    // Data section targets of entries written since the journal was last emptied, sorted
+    // lazily.
+    fbl::Vector<blk_t> live_;
+    bool live_sorted_ = true;
+
+    // Transactions added to the entry being assembled.
+    fbl::Vector<WriteTxn*> pending_;
+    size_t pending_blocks_ = 0;
+
+    fbl::Vector<block_fifo_request_t> requests_;
+};
+
+} // namespace minfs
@@ -9,6 +9,7 @@
 #include <fbl/mutex.h>
 #include <lib/fzl/owned-vmo-mapper.h>
 #include <lib/zx/vmo.h>
+#include <minfs/journal.h>
 #endif
 
 #include <fbl/algorithm.h>
@@ -48,12 +49,12 @@ public:
     void Reset();
 
 #ifdef __Fuchsia__
-    // Actually transacts the enqueued work, and resets the WritebackWork to
-    // its initial state.
+    // Signals the result of writing the enqueued work to disk, and resets the
+    // WritebackWork to its initial state.
     //
     // Returns the number of blocks of the writeback buffer that have been
     // consumed.
-    size_t Complete(zx_handle_t vmo, vmoid_t vmoid);
+    size_t Complete(zx_status_t status);
 
     // Adds a closure to the WritebackWork, such that it will be signalled
     // when the WritebackWork is flushed to disk.
@@ -126,11 +127,13 @@ private:
 #ifdef __Fuchsia__
 
 // WritebackBuffer which manages a writeback buffer (and background thread,
-// which flushes this buffer out to disk).
+// which flushes this buffer out to disk through the journal).
 class WritebackBuffer {
 public:
     // Calls constructor, return an error if anything goes wrong.
-    static zx_status_t Create(Bcache* bc, fzl::OwnedVmoMapper mapper,
+    //
+    // |info| describes the location of the journal.
+    static zx_status_t Create(Bcache* bc, fzl::OwnedVmoMapper mapper, const Superblock& info,
                               fbl::unique_ptr<WritebackBuffer>* out);
     ~WritebackBuffer();
 
@@ -183,7 +186,10 @@ private:
     // and flushes them to disk. This thread acts as a consumer of the
     // writeback buffer.
     thrd_t writeback_thrd_;
+    bool thread_started_ = false;
     Bcache* bc_;
+    // Only accessed by the writeback thread, once it has started.
+    fbl::unique_ptr<Journal> journal_;
     fbl::Mutex writeback_lock_;
 
     // Ensures that if multiple producers are waiting for space to write their
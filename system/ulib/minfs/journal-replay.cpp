@@ -0,0 +1,167 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <fbl/alloc_checker.h>
+#include <fbl/array.h>
+#include <fbl/unique_ptr.h>
+#include <fs/trace.h>
+#include <lib/cksum.h>
+#include <minfs/format.h>
+#include <minfs/fsck.h>
+
+#include "minfs-private.h"
+
+namespace minfs {
+namespace {
+
+// Reads the journal block at |offset| of the journal whose info block is |info_block|.
+zx_status_t ReadJournalBlock(Bcache* bc, blk_t info_block, size_t capacity, size_t offset,
+                             void* data) {
+    return bc->Readblk(static_cast<blk_t>(info_block + 1 + offset % capacity), data);
+}
+
+} // namespace
+
+zx_status_t ReplayJournal(Bcache* bc, const Superblock& info) {
+    TRACE_DURATION("minfs", "ReplayJournal");
+    blk_t info_block = info.journal_start_block;
+    size_t journal_blocks = JournalBlocks(info);
+    bool apply = true;
+#ifndef __Fuchsia__
+    if (bc->extent_lengths_.size() > 0) {
+        // The extents of a sparse image are packed together, so neither the journal nor the
+        // blocks its entries target are where |info| says. The journal can only be checked.
+        if (bc->extent_lengths_.size() != kExtentCount) {
+            FS_TRACE_ERROR("minfs: invalid number of extents\n");
+            return ZX_ERR_INVALID_ARGS;
+        }
+        size_t start = 0;
+        for (size_t i = 0; i < 4; i++) {
+            start += bc->extent_lengths_[i];
+        }
+        info_block = static_cast<blk_t>(start / kMinfsBlockSize);
+        journal_blocks = bc->extent_lengths_[4] / kMinfsBlockSize;
+        apply = false;
+    }
+#endif
+    if (journal_blocks < 2) {
+        FS_TRACE_ERROR("minfs: journal too small\n");
+        return ZX_ERR_IO_DATA_INTEGRITY;
+    }
+    const size_t capacity = journal_blocks - 1;
+
+    char blk[kMinfsBlockSize];
+    zx_status_t status;
+    if ((status = bc->Readblk(info_block, blk)) != ZX_OK) {
+        FS_TRACE_ERROR("minfs: could not read journal info block\n");
+        return status;
+    }
+    JournalInfo journal_info;
+    memcpy(&journal_info, blk, sizeof(journal_info));
+    if (journal_info.magic != kJournalMagic) {
+        FS_TRACE_ERROR("minfs: bad journal magic\n");
+        return ZX_ERR_IO_DATA_INTEGRITY;
+    } else if (journal_info.start_block >= capacity) {
+        FS_TRACE_ERROR("minfs: journal start %" PRIu64 " out of range\n",
+                       journal_info.start_block);
+        return ZX_ERR_IO_DATA_INTEGRITY;
+    }
+
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<JournalHeaderBlock> header(new (&ac) JournalHeaderBlock);
+    if (!ac.check()) {
+        return ZX_ERR_NO_MEMORY;
+    }
+
+    size_t offset = journal_info.start_block;
+    uint64_t sequence = journal_info.sequence;
+    size_t replayed = 0;
+    while (true) {
+        // The journal ends at the first entry which was not completely written.
+        if (ReadJournalBlock(bc, info_block, capacity, offset, header.get()) != ZX_OK ||
+            header->magic != kJournalEntryMagic || header->sequence != sequence ||
+            header->num_blocks + 2 > capacity) {
+            break;
+        }
+        const size_t num_blocks = header->num_blocks;
+        const size_t header_blocks = JournalEntryHeaderBlocks(num_blocks);
+        if (header_blocks + num_blocks + 1 > capacity) {
+            break;
+        }
+
+        // The targets of the metadata blocks, followed by the blocks themselves.
+        const size_t extra_blocks = header_blocks - 1;
+        const size_t data_size = (extra_blocks + num_blocks) * kMinfsBlockSize;
+        fbl::Array<uint8_t> data(new (&ac) uint8_t[data_size], data_size);
+        if (!ac.check()) {
+            return ZX_ERR_NO_MEMORY;
+        }
+        const blk_t* extra_targets = reinterpret_cast<const blk_t*>(data.get());
+        const uint8_t* blocks = data.get() + extra_blocks * kMinfsBlockSize;
+        auto target_of = [&header, extra_targets](size_t i) {
+            return i < kJournalEntryHeaderMaxBlocks
+                   ? header->target_blocks[i]
+                   : extra_targets[i - kJournalEntryHeaderMaxBlocks];
+        };
+
+        // The checksum covers every header block and every metadata block, in journal order.
+        uint32_t checksum = crc32(0, reinterpret_cast<const uint8_t*>(header.get()),
+                                  sizeof(JournalHeaderBlock));
+        bool valid = true;
+        for (size_t i = 0; i < extra_blocks + num_blocks && valid; i++) {
+            uint8_t* block = data.get() + i * kMinfsBlockSize;
+            valid = ReadJournalBlock(bc, info_block, capacity, offset + 1 + i, block) == ZX_OK;
+            checksum = crc32(checksum, block, kMinfsBlockSize);
+        }
+        for (size_t i = 0; i < num_blocks && valid; i++) {
+            valid = target_of(i) != 0 && target_of(i) < bc->Maxblk();
+        }
+        const JournalCommitBlock* commit = reinterpret_cast<const JournalCommitBlock*>(blk);
+        if (!valid ||
+            ReadJournalBlock(bc, info_block, capacity, offset + header_blocks + num_blocks,
+                             blk) != ZX_OK ||
+            commit->magic != kJournalCommitMagic || commit->sequence != sequence ||
+            commit->checksum != checksum) {
+            break;
+        }
+
+        if (!apply) {
+            FS_TRACE_ERROR("minfs: journal of sparse image is not empty; "
+                           "mount it on a device to replay the journal\n");
+            return ZX_ERR_BAD_STATE;
+        }
+        for (size_t i = 0; i < num_blocks; i++) {
+            if ((status = bc->Writeblk(target_of(i), blocks + i * kMinfsBlockSize)) != ZX_OK) {
+                FS_TRACE_ERROR("minfs: failed to replay journal entry %" PRIu64 "\n", sequence);
+                return status;
+            }
+        }
+        offset = (offset + header_blocks + num_blocks + 1) % capacity;
+        sequence++;
+        replayed++;
+    }
+
+    if (replayed == 0) {
+        return ZX_OK;
+    }
+    FS_TRACE_INFO("minfs: replayed %zu journal entries\n", replayed);
+
+    // The replayed metadata must be durable before the entries are discarded.
+    if ((status = bc->Sync()) != ZX_OK) {
+        return status;
+    }
+    memset(blk, 0, sizeof(blk));
+    journal_info.start_block = offset;
+    journal_info.sequence = sequence;
+    memcpy(blk, &journal_info, sizeof(journal_info));
+    if ((status = bc->Writeblk(info_block, blk)) != ZX_OK) {
+        return status;
+    }
+    return bc->Sync();
+}
+
+} // namespace minfs
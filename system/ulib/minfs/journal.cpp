@@ -0,0 +1,368 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <fbl/algorithm.h>
+#include <fbl/alloc_checker.h>
+#include <fs/trace.h>
+#include <lib/cksum.h>
+#include <minfs/journal.h>
+#include <minfs/transaction-limits.h>
+#include <trace/event.h>
+
+#include <utility>
+
+namespace minfs {
+namespace {
+
+int CompareBlocks(const void* a, const void* b) {
+    const blk_t lhs = *static_cast<const blk_t*>(a);
+    const blk_t rhs = *static_cast<const blk_t*>(b);
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+} // namespace
+
+zx_status_t Journal::Create(Bcache* bc, const Superblock& info,
+                            const fzl::OwnedVmoMapper* buffer, vmoid_t buffer_vmoid,
+                            fbl::unique_ptr<Journal>* out) {
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<Journal> journal(new (&ac) Journal(bc, info, buffer, buffer_vmoid));
+    if (!ac.check()) {
+        return ZX_ERR_NO_MEMORY;
+    }
+
+    // Rather than writing an oversized transaction without journaling it, refuse to use a
+    // journal which cannot hold the largest transaction the filesystem may issue.
+    const size_t max_transaction_blocks = TransactionLimits(info).GetMaximumEntryDataBlocks();
+    if (journal->max_entry_blocks_ < max_transaction_blocks) {
+        FS_TRACE_ERROR("minfs: journal entries hold %zu blocks, transactions need %zu\n",
+                       journal->max_entry_blocks_, max_transaction_blocks);
+        return ZX_ERR_NO_SPACE;
+    }
+
+    const size_t extra_header_blocks = JournalEntryHeaderBlocks(journal->max_entry_blocks_) - 1;
+    zx_status_t status;
+    if ((status = journal->blocks_.CreateAndMap((3 + extra_header_blocks) * kMinfsBlockSize,
+                                                "minfs-journal")) != ZX_OK) {
+        return status;
+    } else if ((status = bc->AttachVmo(journal->blocks_.vmo(), &journal->blocks_vmoid_)) !=
+               ZX_OK) {
+        return status;
+    }
+
+    // The journal has already been replayed, so every entry after the start of the journal
+    // is stale.
+    JournalInfo* journal_info = reinterpret_cast<JournalInfo*>(
+            static_cast<uint8_t*>(journal->blocks_.start()) + 2 * kMinfsBlockSize);
+    if ((status = bc->Readblk(info.journal_start_block, journal_info)) != ZX_OK) {
+        return status;
+    } else if (journal_info->magic != kJournalMagic ||
+               journal_info->start_block >= journal->capacity_) {
+        return ZX_ERR_IO_DATA_INTEGRITY;
+    }
+    journal->next_ = journal_info->start_block;
+    journal->sequence_ = journal_info->sequence;
+
+    *out = std::move(journal);
+    return ZX_OK;
+}
+
+Journal::Journal(Bcache* bc, const Superblock& info, const fzl::OwnedVmoMapper* buffer,
+                 vmoid_t buffer_vmoid)
+    : bc_(bc), buffer_(buffer), buffer_vmoid_(buffer_vmoid),
+      info_block_(info.journal_start_block), capacity_(JournalBlocks(info) - 1),
+      max_entry_blocks_(MaxEntryBlocks(capacity_)), dat_block_(info.dat_block) {}
+
+size_t Journal::MaxEntryBlocks(size_t capacity) {
+    // Each entry also needs at least one header block and a commit block.
+    if (capacity < 2) {
+        return 0;
+    }
+    size_t blocks = capacity - 2;
+    while (blocks > 0 && JournalEntryHeaderBlocks(blocks) + blocks + 1 > capacity) {
+        blocks--;
+    }
+    return blocks;
+}
+
+Journal::~Journal() {
+    ZX_DEBUG_ASSERT(pending_.is_empty());
+    if (blocks_vmoid_ != VMOID_INVALID) {
+        block_fifo_request_t request;
+        request.group = bc_->BlockGroupID();
+        request.vmoid = blocks_vmoid_;
+        request.opcode = BLOCKIO_CLOSE_VMO;
+        bc_->Transaction(&request, 1);
+    }
+}
+
+bool Journal::Add(WriteTxn* txn) {
+    const size_t blocks = txn->BlkCount(false);
+    if (!pending_.is_empty() &&
+        (pending_blocks_ + blocks > max_entry_blocks_ || DataOverlapsPending(txn))) {
+        return false;
+    }
+    pending_.push_back(txn);
+    pending_blocks_ += blocks;
+    return true;
+}
+
+zx_status_t Journal::Commit() {
+    TRACE_DURATION("minfs", "Journal::Commit", "txns", pending_.size(),
+                   "blocks", pending_blocks_);
+    zx_status_t status = CommitPending();
+    pending_.reset();
+    pending_blocks_ = 0;
+    return status;
+}
+
+zx_status_t Journal::CommitPending() {
+    if (pending_blocks_ > max_entry_blocks_) {
+        // Only a single transaction larger than TransactionLimits allows can get here. It is
+        // failed before any of it reaches the disk, rather than written without journaling.
+        ZX_DEBUG_ASSERT(pending_.size() == 1);
+        FS_TRACE_ERROR("minfs: transaction of %zu metadata blocks does not fit in the journal\n",
+                       pending_blocks_);
+        return ZX_ERR_NO_SPACE;
+    }
+
+    zx_status_t status;
+    if (DataOverlapsLive() && (status = Checkpoint()) != ZX_OK) {
+        return status;
+    }
+
+    // File data goes straight to its final location, ahead of the metadata which refers to it.
+    // Transactions are written in order, since later ones may overwrite earlier ones.
+    bool wrote_data = false;
+    for (WriteTxn* txn : pending_) {
+        if ((status = txn->WriteInPlace(buffer_vmoid_, true)) != ZX_OK) {
+            return status;
+        }
+        wrote_data |= txn->BlkCount(true) > 0;
+    }
+
+    if (pending_blocks_ > 0) {
+        // The device may reorder writes between flushes, so the data must be durable before
+        // the entry is written; otherwise replay could commit metadata referring to blocks
+        // which never reached the disk.
+        if (wrote_data && (status = bc_->Sync()) != ZX_OK) {
+            return status;
+        }
+        const size_t header_blocks = JournalEntryHeaderBlocks(pending_blocks_);
+        if (used_ + header_blocks + pending_blocks_ + 1 > capacity_ &&
+            (status = Checkpoint()) != ZX_OK) {
+            return status;
+        }
+        if ((status = WriteEntry()) != ZX_OK) {
+            return status;
+        }
+    }
+
+    // A single flush makes every transaction in the entry durable.
+    if ((status = bc_->Sync()) != ZX_OK) {
+        return status;
+    }
+
+    // Now that the entry is durable, the metadata may be written in place. It need not be
+    // flushed until the journal is checkpointed.
+    for (WriteTxn* txn : pending_) {
+        if ((status = txn->WriteInPlace(buffer_vmoid_, false)) != ZX_OK) {
+            return status;
+        }
+    }
+    return ZX_OK;
+}
+
+zx_status_t Journal::WriteEntry() {
+    TRACE_DURATION("minfs", "Journal::WriteEntry");
+    uint8_t* blocks = static_cast<uint8_t*>(blocks_.start());
+    JournalHeaderBlock* header = reinterpret_cast<JournalHeaderBlock*>(blocks);
+    memset(header, 0, sizeof(*header));
+    header->magic = kJournalEntryMagic;
+    header->sequence = sequence_;
+    header->num_blocks = pending_blocks_;
+
+    // Targets beyond those which fit in the header go in the additional header blocks, which
+    // follow the info block in |blocks_|.
+    const size_t header_blocks = JournalEntryHeaderBlocks(pending_blocks_);
+    blk_t* extra_targets = reinterpret_cast<blk_t*>(blocks + 3 * kMinfsBlockSize);
+    memset(extra_targets, 0, (header_blocks - 1) * kMinfsBlockSize);
+
+    size_t count = 0;
+    for (WriteTxn* txn : pending_) {
+        for (const WriteRequest& request : txn->Requests()) {
+            if (request.data) {
+                continue;
+            }
+            for (size_t i = 0; i < request.length; i++) {
+                const blk_t target = static_cast<blk_t>(request.dev_offset + i);
+                if (count < kJournalEntryHeaderMaxBlocks) {
+                    header->target_blocks[count] = target;
+                } else {
+                    extra_targets[count - kJournalEntryHeaderMaxBlocks] = target;
+                }
+                count++;
+                if (target >= dat_block_) {
+                    live_.push_back(target);
+                    live_sorted_ = false;
+                }
+            }
+        }
+    }
+    ZX_DEBUG_ASSERT(count == pending_blocks_);
+
+    // The checksum covers the header and metadata blocks, so that a partially written entry
+    // is never replayed.
+    uint32_t checksum = crc32(0, reinterpret_cast<const uint8_t*>(header), sizeof(*header));
+    requests_.reset();
+    EnqueueJournalWrite(blocks_vmoid_, 0, next_, 1);
+    if (header_blocks > 1) {
+        checksum = crc32(checksum, reinterpret_cast<const uint8_t*>(extra_targets),
+                         (header_blocks - 1) * kMinfsBlockSize);
+        EnqueueJournalWrite(blocks_vmoid_, 3, next_ + 1, header_blocks - 1);
+    }
+    size_t offset = next_ + header_blocks;
+    for (WriteTxn* txn : pending_) {
+        for (const WriteRequest& request : txn->Requests()) {
+            if (request.data) {
+                continue;
+            }
+            const uint8_t* data = static_cast<const uint8_t*>(buffer_->start()) +
+                                  request.vmo_offset * kMinfsBlockSize;
+            checksum = crc32(checksum, data, request.length * kMinfsBlockSize);
+            EnqueueJournalWrite(buffer_vmoid_, request.vmo_offset, offset, request.length);
+            offset += request.length;
+        }
+    }
+
+    JournalCommitBlock* commit = reinterpret_cast<JournalCommitBlock*>(blocks + kMinfsBlockSize);
+    memset(commit, 0, kMinfsBlockSize);
+    commit->magic = kJournalCommitMagic;
+    commit->sequence = sequence_;
+    commit->checksum = checksum;
+    EnqueueJournalWrite(blocks_vmoid_, 1, offset, 1);
+
+    zx_status_t status = bc_->Transaction(requests_.get(), requests_.size());
+    if (status != ZX_OK) {
+        return status;
+    }
+    const size_t entry_blocks = header_blocks + pending_blocks_ + 1;
+    next_ = (next_ + entry_blocks) % capacity_;
+    used_ += entry_blocks;
+    sequence_++;
+    return ZX_OK;
+}
+
+void Journal::EnqueueJournalWrite(vmoid_t vmoid, size_t vmo_offset, size_t offset,
+                                  size_t length) {
+    const uint32_t kDiskBlocksPerMinfsBlock = kMinfsBlockSize / bc_->DeviceBlockSize();
+    offset %= capacity_;
+    while (length > 0) {
+        const size_t blocks = fbl::min(length, capacity_ - offset);
+        block_fifo_request_t request;
+        request.group = bc_->BlockGroupID();
+        request.vmoid = vmoid;
+        request.opcode = BLOCKIO_WRITE;
+        request.vmo_offset = vmo_offset * kDiskBlocksPerMinfsBlock;
+        request.dev_offset = (info_block_ + 1 + offset) * kDiskBlocksPerMinfsBlock;
+        request.length = static_cast<uint32_t>(blocks * kDiskBlocksPerMinfsBlock);
+        requests_.push_back(request);
+
+        vmo_offset += blocks;
+        offset = 0;
+        length -= blocks;
+    }
+}
+
+bool Journal::DataOverlapsLive() {
+    if (live_.is_empty()) {
+        return false;
+    }
+    if (!live_sorted_) {
+        qsort(live_.get(), live_.size(), sizeof(blk_t), CompareBlocks);
+        live_sorted_ = true;
+    }
+
+    for (WriteTxn* txn : pending_) {
+        for (const WriteRequest& request : txn->Requests()) {
+            if (!request.data) {
+                continue;
+            }
+            // Find the first live block at or after the start of the request.
+            size_t lo = 0;
+            size_t hi = live_.size();
+            while (lo < hi) {
+                const size_t mid = lo + (hi - lo) / 2;
+                if (live_[mid] < request.dev_offset) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            if (lo < live_.size() && live_[lo] < request.dev_offset + request.length) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool Journal::DataOverlapsPending(WriteTxn* txn) const {
+    for (const WriteRequest& data : txn->Requests()) {
+        if (!data.data) {
+            continue;
+        }
+        for (WriteTxn* pending : pending_) {
+            for (const WriteRequest& request : pending->Requests()) {
+                if (!request.data && request.dev_offset < data.dev_offset + data.length &&
+                    data.dev_offset < request.dev_offset + request.length) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+zx_status_t Journal::Checkpoint() {
+    TRACE_DURATION("minfs", "Journal::Checkpoint");
+    if (used_ == 0) {
+        return ZX_OK;
+    }
+
+    // Every entry has been written in place; once that is durable, the entries may be
+    // discarded.
+    zx_status_t status;
+    if ((status = bc_->Sync()) != ZX_OK || (status = WriteInfo()) != ZX_OK ||
+        (status = bc_->Sync()) != ZX_OK) {
+        return status;
+    }
+    used_ = 0;
+    live_.reset();
+    live_sorted_ = true;
+    return ZX_OK;
+}
+
+zx_status_t Journal::WriteInfo() {
+    JournalInfo* info = reinterpret_cast<JournalInfo*>(
+            static_cast<uint8_t*>(blocks_.start()) + 2 * kMinfsBlockSize);
+    info->magic = kJournalMagic;
+    info->start_block = next_;
+    info->sequence = sequence_;
+
+    const uint32_t kDiskBlocksPerMinfsBlock = kMinfsBlockSize / bc_->DeviceBlockSize();
+    block_fifo_request_t request;
+    request.group = bc_->BlockGroupID();
+    request.vmoid = blocks_vmoid_;
+    request.opcode = BLOCKIO_WRITE;
+    request.vmo_offset = 2 * kDiskBlocksPerMinfsBlock;
+    request.dev_offset = info_block_ * kDiskBlocksPerMinfsBlock;
+    request.length = kDiskBlocksPerMinfsBlock;
+    return bc_->Transaction(&request, 1);
+}
+
+} // namespace minfs
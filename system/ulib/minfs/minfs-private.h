@@ -36,6 +36,7 @@
 #include <fs/vnode.h>
 #include <lib/zircon-internal/fnv1hash.h>
 #include <minfs/allocator.h>
+#include <minfs/directory-index.h>
 #include <minfs/format.h>
 #include <minfs/inode-manager.h>
 #include <minfs/superblock.h>
@@ -55,7 +56,7 @@ constexpr uint32_t kExtentCount = 6;
 namespace minfs {
 
 #ifdef __Fuchsia__
-using RawBitmap = bitmap::RawBitmapGeneric<bitmap::VmoStorage>;
+using RawBitmap = bitmap::RawBitmapGeneric<bitmap::SummaryStorage<bitmap::VmoStorage>>;
 using BlockRegion = fuchsia_minfs_BlockRegion;
 #else
 using RawBitmap = bitmap::RawBitmapGeneric<bitmap::DefaultStorage>;
@@ -217,6 +218,10 @@ public:
     // functions is preferred.
     zx_status_t ReadDat(blk_t bno, void* data);
 
+    // Writes one block to the data extent, at relative block |bno|, bypassing the journal.
+    // Only fsck, which has exclusive access to the device, may use this.
+    zx_status_t WriteDat(blk_t bno, const void* data);
+
     void SetMetrics(bool enable) { collecting_metrics_ = enable; }
     fs::Ticker StartTicker() { return fs::Ticker(collecting_metrics_); }
 
@@ -363,6 +368,8 @@ public:
     static zx_status_t Recreate(Minfs* fs, ino_t ino, fbl::RefPtr<VnodeMinfs>* out);
 
     bool IsDirectory() const { return inode_.magic == kMinfsMagicDir; }
+    // Returns true if this directory carries an on-disk index of its entries.
+    bool IsIndexed() const { return MinfsDirectoryIndexBuckets(inode_.size) > 0; }
     bool IsUnlinked() const { return inode_.link_count == 0; }
     zx_status_t CanUnlink() const;
 
@@ -447,6 +454,47 @@ private:
     // Enumerates directories.
     zx_status_t ForEachDirent(DirArgs* args, const DirentCallback func);
 
+    // Invokes |func| on the dirent named |args->name|, as |ForEachDirent| would. Uses the
+    // directory index where one is available, rather than visiting every dirent.
+    zx_status_t ForNamedDirent(DirArgs* args, const DirentCallback func);
+
+    // Finds space for a dirent of |args->reclen| bytes, as |ForEachDirent| would with
+    // |DirentCallbackFindSpace|.
+    zx_status_t FindDirentSpace(DirArgs* args);
+
+    // Reacts to the return code of a directory callback on behalf of the caller.
+    zx_status_t FinishDirentCallback(zx_status_t status, DirArgs* args);
+
+    // Returns the index of this directory, building it if the directory has grown large enough
+    // to warrant one. Returns nullptr if the directory is not indexed.
+    DirectoryIndex* GetDirectoryIndex();
+
+    // Invokes |func| on the dirent named |args->name|, found through the on-disk index.
+    zx_status_t ForIndexedDirent(DirArgs* args, const DirentCallback func);
+
+    // Files the entry named |name| at offset |off| in the on-disk index, creating the index if
+    // the entry is the first to extend past |kMinfsDirectoryIndexMinSize|. Fails with
+    // ZX_ERR_NO_SPACE, without modifying the directory, if the entry's bucket is full.
+    zx_status_t IndexDirent(Transaction* state, fbl::StringPiece name, size_t off);
+
+    // Removes the entry named |name| at offset |off| from the on-disk index, if any.
+    zx_status_t UnindexDirent(Transaction* state, fbl::StringPiece name, size_t off);
+
+    // Splits the next bucket of the on-disk index if the directory has outgrown its buckets.
+    zx_status_t GrowDirectoryIndex(Transaction* state);
+
+    // Reads every live entry of a directory which has not yet outgrown its first block into
+    // |out|, as the first bucket of a new on-disk index.
+    zx_status_t BuildIndexBucket(DirectoryIndexBucket* out);
+
+    zx_status_t ReadIndexBucket(uint32_t bucket, DirectoryIndexBucket* out);
+    zx_status_t WriteIndexBucket(Transaction* state, uint32_t bucket,
+                                 const DirectoryIndexBucket& data);
+
+    // Calculates the number of blocks which adding an entry of |reclen| bytes may allocate,
+    // including any needed by the on-disk index.
+    zx_status_t GetRequiredDirentBlocks(uint32_t reclen, blk_t* num_req_blocks) const;
+
     // Directory callback functions.
     //
     // The following functions are passable to |ForEachDirent|, which reads the parent directory,
@@ -461,6 +509,7 @@ private:
     static zx_status_t DirentCallbackUpdateInode(fbl::RefPtr<VnodeMinfs>, Dirent*,
                                                  DirArgs*);
     static zx_status_t DirentCallbackFindSpace(fbl::RefPtr<VnodeMinfs>, Dirent*, DirArgs*);
+    static zx_status_t DirentCallbackIndex(fbl::RefPtr<VnodeMinfs>, Dirent*, DirArgs*);
 
     // Appends a new directory at the specified offset within |args|. This requires a prior call to
     // DirentCallbackFindSpace to find an offset where there is space for the direntry. It takes
@@ -704,6 +753,10 @@ private:
     ino_t ino_{};
     Inode inode_{};
 
+    // Only present for large directories. Discarded (and later rebuilt from the dirents) if an
+    // update to the directory fails partway, rather than attempting to repair it.
+    fbl::unique_ptr<DirectoryIndex> dir_index_;
+
     // This field tracks the current number of file descriptors with
     // an open reference to this Vnode. Notably, this is distinct from the
     // VnodeMinfs's own refcount, since there may still be filesystem
@@ -816,7 +816,7 @@ zx_status_t Minfs::Create(fbl::unique_ptr<Bcache> bc, const Superblock* info,
     }
 
     fbl::unique_ptr<WritebackBuffer> writeback;
-    status = WritebackBuffer::Create(bc.get(), std::move(mapper), &writeback);
+    status = WritebackBuffer::Create(bc.get(), std::move(mapper), sb->Info(), &writeback);
     if (status != ZX_OK) {
         return status;
     }
@@ -855,6 +855,19 @@ zx_status_t Mount(fbl::unique_ptr<minfs::Bcache> bc, fbl::RefPtr<VnodeMinfs>* ro
     }
     const Superblock* info = reinterpret_cast<Superblock*>(blk);
 
+    // Metadata (including the superblock itself) is not consistent until the journal
+    // has been replayed.
+    if ((status = CheckSuperblock(info, bc.get())) != ZX_OK) {
+        FS_TRACE_ERROR("minfs: mount failed\n");
+        return status;
+    } else if ((status = ReplayJournal(bc.get(), *info)) != ZX_OK) {
+        FS_TRACE_ERROR("minfs: failed to replay journal: %d\n", status);
+        return status;
+    } else if ((status = bc->Readblk(0, &blk)) != ZX_OK) {
+        FS_TRACE_ERROR("minfs: could not read info block\n");
+        return status;
+    }
+
     fbl::unique_ptr<Minfs> fs;
     if ((status = Minfs::Create(std::move(bc), info, &fs)) != ZX_OK) {
         FS_TRACE_ERROR("minfs: mount failed\n");
@@ -1168,6 +1181,17 @@ zx_status_t Minfs::ReadDat(blk_t bno, void* data) {
 #endif
 }
 
+zx_status_t Minfs::WriteDat(blk_t bno, const void* data) {
+#ifdef __Fuchsia__
+    return bc_->Writeblk(Info().dat_block + bno, data);
+#else
+    if (bno >= offsets_.DatBlockCount()) {
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+    return bc_->Writeblk(offsets_.DatStartBlock() + bno, data);
+#endif
+}
+
 #ifndef __Fuchsia__
 zx_status_t Minfs::ReadBlk(blk_t bno, blk_t start, blk_t soft_max, blk_t hard_max, void* data) {
     if (bno >= hard_max) {
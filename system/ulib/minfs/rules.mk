@@ -13,8 +13,10 @@ MODULE_COMPILEFLAGS += -fvisibility=hidden
 COMMON_SRCS := \
     $(LOCAL_DIR)/allocator.cpp \
     $(LOCAL_DIR)/bcache.cpp \
+    $(LOCAL_DIR)/directory-index.cpp \
     $(LOCAL_DIR)/fsck.cpp \
     $(LOCAL_DIR)/inode-manager.cpp \
+    $(LOCAL_DIR)/journal-replay.cpp \
     $(LOCAL_DIR)/minfs.cpp \
     $(LOCAL_DIR)/superblock.cpp \
     $(LOCAL_DIR)/transaction-limits.cpp \
@@ -23,7 +25,8 @@ COMMON_SRCS := \
 
 # minfs implementation
 MODULE_SRCS := \
-    $(COMMON_SRCS)
+    $(COMMON_SRCS) \
+    $(LOCAL_DIR)/journal.cpp \
 
 MODULE_STATIC_LIBS := \
     system/ulib/async \
@@ -43,6 +46,7 @@ MODULE_STATIC_LIBS := \
     system/ulib/zircon-internal \
     system/ulib/zx \
     system/ulib/zxcpp \
+    third_party/ulib/cksum \
 
 MODULE_LIBS := \
     system/ulib/async.default \
@@ -62,6 +66,7 @@ MODULE_HOST_SRCS := \
     $(COMMON_SRCS) \
     $(LOCAL_DIR)/host.cpp \
     system/ulib/bitmap/raw-bitmap.cpp \
+    system/ulib/bitmap/summary.cpp \
 
 MODULE_HOST_COMPILEFLAGS := \
     -Werror-implicit-function-declaration \
@@ -72,6 +77,7 @@ MODULE_HOST_COMPILEFLAGS := \
     -Isystem/ulib/fs/include \
     -Isystem/ulib/fzl/include \
     -Isystem/ulib/zxcpp/include \
+    -Ithird_party/ulib/cksum/include \
 
 # host minfs lib
 
@@ -88,5 +94,6 @@ MODULE_HEADER_DEPS += system/ulib/zircon-internal
 MODULE_HOST_LIBS := \
     system/ulib/fbl.hostlib \
     system/ulib/fs.hostlib \
+    third_party/ulib/cksum.hostlib \
 
 include make/module.mk
@@ -80,6 +80,7 @@ void TransactionLimits::CalculateDataBlocks() {
     // directory blocks by some amount, but this is better than an understimate.
     blk_t max_directory_blocks;
     ZX_ASSERT(GetRequiredBlockCount(kOffset, kMinfsMaxDirentSize, &max_directory_blocks) == ZX_OK);
+    max_directory_blocks += kMaxDirectoryIndexBlocks;
     ZX_ASSERT(GetRequiredBlockCount(kOffset, kMaxWriteBytes, &max_data_blocks_) == ZX_OK);
 
     blk_t direct_blocks = (fbl::round_up(kMaxWriteBytes, kMinfsBlockSize) / kMinfsBlockSize) + 1;
@@ -94,18 +95,16 @@ void TransactionLimits::CalculateJournalBlocks(blk_t block_bitmap_blocks) {
 
     // Ensure we have enough space to fit all the block numbers that may be updated in one
     // transaction. This may spill over into multiple blocks.
-    blk_t header_blocks = 1;
-    if (max_entry_data_blocks_ > kJournalEntryHeaderMaxBlocks) {
-        header_blocks += fbl::round_up((max_entry_data_blocks_ - kJournalEntryHeaderMaxBlocks),
-                                       kMinfsDirectPerIndirect) / kMinfsDirectPerIndirect;
-    }
+    blk_t header_blocks = static_cast<blk_t>(JournalEntryHeaderBlocks(max_entry_data_blocks_));
 
     // For revocation records, we need to know the maximum number of metadata blocks within the
     // data section of Minfs that can be deleted within one operation. This is either a directory
-    // vnode's maximum possible number of data blocks + indirect blocks, or a data vnode's maximum
-    // possible number of indirect blocks.
+    // vnode's maximum possible number of data blocks (including its index) + indirect blocks, or a
+    // data vnode's maximum possible number of indirect blocks.
+    constexpr size_t kMaxDirectoryBytes =
+        kMinfsDirectoryIndexOffset + kMinfsDirectoryIndexMaxBuckets * kMinfsBlockSize;
     blk_t maximum_directory_blocks;
-    ZX_ASSERT(GetRequiredBlockCount(0, kMinfsMaxDirectorySize, &maximum_directory_blocks) == ZX_OK);
+    ZX_ASSERT(GetRequiredBlockCount(0, kMaxDirectoryBytes, &maximum_directory_blocks) == ZX_OK);
     blk_t maximum_indirect_blocks = kMinfsIndirect + kMinfsDoublyIndirect * kMinfsDirectPerIndirect;
     blk_t revocation_blocks = fbl::round_up(fbl::max(maximum_directory_blocks,
                                                      maximum_indirect_blocks),
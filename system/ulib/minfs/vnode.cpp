@@ -776,6 +776,7 @@ zx_status_t VnodeMinfs::UnlinkChild(Transaction* state,
     size_t off = offs->off;
     size_t off_next = off + MinfsReclen(de, off);
     Dirent de_prev, de_next;
+    bool coalesce_prev = false, coalesce_next = false;
     zx_status_t status;
 
     // Read the direntries we're considering merging with.
@@ -793,6 +794,7 @@ zx_status_t VnodeMinfs::UnlinkChild(Transaction* state,
             return status;
         }
         if (de_next.ino == 0) {
+            coalesce_next = true;
             coalesced_size += MinfsReclen(&de_next, off_next);
             // If the next entry *was* last, then 'de' is now last.
             de->reclen |= (de_next.reclen & kMinfsReclenLast);
@@ -808,6 +810,7 @@ zx_status_t VnodeMinfs::UnlinkChild(Transaction* state,
             return status;
         }
         if (de_prev.ino == 0) {
+            coalesce_prev = true;
             coalesced_size += MinfsReclen(&de_prev, off_prev);
             off = off_prev;
         }
@@ -818,17 +821,35 @@ zx_status_t VnodeMinfs::UnlinkChild(Transaction* state,
         FS_TRACE_ERROR("unlink: Corrupted direntry with impossibly large size\n");
         return ZX_ERR_IO;
     }
+    if ((status = UnindexDirent(state, fbl::StringPiece(de->name, de->namelen),
+                                offs->off)) != ZX_OK) {
+        return status;
+    }
+    if (dir_index_ != nullptr) {
+        dir_index_->Remove(de, offs->off);
+        if (coalesce_next) {
+            dir_index_->Remove(&de_next, off_next);
+        }
+        if (coalesce_prev) {
+            dir_index_->Remove(&de_prev, off_prev);
+        }
+    }
     de->ino = 0;
     de->reclen = static_cast<uint32_t>(coalesced_size & kMinfsReclenMask) |
         (de->reclen & kMinfsReclenLast);
     // Erase dirent (replace with 'empty' dirent)
     if ((status = WriteExactInternal(state, de, MINFS_DIRENT_SIZE, off)) != ZX_OK) {
+        dir_index_.reset();
         return status;
     }
+    if (dir_index_ != nullptr && dir_index_->Insert(de, off) != ZX_OK) {
+        dir_index_.reset();
+    }
 
-    if (de->reclen & kMinfsReclenLast) {
+    if ((de->reclen & kMinfsReclenLast) && !IsIndexed()) {
         // Truncating the directory merely removed unused space; if it fails,
-        // the directory contents are still valid.
+        // the directory contents are still valid. Indexed directories keep
+        // their size, which ends with the index.
         TruncateInternal(state, off + MINFS_DIRENT_SIZE);
     }
 
@@ -995,6 +1016,17 @@ zx_status_t VnodeMinfs::DirentCallbackFindSpace(fbl::RefPtr<VnodeMinfs> vndir, D
     }
 }
 
+zx_status_t VnodeMinfs::DirentCallbackIndex(fbl::RefPtr<VnodeMinfs> vndir, Dirent* de,
+                                            DirArgs* args) {
+    zx_status_t status = vndir->dir_index_->Insert(de, args->offs.off);
+    if (status != ZX_OK) {
+        return status;
+    } else if (de->reclen & kMinfsReclenLast) {
+        return kDirIteratorDone;
+    }
+    return NextDirent(de, &args->offs);
+}
+
 zx_status_t VnodeMinfs::AppendDirent(DirArgs* args) {
     char data[kMinfsMaxDirentSize];
     Dirent* de = reinterpret_cast<Dirent*>(data);
@@ -1012,6 +1044,12 @@ zx_status_t VnodeMinfs::AppendDirent(DirArgs* args) {
         if (args->reclen > reclen) {
             return ZX_ERR_NO_SPACE;
         }
+        if ((status = IndexDirent(args->state, args->name, args->offs.off)) != ZX_OK) {
+            return status;
+        }
+        if (dir_index_ != nullptr) {
+            dir_index_->Remove(de, args->offs.off);
+        }
     } else {
         // filled entry, can we sub-divide?
         uint32_t size = static_cast<uint32_t>(DirentSize(de->namelen));
@@ -1023,14 +1061,24 @@ zx_status_t VnodeMinfs::AppendDirent(DirArgs* args) {
         if (extra < args->reclen) {
             return ZX_ERR_NO_SPACE;
         }
+        if ((status = IndexDirent(args->state, args->name, args->offs.off + size)) != ZX_OK) {
+            return status;
+        }
         // shrink existing entry
+        if (dir_index_ != nullptr) {
+            dir_index_->Remove(de, args->offs.off);
+        }
         bool was_last_record = de->reclen & kMinfsReclenLast;
         de->reclen = size;
         if ((status = WriteExactInternal(args->state, de,
                                          DirentSize(de->namelen),
                                          args->offs.off)) != ZX_OK) {
+            dir_index_.reset();
             return status;
         }
+        if (dir_index_ != nullptr && dir_index_->Insert(de, args->offs.off) != ZX_OK) {
+            dir_index_.reset();
+        }
 
         args->offs.off += size;
         // Overwrite dirent data to reflect the new dirent.
@@ -1043,8 +1091,12 @@ zx_status_t VnodeMinfs::AppendDirent(DirArgs* args) {
     memcpy(de->name, args->name.data(), de->namelen);
     if ((status = WriteExactInternal(args->state, de, DirentSize(de->namelen),
                                      args->offs.off)) != ZX_OK) {
+        dir_index_.reset();
         return status;
     }
+    if (dir_index_ != nullptr && dir_index_->Insert(de, args->offs.off) != ZX_OK) {
+        dir_index_.reset();
+    }
 
     if (args->type == kMinfsTypeDir) {
         // Child directory has '..' which will point to parent directory
@@ -1052,6 +1104,9 @@ zx_status_t VnodeMinfs::AppendDirent(DirArgs* args) {
     }
 
     inode_.dirent_count++;
+    if ((status = GrowDirectoryIndex(args->state)) != ZX_OK) {
+        return status;
+    }
     inode_.seq_num++;
     InodeSync(args->state->GetWork(), kMxFsSyncMtime);
     args->state->GetWork()->PinVnode(fbl::WrapRefPtr(this));
@@ -1085,23 +1140,277 @@ zx_status_t VnodeMinfs::ForEachDirent(DirArgs* args, const DirentCallback func)
             return status;
         }
 
-        switch ((status = func(fbl::RefPtr<VnodeMinfs>(this), de, args))) {
-        case kDirIteratorNext:
-            break;
-        case kDirIteratorSaveSync:
-            inode_.seq_num++;
-            InodeSync(args->state->GetWork(), kMxFsSyncMtime);
-            args->state->GetWork()->PinVnode(fbl::WrapRefPtr(this));
-            return ZX_OK;
-        case kDirIteratorDone:
-        default:
+        if ((status = func(fbl::RefPtr<VnodeMinfs>(this), de, args)) != kDirIteratorNext) {
+            return FinishDirentCallback(status, args);
+        }
+    }
+
+    return ZX_ERR_NOT_FOUND;
+}
+
+zx_status_t VnodeMinfs::ForNamedDirent(DirArgs* args, const DirentCallback func) {
+    if (IsIndexed()) {
+        return ForIndexedDirent(args, func);
+    }
+
+    DirectoryIndex* index = GetDirectoryIndex();
+    if (index == nullptr) {
+        return ForEachDirent(args, func);
+    }
+
+    char data[kMinfsMaxDirentSize];
+    Dirent* de = reinterpret_cast<Dirent*>(data);
+    size_t off;
+    for (size_t n = 0; index->FindCandidate(args->name, n, &off); n++) {
+        size_t r;
+        zx_status_t status = ReadInternal(data, kMinfsMaxDirentSize, off, &r);
+        if (status != ZX_OK) {
+            return status;
+        } else if ((status = ValidateDirent(de, r, off)) != ZX_OK) {
+            return status;
+        } else if ((de->ino == 0) || fbl::StringPiece(de->name, de->namelen) != args->name) {
+            // A different name with the same hash.
+            continue;
+        }
+
+        args->offs.off = off;
+        args->offs.off_prev = index->FreeRecordBefore(off);
+        if ((status = func(fbl::RefPtr<VnodeMinfs>(this), de, args)) != kDirIteratorNext) {
+            return FinishDirentCallback(status, args);
+        }
+    }
+
+    return ZX_ERR_NOT_FOUND;
+}
+
+zx_status_t VnodeMinfs::FindDirentSpace(DirArgs* args) {
+    DirectoryIndex* index = GetDirectoryIndex();
+    if (index == nullptr) {
+        return ForEachDirent(args, DirentCallbackFindSpace);
+    }
+
+    // AppendDirent re-validates the record, so the index need not be trusted to be exact.
+    if (!index->FindSpace(args->reclen, &args->offs.off)) {
+        return ZX_ERR_NOT_FOUND;
+    }
+    return ZX_OK;
+}
+
+zx_status_t VnodeMinfs::FinishDirentCallback(zx_status_t status, DirArgs* args) {
+    switch (status) {
+    case kDirIteratorSaveSync:
+        inode_.seq_num++;
+        InodeSync(args->state->GetWork(), kMxFsSyncMtime);
+        args->state->GetWork()->PinVnode(fbl::WrapRefPtr(this));
+        return ZX_OK;
+    case kDirIteratorDone:
+    default:
+        return status;
+    }
+}
+
+DirectoryIndex* VnodeMinfs::GetDirectoryIndex() {
+    if ((dir_index_ != nullptr) || !IsDirectory() ||
+        (inode_.size < kMinfsDirectoryIndexMinSize)) {
+        return dir_index_.get();
+    }
+
+    fbl::AllocChecker ac;
+    dir_index_.reset(new (&ac) DirectoryIndex());
+    if (!ac.check()) {
+        return nullptr;
+    }
+    DirArgs args = DirArgs();
+    zx_status_t status;
+    if ((status = ForEachDirent(&args, DirentCallbackIndex)) != ZX_OK) {
+        FS_TRACE_WARN("minfs: Failed to index directory %u: %d\n", ino_, status);
+        dir_index_.reset();
+    }
+    return dir_index_.get();
+}
+
+zx_status_t VnodeMinfs::ForIndexedDirent(DirArgs* args, const DirentCallback func) {
+    const uint32_t hash = DirectoryIndexHash(args->name);
+    DirectoryIndexBucket bucket;
+    zx_status_t status = ReadIndexBucket(
+            MinfsDirectoryIndexBucket(hash, MinfsDirectoryIndexBuckets(inode_.size)), &bucket);
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    char data[kMinfsMaxDirentSize];
+    Dirent* de = reinterpret_cast<Dirent*>(data);
+    for (uint32_t i = 0; i < bucket.count; i++) {
+        if (bucket.slots[i].hash != hash) {
+            continue;
+        }
+        const size_t off = bucket.slots[i].off;
+        size_t r;
+        if ((status = ReadInternal(data, kMinfsMaxDirentSize, off, &r)) != ZX_OK) {
+            return status;
+        } else if ((status = ValidateDirent(de, r, off)) != ZX_OK) {
             return status;
+        } else if ((de->ino == 0) || fbl::StringPiece(de->name, de->namelen) != args->name) {
+            // A different name with the same hash.
+            continue;
+        }
+
+        args->offs.off = off;
+        // Finding the preceding record requires the in-memory index. Without it, an unlinked
+        // entry is simply not coalesced with a free record before it.
+        args->offs.off_prev = (dir_index_ != nullptr) ? dir_index_->FreeRecordBefore(off) : off;
+        if ((status = func(fbl::RefPtr<VnodeMinfs>(this), de, args)) != kDirIteratorNext) {
+            return FinishDirentCallback(status, args);
         }
     }
 
     return ZX_ERR_NOT_FOUND;
 }
 
+zx_status_t VnodeMinfs::IndexDirent(Transaction* state, fbl::StringPiece name, size_t off) {
+    const uint32_t hash = DirectoryIndexHash(name);
+    DirectoryIndexBucket bucket;
+    uint32_t index = 0;
+    zx_status_t status;
+    if (IsIndexed()) {
+        index = MinfsDirectoryIndexBucket(hash, MinfsDirectoryIndexBuckets(inode_.size));
+        if ((status = ReadIndexBucket(index, &bucket)) != ZX_OK) {
+            return status;
+        }
+    } else if (off + DirentSize(static_cast<uint8_t>(name.length())) >
+               kMinfsDirectoryIndexMinSize) {
+        if ((status = BuildIndexBucket(&bucket)) != ZX_OK) {
+            return status;
+        }
+    } else {
+        return ZX_OK;
+    }
+
+    if (bucket.count == kMinfsDirectoryIndexSlots) {
+        FS_TRACE_WARN("minfs: ino#%u: directory index bucket %u is full\n", ino_, index);
+        return ZX_ERR_NO_SPACE;
+    }
+    bucket.slots[bucket.count].hash = hash;
+    bucket.slots[bucket.count].off = static_cast<uint32_t>(off);
+    bucket.count++;
+    return WriteIndexBucket(state, index, bucket);
+}
+
+zx_status_t VnodeMinfs::UnindexDirent(Transaction* state, fbl::StringPiece name, size_t off) {
+    if (!IsIndexed()) {
+        return ZX_OK;
+    }
+
+    const uint32_t hash = DirectoryIndexHash(name);
+    const uint32_t index = MinfsDirectoryIndexBucket(hash,
+                                                     MinfsDirectoryIndexBuckets(inode_.size));
+    DirectoryIndexBucket bucket;
+    zx_status_t status;
+    if ((status = ReadIndexBucket(index, &bucket)) != ZX_OK) {
+        return status;
+    }
+    for (uint32_t i = 0; i < bucket.count; i++) {
+        if (bucket.slots[i].hash == hash && bucket.slots[i].off == off) {
+            bucket.slots[i] = bucket.slots[--bucket.count];
+            return WriteIndexBucket(state, index, bucket);
+        }
+    }
+    FS_TRACE_ERROR("minfs: ino#%u: dirent at %zu is missing from the index\n", ino_, off);
+    return ZX_ERR_IO_DATA_INTEGRITY;
+}
+
+zx_status_t VnodeMinfs::GrowDirectoryIndex(Transaction* state) {
+    const uint32_t buckets = MinfsDirectoryIndexBuckets(inode_.size);
+    if ((buckets == 0) || (buckets == kMinfsDirectoryIndexMaxBuckets) ||
+        (inode_.dirent_count <= buckets * kMinfsDirectoryIndexLoad)) {
+        return ZX_OK;
+    }
+
+    // Split the next bucket of this round, moving the entries which the wider hash files in the
+    // new bucket, which follows the last.
+    const uint32_t round = MinfsDirectoryIndexRound(buckets);
+    const uint32_t index = buckets - round;
+    DirectoryIndexBucket bucket;
+    DirectoryIndexBucket new_bucket = {};
+    zx_status_t status;
+    if ((status = ReadIndexBucket(index, &bucket)) != ZX_OK) {
+        return status;
+    }
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < bucket.count; i++) {
+        if (bucket.slots[i].hash & round) {
+            new_bucket.slots[new_bucket.count++] = bucket.slots[i];
+        } else {
+            bucket.slots[count++] = bucket.slots[i];
+        }
+    }
+    bucket.count = count;
+    if ((status = WriteIndexBucket(state, index, bucket)) != ZX_OK) {
+        return status;
+    }
+    return WriteIndexBucket(state, buckets, new_bucket);
+}
+
+zx_status_t VnodeMinfs::BuildIndexBucket(DirectoryIndexBucket* out) {
+    char data[kMinfsMaxDirentSize];
+    Dirent* de = reinterpret_cast<Dirent*>(data);
+    memset(out, 0, sizeof(*out));
+    size_t off = 0;
+    while (true) {
+        size_t r;
+        zx_status_t status = ReadInternal(data, kMinfsMaxDirentSize, off, &r);
+        if (status != ZX_OK) {
+            return status;
+        } else if ((status = ValidateDirent(de, r, off)) != ZX_OK) {
+            return status;
+        }
+        if (de->ino != 0) {
+            if (out->count == kMinfsDirectoryIndexSlots) {
+                return ZX_ERR_NO_SPACE;
+            }
+            out->slots[out->count].hash =
+                    DirectoryIndexHash(fbl::StringPiece(de->name, de->namelen));
+            out->slots[out->count].off = static_cast<uint32_t>(off);
+            out->count++;
+        }
+        if (de->reclen & kMinfsReclenLast) {
+            return ZX_OK;
+        }
+        off += MinfsReclen(de, off);
+    }
+}
+
+zx_status_t VnodeMinfs::ReadIndexBucket(uint32_t bucket, DirectoryIndexBucket* out) {
+    zx_status_t status = ReadExactInternal(out, kMinfsBlockSize,
+                                           kMinfsDirectoryIndexOffset + bucket * kMinfsBlockSize);
+    if (status != ZX_OK) {
+        return status;
+    } else if (out->count > kMinfsDirectoryIndexSlots) {
+        FS_TRACE_ERROR("minfs: ino#%u: directory index bucket %u is corrupt\n", ino_, bucket);
+        return ZX_ERR_IO_DATA_INTEGRITY;
+    }
+    return ZX_OK;
+}
+
+zx_status_t VnodeMinfs::WriteIndexBucket(Transaction* state, uint32_t bucket,
+                                         const DirectoryIndexBucket& data) {
+    return WriteExactInternal(state, &data, kMinfsBlockSize,
+                              kMinfsDirectoryIndexOffset + bucket * kMinfsBlockSize);
+}
+
+zx_status_t VnodeMinfs::GetRequiredDirentBlocks(uint32_t reclen, blk_t* num_req_blocks) const {
+    // Assume that the entry is appended after the last record, which ends at the size of the
+    // directory unless the index follows it.
+    const size_t off = IsIndexed() ? kMinfsMaxDirectorySize - reclen : inode_.size;
+    zx_status_t status = GetRequiredBlockCount(off, reclen, num_req_blocks);
+    if (status == ZX_OK && (IsIndexed() || off + reclen > kMinfsDirectoryIndexMinSize)) {
+        // Creating the index, or splitting one of its buckets, allocates a bucket along with
+        // the indirect block which maps it.
+        *num_req_blocks += 2;
+    }
+    return status;
+}
+
 void VnodeMinfs::fbl_recycle() {
     ZX_DEBUG_ASSERT(fd_count_ == 0);
     if (!IsUnlinked()) {
@@ -1368,7 +1677,11 @@ zx_status_t VnodeMinfs::WriteInternal(Transaction* state, const void* data,
             break;
         }
         ZX_DEBUG_ASSERT(bno != 0);
-        state->GetWork()->Enqueue(vmo_.get(), n, bno + fs_->Info().dat_block, 1);
+        if (IsDirectory()) {
+            state->GetWork()->Enqueue(vmo_.get(), n, bno + fs_->Info().dat_block, 1);
+        } else {
+            state->GetWork()->EnqueueData(vmo_.get(), n, bno + fs_->Info().dat_block, 1);
+        }
 #else
         blk_t bno;
         if ((status = BlockGet(state, n, &bno))) {
@@ -1435,7 +1748,7 @@ zx_status_t VnodeMinfs::LookupInternal(fbl::RefPtr<fs::Vnode>* out, fbl::StringP
     auto get_metrics = fbl::MakeAutoCall([&ticker, &success, this]() {
         fs_->UpdateLookupMetrics(success, ticker.End());
     });
-    if ((status = ForEachDirent(&args, DirentCallbackFind)) < 0) {
+    if ((status = ForNamedDirent(&args, DirentCallbackFind)) < 0) {
         return status;
     }
     fbl::RefPtr<VnodeMinfs> vn;
@@ -1624,7 +1937,7 @@ zx_status_t VnodeMinfs::Create(fbl::RefPtr<fs::Vnode>* out, fbl::StringPiece nam
     args.name = name;
     // ensure file does not exist
     zx_status_t status;
-    if ((status = ForEachDirent(&args, DirentCallbackFind)) != ZX_ERR_NOT_FOUND) {
+    if ((status = ForNamedDirent(&args, DirentCallbackFind)) != ZX_ERR_NOT_FOUND) {
         return ZX_ERR_ALREADY_EXISTS;
     }
 
@@ -1635,7 +1948,7 @@ zx_status_t VnodeMinfs::Create(fbl::RefPtr<fs::Vnode>* out, fbl::StringPiece nam
     // before updating any other metadata.
     args.type = type;
     args.reclen = static_cast<uint32_t>(DirentSize(static_cast<uint8_t>(name.length())));
-    status = ForEachDirent(&args, DirentCallbackFindSpace);
+    status = FindDirentSpace(&args);
     if (status == ZX_ERR_NOT_FOUND) {
         return ZX_ERR_NO_SPACE;
     } else if (status != ZX_OK) {
@@ -1643,9 +1956,9 @@ zx_status_t VnodeMinfs::Create(fbl::RefPtr<fs::Vnode>* out, fbl::StringPiece nam
     }
 
     // Calculate maximum blocks to reserve for the current directory, based on the size and offset
-    // of the new direntry (Assuming that the offset is the current size of the directory).
+    // of the new direntry.
     blk_t reserve_blocks = 0;
-    if ((status = GetRequiredBlockCount(inode_.size, args.reclen, &reserve_blocks)) != ZX_OK) {
+    if ((status = GetRequiredDirentBlocks(args.reclen, &reserve_blocks)) != ZX_OK) {
         return status;
     }
 
@@ -1775,7 +2088,7 @@ zx_status_t VnodeMinfs::Unlink(fbl::StringPiece name, bool must_be_dir) {
     args.name = name;
     args.type = must_be_dir ? kMinfsTypeDir : 0;
     args.state = state.get();
-    status = ForEachDirent(&args, DirentCallbackUnlink);
+    status = ForNamedDirent(&args, DirentCallbackUnlink);
     if (status == ZX_OK) {
         state->GetWork()->PinVnode(fbl::WrapRefPtr(this));
         fs_->CommitTransaction(std::move(state));
@@ -1867,7 +2180,13 @@ zx_status_t VnodeMinfs::TruncateInternal(Transaction* state, size_t len) {
                     FS_TRACE_ERROR("minfs: Truncate failed to write last block: %d\n", r);
                     return ZX_ERR_IO;
                 }
-                state->GetWork()->Enqueue(vmo_.get(), rel_bno, bno + fs_->Info().dat_block, 1);
+                if (IsDirectory()) {
+                    state->GetWork()->Enqueue(vmo_.get(), rel_bno, bno + fs_->Info().dat_block,
+                                              1);
+                } else {
+                    state->GetWork()->EnqueueData(vmo_.get(), rel_bno,
+                                                  bno + fs_->Info().dat_block, 1);
+                }
 #else
                 if (fs_->bc_->Readblk(bno + fs_->Info().dat_block, bdata)) {
                     return ZX_ERR_IO;
@@ -1943,7 +2262,7 @@ zx_status_t VnodeMinfs::Rename(fbl::RefPtr<fs::Vnode> _newdir, fbl::StringPiece
     // acquire the 'oldname' node (it must exist)
     DirArgs args = DirArgs();
     args.name = oldname;
-    if ((status = ForEachDirent(&args, DirentCallbackFind)) < 0) {
+    if ((status = ForNamedDirent(&args, DirentCallbackFind)) < 0) {
         return status;
     } else if ((status = fs_->VnodeGet(&oldvn, args.ino)) < 0) {
         return status;
@@ -1966,7 +2285,7 @@ zx_status_t VnodeMinfs::Rename(fbl::RefPtr<fs::Vnode> _newdir, fbl::StringPiece
     args.type = oldvn->IsDirectory() ? kMinfsTypeDir : kMinfsTypeFile;
     args.reclen = static_cast<uint32_t>(DirentSize(static_cast<uint8_t>(newname.length())));
 
-    status = newdir->ForEachDirent(&args, DirentCallbackFindSpace);
+    status = newdir->FindDirentSpace(&args);
     if (status == ZX_ERR_NOT_FOUND) {
         return ZX_ERR_NO_SPACE;
     } else if (status != ZX_OK) {
@@ -1977,8 +2296,7 @@ zx_status_t VnodeMinfs::Rename(fbl::RefPtr<fs::Vnode> _newdir, fbl::StringPiece
 
     // Reserve potential blocks to add a new direntry to newdir.
     blk_t reserved_blocks;
-    if ((status = GetRequiredBlockCount(newdir->GetInode()->size, args.reclen, &reserved_blocks))
-        != ZX_OK) {
+    if ((status = newdir->GetRequiredDirentBlocks(args.reclen, &reserved_blocks)) != ZX_OK) {
         return status;
     }
 
@@ -1992,7 +2310,7 @@ zx_status_t VnodeMinfs::Rename(fbl::RefPtr<fs::Vnode> _newdir, fbl::StringPiece
     args.state = state.get();
     args.name = newname;
     args.ino = oldvn->ino_;
-    status = newdir->ForEachDirent(&args, DirentCallbackAttemptRename);
+    status = newdir->ForNamedDirent(&args, DirentCallbackAttemptRename);
     if (status == ZX_ERR_NOT_FOUND) {
         // if 'newname' does not exist, create it
         args.offs = append_offs;
@@ -2013,7 +2331,7 @@ zx_status_t VnodeMinfs::Rename(fbl::RefPtr<fs::Vnode> _newdir, fbl::StringPiece
         auto vn = fbl::RefPtr<VnodeMinfs>::Downcast(vn_fs);
         args.name = "..";
         args.ino = newdir->ino_;
-        if ((status = vn->ForEachDirent(&args, DirentCallbackUpdateInode)) < 0) {
+        if ((status = vn->ForNamedDirent(&args, DirentCallbackUpdateInode)) < 0) {
             return status;
         }
     }
@@ -2024,7 +2342,7 @@ zx_status_t VnodeMinfs::Rename(fbl::RefPtr<fs::Vnode> _newdir, fbl::StringPiece
 
     // finally, remove oldname from its original position
     args.name = oldname;
-    if ((status = ForEachDirent(&args, DirentCallbackForceUnlink)) != ZX_OK) {
+    if ((status = ForNamedDirent(&args, DirentCallbackForceUnlink)) != ZX_OK) {
         return status;
     }
     state->GetWork()->PinVnode(oldvn);
@@ -2054,7 +2372,7 @@ zx_status_t VnodeMinfs::Link(fbl::StringPiece name, fbl::RefPtr<fs::Vnode> _targ
     DirArgs args = DirArgs();
     args.name = name;
     zx_status_t status;
-    if ((status = ForEachDirent(&args, DirentCallbackFind)) != ZX_ERR_NOT_FOUND) {
+    if ((status = ForNamedDirent(&args, DirentCallbackFind)) != ZX_ERR_NOT_FOUND) {
         return (status == ZX_OK) ? ZX_ERR_ALREADY_EXISTS : status;
     }
 
@@ -2062,7 +2380,7 @@ zx_status_t VnodeMinfs::Link(fbl::StringPiece name, fbl::RefPtr<fs::Vnode> _targ
     // before updating any other metadata.
     args.type = kMinfsTypeFile; // We can't hard link directories
     args.reclen = static_cast<uint32_t>(DirentSize(static_cast<uint8_t>(name.length())));
-    status = ForEachDirent(&args, DirentCallbackFindSpace);
+    status = FindDirentSpace(&args);
     if (status == ZX_ERR_NOT_FOUND) {
         return ZX_ERR_NO_SPACE;
     } else if (status != ZX_OK) {
@@ -2071,8 +2389,7 @@ zx_status_t VnodeMinfs::Link(fbl::StringPiece name, fbl::RefPtr<fs::Vnode> _targ
 
     // Reserve potential blocks to write a new direntry.
     blk_t reserved_blocks;
-    if ((status = GetRequiredBlockCount(GetInode()->size, args.reclen, &reserved_blocks))
-        != ZX_OK) {
+    if ((status = GetRequiredDirentBlocks(args.reclen, &reserved_blocks)) != ZX_OK) {
         return status;
     }
 
@@ -30,11 +30,11 @@ namespace minfs {
 
 #ifdef __Fuchsia__
 
-void WriteTxn::Enqueue(zx_handle_t vmo, uint64_t vmo_offset, uint64_t dev_offset,
-                       uint64_t nblocks) {
+void WriteTxn::EnqueueRequest(zx_handle_t vmo, uint64_t vmo_offset, uint64_t dev_offset,
+                              uint64_t nblocks, bool data) {
     ValidateVmoSize(vmo, static_cast<blk_t>(vmo_offset));
     for (size_t i = 0; i < requests_.size(); i++) {
-        if (requests_[i].vmo != vmo) {
+        if (requests_[i].vmo != vmo || requests_[i].data != data) {
             continue;
         }
 
@@ -55,38 +55,53 @@ void WriteTxn::Enqueue(zx_handle_t vmo, uint64_t vmo_offset, uint64_t dev_offset
     request.vmo = vmo;
     // NOTE: It's easier to compare everything when dealing
     // with blocks (not offsets!) so the following are described in
-    // terms of blocks until we Flush().
+    // terms of blocks until they are written out.
     request.vmo_offset = vmo_offset;
     request.dev_offset = dev_offset;
     request.length = nblocks;
+    request.data = data;
     requests_.push_back(std::move(request));
 }
 
-zx_status_t WriteTxn::Flush(zx_handle_t vmo, vmoid_t vmoid) {
-    ZX_DEBUG_ASSERT(vmo != ZX_HANDLE_INVALID);
+zx_status_t WriteTxn::WriteInPlace(vmoid_t vmoid, bool data) {
     ZX_DEBUG_ASSERT(vmoid != VMOID_INVALID);
 
     // Update all the outgoing transactions to be in "disk blocks",
     // not "Minfs blocks".
     block_fifo_request_t blk_reqs[requests_.size()];
     const uint32_t kDiskBlocksPerMinfsBlock = kMinfsBlockSize / bc_->DeviceBlockSize();
+    size_t count = 0;
     for (size_t i = 0; i < requests_.size(); i++) {
-        blk_reqs[i].group = bc_->BlockGroupID();
-        blk_reqs[i].vmoid = vmoid;
-        blk_reqs[i].opcode = BLOCKIO_WRITE;
-        blk_reqs[i].vmo_offset = requests_[i].vmo_offset * kDiskBlocksPerMinfsBlock;
-        blk_reqs[i].dev_offset = requests_[i].dev_offset * kDiskBlocksPerMinfsBlock;
+        if (requests_[i].data != data) {
+            continue;
+        }
+        blk_reqs[count].group = bc_->BlockGroupID();
+        blk_reqs[count].vmoid = vmoid;
+        blk_reqs[count].opcode = BLOCKIO_WRITE;
+        blk_reqs[count].vmo_offset = requests_[i].vmo_offset * kDiskBlocksPerMinfsBlock;
+        blk_reqs[count].dev_offset = requests_[i].dev_offset * kDiskBlocksPerMinfsBlock;
         // TODO(ZX-2253): Remove this assertion.
         uint64_t length = requests_[i].length * kDiskBlocksPerMinfsBlock;
         ZX_ASSERT_MSG(length < UINT32_MAX, "Too many blocks");
-        blk_reqs[i].length = static_cast<uint32_t>(length);
+        blk_reqs[count].length = static_cast<uint32_t>(length);
+        count++;
     }
 
+    if (count == 0) {
+        return ZX_OK;
+    }
     // Actually send the operations to the underlying block device.
-    zx_status_t status = bc_->Transaction(blk_reqs, requests_.size());
+    return bc_->Transaction(blk_reqs, count);
+}
 
-    requests_.reset();
-    return status;
+size_t WriteTxn::BlkCount(bool data) const {
+    size_t blocks_needed = 0;
+    for (size_t i = 0; i < requests_.size(); i++) {
+        if (requests_[i].data == data) {
+            blocks_needed += requests_[i].length;
+        }
+    }
+    return blocks_needed;
 }
 
 size_t WriteTxn::BlkCount() const {
@@ -118,9 +133,9 @@ void WritebackWork::Reset() {
 #ifdef __Fuchsia__
 // Returns the number of blocks of the writeback buffer that have been
 // consumed
-size_t WritebackWork::Complete(zx_handle_t vmo, vmoid_t vmoid) {
+size_t WritebackWork::Complete(zx_status_t status) {
     size_t blk_count = BlkCount();
-    zx_status_t status = Flush(vmo, vmoid);
+    Requests().reset();
     if (closure_) {
         closure_(status);
     }
@@ -155,6 +170,7 @@ void WritebackWork::PinVnode(fbl::RefPtr<VnodeMinfs> vn) {
 #ifdef __Fuchsia__
 
 zx_status_t WritebackBuffer::Create(Bcache* bc, fzl::OwnedVmoMapper mapper,
+                                    const Superblock& info,
                                     fbl::unique_ptr<WritebackBuffer>* out) {
     fbl::unique_ptr<WritebackBuffer> wb(new WritebackBuffer(bc, std::move(mapper)));
     if (wb->mapper_.size() % kMinfsBlockSize != 0) {
@@ -163,15 +179,20 @@ zx_status_t WritebackBuffer::Create(Bcache* bc, fzl::OwnedVmoMapper mapper,
         return ZX_ERR_NO_RESOURCES;
     } else if (cnd_init(&wb->producer_cvar_) != thrd_success) {
         return ZX_ERR_NO_RESOURCES;
-    } else if (thrd_create_with_name(&wb->writeback_thrd_,
-                                     WritebackBuffer::WritebackThread, wb.get(),
-                                     "minfs-writeback") != thrd_success) {
-        return ZX_ERR_NO_RESOURCES;
     }
     zx_status_t status = wb->bc_->AttachVmo(wb->mapper_.vmo(), &wb->buffer_vmoid_);
     if (status != ZX_OK) {
         return status;
     }
+    status = Journal::Create(bc, info, &wb->mapper_, wb->buffer_vmoid_, &wb->journal_);
+    if (status != ZX_OK) {
+        return status;
+    }
+    if (thrd_create_with_name(&wb->writeback_thrd_, WritebackBuffer::WritebackThread, wb.get(),
+                              "minfs-writeback") != thrd_success) {
+        return ZX_ERR_NO_RESOURCES;
+    }
+    wb->thread_started_ = true;
 
     *out = std::move(wb);
     return ZX_OK;
@@ -182,14 +203,25 @@ WritebackBuffer::WritebackBuffer(Bcache* bc, fzl::OwnedVmoMapper mapper) :
     cap_(mapper_.size() / kMinfsBlockSize) {}
 
 WritebackBuffer::~WritebackBuffer() {
-    // Block until the background thread completes itself.
-    {
-        fbl::AutoLock lock(&writeback_lock_);
-        unmounting_ = true;
-        cnd_signal(&consumer_cvar_);
+    if (thread_started_) {
+        // Block until the background thread completes itself.
+        {
+            fbl::AutoLock lock(&writeback_lock_);
+            unmounting_ = true;
+            cnd_signal(&consumer_cvar_);
+        }
+        int r;
+        thrd_join(writeback_thrd_, &r);
+
+        // Everything has been written in place, so leave the journal empty. This keeps a
+        // cleanly unmounted filesystem from replaying stale entries over changes made by
+        // tools which do not use the journal.
+        zx_status_t status = journal_->Checkpoint();
+        if (status != ZX_OK) {
+            FS_TRACE_ERROR("minfs: failed to checkpoint journal: %d\n", status);
+        }
     }
-    int r;
-    thrd_join(writeback_thrd_, &r);
+    journal_.reset();
 
     if (buffer_vmoid_ != VMOID_INVALID) {
         block_fifo_request_t request;
@@ -272,6 +304,7 @@ void WritebackBuffer::CopyToBufferLocked(WriteTxn* txn) {
             request.vmo_offset = 0;
             request.dev_offset = dev_offset;
             request.length = wb_len;
+            request.data = reqs[i].data;
             i++;
             reqs.insert(i, request);
         }
@@ -318,18 +351,29 @@ int WritebackBuffer::WritebackThread(void* arg) {
     b->writeback_lock_.Acquire();
     while (true) {
         while (!b->work_queue_.is_empty()) {
-            auto work = b->work_queue_.pop();
             TRACE_DURATION("minfs", "WritebackBuffer::WritebackThread");
 
-            // Stay unlocked while processing a unit of work
+            // Coalesce all the work which is ready into a single journal entry, so that it
+            // shares one journal write and one flush.
+            WorkQueue batch;
+            while (!b->work_queue_.is_empty() && b->journal_->Add(&b->work_queue_.front())) {
+                batch.push(b->work_queue_.pop());
+            }
+
+            // Stay unlocked while processing the batch
             b->writeback_lock_.Release();
 
             // TODO(smklein): We could add additional validation that the blocks
             // in "work" are contiguous and in the range of [start_, len_) (including
             // wraparound).
-            size_t blks_consumed = work->Complete(b->mapper_.vmo().get(), b->buffer_vmoid_);
-            TRACE_FLOW_END("minfs", "writeback", reinterpret_cast<trace_flow_id_t>(work.get()));
-            work = nullptr;
+            zx_status_t status = b->journal_->Commit();
+            size_t blks_consumed = 0;
+            while (!batch.is_empty()) {
+                auto work = batch.pop();
+                blks_consumed += work->Complete(status);
+                TRACE_FLOW_END("minfs", "writeback",
+                               reinterpret_cast<trace_flow_id_t>(work.get()));
+            }
 
             // Relock before checking the state of the queue
             b->writeback_lock_.Acquire();
@@ -67,6 +67,21 @@ zx_status_t sync_mutex_trylock(sync_mutex_t* mutex);
 // Does nothing if the mutex is already unlocked.
 void sync_mutex_unlock(sync_mutex_t* mutex) __TA_RELEASE(mutex);
 
+// Counts of how contended locks of any |sync_mutex_t| in the process were
+// resolved.
+typedef struct sync_mutex_stats {
+    // The number of locks which claimed the mutex while spinning.
+    uint64_t spin_success;
+    // The number of times a lock waited on the mutex's futex.
+    uint64_t park;
+} sync_mutex_stats_t;
+
+// Reads the counters of contended locks.
+//
+// Returns |ZX_OK| on success, and |ZX_ERR_NOT_SUPPORTED| if the library was
+// built without SYNC_MUTEX_STATS defined, in which case no counts are kept.
+zx_status_t sync_mutex_get_stats(sync_mutex_stats_t* stats);
+
 __END_CDECLS
 
 #endif // LIB_SYNC_MUTEX_H_
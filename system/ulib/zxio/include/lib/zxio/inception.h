@@ -7,6 +7,7 @@
 
 #include <lib/zxio/ops.h>
 #include <lib/zxs/zxs.h>
+#include <stdbool.h>
 #include <threads.h>
 #include <zircon/compiler.h>
 #include <zircon/types.h>
@@ -24,12 +25,20 @@ __BEGIN_CDECLS
 // |event| handle is an optional event object used with some |fuchsia.io.Node|
 // servers.
 //
+// The |buffer| handle is a VMO obtained from the server on the first large
+// read or write, through which large reads and writes are then transferred.
+//
 // Will eventually be an implementation detail of zxio once fdio completes its
 // transition to the zxio backend.
 typedef struct zxio_remote {
     zxio_t io;
     zx_handle_t control;
     zx_handle_t event;
+    zx_handle_t buffer;
+    // Set if the server refused to share |buffer|.
+    bool buffer_unsupported;
+    // Serializes transfers through |buffer|.
+    mtx_t buffer_lock;
 } zxio_remote_t;
 
 static_assert(sizeof(zxio_remote_t) <= sizeof(zxio_storage_t),
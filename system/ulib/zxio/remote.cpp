@@ -11,6 +11,21 @@
 
 #define ZXIO_REMOTE_CHUNK_SIZE 8192
 
+// Reads and writes larger than ZXIO_REMOTE_CHUNK_SIZE are transferred through
+// a VMO of this size shared with the server, rather than in chunks.
+#define ZXIO_REMOTE_BUFFER_SIZE (256u * 1024u)
+
+static_assert(ZXIO_REMOTE_BUFFER_SIZE <= fuchsia_io_MAX_SHARED_BUFFER,
+              "The shared buffer is larger than servers accept");
+
+static void zxio_remote_release_buffer(zxio_remote_t* rio) {
+    if (rio->buffer != ZX_HANDLE_INVALID) {
+        zx_handle_t buffer = rio->buffer;
+        rio->buffer = ZX_HANDLE_INVALID;
+        zx_handle_close(buffer);
+    }
+}
+
 static zx_status_t zxio_remote_release(zxio_t* io, zx_handle_t* out_handle) {
     zxio_remote_t* rio = reinterpret_cast<zxio_remote_t*>(io);
     zx_handle_t control = rio->control;
@@ -20,6 +35,7 @@ static zx_status_t zxio_remote_release(zxio_t* io, zx_handle_t* out_handle) {
         rio->event = ZX_HANDLE_INVALID;
         zx_handle_close(event);
     }
+    zxio_remote_release_buffer(rio);
     *out_handle = control;
     return ZX_OK;
 }
@@ -36,6 +52,7 @@ static zx_status_t zxio_remote_close(zxio_t* io) {
         rio->event = ZX_HANDLE_INVALID;
         zx_handle_close(event);
     }
+    zxio_remote_release_buffer(rio);
     return io_status != ZX_OK ? io_status : status;
 }
 
@@ -65,6 +82,118 @@ static zx_status_t zxio_remote_attr_set(zxio_t* io, uint32_t flags, const zxio_n
     return io_status != ZX_OK ? io_status : status;
 }
 
+// Asks the server for a VMO to use for large transfers, unless one has been
+// shared already. Returns ZX_ERR_NOT_SUPPORTED if the server refuses.
+static zx_status_t zxio_remote_share_buffer_locked(zxio_remote_t* rio) {
+    if (rio->buffer != ZX_HANDLE_INVALID) {
+        return ZX_OK;
+    }
+    if (rio->buffer_unsupported) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    zx_handle_t buffer = ZX_HANDLE_INVALID;
+    zx_status_t status;
+    zx_status_t io_status = fuchsia_io_FileShareBuffer(rio->control, ZXIO_REMOTE_BUFFER_SIZE,
+                                                       &status, &buffer);
+    if (io_status != ZX_OK) {
+        return io_status;
+    }
+    if (status != ZX_OK || buffer == ZX_HANDLE_INVALID) {
+        zx_handle_close(buffer);
+        rio->buffer_unsupported = true;
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    rio->buffer = buffer;
+    return ZX_OK;
+}
+
+// Reads up to |capacity| bytes through the shared VMO, at |*offset| or, if
+// |offset| is null, at the seek offset.
+static zx_status_t zxio_remote_read_shared(zxio_remote_t* rio, const size_t* offset,
+                                           uint8_t* buffer, size_t capacity,
+                                           size_t* out_actual) {
+    mtx_lock(&rio->buffer_lock);
+    zx_status_t status = zxio_remote_share_buffer_locked(rio);
+    size_t received = 0;
+    while (status == ZX_OK && capacity > 0) {
+        size_t chunk = (capacity > ZXIO_REMOTE_BUFFER_SIZE) ? ZXIO_REMOTE_BUFFER_SIZE : capacity;
+        size_t actual = 0;
+        zx_status_t io_status;
+        if (offset != nullptr) {
+            io_status = fuchsia_io_FileReadSharedAt(rio->control, chunk, *offset + received,
+                                                    &status, &actual);
+        } else {
+            io_status = fuchsia_io_FileReadShared(rio->control, chunk, &status, &actual);
+        }
+        if (io_status != ZX_OK) {
+            status = io_status;
+        } else if (status == ZX_OK && actual > chunk) {
+            status = ZX_ERR_IO;
+        }
+        if (status != ZX_OK) {
+            break;
+        }
+        status = zx_vmo_read(rio->buffer, buffer, 0, actual);
+        received += actual;
+        buffer += actual;
+        capacity -= actual;
+        if (chunk != actual) {
+            break;
+        }
+    }
+    mtx_unlock(&rio->buffer_lock);
+    if (status != ZX_OK) {
+        return status;
+    }
+    *out_actual = received;
+    return ZX_OK;
+}
+
+// Writes up to |capacity| bytes through the shared VMO, at |*offset| or, if
+// |offset| is null, at the seek offset.
+static zx_status_t zxio_remote_write_shared(zxio_remote_t* rio, const size_t* offset,
+                                            const uint8_t* buffer, size_t capacity,
+                                            size_t* out_actual) {
+    mtx_lock(&rio->buffer_lock);
+    zx_status_t status = zxio_remote_share_buffer_locked(rio);
+    size_t sent = 0;
+    while (status == ZX_OK && capacity > 0) {
+        size_t chunk = (capacity > ZXIO_REMOTE_BUFFER_SIZE) ? ZXIO_REMOTE_BUFFER_SIZE : capacity;
+        status = zx_vmo_write(rio->buffer, buffer, 0, chunk);
+        if (status != ZX_OK) {
+            break;
+        }
+        size_t actual = 0;
+        zx_status_t io_status;
+        if (offset != nullptr) {
+            io_status = fuchsia_io_FileWriteSharedAt(rio->control, chunk, *offset + sent,
+                                                     &status, &actual);
+        } else {
+            io_status = fuchsia_io_FileWriteShared(rio->control, chunk, &status, &actual);
+        }
+        if (io_status != ZX_OK) {
+            status = io_status;
+        } else if (status == ZX_OK && actual > chunk) {
+            status = ZX_ERR_IO;
+        }
+        if (status != ZX_OK) {
+            break;
+        }
+        sent += actual;
+        buffer += actual;
+        capacity -= actual;
+        if (chunk != actual) {
+            break;
+        }
+    }
+    mtx_unlock(&rio->buffer_lock);
+    if (status != ZX_OK) {
+        return status;
+    }
+    *out_actual = sent;
+    return ZX_OK;
+}
+
 static zx_status_t zxio_remote_read_once(zxio_remote_t* rio, uint8_t* buffer,
                                          size_t capacity, size_t* out_actual) {
     size_t actual = 0u;
@@ -88,6 +217,12 @@ static zx_status_t zxio_remote_read(zxio_t* io, void* data, size_t capacity,
                                     size_t* out_actual) {
     zxio_remote_t* rio = reinterpret_cast<zxio_remote_t*>(io);
     uint8_t* buffer = static_cast<uint8_t*>(data);
+    if (capacity > ZXIO_REMOTE_CHUNK_SIZE) {
+        zx_status_t status = zxio_remote_read_shared(rio, nullptr, buffer, capacity, out_actual);
+        if (status != ZX_ERR_NOT_SUPPORTED) {
+            return status;
+        }
+    }
     size_t received = 0;
     while (capacity > 0) {
         size_t chunk = (capacity > ZXIO_REMOTE_CHUNK_SIZE) ? ZXIO_REMOTE_CHUNK_SIZE : capacity;
@@ -131,6 +266,12 @@ static zx_status_t zxio_remote_read_at(zxio_t* io, size_t offset, void* data,
                                        size_t capacity, size_t* out_actual) {
     zxio_remote_t* rio = reinterpret_cast<zxio_remote_t*>(io);
     uint8_t* buffer = static_cast<uint8_t*>(data);
+    if (capacity > ZXIO_REMOTE_CHUNK_SIZE) {
+        zx_status_t status = zxio_remote_read_shared(rio, &offset, buffer, capacity, out_actual);
+        if (status != ZX_ERR_NOT_SUPPORTED) {
+            return status;
+        }
+    }
     size_t received = 0;
     while (capacity > 0) {
         size_t chunk = (capacity > ZXIO_REMOTE_CHUNK_SIZE) ? ZXIO_REMOTE_CHUNK_SIZE : capacity;
@@ -175,6 +316,12 @@ static zx_status_t zxio_remote_write(zxio_t* io, const void* data,
                                      size_t capacity, size_t* out_actual) {
     zxio_remote_t* rio = reinterpret_cast<zxio_remote_t*>(io);
     const uint8_t* buffer = static_cast<const uint8_t*>(data);
+    if (capacity > ZXIO_REMOTE_CHUNK_SIZE) {
+        zx_status_t status = zxio_remote_write_shared(rio, nullptr, buffer, capacity, out_actual);
+        if (status != ZX_ERR_NOT_SUPPORTED) {
+            return status;
+        }
+    }
     size_t sent = 0u;
     while (capacity > 0) {
         size_t chunk = (capacity > ZXIO_REMOTE_CHUNK_SIZE) ? ZXIO_REMOTE_CHUNK_SIZE : capacity;
@@ -220,6 +367,12 @@ static zx_status_t zxio_remote_write_at(zxio_t* io, size_t offset,
                                         size_t* out_actual) {
     zxio_remote_t* rio = reinterpret_cast<zxio_remote_t*>(io);
     const uint8_t* buffer = static_cast<const uint8_t*>(data);
+    if (capacity > ZXIO_REMOTE_CHUNK_SIZE) {
+        zx_status_t status = zxio_remote_write_shared(rio, &offset, buffer, capacity, out_actual);
+        if (status != ZX_ERR_NOT_SUPPORTED) {
+            return status;
+        }
+    }
     size_t sent = 0u;
     while (capacity > 0) {
         size_t chunk = (capacity > ZXIO_REMOTE_CHUNK_SIZE) ? ZXIO_REMOTE_CHUNK_SIZE : capacity;
@@ -383,6 +536,9 @@ zx_status_t zxio_remote_init(zxio_storage_t* storage, zx_handle_t control,
     zxio_init(&remote->io, &zxio_remote_ops);
     remote->control = control;
     remote->event = event;
+    remote->buffer = ZX_HANDLE_INVALID;
+    remote->buffer_unsupported = false;
+    mtx_init(&remote->buffer_lock, mtx_plain);
     return ZX_OK;
 }
 
@@ -434,5 +590,8 @@ zx_status_t zxio_dir_init(zxio_storage_t* storage, zx_handle_t control) {
     zxio_init(&remote->io, &zxio_dir_ops);
     remote->control = control;
     remote->event = ZX_HANDLE_INVALID;
+    remote->buffer = ZX_HANDLE_INVALID;
+    remote->buffer_unsupported = false;
+    mtx_init(&remote->buffer_lock, mtx_plain);
     return ZX_OK;
 }
@@ -3,6 +3,7 @@
 // found in the LICENSE file.
 
 #include <atomic>
+#include <stdio.h>
 #include <threads.h>
 #include <utility>
 
@@ -21,6 +22,7 @@
 #include <fbl/auto_lock.h>
 #include <fbl/function.h>
 #include <fbl/mutex.h>
+#include <fbl/unique_ptr.h>
 #include <lib/zx/event.h>
 #include <unittest/unittest.h>
 #include <zircon/status.h>
@@ -157,6 +159,25 @@ protected:
     }
 };
 
+// Records the order in which tasks run.
+class OrderedTask : public TestTask {
+public:
+    OrderedTask() = default;
+
+    void set_order(uint32_t* next_order) { next_order_ = next_order; }
+
+    uint32_t order = 0u;
+
+protected:
+    void Handle(async_dispatcher_t* dispatcher, zx_status_t status) override {
+        TestTask::Handle(dispatcher, status);
+        order = (*next_order_)++;
+    }
+
+private:
+    uint32_t* next_order_ = nullptr;
+};
+
 class ResetQuitTask : public TestTask {
 public:
     ResetQuitTask() = default;
@@ -601,6 +622,50 @@ bool wait_test() {
     END_TEST;
 }
 
+class CancelOtherWait : public TestWait {
+public:
+    CancelOtherWait(zx_handle_t object, zx_signals_t trigger)
+        : TestWait(object, trigger) {}
+
+    TestWait* other = nullptr;
+    zx_status_t cancel_result = ZX_ERR_INTERNAL;
+
+protected:
+    void Handle(async_dispatcher_t* dispatcher, zx_status_t status,
+                const zx_packet_signal_t* signal) override {
+        TestWait::Handle(dispatcher, status, signal);
+        cancel_result = other->Cancel(dispatcher);
+    }
+};
+
+bool wait_cancel_pending_test() {
+    BEGIN_TEST;
+
+    async::Loop loop(&kAsyncLoopConfigNoAttachToThread);
+    zx::event event;
+    EXPECT_EQ(ZX_OK, zx::event::create(0u, &event), "create event");
+
+    // Both waits are satisfied before the loop runs, so both of their packets
+    // are read from the port together. Whichever runs first cancels the other,
+    // which must not run even though its packet has already been read.
+    CancelOtherWait wait1(event.get(), ZX_USER_SIGNAL_1);
+    CancelOtherWait wait2(event.get(), ZX_USER_SIGNAL_1);
+    wait1.other = &wait2;
+    wait2.other = &wait1;
+    EXPECT_EQ(ZX_OK, wait1.Begin(loop.dispatcher()), "wait 1");
+    EXPECT_EQ(ZX_OK, wait2.Begin(loop.dispatcher()), "wait 2");
+    EXPECT_EQ(ZX_OK, event.signal(0u, ZX_USER_SIGNAL_1), "signal 1");
+
+    EXPECT_EQ(ZX_OK, loop.RunUntilIdle(), "run loop");
+    EXPECT_EQ(1u, wait1.run_count + wait2.run_count, "run count");
+    EXPECT_EQ(ZX_OK, wait1.run_count ? wait1.cancel_result : wait2.cancel_result, "cancel");
+
+    loop.Shutdown();
+    EXPECT_EQ(1u, wait1.run_count + wait2.run_count, "run count");
+
+    END_TEST;
+}
+
 bool wait_unwaitable_handle_test() {
     BEGIN_TEST;
 
@@ -752,6 +817,90 @@ bool task_test() {
     END_TEST;
 }
 
+bool task_ordering_test() {
+    BEGIN_TEST;
+
+    async::Loop loop(&kAsyncLoopConfigNoAttachToThread);
+
+    // Post tasks with deadlines in the past, in scrambled order and with
+    // several tasks sharing each deadline.  They must run in deadline order,
+    // and tasks sharing a deadline must run in the order they were posted.
+    constexpr uint32_t kNumTasks = 1000u;
+    constexpr uint32_t kNumDeadlines = 100u;
+    zx::time base = async::Now(loop.dispatcher()) - zx::sec(1);
+    uint32_t next_order = 0u;
+    fbl::unique_ptr<OrderedTask[]> tasks(new OrderedTask[kNumTasks]);
+    for (uint32_t i = 0; i < kNumTasks; i++) {
+        tasks[i].set_order(&next_order);
+        uint32_t slot = (i * 37u) % kNumDeadlines;
+        EXPECT_EQ(ZX_OK, tasks[i].PostForTime(loop.dispatcher(), base + zx::usec(slot)));
+    }
+
+    // Cancel every seventh task, including some at the head of the heap.
+    for (uint32_t i = 0; i < kNumTasks; i += 7u) {
+        EXPECT_EQ(ZX_OK, tasks[i].Cancel(loop.dispatcher()));
+        EXPECT_EQ(ZX_ERR_NOT_FOUND, tasks[i].Cancel(loop.dispatcher()));
+    }
+
+    EXPECT_EQ(ZX_OK, loop.RunUntilIdle());
+
+    const OrderedTask* prev = nullptr;
+    for (uint32_t slot = 0; slot < kNumDeadlines; slot++) {
+        for (uint32_t i = 0; i < kNumTasks; i++) {
+            if ((i * 37u) % kNumDeadlines != slot)
+                continue;
+            if (i % 7u == 0u) {
+                EXPECT_EQ(0u, tasks[i].run_count);
+                continue;
+            }
+            EXPECT_EQ(1u, tasks[i].run_count);
+            EXPECT_EQ(ZX_OK, tasks[i].last_status);
+            if (prev) {
+                EXPECT_LT(prev->order, tasks[i].order);
+            }
+            prev = &tasks[i];
+        }
+    }
+
+    loop.Shutdown();
+
+    END_TEST;
+}
+
+// Posts and cancels many tasks while many others are pending, as a service
+// with a deadline per connection does.  The AsyncLoop/PostCancel perftest
+// measures the same operations.
+bool task_stress_test() {
+    BEGIN_TEST;
+
+    async::Loop loop(&kAsyncLoopConfigNoAttachToThread);
+
+    constexpr uint32_t kNumTasks = 20000u;
+    fbl::unique_ptr<TestTask[]> tasks(new TestTask[kNumTasks]);
+
+    // Deadlines are far in the future and scrambled, so that insertion
+    // cannot rely on tasks arriving in deadline order.
+    zx::time base = async::Now(loop.dispatcher()) + zx::hour(1);
+    for (uint32_t i = 0; i < kNumTasks; i++) {
+        zx::time deadline = base + zx::usec((i * 7919u) % kNumTasks);
+        ASSERT_EQ(ZX_OK, tasks[i].PostForTime(loop.dispatcher(), deadline));
+    }
+
+    for (uint32_t i = 0; i < kNumTasks; i++) {
+        uint32_t index = (i * 104729u) % kNumTasks;
+        ASSERT_EQ(ZX_OK, tasks[index].Cancel(loop.dispatcher()));
+    }
+
+    EXPECT_EQ(ZX_OK, loop.RunUntilIdle());
+    for (uint32_t i = 0; i < kNumTasks; i++) {
+        EXPECT_EQ(0u, tasks[i].run_count);
+    }
+
+    loop.Shutdown();
+
+    END_TEST;
+}
+
 bool task_shutdown_test() {
     BEGIN_TEST;
 
@@ -1377,9 +1526,12 @@ RUN_TEST(make_default_true_test)
 RUN_TEST(quit_test)
 RUN_TEST(time_test)
 RUN_TEST(wait_test)
+RUN_TEST(wait_cancel_pending_test)
 RUN_TEST(wait_unwaitable_handle_test)
 RUN_TEST(wait_shutdown_test)
 RUN_TEST(task_test)
+RUN_TEST(task_ordering_test)
+RUN_TEST(task_stress_test)
 RUN_TEST(task_shutdown_test)
 RUN_TEST(receiver_test)
 RUN_TEST(receiver_shutdown_test)
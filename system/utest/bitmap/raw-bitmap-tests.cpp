@@ -550,6 +550,84 @@ template <typename RawBitmap> static bool GrowFailure(void) {
     END_TEST;
 }
 
+// Compares scans of a large summarized bitmap against an unsummarized one, over
+// fragmented contents in which both long uniform runs and short gaps occur.
+template <typename RawBitmap> static bool SummaryMatchesScan(void) {
+    BEGIN_TEST;
+
+    constexpr size_t kSize = 1 << 20;
+    RawBitmap bitmap;
+    RawBitmapGeneric<DefaultStorage> expected;
+    ASSERT_EQ(bitmap.Reset(kSize), ZX_OK);
+    ASSERT_EQ(expected.Reset(kSize), ZX_OK);
+    ASSERT_EQ(bitmap.Set(0, kSize), ZX_OK);
+    ASSERT_EQ(expected.Set(0, kSize), ZX_OK);
+
+    uint32_t seed = 1;
+    auto next = [&seed](size_t max) {
+        seed = seed * 1103515245 + 12345;
+        return static_cast<size_t>(seed >> 8) % max;
+    };
+
+    for (size_t i = 0; i < 500; i++) {
+        const size_t off = next(kSize);
+        const size_t len = fbl::min(1 + next((i % 2) ? 8192 : 64), kSize - off);
+        const bool set = next(3) == 0;
+        if (set) {
+            EXPECT_EQ(bitmap.Set(off, off + len), ZX_OK);
+            EXPECT_EQ(expected.Set(off, off + len), ZX_OK);
+        } else {
+            EXPECT_EQ(bitmap.Clear(off, off + len), ZX_OK);
+            EXPECT_EQ(expected.Clear(off, off + len), ZX_OK);
+        }
+
+        const size_t start = next(kSize);
+        const size_t end = start + next(kSize - start + 1);
+        const size_t run = 1 + next(256);
+        for (bool is_set : {false, true}) {
+            size_t out = 0, expected_out = 0;
+            zx_status_t status = bitmap.Find(is_set, start, end, run, &out);
+            ASSERT_EQ(status, expected.Find(is_set, start, end, run, &expected_out));
+            if (status == ZX_OK) {
+                ASSERT_EQ(out, expected_out);
+            }
+            status = bitmap.ReverseFind(is_set, start, end, run, &out);
+            ASSERT_EQ(status, expected.ReverseFind(is_set, start, end, run, &expected_out));
+            if (status == ZX_OK) {
+                ASSERT_EQ(out, expected_out);
+            }
+        }
+    }
+
+    END_TEST;
+}
+
+// Modifies the storage of a summarized bitmap directly, as a filesystem does
+// when it reads an allocation bitmap from disk.
+template <typename RawBitmap> static bool SummaryStorageModified(void) {
+    BEGIN_TEST;
+
+    constexpr size_t kSize = 1 << 16;
+    RawBitmap bitmap;
+    ASSERT_EQ(bitmap.Reset(kSize), ZX_OK);
+    ASSERT_EQ(bitmap.Set(0, kSize), ZX_OK);
+
+    size_t out;
+    EXPECT_EQ(bitmap.Find(false, 0, kSize, 1, &out), ZX_ERR_NO_RESOURCES);
+
+    size_t* data = static_cast<size_t*>(
+            const_cast<void*>(bitmap.StorageUnsafe()->GetData()));
+    data[(kSize / 2) / kBits] = 0;
+    bitmap.StorageModified();
+
+    ASSERT_EQ(bitmap.Find(false, 0, kSize, kBits, &out), ZX_OK);
+    EXPECT_EQ(out, kSize / 2);
+    ASSERT_EQ(bitmap.ReverseFind(false, 0, kSize, 1, &out), ZX_OK);
+    EXPECT_EQ(out, kSize / 2 + kBits - 1);
+
+    END_TEST;
+}
+
 #define RUN_TEMPLATIZED_TEST(test, specialization) RUN_TEST(test<specialization>)
 #define ALL_TESTS(specialization)                                                                  \
     RUN_TEMPLATIZED_TEST(InitializedEmpty, specialization)                                         \
@@ -572,6 +650,14 @@ RUN_TEST(MoveAssignmentTest<RawBitmapGeneric<VmoStorage>>)
 RUN_TEST(GrowAcrossPage<RawBitmapGeneric<VmoStorage>>)
 RUN_TEST(GrowShrink<RawBitmapGeneric<VmoStorage>>)
 RUN_TEST(GrowFailure<RawBitmapGeneric<DefaultStorage>>)
+ALL_TESTS(RawBitmapGeneric<SummaryStorage<DefaultStorage>>)
+ALL_TESTS(RawBitmapGeneric<SummaryStorage<VmoStorage>>)
+RUN_TEST(MoveConstructorTest<RawBitmapGeneric<SummaryStorage<VmoStorage>>>)
+RUN_TEST(MoveAssignmentTest<RawBitmapGeneric<SummaryStorage<VmoStorage>>>)
+RUN_TEST(GrowAcrossPage<RawBitmapGeneric<SummaryStorage<VmoStorage>>>)
+RUN_TEST(GrowShrink<RawBitmapGeneric<SummaryStorage<VmoStorage>>>)
+RUN_TEST(SummaryMatchesScan<RawBitmapGeneric<SummaryStorage<DefaultStorage>>>)
+RUN_TEST(SummaryStorageModified<RawBitmapGeneric<SummaryStorage<DefaultStorage>>>)
 END_TEST_CASE(raw_bitmap_tests);
 
 } // namespace tests
@@ -4,6 +4,8 @@
 
 #include <fbl/algorithm.h>
 #include <fbl/function.h>
+#include <lib/zx/time.h>
+#include <stdio.h>
 #include <unittest/unittest.h>
 
 #include "test_thread.h"
@@ -1316,6 +1318,133 @@ bool supply_decommit_test() {
 
 // Tests focused on reading a paged vmo.
 
+// Tests that sequential faults get widened into readahead requests once enabled.
+bool readahead_sequential_test() {
+    BEGIN_TEST;
+
+    UserPager pager;
+
+    ASSERT_TRUE(pager.Init());
+
+    Vmo* vmo;
+    constexpr uint64_t kNumPages = 32;
+    ASSERT_TRUE(pager.CreateVmo(kNumPages, &vmo));
+    ASSERT_TRUE(vmo->SetReadahead(16));
+
+    TestThread t([vmo]() -> bool {
+        return vmo->CheckVmar(0, kNumPages);
+    });
+
+    ASSERT_TRUE(t.Start());
+
+    // The window starts at 4 pages and doubles up to the 16 page limit.
+    ASSERT_TRUE(pager.WaitForPageRead(vmo, 0, 4, ZX_TIME_INFINITE));
+    ASSERT_TRUE(pager.SupplyPages(vmo, 0, 4));
+    ASSERT_TRUE(pager.WaitForPageRead(vmo, 4, 8, ZX_TIME_INFINITE));
+    ASSERT_TRUE(pager.SupplyPages(vmo, 4, 8));
+    ASSERT_TRUE(pager.WaitForPageRead(vmo, 12, 16, ZX_TIME_INFINITE));
+    ASSERT_TRUE(pager.SupplyPages(vmo, 12, 16));
+    ASSERT_TRUE(pager.WaitForPageRead(vmo, 28, 4, ZX_TIME_INFINITE));
+    ASSERT_TRUE(pager.SupplyPages(vmo, 28, 4));
+
+    ASSERT_TRUE(t.Wait());
+
+    END_TEST;
+}
+
+// Tests that readahead stops at pages the vmo already has.
+bool readahead_presupply_test() {
+    BEGIN_TEST;
+
+    UserPager pager;
+
+    ASSERT_TRUE(pager.Init());
+
+    Vmo* vmo;
+    ASSERT_TRUE(pager.CreateVmo(8, &vmo));
+    ASSERT_TRUE(vmo->SetReadahead(8));
+    ASSERT_TRUE(pager.SupplyPages(vmo, 2, 1));
+
+    TestThread t([vmo]() -> bool {
+        return vmo->CheckVmar(0, 1);
+    });
+
+    ASSERT_TRUE(t.Start());
+
+    ASSERT_TRUE(pager.WaitForPageRead(vmo, 0, 2, ZX_TIME_INFINITE));
+    ASSERT_TRUE(pager.SupplyPages(vmo, 0, 2));
+
+    ASSERT_TRUE(t.Wait());
+
+    END_TEST;
+}
+
+// Tests that readahead can only be enabled on pager-backed vmos.
+bool readahead_property_test() {
+    BEGIN_TEST;
+
+    zx::vmo vmo;
+    ASSERT_EQ(zx::vmo::create(ZX_PAGE_SIZE, 0, &vmo), ZX_OK);
+    size_t bytes = 4 * ZX_PAGE_SIZE;
+    ASSERT_EQ(vmo.set_property(ZX_PROP_VMO_READAHEAD_MAX, &bytes, sizeof(bytes)),
+              ZX_ERR_NOT_SUPPORTED);
+
+    UserPager pager;
+    ASSERT_TRUE(pager.Init());
+
+    Vmo* paged_vmo;
+    ASSERT_TRUE(pager.CreateVmo(1, &paged_vmo));
+    ASSERT_TRUE(paged_vmo->SetReadahead(4));
+
+    END_TEST;
+}
+
+// Reads a large vmo sequentially while serving every request, and reports the
+// throughput with and without readahead.
+bool readahead_throughput_benchmark() {
+    BEGIN_TEST;
+
+    constexpr uint64_t kNumPages = 4096;
+    for (uint64_t readahead : {0ul, 16ul, 64ul, 256ul}) {
+        UserPager pager;
+        ASSERT_TRUE(pager.Init());
+
+        Vmo* vmo;
+        ASSERT_TRUE(pager.CreateVmo(kNumPages, &vmo));
+        if (readahead) {
+            ASSERT_TRUE(vmo->SetReadahead(readahead));
+        }
+
+        TestThread t([vmo]() -> bool {
+            return vmo->CheckVmar(0, kNumPages);
+        });
+
+        zx::time start = zx::clock::get_monotonic();
+        ASSERT_TRUE(t.Start());
+
+        uint64_t supplied = 0;
+        uint64_t requests = 0;
+        while (supplied < kNumPages) {
+            uint64_t offset, length;
+            ASSERT_TRUE(pager.GetPageReadRequest(vmo, ZX_TIME_INFINITE, &offset, &length));
+            ASSERT_TRUE(pager.SupplyPages(vmo, offset, length));
+            supplied += length;
+            requests++;
+        }
+
+        ASSERT_TRUE(t.Wait());
+        zx::duration elapsed = zx::clock::get_monotonic() - start;
+
+        double mb = static_cast<double>(kNumPages * ZX_PAGE_SIZE) / (1024 * 1024);
+        double secs = static_cast<double>(elapsed.to_nsecs()) / ZX_SEC(1);
+        printf("\nreadahead %3lu pages: %5lu requests, %8.2f MB/s", readahead, requests,
+               mb / secs);
+    }
+    printf("\n");
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(pager_read_tests)
 RUN_TEST(single_page_test);
 RUN_TEST(presupply_test);
@@ -1332,6 +1461,10 @@ RUN_TEST(successive_vmo_test);
 RUN_TEST(multiple_concurrent_vmo_test);
 RUN_TEST(vmar_unmap_test);
 RUN_TEST(vmar_remap_test);
+RUN_TEST(readahead_sequential_test);
+RUN_TEST(readahead_presupply_test);
+RUN_TEST(readahead_property_test);
+RUN_TEST(readahead_throughput_benchmark);
 END_TEST_CASE(pager_read_tests)
 
 // Tests focused on lifecycle of pager and paged vmos.
@@ -8,6 +8,7 @@
 #include <fbl/intrusive_double_list.h>
 #include <lib/zx/vmar.h>
 #include <lib/zx/vmo.h>
+#include <zircon/syscalls/object.h>
 #include <zircon/syscalls/port.h>
 #include <zircon/time.h>
 #include <zircon/types.h>
@@ -37,6 +38,12 @@ public:
         return OpRange(ZX_VMO_OP_DECOMMIT, page_offset, page_count);
     }
 
+    // Sets how many pages the kernel may request ahead of sequential faults.
+    bool SetReadahead(uint64_t page_count) {
+        size_t bytes = page_count * ZX_PAGE_SIZE;
+        return vmo_.set_property(ZX_PROP_VMO_READAHEAD_MAX, &bytes, sizeof(bytes)) == ZX_OK;
+    }
+
     uint64_t GetKey() const { return base_val_; }
     uintptr_t GetBaseAddr() const { return base_addr_; }
 
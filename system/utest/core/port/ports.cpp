@@ -77,6 +77,100 @@ static bool queue_and_close_test(void) {
     END_TEST;
 }
 
+static bool wait_many_test(void) {
+    BEGIN_TEST;
+    zx_status_t status;
+
+    zx_handle_t port;
+    status = zx_port_create(0, &port);
+    EXPECT_EQ(status, ZX_OK, "could not create port");
+
+    zx_port_packet_t out[4] = {};
+    size_t actual = 0u;
+
+    status = zx_port_wait_many(port, 0, out, 0u, &actual);
+    EXPECT_EQ(status, ZX_ERR_INVALID_ARGS);
+
+    status = zx_port_wait_many(port, zx_deadline_after(ZX_USEC(1)), out, 4u, &actual);
+    EXPECT_EQ(status, ZX_ERR_TIMED_OUT);
+
+    for (uint64_t key = 0u; key != 6u; ++key) {
+        const zx_port_packet_t in = {
+            key,
+            ZX_PKT_TYPE_USER,
+            0,
+            { {} }
+        };
+        status = zx_port_queue(port, &in);
+        EXPECT_EQ(status, ZX_OK);
+    }
+
+    // Packets are returned in the order they were queued, up to |count| at a time.
+    status = zx_port_wait_many(port, ZX_TIME_INFINITE, out, 4u, &actual);
+    EXPECT_EQ(status, ZX_OK);
+    EXPECT_EQ(actual, 4u);
+    for (size_t ix = 0u; ix != 4u; ++ix) {
+        EXPECT_EQ(out[ix].key, ix);
+        EXPECT_EQ(out[ix].type, ZX_PKT_TYPE_USER);
+    }
+
+    // A wait returns the packets which are ready without blocking for more.
+    status = zx_port_wait_many(port, ZX_TIME_INFINITE, out, 4u, &actual);
+    EXPECT_EQ(status, ZX_OK);
+    EXPECT_EQ(actual, 2u);
+    EXPECT_EQ(out[0].key, 4u);
+    EXPECT_EQ(out[1].key, 5u);
+
+    status = zx_port_wait_many(port, zx_deadline_after(ZX_USEC(1)), out, 4u, &actual);
+    EXPECT_EQ(status, ZX_ERR_TIMED_OUT);
+
+    status = zx_handle_close(port);
+    EXPECT_EQ(status, ZX_OK);
+
+    END_TEST;
+}
+
+static bool wait_many_drains_test(void) {
+    BEGIN_TEST;
+    zx_status_t status;
+
+    zx_handle_t port;
+    status = zx_port_create(0, &port);
+    EXPECT_EQ(status, ZX_OK, "could not create port");
+
+    zx_port_packet_t out[4] = {};
+    size_t actual = 0u;
+
+    // Each queued packet is counted once by the port, and a batch must account for every packet
+    // it returns; otherwise later waits on the drained port return early.
+    for (int round = 0; round != 3; ++round) {
+        for (uint64_t key = 0u; key != 4u; ++key) {
+            const zx_port_packet_t in = {
+                key,
+                ZX_PKT_TYPE_USER,
+                0,
+                { {} }
+            };
+            status = zx_port_queue(port, &in);
+            EXPECT_EQ(status, ZX_OK);
+        }
+
+        status = zx_port_wait_many(port, ZX_TIME_INFINITE, out, 4u, &actual);
+        EXPECT_EQ(status, ZX_OK);
+        EXPECT_EQ(actual, 4u);
+
+        status = zx_port_wait_many(port, zx_deadline_after(ZX_MSEC(1)), out, 4u, &actual);
+        EXPECT_EQ(status, ZX_ERR_TIMED_OUT);
+        status = zx_port_wait(port, zx_deadline_after(ZX_MSEC(1)), out);
+        EXPECT_EQ(status, ZX_ERR_TIMED_OUT);
+    }
+
+    status = zx_handle_close(port);
+    EXPECT_EQ(status, ZX_OK);
+
+    END_TEST;
+}
+
 static bool queue_too_many(void) {
     BEGIN_TEST;
     zx_status_t status;
@@ -680,6 +774,8 @@ static bool cancel_stress() {
 BEGIN_TEST_CASE(port_tests)
 RUN_TEST(basic_test)
 RUN_TEST(queue_and_close_test)
+RUN_TEST(wait_many_test)
+RUN_TEST(wait_many_drains_test)
 RUN_TEST(queue_too_many)
 RUN_TEST(async_wait_channel_test)
 RUN_TEST(async_wait_event_test_single)
@@ -4,6 +4,7 @@
 
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -1376,6 +1377,136 @@ bool socket_share_consumes_on_failure() {
     END_TEST;
 }
 
+bool socket_rx_buf_limit() {
+    BEGIN_TEST;
+
+    zx_handle_t socket[2];
+    ASSERT_EQ(zx_socket_create(0, &socket[0], &socket[1]), ZX_OK, "");
+
+    zx_info_socket_t info;
+    ASSERT_EQ(zx_object_get_info(socket[0], ZX_INFO_SOCKET, &info, sizeof(info), NULL, NULL),
+              ZX_OK, "");
+    size_t limit = 0;
+    ASSERT_EQ(zx_object_get_property(socket[0], ZX_PROP_SOCKET_RX_BUF_LIMIT, &limit,
+                                     sizeof(limit)),
+              ZX_OK, "");
+    EXPECT_GE(limit, info.rx_buf_max, "");
+
+    // The limit may not be set below the initial capacity.
+    size_t value = info.rx_buf_max - 1;
+    EXPECT_EQ(zx_object_set_property(socket[0], ZX_PROP_SOCKET_RX_BUF_LIMIT, &value,
+                                     sizeof(value)),
+              ZX_ERR_INVALID_ARGS, "");
+
+    value = 0;
+    EXPECT_EQ(zx_object_set_property(socket[0], ZX_PROP_SOCKET_RX_BUF_LIMIT, &value,
+                                     sizeof(value)),
+              ZX_ERR_INVALID_ARGS, "");
+
+    // Nor above 64 times it, whatever the boot options allow.
+    for (size_t bad : {info.rx_buf_max * 64 + 1, info.rx_buf_max * 128, SIZE_MAX}) {
+        EXPECT_EQ(zx_object_set_property(socket[0], ZX_PROP_SOCKET_RX_BUF_LIMIT, &bad,
+                                         sizeof(bad)),
+                  ZX_ERR_INVALID_ARGS, "");
+    }
+
+    // The initial limit is always allowed.
+    value = limit;
+    EXPECT_EQ(zx_object_set_property(socket[0], ZX_PROP_SOCKET_RX_BUF_LIMIT, &value,
+                                     sizeof(value)),
+              ZX_OK, "");
+
+    value = info.rx_buf_max;
+    EXPECT_EQ(zx_object_set_property(socket[0], ZX_PROP_SOCKET_RX_BUF_LIMIT, &value,
+                                     sizeof(value)),
+              ZX_OK, "");
+    EXPECT_EQ(zx_object_get_property(socket[0], ZX_PROP_SOCKET_RX_BUF_LIMIT, &limit,
+                                     sizeof(limit)),
+              ZX_OK, "");
+    EXPECT_EQ(limit, value, "");
+
+    zx_handle_close(socket[0]);
+    zx_handle_close(socket[1]);
+
+    END_TEST;
+}
+
+// Writes to |socket| until it would block, and returns the number of bytes written.
+size_t fill_socket(zx_handle_t socket, char* buffer, size_t len) {
+    size_t total = 0;
+    size_t actual;
+    while (zx_socket_write(socket, 0, buffer, len, &actual) == ZX_OK) {
+        total += actual;
+    }
+    return total;
+}
+
+// Reads from |socket| until it would block, and returns the number of bytes read.
+size_t drain_socket(zx_handle_t socket, char* buffer, size_t len) {
+    size_t total = 0;
+    size_t actual;
+    while (zx_socket_read(socket, 0, buffer, len, &actual) == ZX_OK) {
+        total += actual;
+    }
+    return total;
+}
+
+bool socket_rx_buf_grow() {
+    BEGIN_TEST;
+
+    zx_handle_t socket[2];
+    ASSERT_EQ(zx_socket_create(0, &socket[0], &socket[1]), ZX_OK, "");
+
+    zx_info_socket_t info;
+    ASSERT_EQ(zx_object_get_info(socket[1], ZX_INFO_SOCKET, &info, sizeof(info), NULL, NULL),
+              ZX_OK, "");
+    const size_t initial = info.rx_buf_max;
+    size_t limit = 0;
+    ASSERT_EQ(zx_object_get_property(socket[1], ZX_PROP_SOCKET_RX_BUF_LIMIT, &limit,
+                                     sizeof(limit)),
+              ZX_OK, "");
+    ASSERT_GT(limit, initial, "");
+
+    // The receive buffer grows each time the writer finds it full again soon after the reader
+    // emptied it. Growth depends on how quickly each round runs, so allow for a few slow ones.
+    const size_t len = 64 * 1024;
+    fbl::Array<char> buffer(new char[len], len);
+    memset(buffer.get(), 0xa5, len);
+    size_t prev = initial;
+    for (int round = 0; round < 100 && prev < limit; ++round) {
+        size_t written = fill_socket(socket[0], buffer.get(), len);
+        ASSERT_EQ(zx_object_get_info(socket[1], ZX_INFO_SOCKET, &info, sizeof(info), NULL, NULL),
+                  ZX_OK, "");
+        EXPECT_GE(info.rx_buf_max, prev, "");
+        EXPECT_LE(info.rx_buf_max, limit, "");
+        EXPECT_EQ(info.rx_buf_size, info.rx_buf_max, "");
+        EXPECT_EQ(drain_socket(socket[1], buffer.get(), len), written, "");
+        prev = info.rx_buf_max;
+    }
+    EXPECT_EQ(prev, limit, "");
+
+    // Once at the limit, the buffer stops growing.
+    for (int round = 0; round < 3; ++round) {
+        size_t written = fill_socket(socket[0], buffer.get(), len);
+        EXPECT_EQ(written, limit, "");
+        EXPECT_EQ(drain_socket(socket[1], buffer.get(), len), written, "");
+    }
+
+    // Lowering the limit shrinks the buffer with it.
+    ASSERT_EQ(zx_object_set_property(socket[1], ZX_PROP_SOCKET_RX_BUF_LIMIT, &initial,
+                                     sizeof(initial)),
+              ZX_OK, "");
+    ASSERT_EQ(zx_object_get_info(socket[1], ZX_INFO_SOCKET, &info, sizeof(info), NULL, NULL),
+              ZX_OK, "");
+    EXPECT_EQ(info.rx_buf_max, initial, "");
+    EXPECT_EQ(fill_socket(socket[0], buffer.get(), len), initial, "");
+
+    zx_handle_close(socket[0]);
+    zx_handle_close(socket[1]);
+
+    END_TEST;
+}
+
 } // namespace
 
 BEGIN_TEST_CASE(socket_tests)
@@ -1404,6 +1535,8 @@ RUN_TEST(socket_accept)
 RUN_TEST(socket_share_invalid_handle)
 RUN_TEST(socket_share_consumes_on_failure)
 RUN_TEST(socket_signals2)
+RUN_TEST(socket_rx_buf_limit)
+RUN_TEST(socket_rx_buf_grow)
 END_TEST_CASE(socket_tests)
 
 #ifndef BUILD_COMBINED_TESTS
@@ -204,10 +204,52 @@ static bool test_timeout_elapsed(void) {
     END_TEST;
 }
 
+// A lock which times out while another thread holds the mutex cannot have
+// claimed it by spinning, so it must have waited on the futex.
+static bool test_stats(void) {
+    BEGIN_TEST;
+
+    sync_mutex_stats_t before;
+    zx_status_t status = sync_mutex_get_stats(&before);
+    if (status == ZX_ERR_NOT_SUPPORTED) {
+        unittest_printf("sync_mutex_t stats are not built in\n");
+        END_TEST;
+    }
+    ASSERT_EQ(status, ZX_OK, "");
+
+    timeout_args args;
+    args.mutex = SYNC_MUTEX_INIT;
+    ASSERT_EQ(zx_event_create(0, &args.start_event), ZX_OK, "could not create event");
+    ASSERT_EQ(zx_event_create(0, &args.done_event), ZX_OK, "could not create event");
+
+    thrd_t helper;
+    ASSERT_EQ(thrd_create(&helper, test_timeout_helper, &args), thrd_success, "");
+    ASSERT_EQ(zx_object_wait_one(args.start_event, ZX_EVENT_SIGNALED, ZX_TIME_INFINITE, NULL),
+              ZX_OK, "failed to wait");
+
+    status = sync_mutex_timedlock(&args.mutex, zx_deadline_after(ZX_MSEC(10)));
+    ASSERT_EQ(status, ZX_ERR_TIMED_OUT, "wait should time out");
+
+    sync_mutex_stats_t after;
+    ASSERT_EQ(sync_mutex_get_stats(&after), ZX_OK, "");
+    EXPECT_GT(after.park, before.park, "timed out lock did not wait on the futex");
+    EXPECT_GE(after.spin_success, before.spin_success, "");
+
+    ASSERT_EQ(zx_object_signal(args.done_event, 0, ZX_EVENT_SIGNALED),
+              ZX_OK, "failed to signal");
+    ASSERT_EQ(thrd_join(helper, NULL), thrd_success, "failed to join");
+
+    ASSERT_EQ(zx_handle_close(args.start_event), ZX_OK, "failed to close event");
+    ASSERT_EQ(zx_handle_close(args.done_event), ZX_OK, "failed to close event");
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(sync_mutex_tests)
 RUN_TEST(test_mutexes)
 RUN_TEST(test_try_mutexes)
 RUN_TEST(test_timeout_elapsed)
+RUN_TEST(test_stats)
 END_TEST_CASE(sync_mutex_tests)
 
 #ifndef BUILD_COMBINED_TESTS
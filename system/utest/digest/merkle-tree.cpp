@@ -467,6 +467,32 @@ bool VerifyNodeByNode(void) {
     END_TEST;
 }
 
+// Verifies each node of |kLarge| bytes from a buffer holding only that node.
+bool VerifyFromOffset(void) {
+    BEGIN_TEST_WITH_RC;
+    size_t tree_len = MerkleTree::GetTreeLength(kLarge);
+    Digest digest;
+    ASSERT_OK(MerkleTree::Create(gData, kLarge, gTree, tree_len, &digest));
+    for (uint64_t i = 0; i < kLarge; i += kNodeSize) {
+        ASSERT_OK(MerkleTree::Verify(gData + i, i, kLarge, gTree, tree_len, i, kNodeSize,
+                                     digest));
+    }
+    END_TEST;
+}
+
+bool VerifyFromUnalignedOffset(void) {
+    BEGIN_TEST_WITH_RC;
+    size_t tree_len = MerkleTree::GetTreeLength(kLarge);
+    Digest digest;
+    ASSERT_OK(MerkleTree::Create(gData, kLarge, gTree, tree_len, &digest));
+    ASSERT_ERR(ZX_ERR_INVALID_ARGS,
+               MerkleTree::Verify(gData + 1, 1, kLarge, gTree, tree_len, 1, kNodeSize, digest));
+    ASSERT_ERR(ZX_ERR_INVALID_ARGS,
+               MerkleTree::Verify(gData + kNodeSize, kNodeSize, kLarge, gTree, tree_len, 0,
+                                  kNodeSize, digest));
+    END_TEST;
+}
+
 bool VerifyMissingData(void) {
     BEGIN_TEST_WITH_RC;
     size_t tree_len = MerkleTree::GetTreeLength(kSmall);
@@ -725,6 +751,8 @@ RUN_TEST(CreateTreeTooSmall)
 RUN_TEST(VerifyAll)
 RUN_TEST(VerifyCAll)
 RUN_TEST(VerifyNodeByNode)
+RUN_TEST(VerifyFromOffset)
+RUN_TEST(VerifyFromUnalignedOffset)
 RUN_TEST(VerifyMissingData)
 RUN_TEST(VerifyMissingTree)
 RUN_TEST(VerifyUnalignedTreeLength)
@@ -4,14 +4,18 @@
 
 #include <fcntl.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <fbl/function.h>
 #include <fbl/string.h>
 #include <fbl/string_buffer.h>
 #include <fbl/string_printf.h>
 #include <fbl/unique_fd.h>
+#include <fbl/unique_ptr.h>
+#include <fbl/vector.h>
 #include <fs-management/mount.h>
 #include <fs-test-utils/fixture.h>
 #include <fs-test-utils/perftest.h>
@@ -42,12 +46,13 @@ bool WriteBigFile(ssize_t data_size, perftest::RepeatState* state, Fixture* fixt
     fbl::unique_fd fd(open(GetBigFilePath(*fixture).c_str(), O_CREAT | O_WRONLY));
     ASSERT_TRUE(fd);
     state->DeclareStep("write");
-    uint8_t data[data_size];
+    state->SetBytesProcessedPerRun(data_size);
+    fbl::unique_ptr<uint8_t[]> data(new uint8_t[data_size]);
     uint8_t pattern = static_cast<uint8_t>(rand_r(fixture->mutable_seed()) % (1 << 8));
-    memset(data, pattern, data_size);
+    memset(data.get(), pattern, data_size);
 
     while (state->KeepRunning()) {
-        ASSERT_EQ(write(fd.get(), data, data_size), data_size);
+        ASSERT_EQ(write(fd.get(), data.get(), data_size), data_size);
     }
 
     END_HELPER;
@@ -60,10 +65,11 @@ bool ReadBigFile(ssize_t data_size, perftest::RepeatState* state, Fixture* fixtu
     uint8_t pattern = static_cast<uint8_t>(rand_r(fixture->mutable_seed()) % (1 << 8));
     ASSERT_TRUE(fd);
     state->DeclareStep("read");
-    uint8_t data[data_size];
+    state->SetBytesProcessedPerRun(data_size);
+    fbl::unique_ptr<uint8_t[]> data(new uint8_t[data_size]);
 
     while (state->KeepRunning()) {
-        ASSERT_EQ(read(fd.get(), data, data_size), data_size);
+        ASSERT_EQ(read(fd.get(), data.get(), data_size), data_size);
         ASSERT_EQ(data[0], pattern);
     }
 
@@ -158,6 +164,70 @@ private:
     fbl::StringBuffer<fs_test_utils::kPathSize> path_;
 };
 
+// Wrapper so the files of a single, large directory can be shared across calls.
+class DirectoryOp {
+public:
+    explicit DirectoryOp(fbl::String name) : name_(std::move(name)) {}
+    DirectoryOp(const DirectoryOp&) = delete;
+    DirectoryOp(DirectoryOp&&) = delete;
+    DirectoryOp& operator=(const DirectoryOp&) = delete;
+    DirectoryOp& operator=(DirectoryOp&&) = delete;
+    ~DirectoryOp() = default;
+
+    // Will create files in the directory until |state::KeepGoing| returns false.
+    bool Create(perftest::RepeatState* state, Fixture* fixture) {
+        BEGIN_HELPER;
+        dir_ = fbl::StringPrintf("%s/%s", fixture->fs_path().c_str(), name_.c_str());
+        ASSERT_EQ(mkdir(dir_.c_str(), 0666), 0);
+        file_count_ = 0;
+
+        while (state->KeepRunning()) {
+            fbl::unique_fd fd(open(GetPath(file_count_), O_CREAT | O_EXCL | O_WRONLY, 0644));
+            ASSERT_TRUE(fd);
+            file_count_++;
+        }
+        END_HELPER;
+    }
+
+    // Will stat the created files until |state::KeepGoing| returns false.
+    bool Stat(perftest::RepeatState* state, Fixture* fixture) {
+        BEGIN_HELPER;
+        ASSERT_GT(file_count_, 0u);
+        uint32_t i = 0;
+        while (state->KeepRunning()) {
+            struct stat buff;
+            ASSERT_EQ(stat(GetPath(i), &buff), 0);
+            i = (i + 1) % file_count_;
+        }
+        END_HELPER;
+    }
+
+    // Will unlink the created files until |state::KeepGoing| returns false, or none are left.
+    bool Unlink(perftest::RepeatState* state, Fixture* fixture) {
+        BEGIN_HELPER;
+        uint32_t i = 0;
+        while (i < file_count_ && state->KeepRunning()) {
+            ASSERT_EQ(unlink(GetPath(i)), 0);
+            i++;
+        }
+        if (i == file_count_) {
+            ASSERT_EQ(rmdir(dir_.c_str()), 0);
+        }
+        END_HELPER;
+    }
+
+private:
+    const char* GetPath(uint32_t index) {
+        snprintf(path_, sizeof(path_), "%s/%08x", dir_.c_str(), index);
+        return path_;
+    }
+
+    const fbl::String name_;
+    fbl::String dir_;
+    uint32_t file_count_ = 0;
+    char path_[fs_test_utils::kPathSize];
+};
+
 } // namespace
 
 bool RunBenchmark(int argc, char** argv) {
@@ -170,6 +240,10 @@ bool RunBenchmark(int argc, char** argv) {
         8192,
         16384,
     };
+    const int sequential_test_sample_counts[] = {
+        16,
+        64,
+    };
 
     if (!fs_test_utils::ParseCommandLineArgs(argc, argv, &f_opts, &p_opts)) {
         return false;
@@ -206,6 +280,35 @@ bool RunBenchmark(int argc, char** argv) {
         testcases.push_back(std::move(testcase));
     }
 
+    // Sequential read and write tests with transfers much larger than a
+    // single message to the filesystem.
+    for (int test_sample_count : sequential_test_sample_counts) {
+        TestCaseInfo testcase;
+        testcase.sample_count = test_sample_count;
+        testcase.name = fbl::StringPrintf("%s/Bigfile/1Mbytes/%d-Ops",
+                                          disk_format_string_[f_opts.fs_type], test_sample_count);
+        testcase.teardown = false;
+        for (int cycle = 0; cycle < cycles; ++cycle) {
+            TestInfo write_test, read_test;
+            write_test.name =
+                fbl::StringPrintf("%s/%d-Cycle/Write", testcase.name.c_str(), cycle + 1);
+            write_test.test_fn = [](perftest::RepeatState* state, Fixture* fixture) {
+                return WriteBigFile(1 << 20, state, fixture);
+            };
+            write_test.required_disk_space = test_sample_count * (1 << 20) * (cycle + 1);
+            testcase.tests.push_back(std::move(write_test));
+
+            read_test.name =
+                fbl::StringPrintf("%s/%d-Cycle/Read", testcase.name.c_str(), cycle + 1);
+            read_test.test_fn = [](perftest::RepeatState* state, Fixture* fixture) {
+                return ReadBigFile(1 << 20, state, fixture);
+            };
+            read_test.required_disk_space = test_sample_count * (1 << 20) * (cycle + 1);
+            testcase.tests.push_back(std::move(read_test));
+        }
+        testcases.push_back(std::move(testcase));
+    }
+
     // Path walk tests.
     const int path_walk_sample_counts[] = {
         125,
@@ -240,6 +343,43 @@ bool RunBenchmark(int argc, char** argv) {
         testcases.push_back(std::move(testcase));
     }
 
+    // Large directory tests, which place every file in the same directory.
+    const int directory_sample_counts[] = {
+        1000,
+        10000,
+        100000,
+    };
+
+    fbl::Vector<fbl::unique_ptr<DirectoryOp>> dir_ops;
+    for (int test_sample_count : directory_sample_counts) {
+        TestCaseInfo testcase;
+        testcase.name = fbl::StringPrintf("%s/Directory/%d-Files",
+                                          disk_format_string_[f_opts.fs_type], test_sample_count);
+        testcase.sample_count = test_sample_count;
+        testcase.teardown = false;
+
+        dir_ops.push_back(fbl::make_unique<DirectoryOp>(
+            fbl::StringPrintf("dir-%d", test_sample_count)));
+        DirectoryOp* dir_op = dir_ops[dir_ops.size() - 1].get();
+
+        TestInfo create_test;
+        create_test.name = fbl::StringPrintf("%s/Create", testcase.name.c_str());
+        create_test.test_fn = fbl::BindMember(dir_op, &DirectoryOp::Create);
+        testcase.tests.push_back(std::move(create_test));
+
+        TestInfo stat_test;
+        stat_test.name = fbl::StringPrintf("%s/Stat", testcase.name.c_str());
+        stat_test.test_fn = fbl::BindMember(dir_op, &DirectoryOp::Stat);
+        testcase.tests.push_back(std::move(stat_test));
+
+        TestInfo unlink_test;
+        unlink_test.name = fbl::StringPrintf("%s/Unlink", testcase.name.c_str());
+        unlink_test.test_fn = fbl::BindMember(dir_op, &DirectoryOp::Unlink);
+        testcase.tests.push_back(std::move(unlink_test));
+
+        testcases.push_back(std::move(testcase));
+    }
+
     return fs_test_utils::RunTestCases(f_opts, p_opts, testcases);
 }
 } // namespace fs_bench
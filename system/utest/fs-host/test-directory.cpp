@@ -4,7 +4,13 @@
 
 #include "util.h"
 
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <fbl/algorithm.h>
+#include <fbl/unique_fd.h>
+#include <minfs/format.h>
 
 bool check_dir_contents(const char* dirname, expected_dirent_t* edirents, size_t len) {
     BEGIN_HELPER;
@@ -120,8 +126,112 @@ bool TestDirectoryReaddirLarge(void) {
     END_TEST;
 }
 
+bool read_block(int fd, minfs::blk_t bno, void* data) {
+    BEGIN_HELPER;
+    ASSERT_EQ(pread(fd, data, minfs::kMinfsBlockSize,
+                    static_cast<off_t>(bno) * minfs::kMinfsBlockSize),
+              static_cast<ssize_t>(minfs::kMinfsBlockSize));
+    END_HELPER;
+}
+
+bool write_block(int fd, minfs::blk_t bno, const void* data) {
+    BEGIN_HELPER;
+    ASSERT_EQ(pwrite(fd, data, minfs::kMinfsBlockSize,
+                     static_cast<off_t>(bno) * minfs::kMinfsBlockSize),
+              static_cast<ssize_t>(minfs::kMinfsBlockSize));
+    END_HELPER;
+}
+
+// Locates the device block holding the first bucket of the index of directory |ino|.
+bool find_index_block(int fd, ino_t ino, minfs::blk_t* out) {
+    BEGIN_HELPER;
+    minfs::Superblock info;
+    char blk[minfs::kMinfsBlockSize];
+    ASSERT_TRUE(read_block(fd, 0, blk));
+    memcpy(&info, blk, sizeof(info));
+
+    minfs::Inode inode;
+    ASSERT_TRUE(read_block(fd, info.ino_block + static_cast<minfs::blk_t>(
+                                   ino / minfs::kMinfsInodesPerBlock), blk));
+    memcpy(&inode, blk + (ino % minfs::kMinfsInodesPerBlock) * minfs::kMinfsInodeSize,
+           sizeof(inode));
+    ASSERT_EQ(inode.magic, minfs::kMinfsMagicDir);
+    ASSERT_GT(inode.size, minfs::kMinfsDirectoryIndexOffset, "Directory is not indexed");
+
+    // The index begins within the range of the first indirect block.
+    const minfs::blk_t n = minfs::kMinfsDirectoryIndexOffset / minfs::kMinfsBlockSize;
+    static_assert(n >= minfs::kMinfsDirect, "");
+    static_assert(n - minfs::kMinfsDirect < minfs::kMinfsDirectPerIndirect, "");
+    ASSERT_NE(inode.inum[0], 0);
+    ASSERT_TRUE(read_block(fd, info.dat_block + inode.inum[0], blk));
+    const minfs::blk_t bno = reinterpret_cast<minfs::blk_t*>(blk)[n - minfs::kMinfsDirect];
+    ASSERT_NE(bno, 0);
+    *out = info.dat_block + bno;
+    END_HELPER;
+}
+
+bool TestDirectoryIndexRepair(void) {
+    BEGIN_TEST;
+
+    // Enough entries to outgrow the first block of the directory, and then to split the first
+    // bucket of its index.
+    const int num_files = 1000;
+    ASSERT_EQ(emu_mkdir("::index", 0755), 0);
+    for (int i = 0; i < num_files; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), "::index/%04d", i);
+        int fd = emu_open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+        ASSERT_GT(fd, 0);
+        ASSERT_EQ(emu_close(fd), 0);
+    }
+    ASSERT_EQ(run_fsck(), 0);
+
+    struct stat s;
+    ASSERT_EQ(emu_stat("::index", &s), 0);
+    ASSERT_GT(s.st_size, minfs::kMinfsDirectoryIndexOffset + minfs::kMinfsBlockSize,
+              "Expected the first bucket to have been split");
+
+    fbl::unique_fd disk(open(MOUNT_PATH, O_RDWR));
+    ASSERT_TRUE(disk);
+    minfs::blk_t bno;
+    ASSERT_TRUE(find_index_block(disk.get(), static_cast<ino_t>(s.st_ino), &bno));
+
+    minfs::DirectoryIndexBucket bucket;
+    ASSERT_TRUE(read_block(disk.get(), bno, &bucket));
+    const uint32_t count = bucket.count;
+    ASSERT_GT(count, 0);
+
+    // Drop half of the bucket's entries, and file another entry under the wrong hash.
+    bucket.count = count / 2;
+    bucket.slots[0].hash ^= 1;
+    ASSERT_TRUE(write_block(disk.get(), bno, &bucket));
+
+    // fsck reports the corruption, and rebuilds the bucket.
+    ASSERT_NE(run_fsck(), 0);
+    ASSERT_TRUE(read_block(disk.get(), bno, &bucket));
+    ASSERT_EQ(bucket.count, count);
+    ASSERT_EQ(run_fsck(), 0);
+
+    // Every entry may be found through the index once more.
+    for (int i = 0; i < num_files; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), "::index/%04d", i);
+        int fd = emu_open(path, O_RDWR, 0644);
+        ASSERT_GT(fd, 0);
+        ASSERT_EQ(emu_close(fd), 0);
+    }
+
+    // A bucket which cannot be read back as one is also rebuilt.
+    memset(&bucket, 0xff, sizeof(bucket));
+    ASSERT_TRUE(write_block(disk.get(), bno, &bucket));
+    ASSERT_NE(run_fsck(), 0);
+    ASSERT_EQ(run_fsck(), 0);
+    END_TEST;
+}
+
 RUN_MINFS_TESTS(directory_tests,
     RUN_TEST_LARGE(TestDirectoryLarge)
     RUN_TEST_MEDIUM(TestDirectoryReaddir)
     RUN_TEST_MEDIUM(TestDirectoryReaddirLarge)
+    RUN_TEST_MEDIUM(TestDirectoryIndexRepair)
 )
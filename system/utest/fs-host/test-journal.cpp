@@ -0,0 +1,232 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <fbl/unique_fd.h>
+#include <lib/cksum.h>
+#include <minfs/format.h>
+
+#include "util.h"
+
+namespace {
+
+using minfs::blk_t;
+using minfs::kMinfsBlockSize;
+
+bool read_block(int fd, blk_t bno, void* data) {
+    ASSERT_EQ(pread(fd, data, kMinfsBlockSize, static_cast<off_t>(bno) * kMinfsBlockSize),
+              static_cast<ssize_t>(kMinfsBlockSize));
+    return true;
+}
+
+bool write_block(int fd, blk_t bno, const void* data) {
+    ASSERT_EQ(pwrite(fd, data, kMinfsBlockSize, static_cast<off_t>(bno) * kMinfsBlockSize),
+              static_cast<ssize_t>(kMinfsBlockSize));
+    return true;
+}
+
+bool read_info(int fd, minfs::Superblock* info, minfs::JournalInfo* journal_info) {
+    char blk[kMinfsBlockSize];
+    ASSERT_TRUE(read_block(fd, 0, blk));
+    memcpy(info, blk, sizeof(*info));
+    ASSERT_TRUE(read_block(fd, info->journal_start_block, blk));
+    memcpy(journal_info, blk, sizeof(*journal_info));
+    ASSERT_EQ(journal_info->magic, minfs::kJournalMagic);
+    return true;
+}
+
+// Writes a journal entry which, once replayed, fills |target| with |fill|, as the entry
+// |sequence| at the journal offset |offset|. If |torn|, the entry is written as though the
+// device lost power before the last metadata block reached the disk.
+bool write_entry(int fd, const minfs::Superblock& info, size_t offset, uint64_t sequence,
+                 blk_t target, uint8_t fill, bool torn) {
+    const size_t capacity = minfs::JournalBlocks(info) - 1;
+    auto journal_block = [&info, capacity](size_t offset) {
+        return static_cast<blk_t>(info.journal_start_block + 1 + offset % capacity);
+    };
+
+    minfs::JournalHeaderBlock header;
+    memset(&header, 0, sizeof(header));
+    header.magic = minfs::kJournalEntryMagic;
+    header.sequence = sequence;
+    header.num_blocks = 1;
+    header.target_blocks[0] = target;
+
+    char data[kMinfsBlockSize];
+    memset(data, fill, sizeof(data));
+
+    char blk[kMinfsBlockSize];
+    memset(blk, 0, sizeof(blk));
+    minfs::JournalCommitBlock* commit = reinterpret_cast<minfs::JournalCommitBlock*>(blk);
+    commit->magic = minfs::kJournalCommitMagic;
+    commit->sequence = sequence;
+    commit->checksum = crc32(0, reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+    commit->checksum = crc32(commit->checksum, reinterpret_cast<const uint8_t*>(data),
+                             sizeof(data));
+
+    if (torn) {
+        memset(data, 0, sizeof(data));
+    }
+    ASSERT_TRUE(write_block(fd, journal_block(offset), &header));
+    ASSERT_TRUE(write_block(fd, journal_block(offset + 1), data));
+    ASSERT_TRUE(write_block(fd, journal_block(offset + 2), blk));
+    return true;
+}
+
+// Returns true if every byte of |bno| is |fill|.
+bool block_filled(int fd, blk_t bno, uint8_t fill) {
+    uint8_t blk[kMinfsBlockSize];
+    if (!read_block(fd, bno, blk)) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(blk); i++) {
+        if (blk[i] != fill) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the last data block, which a freshly formatted filesystem leaves unused, after
+// zeroing it.
+blk_t scratch_block(int fd, const minfs::Superblock& info) {
+    const blk_t bno = info.dat_block + info.block_count - 1;
+    uint8_t zero[kMinfsBlockSize] = {};
+    return write_block(fd, bno, zero) ? bno : 0;
+}
+
+bool test_journal_replay(void) {
+    BEGIN_TEST;
+
+    fbl::unique_fd fd(open(MOUNT_PATH, O_RDWR));
+    ASSERT_TRUE(fd);
+    minfs::Superblock info;
+    minfs::JournalInfo journal_info;
+    ASSERT_TRUE(read_info(fd.get(), &info, &journal_info));
+
+    const blk_t target = scratch_block(fd.get(), info);
+    ASSERT_NE(target, 0);
+    ASSERT_TRUE(block_filled(fd.get(), target, 0));
+    ASSERT_TRUE(write_entry(fd.get(), info, journal_info.start_block, journal_info.sequence,
+                            target, 0xa5, false));
+
+    // fsck checks the filesystem as it will be mounted, which replays the entry.
+    ASSERT_EQ(run_fsck(), 0);
+    ASSERT_TRUE(block_filled(fd.get(), target, 0xa5));
+
+    minfs::JournalInfo replayed_info;
+    ASSERT_TRUE(read_info(fd.get(), &info, &replayed_info));
+    const size_t capacity = minfs::JournalBlocks(info) - 1;
+    ASSERT_EQ(replayed_info.start_block, (journal_info.start_block + 3) % capacity);
+    ASSERT_EQ(replayed_info.sequence, journal_info.sequence + 1);
+
+    // The entry has been retired, so replaying again changes nothing.
+    uint8_t zero[kMinfsBlockSize] = {};
+    ASSERT_TRUE(write_block(fd.get(), target, zero));
+    ASSERT_EQ(run_fsck(), 0);
+    ASSERT_TRUE(block_filled(fd.get(), target, 0));
+
+    END_TEST;
+}
+
+bool test_journal_torn_entry(void) {
+    BEGIN_TEST;
+
+    fbl::unique_fd fd(open(MOUNT_PATH, O_RDWR));
+    ASSERT_TRUE(fd);
+    minfs::Superblock info;
+    minfs::JournalInfo journal_info;
+    ASSERT_TRUE(read_info(fd.get(), &info, &journal_info));
+
+    const blk_t target = scratch_block(fd.get(), info);
+    ASSERT_NE(target, 0);
+    ASSERT_TRUE(write_entry(fd.get(), info, journal_info.start_block, journal_info.sequence,
+                            target, 0xa5, true));
+
+    // An entry which was not completely written must not be replayed.
+    ASSERT_EQ(run_fsck(), 0);
+    ASSERT_TRUE(block_filled(fd.get(), target, 0));
+
+    minfs::JournalInfo replayed_info;
+    ASSERT_TRUE(read_info(fd.get(), &info, &replayed_info));
+    ASSERT_EQ(replayed_info.start_block, journal_info.start_block);
+    ASSERT_EQ(replayed_info.sequence, journal_info.sequence);
+
+    END_TEST;
+}
+
+bool test_journal_replay_stops_at_torn_entry(void) {
+    BEGIN_TEST;
+
+    fbl::unique_fd fd(open(MOUNT_PATH, O_RDWR));
+    ASSERT_TRUE(fd);
+    minfs::Superblock info;
+    minfs::JournalInfo journal_info;
+    ASSERT_TRUE(read_info(fd.get(), &info, &journal_info));
+
+    // Of two transactions, only the first was durable when the device lost power.
+    const blk_t target = scratch_block(fd.get(), info);
+    ASSERT_NE(target, 0);
+    const size_t offset = journal_info.start_block;
+    const uint64_t sequence = journal_info.sequence;
+    ASSERT_TRUE(write_entry(fd.get(), info, offset, sequence, target, 0x11, false));
+    ASSERT_TRUE(write_entry(fd.get(), info, offset + 3, sequence + 1, target, 0x22, true));
+
+    ASSERT_EQ(run_fsck(), 0);
+    ASSERT_TRUE(block_filled(fd.get(), target, 0x11));
+
+    minfs::JournalInfo replayed_info;
+    ASSERT_TRUE(read_info(fd.get(), &info, &replayed_info));
+    ASSERT_EQ(replayed_info.sequence, sequence + 1);
+
+    END_TEST;
+}
+
+bool test_journal_stale_entry(void) {
+    BEGIN_TEST;
+
+    fbl::unique_fd fd(open(MOUNT_PATH, O_RDWR));
+    ASSERT_TRUE(fd);
+    minfs::Superblock info;
+    minfs::JournalInfo journal_info;
+    ASSERT_TRUE(read_info(fd.get(), &info, &journal_info));
+
+    // A complete entry left over from before the journal was last emptied carries an older
+    // sequence number, and must not be replayed.
+    const blk_t target = scratch_block(fd.get(), info);
+    ASSERT_NE(target, 0);
+    ASSERT_TRUE(write_entry(fd.get(), info, journal_info.start_block, journal_info.sequence - 1,
+                            target, 0xa5, false));
+    ASSERT_EQ(run_fsck(), 0);
+    ASSERT_TRUE(block_filled(fd.get(), target, 0));
+
+    END_TEST;
+}
+
+bool test_journal_entry_header_blocks(void) {
+    BEGIN_TEST;
+
+    const size_t kMax = minfs::kJournalEntryHeaderMaxBlocks;
+    const size_t kPerBlock = minfs::kJournalEntryTargetsPerBlock;
+    ASSERT_EQ(minfs::JournalEntryHeaderBlocks(1), 1);
+    ASSERT_EQ(minfs::JournalEntryHeaderBlocks(kMax), 1);
+    ASSERT_EQ(minfs::JournalEntryHeaderBlocks(kMax + 1), 2);
+    ASSERT_EQ(minfs::JournalEntryHeaderBlocks(kMax + kPerBlock), 2);
+    ASSERT_EQ(minfs::JournalEntryHeaderBlocks(kMax + kPerBlock + 1), 3);
+
+    END_TEST;
+}
+
+} // namespace
+
+RUN_MINFS_TESTS(journal_tests,
+    RUN_TEST_MEDIUM(test_journal_replay)
+    RUN_TEST_MEDIUM(test_journal_torn_entry)
+    RUN_TEST_MEDIUM(test_journal_replay_stops_at_torn_entry)
+    RUN_TEST_MEDIUM(test_journal_stale_entry)
+    RUN_TEST_SMALL(test_journal_entry_header_blocks)
+)
@@ -49,7 +49,8 @@ void teardown_fs_test() {
 }
 
 int run_fsck() {
-    fbl::unique_fd disk(open(MOUNT_PATH, O_RDONLY));
+    // fsck replays the journal, so it needs to be able to write to the disk.
+    fbl::unique_fd disk(open(MOUNT_PATH, O_RDWR));
 
     if (!disk) {
         fprintf(stderr, "Unable to open disk for fsck\n");
@@ -215,6 +215,58 @@ bool TestDirectoryCoalesceLargeRecord(void) {
     END_TEST;
 }
 
+// Fills the holes left by unlinking entries throughout a large directory, and
+// checks that every entry can still be found.
+bool TestDirectoryReuseHoles(void) {
+    BEGIN_TEST;
+
+    const int kNumEntries = 512;
+    char path[PATH_MAX];
+    ASSERT_EQ(mkdir("::holes", 0666), 0);
+
+    for (int i = 0; i < kNumEntries; i++) {
+        snprintf(path, sizeof(path), "::holes/%064d", i);
+        int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+        ASSERT_GT(fd, 0);
+        ASSERT_EQ(close(fd), 0);
+    }
+
+    // Unlink every other entry, then refill the holes with shorter names.
+    for (int i = 0; i < kNumEntries; i += 2) {
+        snprintf(path, sizeof(path), "::holes/%064d", i);
+        ASSERT_EQ(unlink(path), 0);
+    }
+    for (int i = 0; i < kNumEntries; i += 2) {
+        snprintf(path, sizeof(path), "::holes/%d", i);
+        ASSERT_EQ(mkdir(path, 0666), 0);
+    }
+
+    if (test_info->can_be_mounted) {
+        ASSERT_TRUE(check_remount());
+    }
+
+    struct stat s;
+    for (int i = 0; i < kNumEntries; i++) {
+        snprintf(path, sizeof(path), "::holes/%064d", i);
+        ASSERT_EQ(stat(path, &s), (i % 2) ? 0 : -1);
+        snprintf(path, sizeof(path), "::holes/%d", i);
+        ASSERT_EQ(stat(path, &s), (i % 2) ? -1 : 0);
+    }
+
+    for (int i = 0; i < kNumEntries; i++) {
+        if (i % 2) {
+            snprintf(path, sizeof(path), "::holes/%064d", i);
+            ASSERT_EQ(unlink(path), 0);
+        } else {
+            snprintf(path, sizeof(path), "::holes/%d", i);
+            ASSERT_EQ(rmdir(path), 0);
+        }
+    }
+    ASSERT_EQ(rmdir("::holes"), 0);
+
+    END_TEST;
+}
+
 bool TestDirectoryTrailingSlash(void) {
     BEGIN_TEST;
 
@@ -461,6 +513,7 @@ bool TestDirectoryAfterRmdir(void) {
 RUN_FOR_ALL_FILESYSTEMS(directory_tests,
     RUN_TEST_MEDIUM(TestDirectoryCoalesce)
     RUN_TEST_MEDIUM(TestDirectoryCoalesceLargeRecord)
+    RUN_TEST_MEDIUM(TestDirectoryReuseHoles)
     RUN_TEST_MEDIUM(TestDirectoryFilenameMax)
     RUN_TEST_LARGE(TestDirectoryLarge)
     RUN_TEST_MEDIUM(TestDirectoryTrailingSlash)
@@ -6,6 +6,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
@@ -14,6 +15,7 @@
 #include <fbl/algorithm.h>
 #include <fbl/unique_fd.h>
 #include <fs-management/ramdisk.h>
+#include <fuchsia/hardware/ramdisk/c/fidl.h>
 #include <fuchsia/io/c/fidl.h>
 #include <fuchsia/minfs/c/fidl.h>
 #include <fvm/fvm.h>
@@ -515,6 +517,70 @@ bool TestUnlinkFail(void) {
     END_TEST;
 }
 
+// Loses power at each point while a file is written and synced, on a device which may persist
+// any subset of the writes which were not flushed. Whichever writes survive, the file must not
+// refer to data which did not reach the disk.
+bool TestPowerLossWritingFile(void) {
+    BEGIN_TEST;
+
+    if (use_real_disk) {
+        fprintf(stderr, "Ramdisk required; skipping test\n");
+        return true;
+    }
+
+    const uint32_t flags = fuchsia_hardware_ramdisk_RAMDISK_FLAG_DISCARD_NOT_FLUSHED_ON_WAKE |
+                           fuchsia_hardware_ramdisk_RAMDISK_FLAG_DISCARD_RANDOM;
+    ASSERT_EQ(ramdisk_set_flags(test_ramdisk, flags), ZX_OK);
+
+    // Writes are issued in whole filesystem blocks, so there is no point in losing power
+    // partway through one.
+    const uint64_t step = minfs::kMinfsBlockSize / test_disk_info.block_size;
+    bool completed = false;
+    for (uint64_t blocks = step; !completed; blocks += step) {
+        ASSERT_LT(blocks, 1024 * step, "file write never completed");
+
+        char path[64];
+        snprintf(path, sizeof(path), "%s/power-loss-%" PRIu64, kMountPath, blocks);
+        char data[minfs::kMinfsBlockSize];
+        memset(data, static_cast<int>(blocks / step) | 1, sizeof(data));
+
+        ASSERT_EQ(ramdisk_sleep_after(test_ramdisk, blocks), ZX_OK);
+        fbl::unique_fd fd(open(path, O_CREAT | O_RDWR));
+        if (fd && write(fd.get(), data, sizeof(data)) == sizeof(data)) {
+            fsync(fd.get());
+        }
+        fd.reset();
+        // Unmounting flushes anything still buffered; it fails if the device is asleep.
+        test_info->unmount(kMountPath);
+
+        ramdisk_block_write_counts_t counts;
+        ASSERT_EQ(ramdisk_get_block_counts(test_ramdisk, &counts), ZX_OK);
+        completed = counts.failed == 0;
+        ASSERT_EQ(ramdisk_wake(test_ramdisk), ZX_OK);
+
+        ASSERT_EQ(test_info->fsck(test_disk_path), 0);
+        ASSERT_EQ(test_info->mount(test_disk_path, kMountPath), 0);
+        fd.reset(open(path, O_RDONLY));
+        if (!fd) {
+            ASSERT_FALSE(completed);
+            continue;
+        }
+        struct stat st;
+        ASSERT_EQ(fstat(fd.get(), &st), 0);
+        if (st.st_size == 0) {
+            ASSERT_FALSE(completed);
+            continue;
+        }
+        ASSERT_EQ(st.st_size, sizeof(data));
+        char buf[minfs::kMinfsBlockSize];
+        ASSERT_EQ(read(fd.get(), buf, sizeof(buf)), sizeof(buf));
+        ASSERT_EQ(memcmp(buf, data, sizeof(data)), 0, "file refers to unwritten data");
+    }
+
+    ASSERT_EQ(ramdisk_set_flags(test_ramdisk, 0), ZX_OK);
+    END_TEST;
+}
+
 bool GetAllocatedBlocks(uint64_t* out_allocated_blocks) {
     BEGIN_HELPER;
     fuchsia_io_FilesystemInfo info;
@@ -606,6 +672,7 @@ bool TestGetAllocatedRegions() {
 RUN_MINFS_TESTS_NORMAL(FsMinfsTests,
     RUN_TEST_LARGE(TestFullOperations)
     RUN_TEST_MEDIUM(TestUnlinkFail)
+    RUN_TEST_MEDIUM(TestPowerLossWritingFile)
     RUN_TEST_MEDIUM(TestGetAllocatedRegions)
 )
 
@@ -112,9 +112,60 @@ bool TestOffsetOperations(void) {
     END_TEST;
 }
 
+// Test that reads and writes much larger than a single message to the
+// filesystem transfer all of their data, and move the seek pointer correctly.
+bool TestLargeOperations(void) {
+    BEGIN_TEST;
+
+    srand(0xDEADBEEF);
+
+    // Not a multiple of any transfer size used by the client.
+    constexpr size_t kBufferSize = (1 << 20) + 123;
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<uint8_t[]> expected(new (&ac) uint8_t[kBufferSize]);
+    ASSERT_TRUE(ac.check());
+    fbl::unique_ptr<uint8_t[]> buf(new (&ac) uint8_t[kBufferSize]);
+    ASSERT_TRUE(ac.check());
+    for (size_t i = 0; i < kBufferSize; i++) {
+        expected[i] = static_cast<uint8_t>(rand());
+    }
+
+    const char* filename = "::large_ops";
+    fbl::unique_fd fd(open(filename, O_RDWR | O_CREAT, 0644));
+    ASSERT_TRUE(fd);
+
+    ASSERT_EQ(write(fd.get(), expected.get(), kBufferSize), static_cast<ssize_t>(kBufferSize));
+    ASSERT_EQ(lseek(fd.get(), 0, SEEK_CUR), static_cast<off_t>(kBufferSize));
+
+    // Reading past the end of the file returns only the data in it.
+    ASSERT_EQ(lseek(fd.get(), 1, SEEK_SET), 1);
+    ASSERT_EQ(read(fd.get(), buf.get(), kBufferSize), static_cast<ssize_t>(kBufferSize - 1));
+    ASSERT_EQ(memcmp(buf.get(), expected.get() + 1, kBufferSize - 1), 0);
+    ASSERT_EQ(lseek(fd.get(), 0, SEEK_CUR), static_cast<off_t>(kBufferSize));
+
+    // Positional operations leave the seek pointer alone.
+    memset(buf.get(), 0, kBufferSize);
+    ASSERT_EQ(pwrite(fd.get(), expected.get(), kBufferSize, kBufferSize),
+              static_cast<ssize_t>(kBufferSize));
+    ASSERT_EQ(pread(fd.get(), buf.get(), kBufferSize, kBufferSize),
+              static_cast<ssize_t>(kBufferSize));
+    ASSERT_EQ(memcmp(buf.get(), expected.get(), kBufferSize), 0);
+    ASSERT_EQ(lseek(fd.get(), 0, SEEK_CUR), static_cast<off_t>(kBufferSize));
+
+    struct stat st;
+    ASSERT_EQ(fstat(fd.get(), &st), 0);
+    ASSERT_EQ(st.st_size, static_cast<off_t>(2 * kBufferSize));
+
+    ASSERT_EQ(close(fd.release()), 0);
+    ASSERT_EQ(unlink(filename), 0);
+
+    END_TEST;
+}
+
 }  // namespace
 
 RUN_FOR_ALL_FILESYSTEMS(rw_tests,
     RUN_TEST_MEDIUM(TestZeroLengthOperations)
     RUN_TEST_MEDIUM(TestOffsetOperations)
+    RUN_TEST_MEDIUM(TestLargeOperations)
 )
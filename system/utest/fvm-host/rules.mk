@@ -44,6 +44,7 @@ MODULE_HOST_LIBS := \
     system/ulib/fvm-host.hostlib \
     system/ulib/fvm.hostlib \
     system/ulib/minfs.hostlib \
+    third_party/ulib/cksum.hostlib \
     system/ulib/pretty.hostlib \
     system/ulib/unittest.hostlib \
     third_party/ulib/lz4.hostlib \
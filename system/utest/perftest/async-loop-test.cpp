@@ -0,0 +1,58 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <fbl/string_printf.h>
+#include <fbl/unique_ptr.h>
+#include <lib/async-loop/cpp/loop.h>
+#include <lib/async/cpp/time.h>
+#include <lib/async/task.h>
+#include <lib/zx/time.h>
+#include <perftest/perftest.h>
+#include <zircon/assert.h>
+
+namespace {
+
+void NoOpHandler(async_dispatcher_t* dispatcher, async_task_t* task, zx_status_t status) {}
+
+// Posts |count| tasks to a loop and then cancels them all, as a service with
+// a deadline per connection does.  The deadlines are far in the future and
+// scrambled, and the tasks are canceled in a different scrambled order, so
+// that neither step can rely on tasks arriving in deadline order.
+bool LoopPostCancelTest(perftest::RepeatState* state, uint32_t count) {
+    state->DeclareStep("post");
+    state->DeclareStep("cancel");
+
+    async::Loop loop(&kAsyncLoopConfigNoAttachToThread);
+    fbl::unique_ptr<async_task_t[]> tasks(new async_task_t[count]);
+    zx::time base = async::Now(loop.dispatcher()) + zx::hour(1);
+
+    while (state->KeepRunning()) {
+        for (uint32_t i = 0; i < count; i++) {
+            zx::time deadline = base + zx::usec((i * 7919u) % count);
+            tasks[i] = async_task_t{{ASYNC_STATE_INIT}, NoOpHandler, deadline.get()};
+            ZX_ASSERT(async_post_task(loop.dispatcher(), &tasks[i]) == ZX_OK);
+        }
+        state->NextStep();
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t index = (i * 104729u) % count;
+            ZX_ASSERT(async_cancel_task(loop.dispatcher(), &tasks[index]) == ZX_OK);
+        }
+    }
+    return true;
+}
+
+void RegisterTests() {
+    static const uint32_t kCounts[] = {
+        100,
+        1000,
+        20000,
+    };
+    for (auto count : kCounts) {
+        auto name = fbl::StringPrintf("AsyncLoop/PostCancel/%utasks", count);
+        perftest::RegisterTest(name.c_str(), LoopPostCancelTest, count);
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+}  // namespace
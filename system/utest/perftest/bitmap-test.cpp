@@ -0,0 +1,54 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <bitmap/raw-bitmap.h>
+#include <bitmap/storage.h>
+#include <fbl/string_printf.h>
+#include <perftest/perftest.h>
+
+namespace {
+
+// Test the time taken to find a run of free bits in a mostly-full bitmap of
+// the given size, as a filesystem allocator does.
+//
+// Every bit is set except for a short run at the end of the bitmap, so a
+// linear scan must visit every word of the bitmap, while a summarized scan
+// can skip over the full words.
+template <typename Storage>
+bool BitmapFindTest(perftest::RepeatState* state, size_t size) {
+    constexpr size_t kRun = 16;
+    bitmap::RawBitmapGeneric<Storage> bitmap;
+    if (bitmap.Reset(size) != ZX_OK ||
+        bitmap.Set(0, size) != ZX_OK ||
+        bitmap.Clear(size - kRun, size) != ZX_OK) {
+        return false;
+    }
+
+    while (state->KeepRunning()) {
+        size_t out;
+        if (bitmap.Find(false, 0, size, kRun, &out) != ZX_OK) {
+            return false;
+        }
+        perftest::DoNotOptimize(out);
+    }
+    return true;
+}
+
+void RegisterTests() {
+    static const size_t kSizesBits[] = {
+        1 << 20,
+        1 << 24,
+    };
+    for (auto size : kSizesBits) {
+        auto name = fbl::StringPrintf("Bitmap/Find/%zubits", size);
+        perftest::RegisterTest(name.c_str(), BitmapFindTest<bitmap::DefaultStorage>, size);
+        name = fbl::StringPrintf("Bitmap/Find/Summary/%zubits", size);
+        perftest::RegisterTest(name.c_str(),
+                               BitmapFindTest<bitmap::SummaryStorage<bitmap::DefaultStorage>>,
+                               size);
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+}  // namespace
@@ -0,0 +1,99 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <threads.h>
+
+#include <atomic>
+
+#include <fbl/string_printf.h>
+#include <perftest/perftest.h>
+#include <zircon/syscalls.h>
+
+namespace {
+
+constexpr uint32_t kMaxThreads = 16;
+
+// Each futex is given its own cache line, so that the threads of the
+// multi-threaded test share nothing in userspace.
+struct alignas(64) PaddedFutex {
+    zx_futex_t value = 0;
+};
+
+// Does one iteration of the work measured by FutexWaitWakeTest: a wait which
+// returns immediately because the futex's value does not match, and a wake
+// with no waiters.
+void FutexWaitWake(zx_futex_t* futex) {
+    ZX_ASSERT(zx_futex_wait(futex, 1, ZX_HANDLE_INVALID, ZX_TIME_INFINITE) ==
+              ZX_ERR_BAD_STATE);
+    ZX_ASSERT(zx_futex_wake(futex, 1) == ZX_OK);
+}
+
+// Measures waking a futex which no thread is waiting on, which is what an
+// uncontended unlock of a futex-based lock does when it cannot tell whether
+// there are waiters.
+bool FutexWakeNoWaitersTest(perftest::RepeatState* state) {
+    zx_futex_t futex = 0;
+    while (state->KeepRunning()) {
+        ZX_ASSERT(zx_futex_wake(&futex, 1) == ZX_OK);
+    }
+    return true;
+}
+
+struct LoopArgs {
+    std::atomic<bool>* done;
+    zx_futex_t* futex;
+};
+
+int FutexWaitWakeLoop(void* arg) {
+    auto* args = static_cast<LoopArgs*>(arg);
+    while (!args->done->load()) {
+        FutexWaitWake(args->futex);
+    }
+    return 0;
+}
+
+// Measures waiting on and waking a futex while |thread_count| - 1 other
+// threads of the same process do the same to their own futexes.  None of the
+// futexes are shared, so this shows how much futex operations on unrelated
+// addresses contend with each other in the kernel.
+bool FutexWaitWakeTest(perftest::RepeatState* state, uint32_t thread_count) {
+    state->DeclareStep("wait");
+    state->DeclareStep("wake");
+
+    PaddedFutex futexes[kMaxThreads];
+    LoopArgs args[kMaxThreads];
+    thrd_t threads[kMaxThreads];
+    std::atomic<bool> done(false);
+    for (uint32_t i = 1; i < thread_count; i++) {
+        args[i] = LoopArgs{&done, &futexes[i].value};
+        ZX_ASSERT(thrd_create(&threads[i], FutexWaitWakeLoop, &args[i]) == thrd_success);
+    }
+
+    zx_futex_t* futex = &futexes[0].value;
+    while (state->KeepRunning()) {
+        ZX_ASSERT(zx_futex_wait(futex, 1, ZX_HANDLE_INVALID, ZX_TIME_INFINITE) ==
+                  ZX_ERR_BAD_STATE);
+        state->NextStep();
+        ZX_ASSERT(zx_futex_wake(futex, 1) == ZX_OK);
+    }
+
+    done.store(true);
+    for (uint32_t i = 1; i < thread_count; i++) {
+        ZX_ASSERT(thrd_join(threads[i], nullptr) == thrd_success);
+    }
+    return true;
+}
+
+void RegisterTests() {
+    perftest::RegisterTest("Futex_WakeNoWaiters", FutexWakeNoWaitersTest);
+
+    static const uint32_t kThreadCounts[] = {1, 2, 4, 8, kMaxThreads};
+    for (uint32_t thread_count : kThreadCounts) {
+        auto name = fbl::StringPrintf("Futex_WaitWake/%uthreads", thread_count);
+        perftest::RegisterTest(name.c_str(), FutexWaitWakeTest, thread_count);
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+}  // namespace
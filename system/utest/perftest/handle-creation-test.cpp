@@ -2,6 +2,12 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <threads.h>
+
+#include <atomic>
+
+#include <fbl/string_printf.h>
+#include <fbl/vector.h>
 #include <lib/zx/channel.h>
 #include <lib/zx/event.h>
 #include <lib/zx/eventpair.h>
@@ -44,6 +50,43 @@ bool EventCreateTest(perftest::RepeatState* state) {
     return true;
 }
 
+int EventCreateLoop(void* arg) {
+    auto* done = static_cast<std::atomic<bool>*>(arg);
+    while (!done->load()) {
+        zx::event handle;
+        ZX_ASSERT(zx::event::create(0, &handle) == ZX_OK);
+    }
+    return 0;
+}
+
+// Measures creating and closing an event while |thread_count| - 1 other
+// threads do the same, which shows how kernel object allocation scales
+// across CPUs.
+bool EventCreateMultiThreadTest(perftest::RepeatState* state, uint32_t thread_count) {
+    state->DeclareStep("create");
+    state->DeclareStep("close");
+
+    std::atomic<bool> done(false);
+    fbl::Vector<thrd_t> threads;
+    for (uint32_t i = 1; i < thread_count; i++) {
+        thrd_t thread;
+        ZX_ASSERT(thrd_create(&thread, EventCreateLoop, &done) == thrd_success);
+        threads.push_back(thread);
+    }
+
+    while (state->KeepRunning()) {
+        zx::event handle;
+        ZX_ASSERT(zx::event::create(0, &handle) == ZX_OK);
+        state->NextStep();
+    }
+
+    done.store(true);
+    for (auto thread : threads) {
+        ZX_ASSERT(thrd_join(thread, nullptr) == thrd_success);
+    }
+    return true;
+}
+
 bool EventPairCreateTest(perftest::RepeatState* state) {
     state->DeclareStep("create");
     state->DeclareStep("close");
@@ -135,6 +178,16 @@ void RegisterTests() {
     perftest::RegisterTest("HandleCreate_Process", ProcessCreateTest);
     perftest::RegisterTest("HandleCreate_Thread", ThreadCreateTest);
     perftest::RegisterTest("HandleCreate_Vmo", VmoCreateTest);
+
+    static const uint32_t kThreadCounts[] = {
+        2,
+        4,
+        8,
+    };
+    for (auto thread_count : kThreadCounts) {
+        auto name = fbl::StringPrintf("HandleCreate_Event/%uthreads", thread_count);
+        perftest::RegisterTest(name.c_str(), EventCreateMultiThreadTest, thread_count);
+    }
 }
 PERFTEST_CTOR(RegisterTests);
 
@@ -4,6 +4,10 @@
 
 #include <threads.h>
 
+#include <atomic>
+
+#include <fbl/string_printf.h>
+#include <fbl/vector.h>
 #include <perftest/perftest.h>
 
 namespace {
@@ -24,8 +28,64 @@ bool MutexLockUnlockTest(perftest::RepeatState* state) {
     return true;
 }
 
+struct ContendedArgs {
+    mtx_t mutex;
+    std::atomic<bool> done{false};
+    // Protected by |mutex|.  Incremented to give the critical section some
+    // work to do.
+    uint64_t counter = 0;
+};
+
+int ContendedLoop(void* arg) {
+    auto* args = static_cast<ContendedArgs*>(arg);
+    while (!args->done.load()) {
+        ZX_ASSERT(mtx_lock(&args->mutex) == thrd_success);
+        args->counter++;
+        ZX_ASSERT(mtx_unlock(&args->mutex) == thrd_success);
+    }
+    return 0;
+}
+
+// Measure the times taken to lock and unlock a C11 mutex while
+// |thread_count| - 1 other threads repeatedly lock and unlock it too.  The
+// critical sections are very short, which is the case that spinning on a
+// contended mutex rather than waiting on its futex is meant to help.
+bool MutexContendedTest(perftest::RepeatState* state, uint32_t thread_count) {
+    state->DeclareStep("lock");
+    state->DeclareStep("unlock");
+
+    ContendedArgs args;
+    ZX_ASSERT(mtx_init(&args.mutex, mtx_plain) == thrd_success);
+    fbl::Vector<thrd_t> threads;
+    for (uint32_t i = 1; i < thread_count; i++) {
+        thrd_t thread;
+        ZX_ASSERT(thrd_create(&thread, ContendedLoop, &args) == thrd_success);
+        threads.push_back(thread);
+    }
+
+    while (state->KeepRunning()) {
+        ZX_ASSERT(mtx_lock(&args.mutex) == thrd_success);
+        args.counter++;
+        state->NextStep();
+        ZX_ASSERT(mtx_unlock(&args.mutex) == thrd_success);
+    }
+
+    args.done.store(true);
+    for (auto thread : threads) {
+        ZX_ASSERT(thrd_join(thread, nullptr) == thrd_success);
+    }
+    mtx_destroy(&args.mutex);
+    return true;
+}
+
 void RegisterTests() {
     perftest::RegisterTest("MutexLockUnlock", MutexLockUnlockTest);
+
+    static const uint32_t kThreadCounts[] = {2, 4, 8};
+    for (uint32_t thread_count : kThreadCounts) {
+        auto name = fbl::StringPrintf("MutexContended/%uthreads", thread_count);
+        perftest::RegisterTest(name.c_str(), MutexContendedTest, thread_count);
+    }
 }
 PERFTEST_CTOR(RegisterTests);
 
@@ -0,0 +1,78 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <fbl/string_printf.h>
+#include <lib/zx/port.h>
+#include <perftest/perftest.h>
+#include <zircon/assert.h>
+
+namespace {
+
+constexpr size_t kMaxBatch = 16;
+
+// Queue |count| packets on a port, then dequeue them with zx_port_wait(),
+// one packet per syscall.
+bool PortWaitTest(perftest::RepeatState* state, size_t count) {
+    state->DeclareStep("queue");
+    state->DeclareStep("wait");
+
+    zx::port port;
+    ZX_ASSERT(zx::port::create(0, &port) == ZX_OK);
+    const zx_port_packet_t in = {};
+
+    while (state->KeepRunning()) {
+        for (size_t i = 0; i < count; i++) {
+            ZX_ASSERT(port.queue(&in) == ZX_OK);
+        }
+        state->NextStep();
+        for (size_t i = 0; i < count; i++) {
+            zx_port_packet_t out;
+            ZX_ASSERT(port.wait(zx::time::infinite(), &out) == ZX_OK);
+        }
+    }
+    return true;
+}
+
+// Queue |count| packets on a port, then dequeue them with zx_port_wait_many(),
+// up to kMaxBatch packets per syscall.
+bool PortWaitManyTest(perftest::RepeatState* state, size_t count) {
+    state->DeclareStep("queue");
+    state->DeclareStep("wait");
+
+    zx::port port;
+    ZX_ASSERT(zx::port::create(0, &port) == ZX_OK);
+    const zx_port_packet_t in = {};
+
+    while (state->KeepRunning()) {
+        for (size_t i = 0; i < count; i++) {
+            ZX_ASSERT(port.queue(&in) == ZX_OK);
+        }
+        state->NextStep();
+        size_t remaining = count;
+        while (remaining > 0) {
+            zx_port_packet_t out[kMaxBatch];
+            size_t actual;
+            ZX_ASSERT(port.wait_many(zx::time::infinite(), out, kMaxBatch, &actual) == ZX_OK);
+            remaining -= actual;
+        }
+    }
+    return true;
+}
+
+void RegisterTests() {
+    static const size_t kCounts[] = {
+        1,
+        16,
+        64,
+    };
+    for (auto count : kCounts) {
+        auto name = fbl::StringPrintf("Port/Wait/%zupackets", count);
+        perftest::RegisterTest(name.c_str(), PortWaitTest, count);
+        name = fbl::StringPrintf("Port/WaitMany/%zupackets", count);
+        perftest::RegisterTest(name.c_str(), PortWaitManyTest, count);
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+}  // namespace
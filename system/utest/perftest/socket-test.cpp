@@ -0,0 +1,99 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string.h>
+#include <threads.h>
+
+#include <fbl/array.h>
+#include <fbl/string_printf.h>
+#include <perftest/perftest.h>
+#include <zircon/assert.h>
+#include <zircon/syscalls.h>
+
+namespace {
+
+// The number of bytes written through the socket in each run.
+constexpr size_t kBytesPerRun = 1024 * 1024;
+
+struct ReaderArgs {
+    zx_handle_t socket;
+    size_t chunk;
+};
+
+// Reads from the socket in |chunk| byte reads until the writer closes its end.
+int ReadLoop(void* arg) {
+    auto* args = static_cast<ReaderArgs*>(arg);
+    fbl::Array<char> buffer(new char[args->chunk], args->chunk);
+    while (true) {
+        size_t actual;
+        zx_status_t status = zx_socket_read(args->socket, 0, buffer.get(), args->chunk, &actual);
+        if (status == ZX_ERR_SHOULD_WAIT) {
+            ZX_ASSERT(zx_object_wait_one(args->socket, ZX_SOCKET_READABLE | ZX_SOCKET_PEER_CLOSED,
+                                         ZX_TIME_INFINITE, nullptr) == ZX_OK);
+            continue;
+        }
+        if (status == ZX_ERR_PEER_CLOSED) {
+            return 0;
+        }
+        ZX_ASSERT(status == ZX_OK);
+    }
+}
+
+// Measures writing kBytesPerRun bytes to a socket in |chunk| byte writes
+// while another thread reads them, which lets the receive buffer grow to
+// match the reader.
+bool SocketThroughputTest(perftest::RepeatState* state, uint32_t options, size_t chunk) {
+    state->SetBytesProcessedPerRun(kBytesPerRun);
+
+    zx_handle_t socket[2];
+    ZX_ASSERT(zx_socket_create(options, &socket[0], &socket[1]) == ZX_OK);
+
+    ReaderArgs args = {socket[1], chunk};
+    thrd_t thread;
+    ZX_ASSERT(thrd_create(&thread, ReadLoop, &args) == thrd_success);
+
+    fbl::Array<char> buffer(new char[chunk], chunk);
+    memset(buffer.get(), 0xa5, chunk);
+    while (state->KeepRunning()) {
+        size_t sent = 0;
+        while (sent < kBytesPerRun) {
+            size_t actual;
+            zx_status_t status = zx_socket_write(socket[0], 0, buffer.get(), chunk, &actual);
+            if (status == ZX_ERR_SHOULD_WAIT) {
+                ZX_ASSERT(zx_object_wait_one(socket[0], ZX_SOCKET_WRITABLE, ZX_TIME_INFINITE,
+                                             nullptr) == ZX_OK);
+                continue;
+            }
+            ZX_ASSERT(status == ZX_OK);
+            sent += actual;
+        }
+    }
+
+    ZX_ASSERT(zx_handle_close(socket[0]) == ZX_OK);
+    ZX_ASSERT(thrd_join(thread, nullptr) == thrd_success);
+    ZX_ASSERT(zx_handle_close(socket[1]) == ZX_OK);
+    return true;
+}
+
+void RegisterTests() {
+    static const size_t kStreamChunks[] = {
+        4096,
+        65536,
+    };
+    for (auto chunk : kStreamChunks) {
+        auto name = fbl::StringPrintf("Socket/Stream/%zubytes", chunk);
+        perftest::RegisterTest(name.c_str(), SocketThroughputTest, 0u, chunk);
+    }
+    static const size_t kDatagramChunks[] = {
+        512,
+        8192,
+    };
+    for (auto chunk : kDatagramChunks) {
+        auto name = fbl::StringPrintf("Socket/Datagram/%zubytes", chunk);
+        perftest::RegisterTest(name.c_str(), SocketThroughputTest, ZX_SOCKET_DATAGRAM, chunk);
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+}  // namespace
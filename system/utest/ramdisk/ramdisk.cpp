@@ -821,6 +821,105 @@ bool RamdiskTestFifoMultipleVmoMultithreaded(void) {
     END_TEST;
 }
 
+bool RamdiskTestFifoMultipleQueues(void) {
+    BEGIN_TEST;
+    const size_t kBlockSize = PAGE_SIZE;
+    fbl::unique_ptr<RamdiskTest> ramdisk;
+    ASSERT_TRUE(RamdiskTest::Create(kBlockSize, 1 << 18, &ramdisk));
+
+    // Additional queues can only be added to a running server.
+    zx::fifo fifo;
+    ssize_t expected = sizeof(fifo);
+    ASSERT_LT(ioctl_block_get_queue_fifo(ramdisk->block_fd(), fifo.reset_and_get_address()),
+              0, "Added a queue without a server");
+
+    fbl::AllocChecker ac;
+    fbl::Array<block_client::Client> clients(new (&ac) block_client::Client[BLOCK_MAX_QUEUES](),
+                                             BLOCK_MAX_QUEUES);
+    ASSERT_TRUE(ac.check());
+    ASSERT_EQ(ioctl_block_get_fifos(ramdisk->block_fd(), fifo.reset_and_get_address()),
+              expected, "Failed to get FIFO");
+    ASSERT_EQ(block_client::Client::Create(std::move(fifo), &clients[0]), ZX_OK);
+    for (size_t i = 1; i < clients.size(); i++) {
+        ASSERT_EQ(ioctl_block_get_queue_fifo(ramdisk->block_fd(),
+                                             fifo.reset_and_get_address()),
+                  expected, "Failed to get queue FIFO");
+        ASSERT_EQ(block_client::Client::Create(std::move(fifo), &clients[i]), ZX_OK);
+    }
+    ASSERT_LT(ioctl_block_get_queue_fifo(ramdisk->block_fd(), fifo.reset_and_get_address()),
+              0, "Exceeded the maximum number of queues");
+
+    // VMOs are shared by all queues: data written through one queue can be read
+    // back through another.
+    TestVmoObject obj;
+    ASSERT_TRUE(create_vmo_helper(ramdisk->block_fd(), &obj, kBlockSize));
+    groupid_t group = 0;
+    for (size_t i = 0; i < clients.size(); i++) {
+        const size_t next = (i + 1) % clients.size();
+        ASSERT_TRUE(write_striped_vmo_helper(&clients[i], &obj, i, clients.size(), group,
+                                             kBlockSize));
+        ASSERT_TRUE(read_striped_vmo_helper(&clients[next], &obj, i, clients.size(), group,
+                                            kBlockSize));
+    }
+    ASSERT_TRUE(close_vmo_helper(&clients[clients.size() - 1], &obj, group));
+
+    END_TEST;
+}
+
+bool RamdiskTestFifoSchedulerMerge(void) {
+    BEGIN_TEST;
+    const size_t kBlockSize = PAGE_SIZE;
+    fbl::unique_ptr<RamdiskTest> ramdisk;
+    ASSERT_TRUE(RamdiskTest::Create(kBlockSize, 1 << 18, &ramdisk));
+
+    zx::fifo fifo;
+    ssize_t expected = sizeof(fifo);
+    ASSERT_EQ(ioctl_block_get_fifos(ramdisk->block_fd(), fifo.reset_and_get_address()),
+              expected, "Failed to get FIFO");
+    block_client::Client client;
+    ASSERT_EQ(block_client::Client::Create(std::move(fifo), &client), ZX_OK);
+
+    constexpr size_t kRequestCount = 16;
+    TestVmoObject obj;
+    ASSERT_TRUE(create_vmo_helper(ramdisk->block_fd(), &obj, kBlockSize * kRequestCount));
+
+    // Write the blocks of the VMO in reverse order, so that the scheduler must
+    // sort the requests before it can merge them.
+    block_fifo_request_t requests[kRequestCount];
+    for (size_t i = 0; i < kRequestCount; i++) {
+        const size_t block = kRequestCount - 1 - i;
+        requests[i].group      = 0;
+        requests[i].vmoid      = obj.vmoid;
+        requests[i].opcode     = BLOCKIO_WRITE;
+        requests[i].length     = 1;
+        requests[i].vmo_offset = block;
+        requests[i].dev_offset = block;
+    }
+    ASSERT_EQ(client.Transaction(requests, kRequestCount), ZX_OK);
+
+    bool clear = true;
+    block_sched_stats_t stats;
+    expected = sizeof(stats);
+    ASSERT_EQ(ioctl_block_get_sched_stats(ramdisk->block_fd(), &clear, &stats), expected);
+    ASSERT_EQ(stats.total_requests, kRequestCount);
+    ASSERT_EQ(stats.merged_requests, kRequestCount - 1);
+    ASSERT_EQ(stats.total_ops, 1);
+    ASSERT_EQ(ioctl_block_get_sched_stats(ramdisk->block_fd(), &clear, &stats), expected);
+    ASSERT_EQ(stats.total_requests, 0);
+
+    // The merged write must have written every block from the right place.
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<uint8_t[]> out(new (&ac) uint8_t[kBlockSize * kRequestCount]);
+    ASSERT_TRUE(ac.check());
+    ASSERT_EQ(lseek(ramdisk->block_fd(), 0, SEEK_SET), 0);
+    ASSERT_EQ(read(ramdisk->block_fd(), out.get(), kBlockSize * kRequestCount),
+              static_cast<ssize_t>(kBlockSize * kRequestCount));
+    ASSERT_EQ(memcmp(out.get(), obj.buf.get(), kBlockSize * kRequestCount), 0);
+
+    ASSERT_TRUE(close_vmo_helper(&client, &obj, 0));
+    END_TEST;
+}
+
 bool RamdiskTestFifoUncleanShutdown(void) {
     BEGIN_TEST;
     // Set up the ramdisk
@@ -1530,6 +1629,8 @@ RUN_TEST_SMALL(RamdiskTestFifoBasic)
 RUN_TEST_SMALL(RamdiskTestFifoNoGroup)
 RUN_TEST_SMALL(RamdiskTestFifoMultipleVmo)
 RUN_TEST_SMALL(RamdiskTestFifoMultipleVmoMultithreaded)
+RUN_TEST_SMALL(RamdiskTestFifoMultipleQueues)
+RUN_TEST_SMALL(RamdiskTestFifoSchedulerMerge)
 // TODO(smklein): Test ops across different vmos
 RUN_TEST_SMALL(RamdiskTestFifoUncleanShutdown)
 RUN_TEST_SMALL(RamdiskTestFifoLargeOpsCount)
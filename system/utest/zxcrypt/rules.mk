@@ -11,6 +11,7 @@ MODULE_TYPE := usertest
 MODULE_SRCS += \
     $(LOCAL_DIR)/main.c \
     $(LOCAL_DIR)/test-device.cpp \
+    $(LOCAL_DIR)/throughput.cpp \
     $(LOCAL_DIR)/volume.cpp \
     $(LOCAL_DIR)/zxcrypt.cpp \
 
@@ -132,8 +132,12 @@ bool TestDevice::Create(size_t device_size, size_t block_size, bool fvm) {
 }
 
 bool TestDevice::Bind(Volume::Version version, bool fvm) {
+    return Bind(version, fvm, kDeviceSize, kBlockSize);
+}
+
+bool TestDevice::Bind(Volume::Version version, bool fvm, size_t device_size, size_t block_size) {
     BEGIN_HELPER;
-    ASSERT_TRUE(Create(kDeviceSize, kBlockSize, fvm));
+    ASSERT_TRUE(Create(device_size, block_size, fvm));
     ASSERT_OK(Volume::Create(parent(), key_));
     ASSERT_TRUE(Connect());
     END_HELPER;
@@ -329,7 +333,7 @@ bool TestDevice::CreateFvmPart(size_t device_size, size_t block_size) {
     // Allocate a FVM partition with the last slice unallocated.
     alloc_req_t req;
     memset(&req, 0, sizeof(alloc_req_t));
-    req.slice_count = (kDeviceSize / FVM_BLOCK_SIZE) - 1;
+    req.slice_count = (device_size / FVM_BLOCK_SIZE) - 1;
     memcpy(req.type, zxcrypt_magic, sizeof(zxcrypt_magic));
     for (uint8_t i = 0; i < GUID_LEN; ++i) {
         req.guid[i] = i;
@@ -78,6 +78,9 @@ public:
     // Returns a reference to the root key generated for this device.
     const crypto::Secret& key() const { return key_; }
 
+    // Returns the VMO attached to the zxcrypt volume for use with |block_fifo_txn|.
+    const zx::vmo& vmo() const { return vmo_; }
+
     // API WRAPPERS
 
     // These methods mirror the POSIX API, except that the file descriptors and buffers are
@@ -128,8 +131,11 @@ public:
     bool Create(size_t device_size, size_t block_size, bool fvm);
 
     // Test helper that generates a key and creates a device according to |version| and |fvm|.  It
-    // sets up the device as a zxcrypt volume and binds to it.
+    // sets up the device as a zxcrypt volume and binds to it.  The second variant creates a device
+    // of at least |device_size| bytes in blocks of |block_size| bytes, rather than the default
+    // geometry.
     bool Bind(Volume::Version version, bool fvm);
+    bool Bind(Volume::Version version, bool fvm, size_t device_size, size_t block_size);
 
     // Test helper that rebinds the ramdisk and its children.
     bool Rebind();
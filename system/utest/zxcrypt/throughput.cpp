@@ -0,0 +1,124 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fbl/algorithm.h>
+#include <fbl/alloc_checker.h>
+#include <fbl/unique_ptr.h>
+#include <lib/zx/time.h>
+#include <unittest/unittest.h>
+#include <zircon/device/block.h>
+#include <zircon/types.h>
+#include <zxcrypt/volume.h>
+
+#include "test-device.h"
+
+namespace zxcrypt {
+namespace testing {
+namespace {
+
+// See test-device.h; the following macros allow reusing tests for each of the supported versions.
+#define EACH_PARAM(OP, Test) OP(Test, Volume, AES256_XTS_SHA256)
+
+// Geometry of the device used to measure throughput.  Requests of |kBenchRequestSize| bytes are
+// large enough for the device to split them between its workers.
+const size_t kBenchDeviceSize = 8 * 1024 * 1024;
+const size_t kBenchBlockSize = 4096;
+const size_t kBenchRequestSize = 256 * 1024;
+
+// Returns the throughput in MB/s of transferring |len| bytes between |start| and now.
+double Throughput(size_t len, zx::time start) {
+    zx::duration elapsed = zx::clock::get_monotonic() - start;
+    return static_cast<double>(len) / static_cast<double>(elapsed.to_usecs());
+}
+
+// Sends the |num| |requests| with the given |opcode| over the block fifo, |depth| at a time.
+bool SendRequests(TestDevice* device, block_fifo_request_t* requests, size_t num, uint16_t opcode,
+                  size_t depth) {
+    BEGIN_HELPER;
+    for (size_t i = 0; i < num; ++i) {
+        requests[i].opcode = opcode;
+    }
+    for (size_t i = 0; i < num; i += depth) {
+        ASSERT_OK(device->block_fifo_txn(&requests[i], fbl::min(depth, num - i)));
+    }
+    END_HELPER;
+}
+
+// Writes the whole device and reads it back with |depth| requests in flight at a time, checks that
+// the data is unchanged, and prints the throughput of each.  With more requests in flight, more of
+// the device's workers are busy at once.
+bool MeasureThroughput(TestDevice* device, size_t depth) {
+    BEGIN_HELPER;
+
+    size_t len = device->size();
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<uint8_t[]> to_write(new (&ac) uint8_t[len]);
+    ASSERT_TRUE(ac.check());
+    fbl::unique_ptr<uint8_t[]> as_read(new (&ac) uint8_t[len]);
+    ASSERT_TRUE(ac.check());
+    for (size_t i = 0; i < len; ++i) {
+        to_write[i] = static_cast<uint8_t>(rand());
+    }
+    memset(as_read.get(), 0, len);
+
+    size_t blks_per_req = kBenchRequestSize / device->block_size();
+    size_t num = (device->block_count() + blks_per_req - 1) / blks_per_req;
+    fbl::unique_ptr<block_fifo_request_t[]> requests(new (&ac) block_fifo_request_t[num]);
+    ASSERT_TRUE(ac.check());
+    for (size_t i = 0; i < num; ++i) {
+        size_t off = i * blks_per_req;
+        requests[i].length = static_cast<uint32_t>(fbl::min(blks_per_req,
+                                                            device->block_count() - off));
+        requests[i].dev_offset = off;
+        requests[i].vmo_offset = off;
+    }
+
+    ASSERT_OK(device->vmo().write(to_write.get(), 0, len));
+    zx::time start = zx::clock::get_monotonic();
+    ASSERT_TRUE(SendRequests(device, requests.get(), num, BLOCKIO_WRITE, depth));
+    double write_mbps = Throughput(len, start);
+
+    ASSERT_OK(device->vmo().write(as_read.get(), 0, len));
+    start = zx::clock::get_monotonic();
+    ASSERT_TRUE(SendRequests(device, requests.get(), num, BLOCKIO_READ, depth));
+    double read_mbps = Throughput(len, start);
+
+    ASSERT_OK(device->vmo().read(as_read.get(), 0, len));
+    ASSERT_EQ(memcmp(as_read.get(), to_write.get(), len), 0);
+
+    printf("\n  %zu request(s) of %zu KB in flight: write %.1f MB/s, read %.1f MB/s", depth,
+           kBenchRequestSize / 1024, write_mbps, read_mbps);
+
+    END_HELPER;
+}
+
+bool TestThroughput(Volume::Version version) {
+    BEGIN_TEST;
+
+    TestDevice device;
+    ASSERT_TRUE(device.Bind(version, false /* not FVM */, kBenchDeviceSize, kBenchBlockSize));
+
+    static const size_t kDepths[] = {1, 2, 4, 8, 16};
+    for (size_t depth : kDepths) {
+        EXPECT_TRUE(MeasureThroughput(&device, depth));
+    }
+    printf("\n");
+
+    END_TEST;
+}
+DEFINE_EACH(TestThroughput);
+
+BEGIN_TEST_CASE(ZxcryptThroughput)
+RUN_EACH(TestThroughput)
+END_TEST_CASE(ZxcryptThroughput)
+
+} // namespace
+} // namespace testing
+} // namespace zxcrypt